@@ -0,0 +1,505 @@
+#include "ArUcoDetectorSession.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace HoloLens2CV
+{
+	bool CameraIntrinsics::operator==(const CameraIntrinsics& other) const
+	{
+		return fx == other.fx && fy == other.fy &&
+			cx == other.cx && cy == other.cy &&
+			k1 == other.k1 && k2 == other.k2 && k3 == other.k3 &&
+			p1 == other.p1 && p2 == other.p2;
+	}
+
+	bool DetectionSettings::operator==(const DetectionSettings& other) const
+	{
+		return thresholdWindowMin == other.thresholdWindowMin && thresholdWindowMax == other.thresholdWindowMax &&
+			thresholdWindowStep == other.thresholdWindowStep && thresholdConstant == other.thresholdConstant &&
+			minPerimeterRate == other.minPerimeterRate && maxPerimeterRate == other.maxPerimeterRate &&
+			polygonAccuracyRate == other.polygonAccuracyRate && cornerRefinement == other.cornerRefinement;
+	}
+
+	cv::aruco::DetectorParameters DetectionSettings::ToDetectorParameters() const
+	{
+		cv::aruco::DetectorParameters parameters;
+		parameters.adaptiveThreshWinSizeMin = std::max(3, thresholdWindowMin);
+		parameters.adaptiveThreshWinSizeMax = std::max(parameters.adaptiveThreshWinSizeMin, thresholdWindowMax);
+		parameters.adaptiveThreshWinSizeStep = std::max(1, thresholdWindowStep);
+		parameters.adaptiveThreshConstant = thresholdConstant;
+		parameters.minMarkerPerimeterRate = std::max(0.0, minPerimeterRate);
+		parameters.maxMarkerPerimeterRate = std::max(parameters.minMarkerPerimeterRate, maxPerimeterRate);
+		parameters.polygonalApproxAccuracyRate = std::max(0.0, polygonAccuracyRate);
+		parameters.cornerRefinementMethod = int(cornerRefinement) >= 0 && int(cornerRefinement) <= 3 ? int(cornerRefinement) : 0;
+		return parameters;
+	}
+
+	void ArUcoDetectorSession::Configure(int dictId, float markerLength)
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+
+		if (!m_hasDictionary || dictId != m_dictId)
+		{
+			// https://github.com/opencv/opencv_contrib/blob/4.x/modules/aruco/samples/detect_markers.cpp
+			// aruco dictionary from id
+			m_detector = cv::aruco::ArucoDetector(
+				cv::aruco::getPredefinedDictionary(cv::aruco::PredefinedDictionaryType(dictId)),
+				m_detection.ToDetectorParameters());
+			m_dictId = dictId;
+			m_hasDictionary = true;
+			m_previous.clear();
+			m_estimated.clear();
+		}
+
+		if (m_objPoints.empty() || markerLength != m_markerLength)
+		{
+			// https://stackoverflow.com/questions/76802576/how-to-estimate-pose-of-single-marker-in-opencv-python-4-8-0
+			// set marker corner points, markerLength is the printed marker's side in meters
+			m_objPoints.create(4, 1, CV_32FC3);
+			m_objPoints.ptr<cv::Vec3f>(0)[0] = cv::Vec3f(-markerLength / 2.f, markerLength / 2.f, 0);
+			m_objPoints.ptr<cv::Vec3f>(0)[1] = cv::Vec3f(markerLength / 2.f, markerLength / 2.f, 0);
+			m_objPoints.ptr<cv::Vec3f>(0)[2] = cv::Vec3f(markerLength / 2.f, -markerLength / 2.f, 0);
+			m_objPoints.ptr<cv::Vec3f>(0)[3] = cv::Vec3f(-markerLength / 2.f, -markerLength / 2.f, 0);
+			m_markerLength = markerLength;
+			m_previous.clear();
+			m_estimated.clear();
+		}
+	}
+
+	void ArUcoDetectorSession::SetCameraIntrinsics(const CameraIntrinsics& intrinsics)
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+
+		if (m_hasIntrinsics && intrinsics == m_intrinsics)
+		{
+			return;
+		}
+
+		// camera intrinsic parameters for aruco based pose estimation (camera matrix)
+		m_cameraMatrix = cv::Mat(3, 3, CV_64F, cv::Scalar(0));
+		m_cameraMatrix.at<double>(0, 0) = intrinsics.fx;
+		m_cameraMatrix.at<double>(0, 2) = intrinsics.cx;
+		m_cameraMatrix.at<double>(1, 1) = intrinsics.fy;
+		m_cameraMatrix.at<double>(1, 2) = intrinsics.cy;
+		m_cameraMatrix.at<double>(2, 2) = 1.0;
+
+		// camera distortion matrix for aruco based pose estimation
+		m_distortionCoefficients = cv::Mat(1, 5, CV_64F);
+		m_distortionCoefficients.at<double>(0, 0) = intrinsics.k1;
+		m_distortionCoefficients.at<double>(0, 1) = intrinsics.k2;
+		m_distortionCoefficients.at<double>(0, 2) = intrinsics.p1;
+		m_distortionCoefficients.at<double>(0, 3) = intrinsics.p2;
+		m_distortionCoefficients.at<double>(0, 4) = intrinsics.k3;
+
+		m_intrinsics = intrinsics;
+		m_hasIntrinsics = true;
+		m_undistortion.Reset();
+		m_normalizedCameraMatrix = cv::Mat::eye(3, 3, CV_64F);
+		m_previous.clear();
+		m_estimated.clear();
+	}
+
+	void ArUcoDetectorSession::ConfigureDetection(const DetectionSettings& settings)
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		if (settings == m_detection)
+		{
+			return;
+		}
+		m_detection = settings;
+		if (m_hasDictionary)
+		{
+			m_detector.setDetectorParameters(m_detection.ToDetectorParameters());
+		}
+	}
+
+	DetectionSettings ArUcoDetectorSession::GetDetectionSettings() const
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		return m_detection;
+	}
+
+	bool ArUcoDetectorSession::IsConfigured() const
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		return m_hasDictionary && m_hasIntrinsics;
+	}
+
+	void ArUcoDetectorSession::ConfigureTracking(const TrackingSettings& settings)
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		m_tracking = settings;
+		m_tracking.reacquireInterval = std::max(1, settings.reacquireInterval);
+		m_previous.clear();
+		m_framesSinceFullScan = 0;
+	}
+
+	void ArUcoDetectorSession::SetPyramidLevel(int level)
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		m_pyramidLevel = std::min(std::max(level, 0), kMaxPyramidLevel);
+	}
+
+	int ArUcoDetectorSession::GetPyramidLevel() const
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		return m_pyramidLevel;
+	}
+
+	void ArUcoDetectorSession::ConfigurePose(const PoseSettings& settings)
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		m_pose = settings;
+	}
+
+	TrackingStats ArUcoDetectorSession::GetTrackingStats() const
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		return m_trackingStats;
+	}
+
+	void ArUcoDetectorSession::ResetTrackingStats()
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		m_trackingStats = TrackingStats();
+	}
+
+	void ArUcoDetectorSession::SetLatencies(StageLatencies* latencies)
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		m_latencies = latencies;
+	}
+
+	void ArUcoDetectorSession::Process(const cv::Mat& gray, std::vector<MarkerPose>& markers, const cv::Matx44d* cameraToWorld)
+	{
+		markers.clear();
+
+		std::lock_guard<std::mutex> l(m_mutex);
+		if (!m_hasDictionary || !m_hasIntrinsics)
+		{
+			return;
+		}
+
+		// camera motion since the previous frame, maps previous camera coordinates to current ones
+		cv::Matx44d motion;
+		bool hasMotion = false;
+		if (cameraToWorld)
+		{
+			if (m_hasCameraToWorld)
+			{
+				motion = cameraToWorld->inv() * m_lastCameraToWorld;
+				hasMotion = true;
+			}
+			m_lastCameraToWorld = *cameraToWorld;
+			m_hasCameraToWorld = true;
+		}
+
+		// detect markers, inside the tracked regions when possible
+		auto t1 = std::chrono::steady_clock::now();
+		{
+			TraceScope trace("detect");
+			bool regionScan = false;
+			if (m_tracking.enabled && !m_previous.empty() && m_framesSinceFullScan + 1 < m_tracking.reacquireInterval)
+			{
+				regionScan = DetectInRegions(gray, hasMotion ? &motion : nullptr);
+				if (!regionScan)
+				{
+					m_trackingStats.lost++;
+				}
+			}
+			if (regionScan)
+			{
+				m_framesSinceFullScan++;
+				m_trackingStats.regionScans++;
+			}
+			else
+			{
+				DetectMarkers(gray, m_corners, m_ids);
+				m_framesSinceFullScan = 0;
+				m_trackingStats.fullScans++;
+			}
+		}
+		if (m_latencies)
+		{
+			m_latencies->Record(LatencyStage::Detection, std::chrono::steady_clock::now() - t1);
+		}
+
+		// calculate pose for each marker
+		markers.resize(m_ids.size());
+		for (size_t i = 0; i < m_ids.size(); i++)
+		{
+			MarkerPose& marker = markers[i];
+			marker.id = m_ids[i];
+			marker.camera = m_camera;
+			std::copy(m_corners[i].begin(), m_corners[i].end(), marker.corners.begin());
+		}
+
+		// compiled once per intrinsics & image size
+		if (m_pose.undistortionTable && (!m_undistortion.IsBuilt() || m_undistortion.ImageSize() != gray.size()))
+		{
+			m_undistortion.Build(m_cameraMatrix, m_distortionCoefficients, gray.size());
+		}
+		ScopedLatency pnp(m_latencies, LatencyStage::Pnp);
+		TraceScope trace("pnp");
+		SolvePoses(markers, m_previous);
+	}
+
+	void ArUcoDetectorSession::Undistort(const cv::Mat& gray, cv::Mat& undistorted)
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		if (!m_hasIntrinsics)
+		{
+			undistorted = gray.clone();
+			return;
+		}
+		if (!m_undistortion.IsBuilt() || m_undistortion.ImageSize() != gray.size())
+		{
+			m_undistortion.Build(m_cameraMatrix, m_distortionCoefficients, gray.size());
+		}
+		m_undistortion.Undistort(gray, undistorted);
+	}
+
+	float ArUcoDetectorSession::ReprojectionError(const MarkerPose& marker) const
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		if (!m_hasDictionary || !m_hasIntrinsics)
+		{
+			return -1.f;
+		}
+		std::vector<cv::Point2f> projected;
+		cv::projectPoints(m_objPoints, marker.rvec, marker.tvec, m_cameraMatrix, m_distortionCoefficients, projected);
+		double squared = 0.0;
+		for (size_t c = 0; c < projected.size() && c < marker.corners.size(); c++)
+		{
+			cv::Point2f d = projected[c] - marker.corners[c];
+			squared += double(d.x) * d.x + double(d.y) * d.y;
+		}
+		return float(std::sqrt(squared / double(marker.corners.size())));
+	}
+
+	void ArUcoDetectorSession::EstimatePoses(std::vector<MarkerPose>& markers, const cv::Size& imageSize)
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		if (!m_hasDictionary || !m_hasIntrinsics)
+		{
+			return;
+		}
+		if (m_pose.undistortionTable && imageSize.area() > 0 && (!m_undistortion.IsBuilt() || m_undistortion.ImageSize() != imageSize))
+		{
+			m_undistortion.Build(m_cameraMatrix, m_distortionCoefficients, imageSize);
+		}
+		SolvePoses(markers, m_estimated);
+	}
+
+	void ArUcoDetectorSession::SolvePoses(std::vector<MarkerPose>& markers, std::vector<MarkerPose>& previous)
+	{
+		// previous pose of the same marker as extrinsic guess, the closest one if the id is seen twice
+		m_guesses.assign(markers.size(), -1);
+		if (m_pose.warmStart)
+		{
+			for (size_t i = 0; i < markers.size(); i++)
+			{
+				float best = std::numeric_limits<float>::max();
+				for (size_t j = 0; j < previous.size(); j++)
+				{
+					if (previous[j].id != markers[i].id)
+					{
+						continue;
+					}
+					cv::Point2f d = previous[j].corners[0] - markers[i].corners[0];
+					if (d.dot(d) < best)
+					{
+						best = d.dot(d);
+						m_guesses[i] = int(j);
+					}
+				}
+			}
+		}
+
+		// table lookups replace the undistortion inside solvePnP, which then works on normalized corners
+		const bool normalized = m_pose.undistortionTable && m_undistortion.IsBuilt();
+		cv::Mat cameraMatrix = normalized ? m_normalizedCameraMatrix : m_cameraMatrix;
+		cv::Mat distortionCoefficients = normalized ? cv::Mat() : m_distortionCoefficients;
+
+		auto solve = [&](const cv::Range& range) {
+			std::array<cv::Point2f, 4> corners;
+			for (int i = range.start; i < range.end; i++)
+			{
+				MarkerPose& marker = markers[i];
+				for (int c = 0; c < 4; c++)
+				{
+					corners[c] = normalized ? m_undistortion.Normalize(marker.corners[c]) : marker.corners[c];
+				}
+
+				if (m_guesses[i] >= 0)
+				{
+					// refine from where the marker was, converges in a few iterations
+					marker.rvec = previous[m_guesses[i]].rvec;
+					marker.tvec = previous[m_guesses[i]].tvec;
+					cv::solvePnP(m_objPoints, corners, cameraMatrix, distortionCoefficients, marker.rvec, marker.tvec,
+						true, cv::SOLVEPNP_ITERATIVE);
+				}
+				else
+				{
+					// IPPE_SQUARE expects the corner order of m_objPoints, which is the aruco order
+					int flags = m_pose.solver == PoseSolver::IppeSquare ? cv::SOLVEPNP_IPPE_SQUARE : cv::SOLVEPNP_ITERATIVE;
+					cv::solvePnP(m_objPoints, corners, cameraMatrix, distortionCoefficients, marker.rvec, marker.tvec,
+						false, flags);
+				}
+			}
+		};
+
+		// a thread pool round trip only pays off with many markers
+		int count = int(markers.size());
+		if (m_pose.parallelThreshold > 0 && count >= m_pose.parallelThreshold)
+		{
+			cv::parallel_for_(cv::Range(0, count), solve);
+		}
+		else
+		{
+			solve(cv::Range(0, count));
+		}
+
+		previous = markers;
+	}
+
+	void ArUcoDetectorSession::DetectMarkers(const cv::Mat& image, std::vector<std::vector<cv::Point2f>>& corners, std::vector<int>& ids)
+	{
+		if (m_pyramidLevel == 0)
+		{
+			m_detector.detectMarkers(image, corners, ids, m_rejected);
+			return;
+		}
+
+		// thresholding & contours run on the downsampled level only
+		m_pyramid[0] = image;
+		for (int level = 1; level <= m_pyramidLevel; level++)
+		{
+			cv::pyrDown(m_pyramid[level - 1], m_pyramid[level]);
+		}
+		m_detector.detectMarkers(m_pyramid[m_pyramidLevel], corners, ids, m_rejected);
+		m_pyramid[0] = cv::Mat();
+		if (ids.empty())
+		{
+			return;
+		}
+
+		// back to full resolution pixel centers, then refine within one coarse pixel
+		const float scale = float(1 << m_pyramidLevel);
+		const int window = (1 << m_pyramidLevel) + 1;
+		for (std::vector<cv::Point2f>& marker : corners)
+		{
+			for (cv::Point2f& corner : marker)
+			{
+				corner.x = (corner.x + 0.5f) * scale - 0.5f;
+				corner.y = (corner.y + 0.5f) * scale - 0.5f;
+			}
+			cv::cornerSubPix(image, marker, cv::Size(window, window), cv::Size(-1, -1),
+				cv::TermCriteria(cv::TermCriteria::COUNT | cv::TermCriteria::EPS, 30, 0.01));
+		}
+	}
+
+	bool ArUcoDetectorSession::DetectInRegions(const cv::Mat& gray, const cv::Matx44d* motion)
+	{
+		if (!PredictRegions(gray.size(), motion))
+		{
+			return false;
+		}
+
+		m_ids.clear();
+		m_corners.clear();
+		for (const cv::Rect& region : m_regions)
+		{
+			// the submatrix shares the image data, corners are found relative to the region
+			DetectMarkers(gray(region), m_regionCorners, m_regionIds);
+			for (size_t i = 0; i < m_regionIds.size(); i++)
+			{
+				for (cv::Point2f& corner : m_regionCorners[i])
+				{
+					corner.x += float(region.x);
+					corner.y += float(region.y);
+				}
+				m_ids.push_back(m_regionIds[i]);
+				m_corners.push_back(m_regionCorners[i]);
+			}
+		}
+
+		// every tracked marker must be found again, otherwise it may have moved out of its region
+		for (const MarkerPose& marker : m_previous)
+		{
+			if (std::find(m_ids.begin(), m_ids.end(), marker.id) == m_ids.end())
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool ArUcoDetectorSession::PredictRegions(const cv::Size& imageSize, const cv::Matx44d* motion)
+	{
+		const cv::Rect image(0, 0, imageSize.width, imageSize.height);
+		m_regions.clear();
+
+		for (const MarkerPose& marker : m_previous)
+		{
+			cv::Rect box;
+			if (motion)
+			{
+				// move the marker's previous pose by the camera motion and project its corners
+				cv::Matx33d R;
+				cv::Rodrigues(marker.rvec, R);
+				cv::Matx33d Rm(
+					(*motion)(0, 0), (*motion)(0, 1), (*motion)(0, 2),
+					(*motion)(1, 0), (*motion)(1, 1), (*motion)(1, 2),
+					(*motion)(2, 0), (*motion)(2, 1), (*motion)(2, 2));
+				cv::Vec3d tm((*motion)(0, 3), (*motion)(1, 3), (*motion)(2, 3));
+
+				cv::Vec3d rvec;
+				cv::Vec3d tvec = Rm * marker.tvec + tm;
+				if (tvec[2] <= 0.0)
+				{
+					return false;
+				}
+				cv::Rodrigues(cv::Matx33d(Rm * R), rvec);
+				cv::projectPoints(m_objPoints, rvec, tvec, m_cameraMatrix, m_distortionCoefficients, m_projected);
+				box = cv::boundingRect(m_projected);
+			}
+			else
+			{
+				// no motion known, the marker is searched around where it was
+				m_projected.assign(marker.corners.begin(), marker.corners.end());
+				box = cv::boundingRect(m_projected);
+			}
+
+			int pad = std::max(m_tracking.minPadding, int(m_tracking.padding * std::max(box.width, box.height)));
+			box = cv::Rect(box.x - pad, box.y - pad, box.width + 2 * pad, box.height + 2 * pad) & image;
+			if (box.area() == 0)
+			{
+				return false;
+			}
+			m_regions.push_back(box);
+		}
+
+		// overlapping regions are merged, so a marker is never detected twice
+		for (bool merged = true; merged;)
+		{
+			merged = false;
+			for (size_t i = 0; i < m_regions.size() && !merged; i++)
+			{
+				for (size_t j = i + 1; j < m_regions.size(); j++)
+				{
+					if ((m_regions[i] & m_regions[j]).area() > 0)
+					{
+						m_regions[i] |= m_regions[j];
+						m_regions.erase(m_regions.begin() + j);
+						merged = true;
+						break;
+					}
+				}
+			}
+		}
+		return true;
+	}
+}
@@ -0,0 +1,227 @@
+#pragma once
+// Platform independent ArUco detector state shared by the research mode and
+// the non research mode plugins. Nothing in here depends on WinRT, so the same
+// code can be compiled on Linux for benchmarking with recorded frames.
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <opencv2/opencv.hpp>	// for opencv 4.8+
+
+#include "LatencyHistogram.h"
+#include "TraceRing.h"
+#include "UndistortionTable.h"
+
+namespace HoloLens2CV
+{
+    // same values as the cameraType / sensor arguments of the plugins
+    enum CameraType
+    {
+        LeftFrontCamera = 0,
+        RightFrontCamera = 1,
+        PhotoVideoCamera = 2        // PV frames of recorded sessions, not a research mode sensor
+    };
+
+    // pinhole camera model with 5 distortion coefficients (k1, k2, p1, p2, k3)
+    struct CameraIntrinsics
+    {
+        float fx = 0.f, fy = 0.f;
+        float cx = 0.f, cy = 0.f;
+        float k1 = 0.f, k2 = 0.f, k3 = 0.f;
+        float p1 = 0.f, p2 = 0.f;
+
+        bool operator==(const CameraIntrinsics& other) const;
+        bool operator!=(const CameraIntrinsics& other) const { return !(*this == other); }
+    };
+
+    // pose of a single detected marker relative to the camera
+    struct MarkerPose
+    {
+        int id = -1;
+        int camera = LeftFrontCamera;           // camera the marker was detected on
+        cv::Vec3d rvec;                         // Rodrigues rotation
+        cv::Vec3d tvec;                         // translation in meters
+        std::array<cv::Point2f, 4> corners;     // image corners, clockwise from top left
+    };
+
+    enum class PoseSolver
+    {
+        Iterative = 0,      // generic Levenberg-Marquardt solvePnP
+        IppeSquare = 1      // closed form solution for the 4 corners of a square marker
+    };
+
+    struct PoseSettings
+    {
+        PoseSolver solver = PoseSolver::Iterative;
+        bool warmStart = false;         // refine from the marker's previous pose (iterative with extrinsic guess) when it was seen in the last frame
+        int parallelThreshold = 8;      // markers are solved across cores from this many markers on, 0 never
+        bool undistortionTable = true;  // corners are normalized through the precomputed table of the image size
+    };
+
+    // Tracking mode: once markers are found, only padded regions around their corners
+    // (predicted with the camera motion when known) are searched. The full image is
+    // scanned again every reacquireInterval frames or as soon as a tracked marker is lost.
+    struct TrackingSettings
+    {
+        bool enabled = false;
+        int reacquireInterval = 15;     // a full image scan at least every this many frames
+        float padding = 0.5f;           // margin added around a marker, relative to its size in the image
+        int minPadding = 16;            // margin in pixels for small markers
+    };
+
+    // same values as cv::aruco::CornerRefineMethod
+    enum class CornerRefinement
+    {
+        None = 0,
+        Subpix = 1,
+        Contour = 2,
+        AprilTag = 3
+    };
+
+    // The cv::aruco::DetectorParameters worth tuning when lighting & marker sizes are known,
+    // all others keep OpenCV's defaults, as do these unless configured.
+    struct DetectionSettings
+    {
+        int thresholdWindowMin = 3;             // adaptive threshold window sizes in pixels, odd, min to max by step
+        int thresholdWindowMax = 23;
+        int thresholdWindowStep = 10;
+        double thresholdConstant = 7.0;         // subtracted from the window mean
+        double minPerimeterRate = 0.03;         // marker perimeter relative to the larger image side
+        double maxPerimeterRate = 4.0;
+        double polygonAccuracyRate = 0.03;      // polygon fit tolerance relative to the contour length
+        CornerRefinement cornerRefinement = CornerRefinement::None;
+
+        bool operator==(const DetectionSettings& other) const;
+        bool operator!=(const DetectionSettings& other) const { return !(*this == other); }
+
+        // the OpenCV parameters, windows & rates clamped to what the detector accepts
+        cv::aruco::DetectorParameters ToDetectorParameters() const;
+    };
+
+    struct TrackingStats
+    {
+        int64_t fullScans = 0;          // frames detected on the full image
+        int64_t regionScans = 0;        // frames detected inside the tracked regions only
+        int64_t lost = 0;               // region scans that missed a tracked marker & fell back to a full scan
+    };
+
+    // Long-lived detector state. The dictionary, detector, camera matrices and marker
+    // object points are built when the configuration changes and reused for every frame.
+    class ArUcoDetectorSession
+    {
+    public:
+        // every marker detected by this session is tagged with camera
+        explicit ArUcoDetectorSession(int camera = LeftFrontCamera) : m_camera(camera) {}
+        ArUcoDetectorSession(const ArUcoDetectorSession&) = delete;
+        ArUcoDetectorSession& operator=(const ArUcoDetectorSession&) = delete;
+
+        // rebuilds the detector only if the dictionary or marker length differ from the current ones
+        void Configure(int dictId, float markerLength);
+
+        // rebuilds the camera and distortion matrices only if the intrinsics differ from the current ones
+        void SetCameraIntrinsics(const CameraIntrinsics& intrinsics);
+
+        // thresholding, candidate filtering & corner refinement of the detector, kept across
+        // dictionary changes
+        void ConfigureDetection(const DetectionSettings& settings);
+        DetectionSettings GetDetectionSettings() const;
+
+        bool IsConfigured() const;
+
+        // tracked markers are forgotten, the next frame is a full image scan
+        void ConfigureTracking(const TrackingSettings& settings);
+
+        // Coarse to fine detection: candidates are searched on the image downsampled level times
+        // by 2, their corners are then refined to sub-pixel accuracy on the full resolution image.
+        // 0 (default) detects at full resolution, level is clamped to [0, kMaxPyramidLevel].
+        void SetPyramidLevel(int level);
+        int GetPyramidLevel() const;
+
+        static constexpr int kMaxPyramidLevel = 3;
+
+        void ConfigurePose(const PoseSettings& settings);
+
+        // estimates rvec & tvec of markers from their corners with the configured solver,
+        // imageSize is needed for the undistortion table. Warm starts come from the previous
+        // EstimatePoses call, the tracked markers & warm starts of Process are left alone
+        void EstimatePoses(std::vector<MarkerPose>& markers, const cv::Size& imageSize = cv::Size());
+
+        // undistorted view of a full image, built from the same intrinsics as the pose stage
+        void Undistort(const cv::Mat& gray, cv::Mat& undistorted);
+
+        // RMS distance in pixels between the corners of a marker and its pose projected back
+        // into the image, -1 before the dictionary & intrinsics are set
+        float ReprojectionError(const MarkerPose& marker) const;
+
+        TrackingStats GetTrackingStats() const;
+        void ResetTrackingStats();
+
+        // detection & pose stage times of Process are recorded into latencies (not owned), nullptr stops it
+        void SetLatencies(StageLatencies* latencies);
+
+        // Detect markers on a grayscale image and estimate their poses, markers is overwritten.
+        // cameraToWorld (OpenCV camera axes: x right, y down, z forward) is optional and only used
+        // by the tracking mode to predict where the markers of the previous frame moved to.
+        void Process(const cv::Mat& gray, std::vector<MarkerPose>& markers, const cv::Matx44d* cameraToWorld = nullptr);
+
+    private:
+        // detects on image (whole frame or a region) at the configured pyramid level
+        void DetectMarkers(const cv::Mat& image, std::vector<std::vector<cv::Point2f>>& corners, std::vector<int>& ids);
+
+        // pose stage of Process & EstimatePoses, warm started from & then replacing previous, the mutex must be held
+        void SolvePoses(std::vector<MarkerPose>& markers, std::vector<MarkerPose>& previous);
+
+        // region scan around the tracked markers, false if one of them was not found again
+        bool DetectInRegions(const cv::Mat& gray, const cv::Matx44d* motion);
+
+        // padded bounding boxes of the tracked markers in the current image, merged when overlapping
+        bool PredictRegions(const cv::Size& imageSize, const cv::Matx44d* motion);
+
+        mutable std::mutex m_mutex;
+
+        const int m_camera;
+
+        bool m_hasDictionary = false;
+        bool m_hasIntrinsics = false;
+        int m_dictId = -1;
+        float m_markerLength = 0.f;
+        CameraIntrinsics m_intrinsics;
+        DetectionSettings m_detection;
+
+        cv::aruco::ArucoDetector m_detector;
+        cv::Mat m_cameraMatrix;
+        cv::Mat m_distortionCoefficients;
+        cv::Mat m_objPoints;
+
+        // scratch buffers kept between frames to avoid reallocations
+        std::vector<int> m_ids;
+        std::vector<std::vector<cv::Point2f>> m_corners;
+        std::vector<std::vector<cv::Point2f>> m_rejected;
+
+        PoseSettings m_pose;
+        std::vector<int> m_guesses;             // index into the previous markers per marker, -1 for a cold start
+        std::vector<MarkerPose> m_estimated;    // markers of the previous EstimatePoses call, its warm starts
+
+        UndistortionTable m_undistortion;       // built for the size of the first processed image
+        cv::Mat m_normalizedCameraMatrix;       // identity, for poses solved on normalized corners
+
+        int m_pyramidLevel = 0;
+        std::array<cv::Mat, kMaxPyramidLevel + 1> m_pyramid;
+
+        StageLatencies* m_latencies = nullptr;
+
+        TrackingSettings m_tracking;
+        TrackingStats m_trackingStats;
+        std::vector<MarkerPose> m_previous;     // markers of the previous frame, seed regions & warm starts
+        int m_framesSinceFullScan = 0;
+        cv::Matx44d m_lastCameraToWorld;
+        bool m_hasCameraToWorld = false;
+
+        std::vector<cv::Rect> m_regions;
+        std::vector<int> m_regionIds;
+        std::vector<std::vector<cv::Point2f>> m_regionCorners;
+        std::vector<cv::Point2f> m_projected;
+    };
+}
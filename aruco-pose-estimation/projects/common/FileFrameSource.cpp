@@ -0,0 +1,55 @@
+#include "FileFrameSource.h"
+
+#include <algorithm>
+#include <filesystem>
+
+namespace HoloLens2CV
+{
+	FileFrameSource::FileFrameSource(const std::string& directory, const std::string& suffix)
+	{
+		for (const auto& entry : std::filesystem::directory_iterator(directory))
+		{
+			if (!entry.is_regular_file())
+			{
+				continue;
+			}
+			std::string path = entry.path().string();
+			if (path.size() >= suffix.size() && path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0)
+			{
+				m_files.push_back(path);
+			}
+		}
+		std::sort(m_files.begin(), m_files.end());
+	}
+
+	bool FileFrameSource::Next(cv::Mat& gray, int64_t& timestamp)
+	{
+		while (m_next < m_files.size())
+		{
+			const std::string& path = m_files[m_next++];
+			gray = cv::imread(path, cv::IMREAD_GRAYSCALE);
+			if (gray.empty())
+			{
+				// not an image, skip it
+				continue;
+			}
+
+			timestamp = TimestampOf(path);
+			return true;
+		}
+		return false;
+	}
+
+	int64_t FileFrameSource::TimestampOf(const std::string& path)
+	{
+		std::string name = std::filesystem::path(path).filename().string();
+		try
+		{
+			return std::stoll(name.substr(0, name.find('_')));
+		}
+		catch (...)
+		{
+			return 0;
+		}
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+// Reads grayscale frames from a directory of images, e.g. the <ts>_LF.tiff files
+// saved by TCPServer.py. Used to run the detection code off-device.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+namespace HoloLens2CV
+{
+    class FileFrameSource
+    {
+    public:
+        // collects every file in directory ending with suffix, ordered by file name
+        FileFrameSource(const std::string& directory, const std::string& suffix = ".tiff");
+
+        size_t Count() const { return m_files.size(); }
+
+        // loads the next frame as 8 bit grayscale, returns false after the last frame
+        // timestamp is parsed from the "<ts>_" file name prefix, 0 if there is none
+        bool Next(cv::Mat& gray, int64_t& timestamp);
+
+        void Rewind() { m_next = 0; }
+
+        // collected file paths, in the order Next reads them
+        const std::vector<std::string>& Files() const { return m_files; }
+
+        // time stamp of the "<ts>_" file name prefix, 0 if there is none
+        static int64_t TimestampOf(const std::string& path);
+
+    private:
+        std::vector<std::string> m_files;
+        size_t m_next = 0;
+    };
+}
@@ -0,0 +1,171 @@
+#pragma once
+// Bounded queue handing captured frames from the acquisition thread to one or
+// more detection threads. The producer never blocks: when the queue is full
+// (or always, in LatestOnly mode) queued frames are dropped and counted.
+// Frame objects are pooled, so steady state runs without allocations.
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace HoloLens2CV
+{
+    enum class DropPolicy
+    {
+        LatestOnly = 0,     // consumers always get the newest frame, older queued frames are dropped
+        Fifo = 1            // frames are consumed in order, the oldest frame is dropped when full
+    };
+
+    struct FrameQueueStats
+    {
+        int depth = 0;          // frames currently queued
+        int maxDepth = 0;       // highest depth since the last reset
+        int capacity = 0;
+        int64_t pushed = 0;
+        int64_t popped = 0;
+        int64_t dropped = 0;
+    };
+
+    template <typename Frame>
+    class FrameQueue
+    {
+    public:
+        explicit FrameQueue(int capacity = 4, DropPolicy policy = DropPolicy::LatestOnly)
+        {
+            Configure(capacity, policy);
+        }
+
+        FrameQueue(const FrameQueue&) = delete;
+        FrameQueue& operator=(const FrameQueue&) = delete;
+
+        // queued frames are dropped when the configuration changes
+        void Configure(int capacity, DropPolicy policy)
+        {
+            std::lock_guard<std::mutex> l(m_mutex);
+            m_capacity = std::max(1, capacity);
+            m_policy = policy;
+            while (!m_queue.empty())
+            {
+                m_pool.push_back(std::move(m_queue.front()));
+                m_queue.pop_front();
+                m_dropped++;
+            }
+        }
+
+        // a frame to be filled by the producer, reuses released frames
+        std::unique_ptr<Frame> Acquire()
+        {
+            {
+                std::lock_guard<std::mutex> l(m_mutex);
+                if (!m_pool.empty())
+                {
+                    auto frame = std::move(m_pool.back());
+                    m_pool.pop_back();
+                    return frame;
+                }
+            }
+            return std::make_unique<Frame>();
+        }
+
+        // gives a frame back to the pool once it is not needed anymore
+        void Release(std::unique_ptr<Frame> frame)
+        {
+            if (!frame)
+            {
+                return;
+            }
+            std::lock_guard<std::mutex> l(m_mutex);
+            m_pool.push_back(std::move(frame));
+        }
+
+        // never blocks, drops queued frames according to the drop policy
+        void Push(std::unique_ptr<Frame> frame)
+        {
+            {
+                std::lock_guard<std::mutex> l(m_mutex);
+                size_t limit = m_policy == DropPolicy::LatestOnly ? 1 : size_t(m_capacity);
+                while (m_queue.size() >= limit)
+                {
+                    m_pool.push_back(std::move(m_queue.front()));
+                    m_queue.pop_front();
+                    m_dropped++;
+                }
+                m_queue.push_back(std::move(frame));
+                m_pushed++;
+                m_maxDepth = std::max(m_maxDepth, int(m_queue.size()));
+            }
+            m_cv.notify_one();
+        }
+
+        // blocks until a frame is available, returns false once the queue is closed
+        bool Pop(std::unique_ptr<Frame>& frame)
+        {
+            std::unique_lock<std::mutex> l(m_mutex);
+            m_cv.wait(l, [this] { return !m_queue.empty() || m_closed; });
+            if (m_queue.empty())
+            {
+                return false;
+            }
+            frame = std::move(m_queue.front());
+            m_queue.pop_front();
+            m_popped++;
+            return true;
+        }
+
+        // wakes up every consumer, Pop returns false after the remaining frames are consumed
+        void Close()
+        {
+            {
+                std::lock_guard<std::mutex> l(m_mutex);
+                m_closed = true;
+            }
+            m_cv.notify_all();
+        }
+
+        void Reopen()
+        {
+            std::lock_guard<std::mutex> l(m_mutex);
+            m_closed = false;
+        }
+
+        FrameQueueStats GetStats() const
+        {
+            std::lock_guard<std::mutex> l(m_mutex);
+            FrameQueueStats stats;
+            stats.depth = int(m_queue.size());
+            stats.maxDepth = m_maxDepth;
+            stats.capacity = m_policy == DropPolicy::LatestOnly ? 1 : m_capacity;
+            stats.pushed = m_pushed;
+            stats.popped = m_popped;
+            stats.dropped = m_dropped;
+            return stats;
+        }
+
+        void ResetStats()
+        {
+            std::lock_guard<std::mutex> l(m_mutex);
+            m_maxDepth = int(m_queue.size());
+            m_pushed = m_popped = m_dropped = 0;
+        }
+
+    private:
+        mutable std::mutex m_mutex;
+        std::condition_variable m_cv;
+
+        std::deque<std::unique_ptr<Frame>> m_queue;
+        std::vector<std::unique_ptr<Frame>> m_pool;
+
+        int m_capacity = 4;
+        DropPolicy m_policy = DropPolicy::LatestOnly;
+        bool m_closed = false;
+
+        int m_maxDepth = 0;
+        int64_t m_pushed = 0;
+        int64_t m_popped = 0;
+        int64_t m_dropped = 0;
+    };
+}
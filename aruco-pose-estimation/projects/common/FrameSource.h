@@ -0,0 +1,23 @@
+#pragma once
+// Where captured frames come from: the research mode sensors on the device or
+// a recorded session off-device. The acquisition & detection pipeline only
+// sees this interface, so the same code runs on both.
+
+#include "FrontCamerasFrame.h"
+
+namespace HoloLens2CV
+{
+    class FrameSource
+    {
+    public:
+        virtual ~FrameSource() = default;
+
+        // Next captured frame of any camera (a CameraType), swapped or copied into frame so its
+        // buffers are reused. Frames of one camera come in capture order. False at the end of the
+        // source, on a sensor error or after Stop.
+        virtual bool Next(int& camera, CameraFrame& frame) = 0;
+
+        // makes Next return false, may be called from any thread
+        virtual void Stop() = 0;
+    };
+}
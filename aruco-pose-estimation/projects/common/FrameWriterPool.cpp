@@ -0,0 +1,327 @@
+#include "FrameWriterPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+
+#include "MarkerTelemetry.h"
+#include "StereoFrameCodec.h"
+
+namespace HoloLens2CV
+{
+	// capture profiles of the PV camera, all pixel counts differ
+	static const int kPvSizes[][2] = {
+		{ 1920, 1080 }, { 1280, 720 }, { 1504, 846 }, { 1952, 1100 }, { 2272, 1278 },
+		{ 896, 504 }, { 960, 540 }, { 640, 360 }, { 500, 282 }, { 424, 240 }
+	};
+
+	bool PvImageSize(size_t pixels, int& width, int& height)
+	{
+		for (const auto& size : kPvSizes)
+		{
+			if (size_t(size[0]) * size_t(size[1]) == pixels)
+			{
+				width = size[0];
+				height = size[1];
+				return true;
+			}
+		}
+		return false;
+	}
+
+	FrameWriterPool::~FrameWriterPool()
+	{
+		Stop();
+	}
+
+	void FrameWriterPool::Start(const WriterSettings& settings)
+	{
+		Stop();
+		m_settings = settings;
+		m_settings.threads = std::max(1, settings.threads);
+		m_settings.capacity = std::max(1, settings.capacity);
+		m_stopping = false;
+		m_stats = WriterStats();
+		for (int i = 0; i < m_settings.threads; i++)
+		{
+			m_threads.emplace_back(&FrameWriterPool::Work, this);
+		}
+	}
+
+	void FrameWriterPool::Submit(const std::string& headset, IngestMessage&& message)
+	{
+		if (message.type == IngestMessageType::MarkerText || message.type == IngestMessageType::MarkerTelemetry)
+		{
+			bool written = AppendText(headset, message);
+			std::lock_guard<std::mutex> l(m_mutex);
+			(written ? m_stats.written : m_stats.failed)++;
+			m_stats.bytes += written ? int64_t(message.payload.size()) : 0;
+			return;
+		}
+
+		std::unique_lock<std::mutex> l(m_mutex);
+		if (int(m_queue.size()) >= m_settings.capacity)
+		{
+			auto t1 = std::chrono::steady_clock::now();
+			m_room.wait(l, [this] { return int(m_queue.size()) < m_settings.capacity || m_stopping; });
+			m_stats.blockedMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t1).count();
+		}
+		if (m_threads.empty())
+		{
+			m_stats.failed++;
+			return;
+		}
+		m_queue.push_back({ headset, std::move(message) });
+		m_stats.maxDepth = std::max(m_stats.maxDepth, int(m_queue.size()));
+		l.unlock();
+		m_ready.notify_one();
+	}
+
+	void FrameWriterPool::Flush()
+	{
+		{
+			std::unique_lock<std::mutex> l(m_mutex);
+			m_done.wait(l, [this] { return (m_queue.empty() && m_busy == 0) || m_threads.empty(); });
+		}
+		std::lock_guard<std::mutex> l(m_textMutex);
+		for (auto& text : m_texts)
+		{
+			std::fflush(text.second);
+		}
+	}
+
+	void FrameWriterPool::Stop()
+	{
+		{
+			std::lock_guard<std::mutex> l(m_mutex);
+			m_stopping = true;
+		}
+		m_ready.notify_all();
+		m_room.notify_all();
+		for (auto& thread : m_threads)
+		{
+			thread.join();
+		}
+		m_threads.clear();
+		m_done.notify_all();
+		CloseTexts();
+	}
+
+	bool FrameWriterPool::AppendText(const std::string& headset, const IngestMessage& message)
+	{
+		const std::string directory = DirectoryOf(headset);
+		if (!EnsureDirectories(directory))
+		{
+			return false;
+		}
+		const bool telemetry = message.type == IngestMessageType::MarkerTelemetry;
+		MarkerTelemetryBatch batch;
+		if (telemetry && DecodeMarkerTelemetry(message.payload.data(), message.payload.size(), batch) != message.payload.size())
+		{
+			return false;       // would leave telemetry.bin unreadable after it
+		}
+		if (m_settings.recording)
+		{
+			// a batch carries the time stamp of its frame, the text has none & follows the newest frame written so far
+			SessionRecordingWriter* recording = RecordingOf(directory);
+			return recording != nullptr && recording->Append(RecordStream::Markers,
+				telemetry ? RecordFormat::MarkerTelemetry : RecordFormat::MarkerText,
+				telemetry ? batch.timestamp : recording->LastTimestamp(),
+				0, 0, message.payload.data(), message.payload.size());
+		}
+
+		// batches delimit themselves, the texts are one per line
+		const std::string path = (std::filesystem::path(directory) / (telemetry ? "telemetry.bin" : "markers.txt")).string();
+		std::lock_guard<std::mutex> l(m_textMutex);
+		FILE*& file = m_texts[path];
+		if (file == nullptr)
+		{
+			file = std::fopen(path.c_str(), "ab");
+			if (file == nullptr)
+			{
+				m_texts.erase(path);
+				return false;
+			}
+		}
+		return std::fwrite(message.payload.data(), 1, message.payload.size(), file) == message.payload.size() &&
+			(telemetry || std::fputc('\n', file) != EOF);
+	}
+
+	void FrameWriterPool::CloseTexts()
+	{
+		std::lock_guard<std::mutex> l(m_textMutex);
+		for (auto& text : m_texts)
+		{
+			std::fclose(text.second);
+		}
+		m_texts.clear();
+
+		// the footers are written now, a recording left open is read by recovering its index
+		for (auto& recording : m_recordings)
+		{
+			if (!recording.second->Close())
+			{
+				std::lock_guard<std::mutex> s(m_mutex);
+				m_stats.failed++;
+			}
+		}
+		m_recordings.clear();
+	}
+
+	SessionRecordingWriter* FrameWriterPool::RecordingOf(const std::string& directory)
+	{
+		std::lock_guard<std::mutex> l(m_textMutex);
+		std::unique_ptr<SessionRecordingWriter>& recording = m_recordings[directory];
+		if (recording == nullptr)
+		{
+			recording = std::make_unique<SessionRecordingWriter>();
+			if (!recording->Open((std::filesystem::path(directory) / "session.hl2rec").string()))
+			{
+				m_recordings.erase(directory);
+				return nullptr;
+			}
+		}
+		return recording.get();
+	}
+
+	WriterStats FrameWriterPool::Stats() const
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		return m_stats;
+	}
+
+	std::string FrameWriterPool::DirectoryOf(const std::string& headset) const
+	{
+		if (!m_settings.perHeadsetDirectories)
+		{
+			return m_settings.directory;
+		}
+
+		// addresses hold ':' for IPv6 & ports
+		std::string name = headset;
+		std::replace(name.begin(), name.end(), ':', '_');
+		return (std::filesystem::path(m_settings.directory) / name).string();
+	}
+
+	void FrameWriterPool::Work()
+	{
+		std::unique_lock<std::mutex> l(m_mutex);
+		while (true)
+		{
+			// the queue is written before stopping
+			m_ready.wait(l, [this] { return !m_queue.empty() || m_stopping; });
+			if (m_queue.empty())
+			{
+				return;
+			}
+			Job job = std::move(m_queue.front());
+			m_queue.pop_front();
+			m_busy++;
+			l.unlock();
+			m_room.notify_one();
+
+			bool written = Write(job);
+
+			l.lock();
+			m_busy--;
+			(written ? m_stats.written : m_stats.failed)++;
+			m_stats.bytes += written ? int64_t(job.message.payload.size()) : 0;
+			m_done.notify_all();
+		}
+	}
+
+	bool FrameWriterPool::EnsureDirectories(const std::string& directory)
+	{
+		std::lock_guard<std::mutex> l(m_directoryMutex);
+		if (m_directories.count(directory) > 0)
+		{
+			return true;
+		}
+		std::error_code error;
+		std::filesystem::create_directories(directory, error);
+		for (const char* folder : { "photovideo", "leftfront", "rightfront" })
+		{
+			if (!error && !m_settings.recording)
+			{
+				std::filesystem::create_directories(std::filesystem::path(directory) / folder, error);
+			}
+		}
+		if (error)
+		{
+			return false;
+		}
+		m_directories.insert(directory);
+		return true;
+	}
+
+	bool FrameWriterPool::Store(const std::string& directory, RecordStream stream, int64_t timestamp, const cv::Mat& image)
+	{
+		if (m_settings.recording)
+		{
+			SessionRecordingWriter* recording = RecordingOf(directory);
+			return recording != nullptr &&
+				recording->AppendImage(stream, timestamp, image.cols, image.rows, image.channels(), image.data);
+		}
+		static const char* folders[3] = { "leftfront", "rightfront", "photovideo" };
+		static const char* suffixes[3] = { "_LF.tiff", "_RF.tiff", "_PV.tiff" };
+		int camera = int(stream);
+		return cv::imwrite((std::filesystem::path(directory) / folders[camera] / (std::to_string(timestamp) + suffixes[camera])).string(), image);
+	}
+
+	bool FrameWriterPool::Write(const Job& job)
+	{
+		const std::string directory = DirectoryOf(job.headset);
+		if (!EnsureDirectories(directory))
+		{
+			return false;
+		}
+		const IngestMessage& message = job.message;
+		uint8_t* data = const_cast<uint8_t*>(message.payload.data());
+
+		switch (message.type)
+		{
+		case IngestMessageType::PvImage:
+		{
+			int width = 0, height = 0;
+			if (message.payload.size() % 4 != 0 || !PvImageSize(message.payload.size() / 4, width, height))
+			{
+				return false;
+			}
+			return Store(directory, RecordStream::PhotoVideo, message.timestamps[0], cv::Mat(height, width, CV_8UC4, data));
+		}
+
+		case IngestMessageType::SpatialImages:
+		{
+			// the visible light cameras are 640x480 8 bit gray
+			const size_t half = message.payload.size() / 2;
+			if (message.payload.size() % 2 != 0 || half != 640 * 480)
+			{
+				return false;
+			}
+			return Store(directory, RecordStream::LeftFront, message.timestamps[0], cv::Mat(480, 640, CV_8U, data)) &&
+				Store(directory, RecordStream::RightFront, message.timestamps[1], cv::Mat(480, 640, CV_8U, data + half));
+		}
+
+		case IngestMessageType::CompressedSpatialImages:
+		{
+			// decoded back to the images an 'f' message carries, a codec per call as the threads share none
+			StereoFrameCodec codec;
+			std::vector<uint8_t> LF, RF;
+			int width = 0, height = 0;
+			if (!codec.Decode(message.payload.data(), message.payload.size(), width, height, LF, RF))
+			{
+				return false;
+			}
+			return Store(directory, RecordStream::LeftFront, message.timestamps[0], cv::Mat(height, width, CV_8U, LF.data())) &&
+				Store(directory, RecordStream::RightFront, message.timestamps[1], cv::Mat(height, width, CV_8U, RF.data()));
+		}
+
+		case IngestMessageType::MarkerText:
+		case IngestMessageType::MarkerTelemetry:
+			// appended by Submit
+			break;
+		}
+		return false;
+	}
+}
@@ -0,0 +1,111 @@
+#pragma once
+// Writes received messages to disk on a pool of threads, in the layout of
+// TCPServer.py so SessionReplaySource reads the result: photovideo/<ts>_PV.tiff,
+// leftfront/<ts>_LF.tiff, rightfront/<ts>_RF.tiff, the marker text appended
+// to markers.txt and the marker telemetry batches to telemetry.bin. Every headset gets a directory of its own (by address)
+// unless they share one. With recording on, all of it is appended to one
+// SessionRecording per directory instead, session.hl2rec.
+//
+// The queue is bounded and Submit blocks while it is full, so a slow disk slows
+// the receiving side down (and TCP the headsets) instead of frames being
+// dropped. Marker text & telemetry are small and appended on the submitting
+// thread, so they stay in arrival order.
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "IngestProtocol.h"
+#include "SessionRecording.h"
+
+namespace HoloLens2CV
+{
+    struct WriterSettings
+    {
+        std::string directory = "data";
+        bool perHeadsetDirectories = true;  // <directory>/<headset>/..., else all in <directory> like TCPServer.py
+        int threads = 4;
+        int capacity = 32;                  // queued messages before Submit blocks
+        bool recording = false;             // <directory>/session.hl2rec instead of TIFF files, markers.txt & telemetry.bin
+    };
+
+    struct WriterStats
+    {
+        int64_t written = 0;                // images, marker texts & telemetry batches
+        int64_t failed = 0;                 // unknown image sizes & failed writes
+        int64_t bytes = 0;                  // payload bytes of the written messages
+        int maxDepth = 0;
+        double blockedMs = 0.0;             // time Submit waited for room in the queue
+    };
+
+    // width & height of a PV image of that many pixels among the HoloLens 2 capture profiles
+    bool PvImageSize(size_t pixels, int& width, int& height);
+
+    class FrameWriterPool
+    {
+    public:
+        FrameWriterPool() = default;
+        FrameWriterPool(const FrameWriterPool&) = delete;
+        FrameWriterPool& operator=(const FrameWriterPool&) = delete;
+        ~FrameWriterPool();
+
+        void Start(const WriterSettings& settings);
+
+        // images block while the queue is full, headset names the sender (e.g. its address)
+        void Submit(const std::string& headset, IngestMessage&& message);
+
+        // returns once every submitted message is written & the marker files are flushed
+        void Flush();
+
+        // writes what is queued, then joins the threads
+        void Stop();
+
+        WriterStats Stats() const;
+
+        // where the files of a headset go
+        std::string DirectoryOf(const std::string& headset) const;
+
+    private:
+        struct Job
+        {
+            std::string headset;
+            IngestMessage message;
+        };
+
+        void Work();
+        bool Write(const Job& job);
+        bool EnsureDirectories(const std::string& directory);
+        bool Store(const std::string& directory, RecordStream stream, int64_t timestamp, const cv::Mat& image);
+        SessionRecordingWriter* RecordingOf(const std::string& directory);
+        bool AppendText(const std::string& headset, const IngestMessage& message);
+        void CloseTexts();
+
+        WriterSettings m_settings;
+        std::vector<std::thread> m_threads;
+
+        mutable std::mutex m_mutex;
+        std::condition_variable m_ready;    // a job was queued or the pool stops
+        std::condition_variable m_room;     // a job was taken
+        std::condition_variable m_done;     // a job was written
+        std::deque<Job> m_queue;
+        int m_busy = 0;                     // jobs taken & not yet written
+        bool m_stopping = false;
+        WriterStats m_stats;
+
+        std::mutex m_textMutex;             // m_texts & m_recordings
+        std::map<std::string, FILE*> m_texts;       // markers.txt & telemetry.bin by path, open until Stop
+        std::map<std::string, std::unique_ptr<SessionRecordingWriter>> m_recordings;    // by directory, open until Stop
+        std::mutex m_directoryMutex;
+        std::set<std::string> m_directories;        // created already
+    };
+}
@@ -0,0 +1,107 @@
+#include "FrontCamerasDetector.h"
+
+#include <utility>
+
+namespace HoloLens2CV
+{
+	DetectionWorker::DetectionWorker()
+	{
+		m_thread = std::thread(&DetectionWorker::Run, this);
+	}
+
+	DetectionWorker::~DetectionWorker()
+	{
+		{
+			std::lock_guard<std::mutex> l(m_mutex);
+			m_stop = true;
+		}
+		m_cv.notify_all();
+		m_thread.join();
+	}
+
+	void DetectionWorker::Submit(std::function<void()> job)
+	{
+		{
+			std::lock_guard<std::mutex> l(m_mutex);
+			m_job = std::move(job);
+			m_busy = true;
+		}
+		m_cv.notify_all();
+	}
+
+	void DetectionWorker::Wait()
+	{
+		std::unique_lock<std::mutex> l(m_mutex);
+		m_cv.wait(l, [this] { return !m_busy; });
+		if (m_error)
+		{
+			std::rethrow_exception(std::exchange(m_error, nullptr));
+		}
+	}
+
+	void DetectionWorker::Run()
+	{
+		std::unique_lock<std::mutex> l(m_mutex);
+		while (true)
+		{
+			m_cv.wait(l, [this] { return m_busy || m_stop; });
+			if (m_stop)
+			{
+				return;
+			}
+
+			// run the job without holding the lock, an exception must not end the thread
+			auto job = std::move(m_job);
+			std::exception_ptr error;
+			l.unlock();
+			try
+			{
+				job();
+			}
+			catch (...)
+			{
+				error = std::current_exception();
+			}
+			l.lock();
+
+			m_error = error;
+			m_busy = false;
+			m_cv.notify_all();
+		}
+	}
+
+	FrontCamerasDetector::FrontCamerasDetector(ArUcoDetectorSession& LFDetector, ArUcoDetectorSession& RFDetector)
+		: m_LFDetector(LFDetector), m_RFDetector(RFDetector)
+	{
+	}
+
+	void FrontCamerasDetector::Process(const cv::Mat& LFImage, const cv::Mat& RFImage, std::vector<MarkerPose>& markers,
+		const cv::Matx44d* LFCameraToWorld, const cv::Matx44d* RFCameraToWorld)
+	{
+		// the worker traces its half under the frame of the caller
+		int64_t sequence = TraceFrame::Sequence();
+		int64_t timestamp = TraceFrame::Timestamp();
+		m_LFWorker.Submit([this, &LFImage, LFCameraToWorld, sequence, timestamp]
+			{
+				TraceFrame frame(sequence, timestamp);
+				m_LFDetector.Process(LFImage, m_LFMarkers, LFCameraToWorld);
+			});
+		try
+		{
+			m_RFDetector.Process(RFImage, m_RFMarkers, RFCameraToWorld);
+		}
+		catch (...)
+		{
+			// the worker still reads LFImage, it is the caller's
+			m_LFWorker.Wait();
+			throw;
+		}
+		m_LFWorker.Wait();
+
+		// merge, every pose is already tagged with its camera by the sessions
+		markers.clear();
+		markers.reserve(m_LFMarkers.size() + m_RFMarkers.size());
+		markers.insert(markers.end(), m_LFMarkers.begin(), m_LFMarkers.end());
+		markers.insert(markers.end(), m_RFMarkers.begin(), m_RFMarkers.end());
+	}
+}
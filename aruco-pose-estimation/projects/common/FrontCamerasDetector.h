@@ -0,0 +1,65 @@
+#pragma once
+// Runs ArUco detection on the left front and right front images at the same time
+// and merges the results into one set, each marker tagged with its camera.
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ArUcoDetectorSession.h"
+
+namespace HoloLens2CV
+{
+    // persistent thread executing one job at a time, avoids creating a thread per frame
+    class DetectionWorker
+    {
+    public:
+        DetectionWorker();
+        ~DetectionWorker();
+        DetectionWorker(const DetectionWorker&) = delete;
+        DetectionWorker& operator=(const DetectionWorker&) = delete;
+
+        // hands job over to the worker thread, the previous job must have been waited for
+        void Submit(std::function<void()> job);
+
+        // blocks until the submitted job has finished, then rethrows what the job threw
+        void Wait();
+
+    private:
+        void Run();
+
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::function<void()> m_job;
+        std::exception_ptr m_error;         // of the last job, handed to Wait
+        bool m_busy = false;
+        bool m_stop = false;
+        std::thread m_thread;
+    };
+
+    class FrontCamerasDetector
+    {
+    public:
+        // the sessions are owned by the caller and keep their own configuration
+        FrontCamerasDetector(ArUcoDetectorSession& LFDetector, ArUcoDetectorSession& RFDetector);
+
+        // detects LF on the worker thread and RF on the calling thread, then merges
+        // both result sets into markers (LF markers first), the optional camera to world
+        // transforms are passed on to the sessions for their tracking mode. An exception of
+        // either camera is thrown on the calling thread once the worker is done with the images.
+        void Process(const cv::Mat& LFImage, const cv::Mat& RFImage, std::vector<MarkerPose>& markers,
+            const cv::Matx44d* LFCameraToWorld = nullptr, const cv::Matx44d* RFCameraToWorld = nullptr);
+
+    private:
+        ArUcoDetectorSession& m_LFDetector;
+        ArUcoDetectorSession& m_RFDetector;
+
+        std::vector<MarkerPose> m_LFMarkers;
+        std::vector<MarkerPose> m_RFMarkers;
+
+        DetectionWorker m_LFWorker;
+    };
+}
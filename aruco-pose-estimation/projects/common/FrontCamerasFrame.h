@@ -0,0 +1,30 @@
+#pragma once
+// One captured left front / right front frame pair as handed from the
+// acquisition stage to the detection stage.
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace HoloLens2CV
+{
+    struct CameraFrame
+    {
+        uint64_t hostTicks = 0;                 // QPC
+        int64_t timestamp = 0;                  // FileTime
+        int width = 0;
+        int height = 0;
+        std::vector<uint8_t> image;             // 8 bit grayscale, width * height
+        std::array<float, 16> cameraToWorld{};  // row major, DirectX convention
+    };
+
+    struct FrontCamerasFrame
+    {
+        CameraFrame LF;
+        CameraFrame RF;
+        bool hasLF = true;                      // false for a RF frame without LF partner (see StereoFramePairer)
+        bool hasRF = true;
+        int64_t skew = 0;                       // RF - LF host ticks of a pair, 0 for a single frame
+        int64_t sequence = 0;                   // counts the pairs of a run, ties the stages together in a trace
+    };
+}
@@ -0,0 +1,324 @@
+#include "FrontCamerasPipeline.h"
+
+#include <chrono>
+#include <thread>
+#include <utility>
+
+namespace HoloLens2CV
+{
+	void FrontCamerasPipeline::Configure(const PipelineSettings& settings)
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		m_settings = settings;
+	}
+
+	void FrontCamerasPipeline::SetCameraToRig(int camera, const cv::Matx44d& cameraToRig)
+	{
+		if (camera != LeftFrontCamera && camera != RightFrontCamera)
+		{
+			return;
+		}
+		std::lock_guard<std::mutex> l(m_mutex);
+		m_cameraToRig[camera] = cameraToRig;
+	}
+
+	FrontCamerasPipeline::FrontCamerasPipeline()
+	{
+		m_LFDetector.SetLatencies(&m_latencies);
+		m_RFDetector.SetLatencies(&m_latencies);
+	}
+
+	void FrontCamerasPipeline::Run(FrameSource& source, RigPoseSource* poses, bool usePoseHistory)
+	{
+		bool synchronous = false;
+		{
+			std::lock_guard<std::mutex> l(m_mutex);
+			m_source = &source;
+			synchronous = m_settings.synchronous;
+		}
+		m_running = true;
+		TraceRing::Global().NameThread("acquisition");
+
+		// detection runs on its own thread, fed by the frame queue
+		m_frameQueue.Reopen();
+		std::thread detectionThread;
+		if (!synchronous)
+		{
+			detectionThread = std::thread(FrontCamerasPipeline::DetectionLoop, this);
+		}
+
+		// rig poses are sampled from now on, the history has no pose before the first samples
+		if (poses != nullptr && usePoseHistory)
+		{
+			m_poseHistory.Clear();
+			m_poseHistory.ResetStats();
+			m_poseHistory.Start(poses);
+		}
+
+		// frames keep their allocations, they are swapped through the pairer & the queue
+		CameraFrame scratch;
+		FrontCamerasFrame pair;
+		int64_t sequence = 0;
+		int camera = LeftFrontCamera;
+		m_pairer.Clear();
+		m_pairer.ResetStats();
+
+		try
+		{
+			while (m_running)
+			{
+				{
+					ScopedLatency wait(&m_latencies, LatencyStage::AcquisitionWait);
+					TraceScope trace("acquire");
+					if (!source.Next(camera, scratch))
+					{
+						break;
+					}
+				}
+				{
+					std::lock_guard<std::mutex> l(m_mutex);
+					m_stats.frames++;
+				}
+				if (camera != LeftFrontCamera && camera != RightFrontCamera)
+				{
+					continue;       // PV frames are not part of the front camera pipeline
+				}
+
+				// the n-th LF and RF buffers are not always the same exposure, they are matched
+				// by host ticks first, frames without partner are dropped or processed alone
+				m_pairer.Push(camera, scratch);
+				while (m_pairer.Pop(pair))
+				{
+					pair.sequence = sequence++;
+					TraceFrame trace(pair.sequence, pair.hasLF ? pair.LF.timestamp : pair.RF.timestamp);
+
+					// locate camera rig once per pair, LF and RF were exposed together
+					cv::Matx44d rigToWorld;
+					bool located = false;
+					{
+						ScopedLatency lookup(&m_latencies, LatencyStage::PoseLookup);
+						TraceScope locate("locate");
+						located = LocateRig(poses, pair.hasLF ? pair.LF : pair.RF, rigToWorld);
+					}
+					cv::Matx44d LFToRig, RFToRig;
+					bool detect = true;
+					{
+						std::lock_guard<std::mutex> l(m_mutex);
+						(located ? m_stats.located : m_stats.unlocated)++;
+						LFToRig = m_cameraToRig[LeftFrontCamera];
+						RFToRig = m_cameraToRig[RightFrontCamera];
+						detect = m_settings.detect;
+					}
+					if (!located)
+					{
+						continue;
+					}
+
+					// camera to world = rig to world * camera to rig
+					SetCameraToWorld(pair.LF, rigToWorld * LFToRig);
+					SetCameraToWorld(pair.RF, rigToWorld * RFToRig);
+
+					if (m_frameCallback)
+					{
+						ScopedLatency copy(&m_latencies, LatencyStage::BufferCopy);
+						TraceScope publish("publish images");
+						m_frameCallback(pair);
+					}
+
+					if (!detect)
+					{
+						continue;
+					}
+					if (synchronous)
+					{
+						Process(pair);
+						continue;
+					}
+
+					// hand the frame pair over to the detection thread, never blocks,
+					// the buffers it replaces go back to the pairer
+					TraceScope push("queue push");
+					auto frame = m_frameQueue.Acquire();
+					std::swap(*frame, pair);
+					m_frameQueue.Push(std::move(frame));
+				}
+			}
+		}
+		catch (...) {}
+
+		// let the detection thread finish the queued frames & exit
+		m_frameQueue.Close();
+		if (detectionThread.joinable())
+		{
+			detectionThread.join();
+		}
+		m_poseHistory.Stop();
+
+		m_running = false;
+		std::lock_guard<std::mutex> l(m_mutex);
+		m_source = nullptr;
+	}
+
+	void FrontCamerasPipeline::Stop()
+	{
+		m_running = false;
+		std::lock_guard<std::mutex> l(m_mutex);
+		if (m_source != nullptr)
+		{
+			m_source->Stop();
+		}
+	}
+
+	void FrontCamerasPipeline::DetectionLoop(FrontCamerasPipeline* pipeline)
+	{
+		TraceRing::Global().NameThread("detection");
+		std::unique_ptr<FrontCamerasFrame> frame;
+		while (pipeline->m_frameQueue.Pop(frame))
+		{
+			try
+			{
+				// detect & estimate pose of markers on the selected front camera image(s)
+				pipeline->Process(*frame);
+			}
+			catch (...) {}
+
+			pipeline->m_frameQueue.Release(std::move(frame));
+		}
+	}
+
+	bool FrontCamerasPipeline::LocateRig(RigPoseSource* poses, const CameraFrame& frame, cv::Matx44d& rigToWorld)
+	{
+		if (poses == nullptr)
+		{
+			rigToWorld = cv::Matx44d::eye();
+			return true;
+		}
+
+		// the history first, the source itself without history, before its first samples or across a loss
+		RigPose pose;
+		if ((m_poseHistory.IsRunning() && m_poseHistory.TryGetPose(frame.timestamp, pose)) || poses->TryLocate(frame.timestamp, pose))
+		{
+			rigToWorld = RigPoseHistory::ToMatrix(pose);
+			return true;
+		}
+		return false;
+	}
+
+	void FrontCamerasPipeline::Process(const FrontCamerasFrame& frame)
+	{
+		auto t1 = std::chrono::steady_clock::now();
+		TraceFrame trace(frame.sequence, frame.hasLF ? frame.LF.timestamp : frame.RF.timestamp);
+		TraceScope process("process");
+
+		// a frame without partner only has the side of its camera
+		int sensor = 2;
+		{
+			std::lock_guard<std::mutex> l(m_mutex);
+			sensor = m_settings.sensor;
+		}
+		bool useLF = frame.hasLF && (sensor == 0 || sensor == 2);
+		bool useRF = frame.hasRF && (sensor == 1 || sensor == 2);
+		if (!useLF && !useRF)
+		{
+			return;     // single frame of the camera not selected
+		}
+		const int64_t timestamp = useLF ? frame.LF.timestamp : frame.RF.timestamp;
+
+		// load sensor images
+		cv::Mat LFImage(frame.LF.height, frame.LF.width, CV_8U, (void*)frame.LF.image.data());
+		cv::Mat RFImage(frame.RF.height, frame.RF.width, CV_8U, (void*)frame.RF.image.data());
+
+		// camera poses let the tracking mode predict where the markers moved to
+		cv::Matx44d LFToWorld = CameraToWorld(frame.LF);
+		cv::Matx44d RFToWorld = CameraToWorld(frame.RF);
+
+		// detect markers & estimate their poses with the persistent detectors
+		m_markers.clear();
+		if (useLF && useRF)
+		{
+			// both cameras at the same time, results are merged & tagged with the camera,
+			// markers found on both images are then triangulated when stereo is enabled
+			m_frontCamerasDetector.Process(LFImage, RFImage, m_markers, &LFToWorld, &RFToWorld);
+			TraceScope stereo("stereo");
+			m_stereo.Process(m_markers);
+		}
+		else if (useLF)
+		{
+			m_LFDetector.Process(LFImage, m_markers, &LFToWorld);
+		}
+		else
+		{
+			m_RFDetector.Process(RFImage, m_markers, &RFToWorld);
+		}
+
+		// world pose of each marker feeds its filter, sensor time of the camera it was seen by
+		{
+			TraceScope filter("pose filter");
+			for (const MarkerPose& marker : m_markers)
+			{
+				bool right = marker.camera == RightFrontCamera;
+				cv::Matx33d R;
+				cv::Rodrigues(marker.rvec, R);
+				cv::Matx44d markerToCamera(
+					R(0, 0), R(0, 1), R(0, 2), marker.tvec[0],
+					R(1, 0), R(1, 1), R(1, 2), marker.tvec[1],
+					R(2, 0), R(2, 1), R(2, 2), marker.tvec[2],
+					0, 0, 0, 1);
+				m_poseFilter.Update(marker.id, (right ? RFToWorld : LFToWorld) * markerToCamera, right ? frame.RF.timestamp : frame.LF.timestamp);
+			}
+			m_poseFilter.RemoveStale(timestamp);
+		}
+
+		{
+			std::lock_guard<std::mutex> l(m_mutex);
+			m_stats.processed++;
+			m_stats.markers += int64_t(m_markers.size());
+			m_stats.lastProcessingTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t1).count();
+		}
+
+		if (m_resultCallback)
+		{
+			ScopedLatency publication(&m_latencies, LatencyStage::Publication);
+			TraceScope publish("publish results");
+			m_resultCallback(frame, m_markers);
+		}
+	}
+
+	PipelineStats FrontCamerasPipeline::GetStats() const
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		return m_stats;
+	}
+
+	void FrontCamerasPipeline::ResetStats()
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		m_stats = PipelineStats();
+	}
+
+	cv::Matx44d FrontCamerasPipeline::CameraToWorld(const CameraFrame& frame)
+	{
+		// stored as a DirectX row vector matrix, transposed for column vectors. The research mode
+		// camera unit plane is at z = 1, so the camera axes already match OpenCV's.
+		cv::Matx44d m;
+		for (int r = 0; r < 4; r++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				m(r, c) = frame.cameraToWorld[c * 4 + r];
+			}
+		}
+		return m;
+	}
+
+	void FrontCamerasPipeline::SetCameraToWorld(CameraFrame& frame, const cv::Matx44d& cameraToWorld)
+	{
+		for (int r = 0; r < 4; r++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				frame.cameraToWorld[c * 4 + r] = float(cameraToWorld(r, c));
+			}
+		}
+	}
+}
@@ -0,0 +1,127 @@
+#pragma once
+// The front camera pipeline of the research mode plugin without the sensors:
+// frames of a FrameSource are paired by host ticks, located with the rig pose
+// (pose history or source), handed to a detection thread through the frame
+// queue, detected on the selected camera(s), triangulated, and fed to the pose
+// filter. The owner publishes images & results from two callbacks. The plugin
+// drives it with the research mode sensors, the Linux tools with a replayed
+// session.
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "ArUcoDetectorSession.h"
+#include "FrameQueue.h"
+#include "FrameSource.h"
+#include "FrontCamerasDetector.h"
+#include "FrontCamerasFrame.h"
+#include "LatencyHistogram.h"
+#include "MarkerPoseFilter.h"
+#include "RigPoseHistory.h"
+#include "StereoFramePairer.h"
+#include "StereoMarkerTriangulator.h"
+#include "TraceRing.h"
+
+namespace HoloLens2CV
+{
+    struct PipelineSettings
+    {
+        int sensor = 2;                 // 0: LF, 1: RF, 2: both, like the plugin's sensor argument
+        bool detect = true;             // false only pairs, locates & hands frames to the frame callback
+        bool synchronous = false;       // detection on the acquisition thread, no frame is dropped (replays), read by Run
+    };
+
+    struct PipelineStats
+    {
+        int64_t frames = 0;             // frames read from the source
+        int64_t located = 0;            // pairs or single frames with a rig pose
+        int64_t unlocated = 0;          // pairs or single frames dropped without a rig pose
+        int64_t processed = 0;          // pairs or single frames detected
+        int64_t markers = 0;            // markers reported in total
+        double lastProcessingTime = 0.0;    // ms, detection to filter update of the last processed frame
+    };
+
+    class FrontCamerasPipeline
+    {
+    public:
+        // acquisition thread, a located pair or single frame (e.g. to publish its images)
+        using FrameCallback = std::function<void(const FrontCamerasFrame& frame)>;
+
+        // detection thread, markers of a processed frame relative to the camera they were seen by
+        using ResultCallback = std::function<void(const FrontCamerasFrame& frame, const std::vector<MarkerPose>& markers)>;
+
+        FrontCamerasPipeline();
+        FrontCamerasPipeline(const FrontCamerasPipeline&) = delete;
+        FrontCamerasPipeline& operator=(const FrontCamerasPipeline&) = delete;
+
+        void Configure(const PipelineSettings& settings);
+
+        // camera (LF / RF) to rig transform, column vectors, from the sensor extrinsics
+        void SetCameraToRig(int camera, const cv::Matx44d& cameraToRig);
+
+        // set before Run
+        void SetFrameCallback(FrameCallback callback) { m_frameCallback = std::move(callback); }
+        void SetResultCallback(ResultCallback callback) { m_resultCallback = std::move(callback); }
+
+        // Reads source on the calling thread until it ends or Stop is called, detection runs on a
+        // thread of its own unless synchronous. Frames are located with poses: through the pose
+        // history sampling it when usePoseHistory, else directly; without poses the rig stays at
+        // the world origin. The queued frames are processed before Run returns.
+        void Run(FrameSource& source, RigPoseSource* poses, bool usePoseHistory);
+        void Stop();
+
+        // components, configured by the owner
+        ArUcoDetectorSession& LFDetector() { return m_LFDetector; }
+        ArUcoDetectorSession& RFDetector() { return m_RFDetector; }
+        StereoMarkerTriangulator& Stereo() { return m_stereo; }
+        MarkerPoseFilter& PoseFilter() { return m_poseFilter; }
+        StereoFramePairer& Pairer() { return m_pairer; }
+        RigPoseHistory& PoseHistory() { return m_poseHistory; }
+        FrameQueue<FrontCamerasFrame>& Queue() { return m_frameQueue; }
+
+        PipelineStats GetStats() const;
+        void ResetStats();
+
+        // microsecond histograms of every stage, recorded by the pipeline & its detectors
+        StageLatencies& Latencies() { return m_latencies; }
+
+        // camera to world of a frame as OpenCV matrix (column vectors) & back, the frame
+        // keeps it in the DirectX layout the plugin hands to Unity
+        static cv::Matx44d CameraToWorld(const CameraFrame& frame);
+        static void SetCameraToWorld(CameraFrame& frame, const cv::Matx44d& cameraToWorld);
+
+    private:
+        static void DetectionLoop(FrontCamerasPipeline* pipeline);
+
+        // rig to world at the time of frame, false if there is no pose for it
+        bool LocateRig(RigPoseSource* poses, const CameraFrame& frame, cv::Matx44d& rigToWorld);
+
+        // detection, triangulation & pose filter of one pair or single frame
+        void Process(const FrontCamerasFrame& frame);
+
+        mutable std::mutex m_mutex;     // settings, extrinsics & stats
+        PipelineSettings m_settings;
+        cv::Matx44d m_cameraToRig[2] = { cv::Matx44d::eye(), cv::Matx44d::eye() };
+        PipelineStats m_stats;
+        StageLatencies m_latencies;
+
+        FrameCallback m_frameCallback;
+        ResultCallback m_resultCallback;
+        std::atomic_bool m_running = false;
+        FrameSource* m_source = nullptr;
+
+        // detectors are built by the owner's configuration and reused for every frame
+        ArUcoDetectorSession m_LFDetector{ LeftFrontCamera };
+        ArUcoDetectorSession m_RFDetector{ RightFrontCamera };
+        FrontCamerasDetector m_frontCamerasDetector{ m_LFDetector, m_RFDetector };     // sensor == 2
+        StereoMarkerTriangulator m_stereo;
+        MarkerPoseFilter m_poseFilter;
+
+        StereoFramePairer m_pairer;
+        RigPoseHistory m_poseHistory;
+        FrameQueue<FrontCamerasFrame> m_frameQueue;
+        std::vector<MarkerPose> m_markers;  // detection thread
+    };
+}
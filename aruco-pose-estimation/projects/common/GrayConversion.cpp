@@ -0,0 +1,400 @@
+#include "GrayConversion.h"
+
+#include <cstring>
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define HL2CV_GRAY_NEON 1
+#include <arm_neon.h>
+#elif defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define HL2CV_GRAY_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// AVX2 code is compiled per function, the rest of the build stays at the baseline
+#if defined(HL2CV_GRAY_X86) && (defined(__GNUC__) || defined(__clang__))
+#define HL2CV_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define HL2CV_TARGET_AVX2
+#endif
+
+namespace HoloLens2CV
+{
+	namespace
+	{
+		// cvtColor BGR2GRAY weights, 14 bit fixed point, they sum up to 1 << 14
+		constexpr uint32_t kB = 1868;
+		constexpr uint32_t kG = 9617;
+		constexpr uint32_t kR = 4899;
+		constexpr int kShift = 14;
+
+		// 14 bits of the weights plus 2 per halving of width & height
+		int ShiftOf(int factor)
+		{
+			return kShift + (factor == 4 ? 4 : factor == 2 ? 2 : 0);
+		}
+
+		// output pixels [x0, x1) of row y, the reference for every other kernel
+		void ScalarRow(const uint8_t* bgra, size_t bgraStride, int y, int x0, int x1, uint8_t* out, int factor)
+		{
+			const int shift = ShiftOf(factor);
+			const uint32_t round = 1u << (shift - 1);
+			for (int x = x0; x < x1; x++)
+			{
+				uint32_t sum = 0;
+				for (int r = 0; r < factor; r++)
+				{
+					const uint8_t* p = bgra + size_t(y * factor + r) * bgraStride + size_t(x) * factor * 4;
+					for (int c = 0; c < factor; c++, p += 4)
+					{
+						sum += p[0] * kB + p[1] * kG + p[2] * kR;
+					}
+				}
+				out[x] = uint8_t((sum + round) >> shift);
+			}
+		}
+
+		void ScalarKernel(const uint8_t* bgra, size_t bgraStride, int outWidth, int outHeight, uint8_t* gray, size_t grayStride, int factor)
+		{
+			for (int y = 0; y < outHeight; y++)
+			{
+				ScalarRow(bgra, bgraStride, y, 0, outWidth, gray + size_t(y) * grayStride, factor);
+			}
+		}
+
+#if defined(HL2CV_GRAY_X86)
+		// [a0 + a1, a2 + a3, b0 + b1, b2 + b3]
+		inline __m128i PairSums(__m128i a, __m128i b)
+		{
+			__m128 fa = _mm_castsi128_ps(a), fb = _mm_castsi128_ps(b);
+			return _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(fa, fb, _MM_SHUFFLE(2, 0, 2, 0))),
+				_mm_castps_si128(_mm_shuffle_ps(fa, fb, _MM_SHUFFLE(3, 1, 3, 1))));
+		}
+
+		// unrounded luma of 4 pixels: B * kB + G * kG per pixel & R * kR + A * 0, then the pairs added
+		inline __m128i Luma4(const uint8_t* p, __m128i weights)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i*)p);
+			__m128i zero = _mm_setzero_si128();
+			return PairSums(_mm_madd_epi16(_mm_unpacklo_epi8(v, zero), weights), _mm_madd_epi16(_mm_unpackhi_epi8(v, zero), weights));
+		}
+
+		void Sse2Kernel(const uint8_t* bgra, size_t bgraStride, int outWidth, int outHeight, uint8_t* gray, size_t grayStride, int factor)
+		{
+			const __m128i weights = _mm_setr_epi16(kB, kG, kR, 0, kB, kG, kR, 0);
+			const int shift = ShiftOf(factor);
+			const __m128i round = _mm_set1_epi32(1 << (shift - 1));
+			const __m128i count = _mm_cvtsi32_si128(shift);
+			const int step = 16 / factor;      // output pixels per 16 input pixels
+
+			for (int y = 0; y < outHeight; y++)
+			{
+				uint8_t* out = gray + size_t(y) * grayStride;
+				int x = 0;
+				for (; x + step <= outWidth; x += step)
+				{
+					// 16 pixels of every row of the block, summed up vertically
+					__m128i s[4] = { _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128() };
+					for (int r = 0; r < factor; r++)
+					{
+						const uint8_t* p = bgra + size_t(y * factor + r) * bgraStride + size_t(x) * factor * 4;
+						for (int k = 0; k < 4; k++)
+						{
+							s[k] = _mm_add_epi32(s[k], Luma4(p + 16 * k, weights));
+						}
+					}
+
+					// then horizontally, neighbours once per halving
+					int n = 4;
+					for (int f = factor; f > 1; f >>= 1, n >>= 1)
+					{
+						for (int k = 0; k < n / 2; k++)
+						{
+							s[k] = PairSums(s[2 * k], s[2 * k + 1]);
+						}
+					}
+					for (int k = 0; k < n; k++)
+					{
+						s[k] = _mm_srl_epi32(_mm_add_epi32(s[k], round), count);
+					}
+
+					if (n == 4)
+					{
+						_mm_storeu_si128((__m128i*)(out + x), _mm_packus_epi16(_mm_packs_epi32(s[0], s[1]), _mm_packs_epi32(s[2], s[3])));
+					}
+					else if (n == 2)
+					{
+						__m128i words = _mm_packs_epi32(s[0], s[1]);
+						_mm_storel_epi64((__m128i*)(out + x), _mm_packus_epi16(words, words));
+					}
+					else
+					{
+						__m128i words = _mm_packs_epi32(s[0], s[0]);
+						int32_t bytes = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+						std::memcpy(out + x, &bytes, 4);
+					}
+				}
+				ScalarRow(bgra, bgraStride, y, x, outWidth, out, factor);
+			}
+		}
+
+		// AVX2 shuffles & packs work per 128 bit lane, this puts the 64 bit quarters back in order
+		HL2CV_TARGET_AVX2 inline __m256i InOrder(__m256i v)
+		{
+			return _mm256_permute4x64_epi64(v, _MM_SHUFFLE(3, 1, 2, 0));
+		}
+
+		HL2CV_TARGET_AVX2 inline __m256i PairSums(__m256i a, __m256i b)
+		{
+			__m256 fa = _mm256_castsi256_ps(a), fb = _mm256_castsi256_ps(b);
+			return InOrder(_mm256_add_epi32(_mm256_castps_si256(_mm256_shuffle_ps(fa, fb, _MM_SHUFFLE(2, 0, 2, 0))),
+				_mm256_castps_si256(_mm256_shuffle_ps(fa, fb, _MM_SHUFFLE(3, 1, 3, 1)))));
+		}
+
+		// unrounded luma of 8 pixels, the unpacking keeps them in order within the lanes
+		HL2CV_TARGET_AVX2 inline __m256i Luma8(const uint8_t* p, __m256i weights)
+		{
+			__m256i v = _mm256_loadu_si256((const __m256i*)p);
+			__m256i zero = _mm256_setzero_si256();
+			__m256 lo = _mm256_castsi256_ps(_mm256_madd_epi16(_mm256_unpacklo_epi8(v, zero), weights));
+			__m256 hi = _mm256_castsi256_ps(_mm256_madd_epi16(_mm256_unpackhi_epi8(v, zero), weights));
+			return _mm256_add_epi32(_mm256_castps_si256(_mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0))),
+				_mm256_castps_si256(_mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1))));
+		}
+
+		HL2CV_TARGET_AVX2 void Avx2Kernel(const uint8_t* bgra, size_t bgraStride, int outWidth, int outHeight, uint8_t* gray, size_t grayStride, int factor)
+		{
+			const __m256i weights = _mm256_setr_epi16(kB, kG, kR, 0, kB, kG, kR, 0, kB, kG, kR, 0, kB, kG, kR, 0);
+			const int shift = ShiftOf(factor);
+			const __m256i round = _mm256_set1_epi32(1 << (shift - 1));
+			const __m128i count = _mm_cvtsi32_si128(shift);
+			const int step = 32 / factor;      // output pixels per 32 input pixels
+
+			for (int y = 0; y < outHeight; y++)
+			{
+				uint8_t* out = gray + size_t(y) * grayStride;
+				int x = 0;
+				for (; x + step <= outWidth; x += step)
+				{
+					__m256i s[4] = { _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256() };
+					for (int r = 0; r < factor; r++)
+					{
+						const uint8_t* p = bgra + size_t(y * factor + r) * bgraStride + size_t(x) * factor * 4;
+						for (int k = 0; k < 4; k++)
+						{
+							s[k] = _mm256_add_epi32(s[k], Luma8(p + 32 * k, weights));
+						}
+					}
+
+					int n = 4;
+					for (int f = factor; f > 1; f >>= 1, n >>= 1)
+					{
+						for (int k = 0; k < n / 2; k++)
+						{
+							s[k] = PairSums(s[2 * k], s[2 * k + 1]);
+						}
+					}
+					for (int k = 0; k < n; k++)
+					{
+						s[k] = _mm256_srl_epi32(_mm256_add_epi32(s[k], round), count);
+					}
+
+					if (n == 4)
+					{
+						__m256i low = InOrder(_mm256_packs_epi32(s[0], s[1]));
+						__m256i high = InOrder(_mm256_packs_epi32(s[2], s[3]));
+						_mm256_storeu_si256((__m256i*)(out + x), InOrder(_mm256_packus_epi16(low, high)));
+					}
+					else if (n == 2)
+					{
+						__m256i words = InOrder(_mm256_packs_epi32(s[0], s[1]));
+						_mm_storeu_si128((__m128i*)(out + x), _mm256_castsi256_si128(InOrder(_mm256_packus_epi16(words, words))));
+					}
+					else
+					{
+						__m256i words = InOrder(_mm256_packs_epi32(s[0], s[0]));
+						_mm_storel_epi64((__m128i*)(out + x), _mm256_castsi256_si128(_mm256_packus_epi16(words, words)));
+					}
+				}
+				ScalarRow(bgra, bgraStride, y, x, outWidth, out, factor);
+			}
+		}
+
+		bool CpuHasAvx2()
+		{
+#if defined(_MSC_VER) && !defined(__clang__)
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7)
+			{
+				return false;
+			}
+			// the OS must save the YMM registers too
+			__cpuid(info, 1);
+			bool osxsave = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0;
+			if (!osxsave || (_xgetbv(0) & 6) != 6)
+			{
+				return false;
+			}
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+#else
+			return __builtin_cpu_supports("avx2");
+#endif
+		}
+#endif
+
+#if defined(HL2CV_GRAY_NEON)
+		void NeonKernel(const uint8_t* bgra, size_t bgraStride, int outWidth, int outHeight, uint8_t* gray, size_t grayStride, int factor)
+		{
+			const int shift = ShiftOf(factor);
+			const uint32x4_t round = vdupq_n_u32(1u << (shift - 1));
+			const int32x4_t count = vdupq_n_s32(-shift);
+			const int step = 16 / factor;      // output pixels per 16 input pixels
+
+			for (int y = 0; y < outHeight; y++)
+			{
+				uint8_t* out = gray + size_t(y) * grayStride;
+				int x = 0;
+				for (; x + step <= outWidth; x += step)
+				{
+					// the interleaved load splits B, G, R & A of 16 pixels
+					uint32x4_t s[4] = { vdupq_n_u32(0), vdupq_n_u32(0), vdupq_n_u32(0), vdupq_n_u32(0) };
+					for (int r = 0; r < factor; r++)
+					{
+						uint8x16x4_t v = vld4q_u8(bgra + size_t(y * factor + r) * bgraStride + size_t(x) * factor * 4);
+						uint16x8_t b[2] = { vmovl_u8(vget_low_u8(v.val[0])), vmovl_u8(vget_high_u8(v.val[0])) };
+						uint16x8_t g[2] = { vmovl_u8(vget_low_u8(v.val[1])), vmovl_u8(vget_high_u8(v.val[1])) };
+						uint16x8_t c[2] = { vmovl_u8(vget_low_u8(v.val[2])), vmovl_u8(vget_high_u8(v.val[2])) };
+						for (int h = 0; h < 2; h++)
+						{
+							uint32x4_t& low = s[2 * h];
+							uint32x4_t& high = s[2 * h + 1];
+							low = vmlal_n_u16(low, vget_low_u16(b[h]), kB);
+							low = vmlal_n_u16(low, vget_low_u16(g[h]), kG);
+							low = vmlal_n_u16(low, vget_low_u16(c[h]), kR);
+							high = vmlal_n_u16(high, vget_high_u16(b[h]), kB);
+							high = vmlal_n_u16(high, vget_high_u16(g[h]), kG);
+							high = vmlal_n_u16(high, vget_high_u16(c[h]), kR);
+						}
+					}
+
+					int n = 4;
+					for (int f = factor; f > 1; f >>= 1, n >>= 1)
+					{
+						for (int k = 0; k < n / 2; k++)
+						{
+							s[k] = vpaddq_u32(s[2 * k], s[2 * k + 1]);
+						}
+					}
+					for (int k = 0; k < n; k++)
+					{
+						s[k] = vshlq_u32(vaddq_u32(s[k], round), count);
+					}
+
+					if (n == 4)
+					{
+						uint16x8_t low = vcombine_u16(vmovn_u32(s[0]), vmovn_u32(s[1]));
+						uint16x8_t high = vcombine_u16(vmovn_u32(s[2]), vmovn_u32(s[3]));
+						vst1q_u8(out + x, vcombine_u8(vqmovn_u16(low), vqmovn_u16(high)));
+					}
+					else if (n == 2)
+					{
+						vst1_u8(out + x, vqmovn_u16(vcombine_u16(vmovn_u32(s[0]), vmovn_u32(s[1]))));
+					}
+					else
+					{
+						uint8x8_t bytes = vqmovn_u16(vcombine_u16(vmovn_u32(s[0]), vmovn_u32(s[0])));
+						vst1_lane_u32((uint32_t*)(out + x), vreinterpret_u32_u8(bytes), 0);
+					}
+				}
+				ScalarRow(bgra, bgraStride, y, x, outWidth, out, factor);
+			}
+		}
+#endif
+	}
+
+	bool IsGrayKernelSupported(GrayKernel kernel)
+	{
+		switch (kernel)
+		{
+		case GrayKernel::Scalar:
+			return true;
+#if defined(HL2CV_GRAY_X86)
+		case GrayKernel::Sse2:
+			return true;
+		case GrayKernel::Avx2:
+		{
+			static const bool avx2 = CpuHasAvx2();
+			return avx2;
+		}
+#endif
+#if defined(HL2CV_GRAY_NEON)
+		case GrayKernel::Neon:
+			return true;
+#endif
+		default:
+			return false;
+		}
+	}
+
+	GrayKernel BestGrayKernel()
+	{
+		static const GrayKernel best =
+			IsGrayKernelSupported(GrayKernel::Neon) ? GrayKernel::Neon :
+			IsGrayKernelSupported(GrayKernel::Avx2) ? GrayKernel::Avx2 :
+			IsGrayKernelSupported(GrayKernel::Sse2) ? GrayKernel::Sse2 : GrayKernel::Scalar;
+		return best;
+	}
+
+	const char* GrayKernelName(GrayKernel kernel)
+	{
+		switch (kernel)
+		{
+		case GrayKernel::Scalar: return "scalar";
+		case GrayKernel::Sse2: return "SSE2";
+		case GrayKernel::Avx2: return "AVX2";
+		case GrayKernel::Neon: return "NEON";
+		}
+		return "unknown";
+	}
+
+	bool BgraToGray(const uint8_t* bgra, size_t bgraStride, int width, int height,
+		uint8_t* gray, size_t grayStride, int factor, GrayKernel kernel)
+	{
+		const int outWidth = factor > 0 ? width / factor : 0;
+		const int outHeight = factor > 0 ? height / factor : 0;
+		if ((factor != 1 && factor != 2 && factor != 4) || outWidth <= 0 || outHeight <= 0 || !IsGrayKernelSupported(kernel))
+		{
+			return false;
+		}
+
+		switch (kernel)
+		{
+#if defined(HL2CV_GRAY_X86)
+		case GrayKernel::Sse2:
+			Sse2Kernel(bgra, bgraStride, outWidth, outHeight, gray, grayStride, factor);
+			return true;
+		case GrayKernel::Avx2:
+			Avx2Kernel(bgra, bgraStride, outWidth, outHeight, gray, grayStride, factor);
+			return true;
+#endif
+#if defined(HL2CV_GRAY_NEON)
+		case GrayKernel::Neon:
+			NeonKernel(bgra, bgraStride, outWidth, outHeight, gray, grayStride, factor);
+			return true;
+#endif
+		default:
+			ScalarKernel(bgra, bgraStride, outWidth, outHeight, gray, grayStride, factor);
+			return true;
+		}
+	}
+
+	bool BgraToGray(const uint8_t* bgra, size_t bgraStride, int width, int height,
+		uint8_t* gray, size_t grayStride, int factor)
+	{
+		return BgraToGray(bgra, bgraStride, width, height, gray, grayStride, factor, BestGrayKernel());
+	}
+}
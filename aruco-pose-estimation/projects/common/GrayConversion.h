@@ -0,0 +1,42 @@
+#pragma once
+// BGRA to 8 bit luma in one pass over the image, optionally decimated by 2 or
+// 4 (the mean of each 2x2 / 4x4 block) in the same pass. Replaces cvtColor
+// followed by resize, which read & write the full image twice. Luma uses the
+// fixed point BT.601 weights of cvtColor (BGRA2GRAY), at factor 1 the result
+// is identical to it; decimated, the block mean is taken before rounding.
+//
+// Hand vectorized for NEON (ARM64 HoloLens), SSE2 and AVX2 (x64 development
+// machines), the scalar kernel is the reference all of them match bit by bit.
+// Independent of OpenCV.
+
+#include <cstddef>
+#include <cstdint>
+
+namespace HoloLens2CV
+{
+    enum class GrayKernel
+    {
+        Scalar = 0,
+        Sse2 = 1,
+        Avx2 = 2,
+        Neon = 3
+    };
+
+    // compiled in & supported by the CPU, Scalar always is
+    bool IsGrayKernelSupported(GrayKernel kernel);
+
+    // fastest supported kernel, checked once
+    GrayKernel BestGrayKernel();
+
+    const char* GrayKernelName(GrayKernel kernel);
+
+    // Writes width / factor x height / factor luma pixels, rows & columns beyond the last
+    // full block are ignored. factor is 1, 2 or 4, returns false for any other factor,
+    // an unsupported kernel or an image smaller than one block.
+    bool BgraToGray(const uint8_t* bgra, size_t bgraStride, int width, int height,
+        uint8_t* gray, size_t grayStride, int factor, GrayKernel kernel);
+
+    // with the best kernel
+    bool BgraToGray(const uint8_t* bgra, size_t bgraStride, int width, int height,
+        uint8_t* gray, size_t grayStride, int factor = 1);
+}
@@ -0,0 +1,74 @@
+#include "ImageView.h"
+
+#include "GrayConversion.h"
+
+namespace HoloLens2CV
+{
+	int PlaneBytesPerPixel(PixelFormat format)
+	{
+		switch (format)
+		{
+		case PixelFormat::Gray8:
+		case PixelFormat::Nv12:
+			return 1;
+		case PixelFormat::Yuy2:
+			return 2;
+		case PixelFormat::Bgra8:
+			return 4;
+		}
+		return 0;
+	}
+
+	bool IsValid(const ImageView& view)
+	{
+		int bytesPerPixel = PlaneBytesPerPixel(view.format);
+		if (bytesPerPixel == 0 || view.data == nullptr || view.width <= 0 || view.height <= 0)
+		{
+			return false;
+		}
+
+		// YUY2 pixels come in pairs sharing their chroma
+		if (view.format == PixelFormat::Yuy2 && view.width % 2 != 0)
+		{
+			return false;
+		}
+
+		// the last row needs no padding
+		size_t row = size_t(view.width) * size_t(bytesPerPixel);
+		return view.stride >= row && view.stride * size_t(view.height - 1) + row <= view.size;
+	}
+
+	bool HasLumaPlane(PixelFormat format)
+	{
+		return format == PixelFormat::Gray8 || format == PixelFormat::Nv12;
+	}
+
+	cv::Mat LumaOf(const ImageView& view, cv::Mat& scratch)
+	{
+		if (!IsValid(view))
+		{
+			return cv::Mat();
+		}
+
+		void* data = const_cast<uint8_t*>(view.data);
+		switch (view.format)
+		{
+		case PixelFormat::Gray8:
+		case PixelFormat::Nv12:
+			// the luma plane as it is, the stride skips the row padding
+			return cv::Mat(view.height, view.width, CV_8U, data, view.stride);
+
+		case PixelFormat::Yuy2:
+			// every other byte, Y0 U Y1 V
+			cv::cvtColor(cv::Mat(view.height, view.width, CV_8UC2, data, view.stride), scratch, cv::COLOR_YUV2GRAY_YUY2);
+			return scratch;
+
+		case PixelFormat::Bgra8:
+			// vectorized, same result as cvtColor BGRA2GRAY
+			scratch.create(view.height, view.width, CV_8U);
+			BgraToGray(view.data, view.stride, view.width, view.height, scratch.data, scratch.step, 1);
+			return scratch;
+		}
+		return cv::Mat();
+	}
+}
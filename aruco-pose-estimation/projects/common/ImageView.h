@@ -0,0 +1,51 @@
+#pragma once
+// Non-owning view of a camera frame in one of the pixel formats the capture
+// paths deliver. Marker detection only needs the luma: gray frames and the
+// first plane of NV12 frames are wrapped as they are, without a conversion or
+// a copy. YUY2 interleaves luma & chroma and BGRA has no luma at all, both are
+// converted into a scratch image of the caller.
+//
+// NV12 / YUY2 luma is video range (16 - 235) while the BGRA conversion spans
+// the full range, the adaptive thresholding of the detector is indifferent to
+// the offset.
+
+#include <cstddef>
+#include <cstdint>
+
+#include <opencv2/opencv.hpp>	// for opencv 4.8+
+
+namespace HoloLens2CV
+{
+    // same values as BitmapPixelFormat where one exists
+    enum class PixelFormat
+    {
+        Gray8 = 62,
+        Nv12 = 103,
+        Yuy2 = 107,
+        Bgra8 = 87
+    };
+
+    struct ImageView
+    {
+        PixelFormat format = PixelFormat::Bgra8;
+        int width = 0;
+        int height = 0;
+        const uint8_t* data = nullptr;  // first row of the luma plane, of the packed pixels for YUY2 & BGRA
+        size_t stride = 0;              // bytes from one row of that plane to the next
+        size_t size = 0;                // bytes readable from data on, the rows must fit
+    };
+
+    // bytes per pixel of the plane data points to: 1 (gray, NV12 luma), 2 (YUY2) or 4 (BGRA)
+    int PlaneBytesPerPixel(PixelFormat format);
+
+    // known format, positive size, stride wide enough & all rows inside size
+    bool IsValid(const ImageView& view);
+
+    // the luma is a plane of its own, LumaOf wraps the frame memory
+    bool HasLumaPlane(PixelFormat format);
+
+    // 8 bit luma of the view. Gray & NV12 frames are wrapped (the result shares the
+    // frame memory, valid as long as it is), YUY2 & BGRA are converted into scratch,
+    // which keeps its allocation between frames. Empty for an invalid view.
+    cv::Mat LumaOf(const ImageView& view, cv::Mat& scratch);
+}
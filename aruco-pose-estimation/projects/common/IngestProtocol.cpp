@@ -0,0 +1,143 @@
+#include "IngestProtocol.h"
+
+#include <algorithm>
+
+namespace HoloLens2CV
+{
+	static int64_t ReadBigEndian(const uint8_t* bytes, int count)
+	{
+		uint64_t value = 0;
+		for (int i = 0; i < count; i++)
+		{
+			value = (value << 8) | bytes[i];
+		}
+		// sign extended, the length is an Int32
+		return count == 4 ? int64_t(int32_t(uint32_t(value))) : int64_t(value);
+	}
+
+	static void WriteBigEndian(uint64_t value, int count, std::vector<uint8_t>& out)
+	{
+		for (int i = count - 1; i >= 0; i--)
+		{
+			out.push_back(uint8_t(value >> (8 * i)));
+		}
+	}
+
+	int IngestTimestampCount(IngestMessageType type)
+	{
+		switch (type)
+		{
+		case IngestMessageType::PvImage:
+			return 1;
+		case IngestMessageType::SpatialImages:
+		case IngestMessageType::CompressedSpatialImages:
+			return 2;
+		case IngestMessageType::MarkerText:
+		case IngestMessageType::MarkerTelemetry:
+			return 0;
+		}
+		return 0;
+	}
+
+	size_t IngestHeaderSize(IngestMessageType type)
+	{
+		switch (type)
+		{
+		case IngestMessageType::PvImage:
+		case IngestMessageType::SpatialImages:
+		case IngestMessageType::CompressedSpatialImages:
+		case IngestMessageType::MarkerText:
+		case IngestMessageType::MarkerTelemetry:
+			return 4 + 8 * size_t(IngestTimestampCount(type));
+		}
+		return 0;
+	}
+
+	void EncodeIngestMessage(const IngestMessage& message, std::vector<uint8_t>& out)
+	{
+		out.push_back(uint8_t(message.type));
+		WriteBigEndian(uint32_t(message.payload.size()), 4, out);
+		for (int i = 0; i < IngestTimestampCount(message.type); i++)
+		{
+			WriteBigEndian(uint64_t(message.timestamps[i]), 8, out);
+		}
+		out.insert(out.end(), message.payload.begin(), message.payload.end());
+	}
+
+	IngestStreamDecoder::IngestStreamDecoder(size_t maxPayload)
+		: m_maxPayload(std::min(maxPayload, size_t(INT32_MAX)))
+	{
+	}
+
+	bool IngestStreamDecoder::Feed(const uint8_t* data, size_t size, std::vector<IngestMessage>& messages)
+	{
+		m_bytes += int64_t(size);
+		while (size > 0 && m_error == nullptr)
+		{
+			switch (m_state)
+			{
+			case State::Type:
+				m_current.type = IngestMessageType(*data);
+				m_headerSize = IngestHeaderSize(m_current.type);
+				if (m_headerSize == 0)
+				{
+					m_error = "unknown message type";
+					break;
+				}
+				m_headerFilled = 0;
+				m_state = State::Header;
+				data++;
+				size--;
+				break;
+
+			case State::Header:
+			{
+				size_t count = std::min(size, m_headerSize - m_headerFilled);
+				std::copy(data, data + count, m_header + m_headerFilled);
+				m_headerFilled += count;
+				data += count;
+				size -= count;
+				if (m_headerFilled < m_headerSize)
+				{
+					break;
+				}
+
+				int64_t length = ReadBigEndian(m_header, 4);
+				if (length < 0 || size_t(length) > m_maxPayload)
+				{
+					m_error = "message length out of range";
+					break;
+				}
+				for (int i = 0; i < 2; i++)
+				{
+					m_current.timestamps[i] = i < IngestTimestampCount(m_current.type) ? ReadBigEndian(m_header + 4 + 8 * i, 8) : 0;
+				}
+				m_payloadSize = size_t(length);
+				m_current.payload.clear();
+				m_current.payload.reserve(m_payloadSize);
+				m_state = State::Payload;
+				break;
+			}
+
+			case State::Payload:
+			{
+				size_t count = std::min(size, m_payloadSize - m_current.payload.size());
+				m_current.payload.insert(m_current.payload.end(), data, data + count);
+				data += count;
+				size -= count;
+				break;
+			}
+			}
+
+			// an empty payload completes with its header
+			if (m_state == State::Payload && m_current.payload.size() == m_payloadSize)
+			{
+				messages.push_back(std::move(m_current));
+				m_current = IngestMessage();
+				m_messages++;
+				m_state = State::Type;
+			}
+		}
+		return m_error == nullptr;
+	}
+}
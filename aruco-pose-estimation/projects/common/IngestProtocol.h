@@ -0,0 +1,85 @@
+#pragma once
+// The messages the TCPClient scripts send to the PC, big endian like the UWP
+// DataWriter writes them:
+//   'p' | int32 length | int64 timestamp | length bytes of a BGRA PV image
+//   'f' | int32 length | int64 LF timestamp | int64 RF timestamp | LF & RF images, length / 2 bytes each
+//   'c' | int32 length | int64 LF timestamp | int64 RF timestamp | the pair encoded by StereoFrameCodec
+//   'm' | int32 length | length bytes of UTF-8 marker text
+//   't' | int32 length | a batch of marker records of one frame (MarkerTelemetry.h)
+// TCP delivers a byte stream, a read may end inside a message or hold several,
+// the decoder reassembles them from whatever chunks it is fed. Independent of
+// sockets & OpenCV.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace HoloLens2CV
+{
+    enum class IngestMessageType : uint8_t
+    {
+        PvImage = 'p',
+        SpatialImages = 'f',
+        CompressedSpatialImages = 'c',      // opt-in on the headset, older receivers only know 'f'
+        MarkerText = 'm',
+        MarkerTelemetry = 't'               // replaces 'm' in ArUcoTracking.cs, TCPServer.py prints both
+    };
+
+    // larger lengths are taken for a corrupt stream, a 1920x1080 BGRA frame is ~8 MB
+    constexpr size_t kMaxIngestPayload = 64 * 1024 * 1024;
+
+    struct IngestMessage
+    {
+        IngestMessageType type = IngestMessageType::MarkerText;
+        int64_t timestamps[2] = { 0, 0 };       // PV: [0], LF & RF: [0] & [1], marker text & telemetry: none
+        std::vector<uint8_t> payload;
+    };
+
+    // bytes between the type byte & the payload, 0 for an unknown type
+    size_t IngestHeaderSize(IngestMessageType type);
+
+    // 0 for an unknown type
+    int IngestTimestampCount(IngestMessageType type);
+
+    // appends the message as it goes on the wire
+    void EncodeIngestMessage(const IngestMessage& message, std::vector<uint8_t>& out);
+
+    class IngestStreamDecoder
+    {
+    public:
+        explicit IngestStreamDecoder(size_t maxPayload = kMaxIngestPayload);
+
+        // Consumes all of data, every message completed by it is appended to messages.
+        // Returns false on an unknown type or a length out of range, the stream cannot be
+        // resynchronized after that and further calls return false.
+        bool Feed(const uint8_t* data, size_t size, std::vector<IngestMessage>& messages);
+
+        bool Failed() const { return m_error != nullptr; }
+        const char* Error() const { return m_error; }
+
+        // between two messages, false when the stream ended inside one
+        bool AtBoundary() const { return m_state == State::Type && m_error == nullptr; }
+
+        int64_t Messages() const { return m_messages; }
+        int64_t Bytes() const { return m_bytes; }
+
+    private:
+        enum class State
+        {
+            Type,
+            Header,
+            Payload
+        };
+
+        size_t m_maxPayload;
+        State m_state = State::Type;
+        uint8_t m_header[20] = {};
+        size_t m_headerSize = 0;
+        size_t m_headerFilled = 0;
+        size_t m_payloadSize = 0;
+        IngestMessage m_current;
+        const char* m_error = nullptr;
+        int64_t m_messages = 0;
+        int64_t m_bytes = 0;
+    };
+}
@@ -0,0 +1,300 @@
+#include "IngestServer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace HoloLens2CV
+{
+	// reads per readiness event, level triggered epoll comes back for the rest so one busy
+	// headset cannot starve the others
+	static const int kReadsPerEvent = 16;
+
+	IngestServer::~IngestServer()
+	{
+		Stop();
+	}
+
+	void IngestServer::Fail(const char* call)
+	{
+		m_error = std::string(call) + ": " + std::strerror(errno);
+		for (int* fd : { &m_listen, &m_epoll, &m_wake })
+		{
+			if (*fd >= 0)
+			{
+				close(*fd);
+				*fd = -1;
+			}
+		}
+	}
+
+	bool IngestServer::Start(const IngestServerSettings& settings)
+	{
+		Stop();
+		m_settings = settings;
+		m_settings.readSize = std::max<size_t>(4096, settings.readSize);
+		m_error.clear();
+
+		sockaddr_in address = {};
+		address.sin_family = AF_INET;
+		address.sin_port = htons(uint16_t(settings.port));
+		if (inet_pton(AF_INET, settings.host.c_str(), &address.sin_addr) != 1)
+		{
+			m_error = "not an IPv4 address: " + settings.host;
+			return false;
+		}
+
+		m_listen = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		if (m_listen < 0)
+		{
+			Fail("socket");
+			return false;
+		}
+		int yes = 1;
+		setsockopt(m_listen, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+		if (bind(m_listen, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+		{
+			Fail("bind");
+			return false;
+		}
+		if (listen(m_listen, 16) != 0)
+		{
+			Fail("listen");
+			return false;
+		}
+		socklen_t length = sizeof(address);
+		getsockname(m_listen, reinterpret_cast<sockaddr*>(&address), &length);
+		m_port = ntohs(address.sin_port);
+
+		m_epoll = epoll_create1(EPOLL_CLOEXEC);
+		m_wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (m_epoll < 0 || m_wake < 0)
+		{
+			Fail("epoll");
+			return false;
+		}
+		for (int fd : { m_listen, m_wake })
+		{
+			epoll_event event = {};
+			event.events = EPOLLIN;
+			event.data.fd = fd;
+			epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &event);
+		}
+
+		m_buffer.resize(m_settings.readSize);
+		m_thread = std::thread(&IngestServer::Run, this);
+		return true;
+	}
+
+	void IngestServer::Stop()
+	{
+		if (m_thread.joinable())
+		{
+			uint64_t one = 1;
+			ssize_t written = write(m_wake, &one, sizeof(one));
+			(void)written;
+			m_thread.join();
+		}
+		for (int* fd : { &m_listen, &m_epoll, &m_wake })
+		{
+			if (*fd >= 0)
+			{
+				close(*fd);
+				*fd = -1;
+			}
+		}
+	}
+
+	std::vector<IngestConnectionStats> IngestServer::Stats() const
+	{
+		std::lock_guard<std::mutex> l(m_statsMutex);
+		std::vector<IngestConnectionStats> stats;
+		for (const auto& entry : m_stats)
+		{
+			stats.push_back(entry.second);
+		}
+		return stats;
+	}
+
+	void IngestServer::Run()
+	{
+		std::vector<epoll_event> events(64);
+		bool running = true;
+		while (running)
+		{
+			int count = epoll_wait(m_epoll, events.data(), int(events.size()), -1);
+			if (count < 0 && errno != EINTR)
+			{
+				break;
+			}
+			for (int i = 0; i < count; i++)
+			{
+				int fd = events[i].data.fd;
+				if (fd == m_wake)
+				{
+					running = false;
+				}
+				else if (fd == m_listen)
+				{
+					Accept();
+				}
+				else
+				{
+					// closed by an earlier event of this round
+					auto connection = m_connections.find(fd);
+					if (connection != m_connections.end())
+					{
+						Read(connection->second);
+					}
+				}
+			}
+		}
+
+		while (!m_connections.empty())
+		{
+			Close(m_connections.begin()->first, "server stopped");
+		}
+	}
+
+	void IngestServer::Accept()
+	{
+		while (true)
+		{
+			sockaddr_in address = {};
+			socklen_t length = sizeof(address);
+			int fd = accept4(m_listen, reinterpret_cast<sockaddr*>(&address), &length, SOCK_NONBLOCK | SOCK_CLOEXEC);
+			if (fd < 0)
+			{
+				// EAGAIN once the backlog is empty, errors of one client do not stop the others
+				return;
+			}
+
+			char peer[INET_ADDRSTRLEN] = {};
+			inet_ntop(AF_INET, &address.sin_addr, peer, sizeof(peer));
+			int id = m_nextId++;
+			m_accepted++;
+			if (int(m_connections.size()) >= m_settings.maxConnections)
+			{
+				close(fd);
+				if (m_connectionCallback)
+				{
+					m_connectionCallback(id, peer, "refused, too many connections");
+				}
+				continue;
+			}
+
+			// room for a few frames in flight while the callback blocks
+			int bufferSize = 8 * 1024 * 1024;
+			setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+
+			Connection& connection = m_connections.emplace(fd, Connection(m_settings.maxPayload)).first->second;
+			connection.fd = fd;
+			connection.stats.id = id;
+			connection.stats.peer = peer;
+			connection.stats.open = true;
+			{
+				std::lock_guard<std::mutex> l(m_statsMutex);
+				m_stats[id] = connection.stats;
+			}
+			m_open = int(m_connections.size());
+
+			epoll_event event = {};
+			event.events = EPOLLIN | EPOLLRDHUP;
+			event.data.fd = fd;
+			epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &event);
+			if (m_connectionCallback)
+			{
+				m_connectionCallback(id, peer, "connected");
+			}
+		}
+	}
+
+	void IngestServer::Read(Connection& connection)
+	{
+		const int fd = connection.fd;
+		std::string reason;
+		for (int r = 0; r < kReadsPerEvent && reason.empty(); r++)
+		{
+			ssize_t received = recv(fd, m_buffer.data(), m_buffer.size(), 0);
+			if (received < 0)
+			{
+				if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+				{
+					break;
+				}
+				reason = std::string("read failed, ") + std::strerror(errno);
+				break;
+			}
+			if (received == 0)
+			{
+				reason = connection.decoder.AtBoundary() ? "closed by the headset" : "closed by the headset inside a message";
+				break;
+			}
+
+			connection.stats.reads++;
+			connection.stats.bytes += received;
+			m_messages.clear();
+			bool valid = connection.decoder.Feed(m_buffer.data(), size_t(received), m_messages);
+			for (IngestMessage& message : m_messages)
+			{
+				switch (message.type)
+				{
+				case IngestMessageType::PvImage: connection.stats.pvImages++; break;
+				case IngestMessageType::SpatialImages: connection.stats.spatialImages++; break;
+				case IngestMessageType::CompressedSpatialImages: connection.stats.compressedSpatialImages++; break;
+				case IngestMessageType::MarkerText: connection.stats.markerTexts++; break;
+				case IngestMessageType::MarkerTelemetry: connection.stats.markerTelemetry++; break;
+				}
+				if (m_messageCallback)
+				{
+					m_messageCallback(connection.stats.id, connection.stats.peer, std::move(message));
+				}
+			}
+			if (!valid)
+			{
+				reason = std::string("protocol error, ") + connection.decoder.Error();
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> l(m_statsMutex);
+			m_stats[connection.stats.id] = connection.stats;
+		}
+		if (!reason.empty())
+		{
+			Close(fd, reason);
+		}
+	}
+
+	void IngestServer::Close(int fd, const std::string& reason)
+	{
+		auto connection = m_connections.find(fd);
+		if (connection == m_connections.end())
+		{
+			return;
+		}
+		epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+		close(fd);
+
+		IngestConnectionStats stats = connection->second.stats;
+		stats.open = false;
+		stats.closeReason = reason;
+		m_connections.erase(connection);
+		m_open = int(m_connections.size());
+		{
+			std::lock_guard<std::mutex> l(m_statsMutex);
+			m_stats[stats.id] = stats;
+		}
+		if (m_connectionCallback)
+		{
+			m_connectionCallback(stats.id, stats.peer, reason);
+		}
+	}
+}
@@ -0,0 +1,122 @@
+#pragma once
+// The PC end of the TCPClient scripts, replacing TCPServer.py: accepts any
+// number of headsets and reads all of them on one thread with epoll. Each
+// connection has its own IngestStreamDecoder, so messages split over reads or
+// sharing one are reassembled, and a corrupt stream only closes that headset.
+// Complete messages are handed to the message callback on the server thread,
+// which may block (e.g. FrameWriterPool::Submit): reading pauses and TCP flow
+// control slows the headsets down, nothing is dropped.
+//
+// Linux only (epoll, eventfd), IPv4.
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "IngestProtocol.h"
+
+namespace HoloLens2CV
+{
+    struct IngestServerSettings
+    {
+        std::string host = "0.0.0.0";       // address to listen on, e.g. the PC's address on the headset subnet
+        int port = 9090;                    // 0: any free port, see Port
+        int maxConnections = 16;            // further headsets are refused
+        size_t maxPayload = kMaxIngestPayload;
+        size_t readSize = 256 * 1024;       // bytes per read call
+    };
+
+    struct IngestConnectionStats
+    {
+        int id = 0;
+        std::string peer;                   // address of the headset
+        bool open = false;
+        int64_t pvImages = 0;
+        int64_t spatialImages = 0;
+        int64_t compressedSpatialImages = 0;
+        int64_t markerTexts = 0;
+        int64_t markerTelemetry = 0;        // 't' batches
+        int64_t bytes = 0;                  // received, framing included
+        int64_t reads = 0;
+        std::string closeReason;
+    };
+
+    class IngestServer
+    {
+    public:
+        // server thread, connection is an id unique for the server's lifetime
+        using MessageCallback = std::function<void(int connection, const std::string& peer, IngestMessage&& message)>;
+
+        // server thread, event is "connected" or why the connection was closed
+        using ConnectionCallback = std::function<void(int connection, const std::string& peer, const std::string& event)>;
+
+        IngestServer() = default;
+        IngestServer(const IngestServer&) = delete;
+        IngestServer& operator=(const IngestServer&) = delete;
+        ~IngestServer();
+
+        // set before Start
+        void SetMessageCallback(MessageCallback callback) { m_messageCallback = std::move(callback); }
+        void SetConnectionCallback(ConnectionCallback callback) { m_connectionCallback = std::move(callback); }
+
+        // binds & listens, then serves on a thread of its own. false with LastError set if
+        // the address cannot be bound
+        bool Start(const IngestServerSettings& settings);
+
+        // closes every connection & joins the server thread
+        void Stop();
+
+        const std::string& LastError() const { return m_error; }
+
+        // the bound port, the chosen one for port 0
+        int Port() const { return m_port; }
+
+        int OpenConnections() const { return m_open; }
+        int64_t Accepted() const { return m_accepted; }
+
+        // open & closed connections, by id
+        std::vector<IngestConnectionStats> Stats() const;
+
+    private:
+        struct Connection
+        {
+            int fd = -1;
+            IngestStreamDecoder decoder;
+            IngestConnectionStats stats;
+
+            explicit Connection(size_t maxPayload) : decoder(maxPayload) {}
+        };
+
+        void Run();
+        void Accept();
+        void Read(Connection& connection);
+        void Close(int fd, const std::string& reason);
+        void Fail(const char* call);
+
+        IngestServerSettings m_settings;
+        MessageCallback m_messageCallback;
+        ConnectionCallback m_connectionCallback;
+        std::string m_error;
+
+        int m_listen = -1;
+        int m_epoll = -1;
+        int m_wake = -1;                    // eventfd, cuts the wait short on Stop
+        int m_port = 0;
+        std::thread m_thread;
+
+        std::map<int, Connection> m_connections;        // by socket, server thread only
+        std::vector<uint8_t> m_buffer;
+        std::vector<IngestMessage> m_messages;
+        int m_nextId = 1;
+
+        mutable std::mutex m_statsMutex;
+        std::map<int, IngestConnectionStats> m_stats;   // by id, copies updated after each read
+        std::atomic_int m_open = 0;
+        std::atomic<int64_t> m_accepted = 0;
+    };
+}
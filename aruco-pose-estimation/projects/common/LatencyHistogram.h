@@ -0,0 +1,194 @@
+#pragma once
+// Lock-free latency histograms of the pipeline stages. Durations are counted
+// in microseconds into fixed buckets: exact below 16 us, then 8 buckets per
+// power of two (at most 12.5% wide) up to about a minute. Any thread may record
+// at any time without locking, percentiles are read from a snapshot of the
+// counters. Header only, like the other small building blocks.
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace HoloLens2CV
+{
+    // same values as the stage argument of the plugin
+    enum class LatencyStage
+    {
+        AcquisitionWait = 0,    // waiting for & copying the next sensor frame
+        PoseLookup = 1,         // rig pose of a frame, pose history or locator
+        Detection = 2,          // marker detection, full image or tracked regions
+        Pnp = 3,                // pose stage of the detected markers
+        BufferCopy = 4,         // frame images copied out for the camera buffers
+        Publication = 5         // detection results packed & published
+    };
+
+    constexpr int kLatencyStageCount = 6;
+
+    // microseconds since the last reset, percentiles are the upper bound of their bucket
+    struct LatencySummary
+    {
+        int64_t count = 0;
+        float p50 = 0.f;
+        float p95 = 0.f;
+        float p99 = 0.f;
+        float max = 0.f;
+    };
+
+    class LatencyHistogram
+    {
+    public:
+        static constexpr int kLinearBuckets = 16;   // 0 - 15 us, one per us
+        static constexpr int kSubBuckets = 8;       // per power of two from 16 us on
+        static constexpr int kOctaves = 22;         // up to 2^26 us
+        static constexpr int kBuckets = kLinearBuckets + kOctaves * kSubBuckets;
+
+        LatencyHistogram() { Reset(); }
+        LatencyHistogram(const LatencyHistogram&) = delete;
+        LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+        void Record(int64_t microseconds)
+        {
+            microseconds = microseconds < 0 ? 0 : microseconds;
+            m_buckets[Bucket(microseconds)].fetch_add(1, std::memory_order_relaxed);
+            int64_t max = m_max.load(std::memory_order_relaxed);
+            while (microseconds > max && !m_max.compare_exchange_weak(max, microseconds, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        void Record(std::chrono::steady_clock::duration duration)
+        {
+            Record(int64_t(std::chrono::duration_cast<std::chrono::microseconds>(duration).count()));
+        }
+
+        // values recorded during the call may or may not be counted
+        LatencySummary Summarize() const
+        {
+            std::array<uint32_t, kBuckets> counts;
+            int64_t total = 0;
+            for (int i = 0; i < kBuckets; i++)
+            {
+                counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+                total += counts[i];
+            }
+
+            LatencySummary summary;
+            summary.count = total;
+            summary.max = float(m_max.load(std::memory_order_relaxed));
+            if (total == 0)
+            {
+                return summary;
+            }
+
+            // smallest bucket holding at least the given share of the values
+            const double shares[3] = { 0.50, 0.95, 0.99 };
+            float* values[3] = { &summary.p50, &summary.p95, &summary.p99 };
+            int64_t seen = 0;
+            int next = 0;
+            for (int i = 0; i < kBuckets && next < 3; i++)
+            {
+                seen += counts[i];
+                while (next < 3 && double(seen) >= shares[next] * double(total))
+                {
+                    *values[next++] = float(UpperBound(i)) < summary.max ? float(UpperBound(i)) : summary.max;
+                }
+            }
+            return summary;
+        }
+
+        // not synchronized with Record, values recorded meanwhile may survive
+        void Reset()
+        {
+            for (std::atomic<uint32_t>& bucket : m_buckets)
+            {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+            m_max.store(0, std::memory_order_relaxed);
+        }
+
+        static int Bucket(int64_t microseconds)
+        {
+            if (microseconds < kLinearBuckets)
+            {
+                return int(microseconds);
+            }
+            int octave = 4;
+            while (octave < 62 && (microseconds >> (octave + 1)) != 0)
+            {
+                octave++;
+            }
+            int sub = int((microseconds >> (octave - 3)) & (kSubBuckets - 1));
+            int bucket = kLinearBuckets + (octave - 4) * kSubBuckets + sub;
+            return bucket < kBuckets ? bucket : kBuckets - 1;
+        }
+
+        // largest value counted in bucket
+        static int64_t UpperBound(int bucket)
+        {
+            if (bucket < kLinearBuckets)
+            {
+                return bucket;
+            }
+            int octave = (bucket - kLinearBuckets) / kSubBuckets + 4;
+            int sub = (bucket - kLinearBuckets) % kSubBuckets;
+            return (int64_t(kSubBuckets + sub + 1) << (octave - 3)) - 1;
+        }
+
+    private:
+        std::array<std::atomic<uint32_t>, kBuckets> m_buckets;
+        std::atomic<int64_t> m_max;
+    };
+
+    // one histogram per pipeline stage
+    class StageLatencies
+    {
+    public:
+        void Record(LatencyStage stage, std::chrono::steady_clock::duration duration)
+        {
+            m_histograms[int(stage)].Record(duration);
+        }
+
+        LatencySummary Summarize(LatencyStage stage) const
+        {
+            return m_histograms[int(stage)].Summarize();
+        }
+
+        void Reset()
+        {
+            for (LatencyHistogram& histogram : m_histograms)
+            {
+                histogram.Reset();
+            }
+        }
+
+    private:
+        std::array<LatencyHistogram, kLatencyStageCount> m_histograms;
+    };
+
+    // records the time from construction to destruction, nothing without latencies
+    class ScopedLatency
+    {
+    public:
+        ScopedLatency(StageLatencies* latencies, LatencyStage stage)
+            : m_latencies(latencies), m_stage(stage), m_start(latencies ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point())
+        {
+        }
+
+        ~ScopedLatency()
+        {
+            if (m_latencies)
+            {
+                m_latencies->Record(m_stage, std::chrono::steady_clock::now() - m_start);
+            }
+        }
+
+        ScopedLatency(const ScopedLatency&) = delete;
+        ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+    private:
+        StageLatencies* m_latencies;
+        LatencyStage m_stage;
+        std::chrono::steady_clock::time_point m_start;
+    };
+}
@@ -0,0 +1,130 @@
+#include "MarkerPoseFilter.h"
+#include "Quaternion.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace HoloLens2CV
+{
+	using namespace Quaternion;
+
+	namespace
+	{
+		const double kPi = 3.14159265358979323846;
+		const double kTicksPerSecond = 1e7;
+		const double kMinUpdateInterval = 0.005;    // seconds, well below the frame interval of the cameras
+
+		double Norm(const cv::Vec3d& v)
+		{
+			return std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+		}
+
+		// smoothing factor of an exponential low pass filter with the given cutoff frequency
+		double Alpha(double cutoff, double dt)
+		{
+			double tau = 1.0 / (2.0 * kPi * cutoff);
+			return 1.0 / (1.0 + tau / dt);
+		}
+
+		cv::Vec3d Lowpass(const cv::Vec3d& previous, const cv::Vec3d& value, double alpha)
+		{
+			return previous + (value - previous) * alpha;
+		}
+	}
+
+	void MarkerPoseFilter::Configure(const PoseFilterSettings& settings)
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		m_settings = settings;
+	}
+
+	void MarkerPoseFilter::Update(int id, const cv::Matx44d& markerToWorld, int64_t timestamp)
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+
+		cv::Vec3d position(markerToWorld(0, 3), markerToWorld(1, 3), markerToWorld(2, 3));
+		cv::Vec4d orientation = FromMatrix(markerToWorld);
+
+		auto it = m_tracks.find(id);
+		if (it == m_tracks.end() || double(timestamp - it->second.timestamp) > m_settings.timeout * kTicksPerSecond)
+		{
+			// new or lost for too long, restart from the measurement at rest
+			Track& track = m_tracks[id];
+			track.timestamp = timestamp;
+			track.position = position;
+			track.velocity = cv::Vec3d(0, 0, 0);
+			track.orientation = orientation;
+			track.angularVelocity = cv::Vec3d(0, 0, 0);
+			return;
+		}
+
+		// the second camera of the same frame pair or an out of order frame carries no usable motion,
+		// the small offset between two cameras would turn into a large velocity
+		Track& track = it->second;
+		double dt = double(timestamp - track.timestamp) / kTicksPerSecond;
+		if (dt < kMinUpdateInterval)
+		{
+			return;
+		}
+
+		// position: velocity first, its magnitude sets the cutoff of the position filter
+		track.velocity = Lowpass(track.velocity, (position - track.position) * (1.0 / dt), Alpha(m_settings.derivativeCutoff, dt));
+		double cutoff = m_settings.minCutoff + m_settings.beta * Norm(track.velocity);
+		track.position = Lowpass(track.position, position, Alpha(cutoff, dt));
+
+		// orientation: same with the angular velocity, q and -q are the same rotation
+		const cv::Vec4d& previous = track.orientation;
+		if (previous.dot(orientation) < 0.0)
+		{
+			orientation = orientation * -1.0;
+		}
+		cv::Vec3d angularVelocity = Log(Multiply(orientation, Conjugate(previous))) * (1.0 / dt);
+		track.angularVelocity = Lowpass(track.angularVelocity, angularVelocity, Alpha(m_settings.derivativeCutoff, dt));
+		cutoff = m_settings.minCutoff + m_settings.beta * Norm(track.angularVelocity);
+		track.orientation = Slerp(previous, orientation, Alpha(cutoff, dt));
+
+		track.timestamp = timestamp;
+	}
+
+	bool MarkerPoseFilter::Predict(int id, int64_t targetTimestamp, cv::Matx44d& markerToWorld) const
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+
+		auto it = m_tracks.find(id);
+		if (it == m_tracks.end())
+		{
+			return false;
+		}
+
+		// only forward in time & never further than maxPrediction
+		const Track& track = it->second;
+		double horizon = std::min(std::max(double(targetTimestamp - track.timestamp) / kTicksPerSecond, 0.0), m_settings.maxPrediction);
+
+		cv::Vec3d position = track.position + track.velocity * horizon;
+		cv::Vec4d orientation = Normalized(Multiply(Exp(track.angularVelocity * horizon), track.orientation));
+		markerToWorld = ToMatrix(orientation, position);
+		return true;
+	}
+
+	void MarkerPoseFilter::RemoveStale(int64_t timestamp)
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		for (auto it = m_tracks.begin(); it != m_tracks.end();)
+		{
+			if (double(timestamp - it->second.timestamp) > m_settings.timeout * kTicksPerSecond)
+			{
+				it = m_tracks.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+	}
+
+	void MarkerPoseFilter::Clear()
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		m_tracks.clear();
+	}
+}
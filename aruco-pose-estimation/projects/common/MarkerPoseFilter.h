@@ -0,0 +1,58 @@
+#pragma once
+// Per-marker pose smoothing & prediction, keyed by marker id. Every marker
+// keeps a One-Euro filter on its world position and orientation: slow motion
+// is smoothed strongly (no jitter), fast motion follows quickly (little lag).
+// The filtered velocities extrapolate a pose to a caller supplied time stamp,
+// e.g. the time the next frame is rendered, to hide the processing latency.
+//
+// Time stamps are in 100 ns ticks, like the sensor frame time stamps.
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+#include <opencv2/opencv.hpp>	// for opencv 4.8+
+
+namespace HoloLens2CV
+{
+    struct PoseFilterSettings
+    {
+        double minCutoff = 1.0;         // Hz, smoothing of a still marker, lower is smoother
+        double beta = 20.0;             // Hz the cutoff rises per m/s (rad/s), higher is less lag when moving
+        double derivativeCutoff = 1.0;  // Hz, smoothing of the velocities used for prediction
+        double maxPrediction = 0.1;     // seconds a pose is extrapolated at most
+        double timeout = 0.5;           // seconds after which an unseen marker is forgotten
+    };
+
+    class MarkerPoseFilter
+    {
+    public:
+        // known markers keep their state, the new settings apply from their next update
+        void Configure(const PoseFilterSettings& settings);
+
+        // markerToWorld is a rigid transform (column vectors), timestamp the sensor time of the frame
+        void Update(int id, const cv::Matx44d& markerToWorld, int64_t timestamp);
+
+        // filtered pose of marker id extrapolated to targetTimestamp, false if the marker is not tracked
+        bool Predict(int id, int64_t targetTimestamp, cv::Matx44d& markerToWorld) const;
+
+        // forgets markers not updated within the timeout before timestamp
+        void RemoveStale(int64_t timestamp);
+
+        void Clear();
+
+    private:
+        struct Track
+        {
+            int64_t timestamp = 0;          // time of the last update
+            cv::Vec3d position;             // filtered
+            cv::Vec3d velocity;             // filtered, m/s
+            cv::Vec4d orientation;          // filtered unit quaternion (x, y, z, w)
+            cv::Vec3d angularVelocity;      // filtered, rad/s in world axes
+        };
+
+        mutable std::mutex m_mutex;
+        PoseFilterSettings m_settings;
+        std::unordered_map<int, Track> m_tracks;
+    };
+}
@@ -0,0 +1,104 @@
+#include "MarkerResultBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace HoloLens2CV
+{
+	constexpr size_t kHeaderWords = sizeof(MarkerBufferHeader) / 4;
+	constexpr size_t kRecordWords = sizeof(MarkerRecord) / 4;
+
+	size_t MarkerBufferWords(size_t markerCount)
+	{
+		return kHeaderWords + markerCount * kRecordWords;
+	}
+
+	size_t PackMarkerBuffer(const MarkerFrameInfo& frame, const std::vector<MarkerPose>& markers, void* buffer, size_t bufferWords)
+	{
+		if (bufferWords < kHeaderWords)
+		{
+			return 0;
+		}
+		size_t count = std::min(markers.size(), (bufferWords - kHeaderWords) / kRecordWords);
+
+		MarkerBufferHeader header;
+		header.version = kMarkerBufferVersion;
+		header.headerWords = uint32_t(kHeaderWords);
+		header.recordWords = uint32_t(kRecordWords);
+		header.markerCount = uint32_t(count);
+		header.detectedCount = uint32_t(markers.size());
+		header.sequenceLow = uint32_t(frame.sequence);
+		header.sequenceHigh = uint32_t(frame.sequence >> 32);
+		header.timestampLow = uint32_t(uint64_t(frame.timestamp));
+		header.timestampHigh = uint32_t(uint64_t(frame.timestamp) >> 32);
+		std::memcpy(header.cameraToWorld, frame.cameraToWorld, sizeof(header.cameraToWorld));
+
+		// the caller's buffer is only guaranteed to be 4 byte aligned, copy whole structs
+		uint8_t* out = static_cast<uint8_t*>(buffer);
+		std::memcpy(out, &header, sizeof(header));
+		out += sizeof(header);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			const MarkerPose& pose = markers[i];
+			MarkerRecord record;
+			record.id = pose.id;
+			record.camera = pose.camera;
+			for (int k = 0; k < 3; k++)
+			{
+				record.tvec[k] = float(pose.tvec[k]);
+				record.rvec[k] = float(pose.rvec[k]);
+			}
+			for (int c = 0; c < 4; c++)
+			{
+				record.corners[2 * c] = pose.corners[c].x;
+				record.corners[2 * c + 1] = pose.corners[c].y;
+			}
+			std::memcpy(out, &record, sizeof(record));
+			out += sizeof(record);
+		}
+
+		return MarkerBufferWords(count);
+	}
+
+	bool UnpackMarkerBuffer(const void* buffer, size_t bufferWords, MarkerFrameInfo& frame, std::vector<MarkerPose>& markers)
+	{
+		markers.clear();
+		if (bufferWords < kHeaderWords)
+		{
+			return false;
+		}
+
+		const uint8_t* in = static_cast<const uint8_t*>(buffer);
+		MarkerBufferHeader header;
+		std::memcpy(&header, in, sizeof(header));
+		if (header.version != kMarkerBufferVersion || header.headerWords != kHeaderWords || header.recordWords != kRecordWords ||
+			bufferWords < MarkerBufferWords(header.markerCount))
+		{
+			return false;
+		}
+
+		frame.sequence = uint64_t(header.sequenceLow) | (uint64_t(header.sequenceHigh) << 32);
+		frame.timestamp = int64_t(uint64_t(header.timestampLow) | (uint64_t(header.timestampHigh) << 32));
+		std::memcpy(frame.cameraToWorld, header.cameraToWorld, sizeof(frame.cameraToWorld));
+		in += sizeof(header);
+
+		markers.resize(header.markerCount);
+		for (MarkerPose& pose : markers)
+		{
+			MarkerRecord record;
+			std::memcpy(&record, in, sizeof(record));
+			in += sizeof(record);
+
+			pose.id = record.id;
+			pose.camera = record.camera;
+			pose.tvec = cv::Vec3d(record.tvec[0], record.tvec[1], record.tvec[2]);
+			pose.rvec = cv::Vec3d(record.rvec[0], record.rvec[1], record.rvec[2]);
+			for (int c = 0; c < 4; c++)
+			{
+				pose.corners[c] = cv::Point2f(record.corners[2 * c], record.corners[2 * c + 1]);
+			}
+		}
+		return true;
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+// Flat layout of the detection results of one frame, written into a single
+// caller provided buffer instead of one runtime object per marker. The buffer
+// is a sequence of 32 bit words: a frame header followed by one fixed size
+// record per marker. Both structs only contain 32 bit fields, so the layout is
+// the same for C, C++ and C# (Unity reads it from a float[]).
+//
+//   | MarkerBufferHeader | MarkerRecord 0 | MarkerRecord 1 | ...
+//
+// The camera to world matrices are stored once in the header, a record refers
+// to them through its camera index.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ArUcoDetectorSession.h"
+
+namespace HoloLens2CV
+{
+    constexpr uint32_t kMarkerBufferVersion = 1;
+
+    struct MarkerBufferHeader
+    {
+        uint32_t version;               // kMarkerBufferVersion
+        uint32_t headerWords;           // size of this header in 32 bit words
+        uint32_t recordWords;           // size of one MarkerRecord in 32 bit words
+        uint32_t markerCount;           // records written after the header
+        uint32_t detectedCount;         // markers detected, more than markerCount if the buffer was too small
+        uint32_t sequenceLow;           // detection sequence number, split in two words
+        uint32_t sequenceHigh;
+        uint32_t timestampLow;          // FileTime of the processed frame, split in two words
+        uint32_t timestampHigh;
+        float cameraToWorld[2][16];     // row major camera to world of the LF / RF camera (Unity convention)
+    };
+
+    struct MarkerRecord
+    {
+        int32_t id;
+        int32_t camera;                 // index into MarkerBufferHeader::cameraToWorld
+        float tvec[3];                  // translation in meters
+        float rvec[3];                  // Rodrigues rotation
+        float corners[8];               // x, y of the image corners, clockwise from top left
+    };
+
+    static_assert(sizeof(MarkerBufferHeader) % 4 == 0 && sizeof(MarkerRecord) % 4 == 0, "records must be made of 32 bit words");
+    static_assert(sizeof(MarkerBufferHeader) == (9 + 32) * 4, "unexpected padding in MarkerBufferHeader");
+    static_assert(sizeof(MarkerRecord) == 16 * 4, "unexpected padding in MarkerRecord");
+
+    // everything of the frame except the markers, copied into the header
+    struct MarkerFrameInfo
+    {
+        uint64_t sequence = 0;
+        int64_t timestamp = 0;
+        float cameraToWorld[2][16] = {};
+    };
+
+    // number of 32 bit words needed for markerCount markers
+    size_t MarkerBufferWords(size_t markerCount);
+
+    // Writes the header and as many records as fit into buffer (bufferWords 32 bit words).
+    // Returns the number of words written, 0 if the buffer cannot even hold the header.
+    size_t PackMarkerBuffer(const MarkerFrameInfo& frame, const std::vector<MarkerPose>& markers, void* buffer, size_t bufferWords);
+
+    // Reads a packed buffer back, false if it is too small or was written by another layout version.
+    bool UnpackMarkerBuffer(const void* buffer, size_t bufferWords, MarkerFrameInfo& frame, std::vector<MarkerPose>& markers);
+}
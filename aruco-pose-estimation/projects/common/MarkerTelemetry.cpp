@@ -0,0 +1,90 @@
+#include "MarkerTelemetry.h"
+
+#include <cstring>
+
+namespace HoloLens2CV
+{
+	static const uint32_t kBatchMagic = 0x31544C48;      // "HLT1"
+
+	template <typename T>
+	static void Put(std::vector<uint8_t>& out, size_t& at, const T& value)
+	{
+		std::memcpy(out.data() + at, &value, sizeof(T));
+		at += sizeof(T);
+	}
+
+	template <typename T>
+	static T Get(const uint8_t* data, size_t at)
+	{
+		T value;
+		std::memcpy(&value, data + at, sizeof(T));
+		return value;
+	}
+
+	void EncodeMarkerTelemetry(const MarkerTelemetryBatch& batch, std::vector<uint8_t>& out)
+	{
+		size_t at = out.size();
+		out.resize(at + kMarkerTelemetryHeaderSize + batch.markers.size() * kMarkerTelemetryRecordSize);
+		Put(out, at, kBatchMagic);
+		Put(out, at, kMarkerTelemetryVersion);
+		Put(out, at, uint16_t(kMarkerTelemetryRecordSize));
+		Put(out, at, uint32_t(batch.markers.size()));
+		Put(out, at, uint32_t(0));
+		Put(out, at, batch.frameSequence);
+		Put(out, at, batch.timestamp);
+		for (float value : batch.cameraToWorld)
+		{
+			Put(out, at, value);
+		}
+		for (const MarkerTelemetry& marker : batch.markers)
+		{
+			Put(out, at, marker.id);
+			for (float value : marker.tvec)
+			{
+				Put(out, at, value);
+			}
+			for (float value : marker.rvec)
+			{
+				Put(out, at, value);
+			}
+			Put(out, at, marker.reprojectionError);
+		}
+	}
+
+	size_t DecodeMarkerTelemetry(const uint8_t* data, size_t size, MarkerTelemetryBatch& batch)
+	{
+		if (size < kMarkerTelemetryHeaderSize || Get<uint32_t>(data, 0) != kBatchMagic ||
+			Get<uint16_t>(data, 4) != kMarkerTelemetryVersion)
+		{
+			return 0;
+		}
+		size_t recordSize = Get<uint16_t>(data, 6);
+		uint32_t count = Get<uint32_t>(data, 8);
+		if (recordSize < kMarkerTelemetryRecordSize || count > kMaxTelemetryRecords ||
+			count * recordSize > size - kMarkerTelemetryHeaderSize)
+		{
+			return 0;
+		}
+
+		batch.frameSequence = Get<int64_t>(data, 16);
+		batch.timestamp = Get<int64_t>(data, 24);
+		for (int i = 0; i < 12; i++)
+		{
+			batch.cameraToWorld[i] = Get<float>(data, 32 + 4 * size_t(i));
+		}
+		batch.markers.resize(count);
+		const uint8_t* record = data + kMarkerTelemetryHeaderSize;
+		for (MarkerTelemetry& marker : batch.markers)
+		{
+			marker.id = Get<int32_t>(record, 0);
+			for (int i = 0; i < 3; i++)
+			{
+				marker.tvec[i] = Get<float>(record, 4 + 4 * size_t(i));
+				marker.rvec[i] = Get<float>(record, 16 + 4 * size_t(i));
+			}
+			marker.reprojectionError = Get<float>(record, 28);
+			record += recordSize;
+		}
+		return kMarkerTelemetryHeaderSize + count * recordSize;
+	}
+}
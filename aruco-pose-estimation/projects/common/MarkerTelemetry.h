@@ -0,0 +1,51 @@
+#pragma once
+// Detection results as fixed-size binary records, batched per frame, in place
+// of a formatted 'm' text per marker. A batch is what the headset sends as a
+// 't' message and what HeadsetIngest appends to telemetry.bin, batch after
+// batch; utilities/native/TelemetryColumns turns such a file into columns.
+//
+// Layout, little endian like x64 & ARM64:
+//   batch header  uint32 magic "HLT1" | uint16 version | uint16 record size | uint32 records
+//                 | uint32 0 | int64 frame sequence | int64 sensor timestamp
+//                 | float camera to world[12] (3x4 row major)                   80 bytes
+//   record        int32 id | float tvec[3] | float rvec[3] | float reprojection error    32 bytes
+// The frame fields are in the header once instead of in every record. Readers
+// step over records by the record size in the header, so fields appended to a
+// record later are skipped by older readers. Independent of OpenCV.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace HoloLens2CV
+{
+    constexpr uint16_t kMarkerTelemetryVersion = 1;
+    constexpr size_t kMarkerTelemetryHeaderSize = 80;
+    constexpr size_t kMarkerTelemetryRecordSize = 32;
+
+    // more are taken for a corrupt batch, a frame shows a few dozen at most
+    constexpr uint32_t kMaxTelemetryRecords = 4096;
+
+    struct MarkerTelemetry
+    {
+        int32_t id = -1;
+        float tvec[3] = {};                 // meters, camera space
+        float rvec[3] = {};                 // Rodrigues rotation, camera space
+        float reprojectionError = -1.f;     // RMS pixels between the corners & the projected pose, -1 unknown
+    };
+
+    struct MarkerTelemetryBatch
+    {
+        int64_t frameSequence = 0;
+        int64_t timestamp = 0;              // sensor time stamp of the frame
+        float cameraToWorld[12] = { 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f };
+        std::vector<MarkerTelemetry> markers;
+    };
+
+    // appends the batch as it goes on the wire
+    void EncodeMarkerTelemetry(const MarkerTelemetryBatch& batch, std::vector<uint8_t>& out);
+
+    // Decodes the batch at the start of data. Returns its size in bytes, 0 if data does not
+    // start with a complete valid batch.
+    size_t DecodeMarkerTelemetry(const uint8_t* data, size_t size, MarkerTelemetryBatch& batch);
+}
@@ -0,0 +1,100 @@
+#pragma once
+// Unit quaternion helpers shared by the pose filter and the rig pose history.
+// Quaternions are cv::Vec4d (x, y, z, w), matrices rigid transforms for
+// column vectors.
+
+#include <cmath>
+
+#include <opencv2/opencv.hpp>	// for opencv 4.8+
+
+namespace HoloLens2CV
+{
+    namespace Quaternion
+    {
+        inline cv::Vec4d Multiply(const cv::Vec4d& a, const cv::Vec4d& b)
+        {
+            return cv::Vec4d(
+                a[3] * b[0] + a[0] * b[3] + a[1] * b[2] - a[2] * b[1],
+                a[3] * b[1] - a[0] * b[2] + a[1] * b[3] + a[2] * b[0],
+                a[3] * b[2] + a[0] * b[1] - a[1] * b[0] + a[2] * b[3],
+                a[3] * b[3] - a[0] * b[0] - a[1] * b[1] - a[2] * b[2]);
+        }
+
+        inline cv::Vec4d Conjugate(const cv::Vec4d& q)
+        {
+            return cv::Vec4d(-q[0], -q[1], -q[2], q[3]);
+        }
+
+        inline cv::Vec4d Normalized(const cv::Vec4d& q)
+        {
+            double n = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+            return n > 0.0 ? cv::Vec4d(q[0] / n, q[1] / n, q[2] / n, q[3] / n) : cv::Vec4d(0, 0, 0, 1);
+        }
+
+        inline cv::Vec4d FromMatrix(const cv::Matx44d& m)
+        {
+            double trace = m(0, 0) + m(1, 1) + m(2, 2);
+            cv::Vec4d q;
+            if (trace > 0.0)
+            {
+                double s = 2.0 * std::sqrt(trace + 1.0);
+                q = cv::Vec4d((m(2, 1) - m(1, 2)) / s, (m(0, 2) - m(2, 0)) / s, (m(1, 0) - m(0, 1)) / s, 0.25 * s);
+            }
+            else if (m(0, 0) > m(1, 1) && m(0, 0) > m(2, 2))
+            {
+                double s = 2.0 * std::sqrt(1.0 + m(0, 0) - m(1, 1) - m(2, 2));
+                q = cv::Vec4d(0.25 * s, (m(0, 1) + m(1, 0)) / s, (m(0, 2) + m(2, 0)) / s, (m(2, 1) - m(1, 2)) / s);
+            }
+            else if (m(1, 1) > m(2, 2))
+            {
+                double s = 2.0 * std::sqrt(1.0 + m(1, 1) - m(0, 0) - m(2, 2));
+                q = cv::Vec4d((m(0, 1) + m(1, 0)) / s, 0.25 * s, (m(1, 2) + m(2, 1)) / s, (m(0, 2) - m(2, 0)) / s);
+            }
+            else
+            {
+                double s = 2.0 * std::sqrt(1.0 + m(2, 2) - m(0, 0) - m(1, 1));
+                q = cv::Vec4d((m(0, 2) + m(2, 0)) / s, (m(1, 2) + m(2, 1)) / s, 0.25 * s, (m(1, 0) - m(0, 1)) / s);
+            }
+            return Normalized(q);
+        }
+
+        inline cv::Matx44d ToMatrix(const cv::Vec4d& q, const cv::Vec3d& t)
+        {
+            double x = q[0], y = q[1], z = q[2], w = q[3];
+            return cv::Matx44d(
+                1 - 2 * (y * y + z * z), 2 * (x * y - z * w), 2 * (x * z + y * w), t[0],
+                2 * (x * y + z * w), 1 - 2 * (x * x + z * z), 2 * (y * z - x * w), t[1],
+                2 * (x * z - y * w), 2 * (y * z + x * w), 1 - 2 * (x * x + y * y), t[2],
+                0, 0, 0, 1);
+        }
+
+        // rotation vector (axis * angle) of a unit quaternion & back
+        inline cv::Vec3d Log(const cv::Vec4d& q)
+        {
+            double s = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2]);
+            if (s < 1e-12)
+            {
+                return cv::Vec3d(0, 0, 0);
+            }
+            double angle = 2.0 * std::atan2(s, q[3]);
+            return cv::Vec3d(q[0], q[1], q[2]) * (angle / s);
+        }
+
+        inline cv::Vec4d Exp(const cv::Vec3d& v)
+        {
+            double angle = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+            if (angle < 1e-12)
+            {
+                return cv::Vec4d(0, 0, 0, 1);
+            }
+            double s = std::sin(angle / 2.0) / angle;
+            return cv::Vec4d(v[0] * s, v[1] * s, v[2] * s, std::cos(angle / 2.0));
+        }
+
+        inline cv::Vec4d Slerp(const cv::Vec4d& a, const cv::Vec4d& b, double t)
+        {
+            // along the rotation from a to b, b is already in a's hemisphere
+            return Normalized(Multiply(Exp(Log(Multiply(b, Conjugate(a))) * t), a));
+        }
+    }
+}
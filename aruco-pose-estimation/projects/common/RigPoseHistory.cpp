@@ -0,0 +1,217 @@
+#include "RigPoseHistory.h"
+#include "Quaternion.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace HoloLens2CV
+{
+	RigPoseHistory::~RigPoseHistory()
+	{
+		Stop();
+	}
+
+	void RigPoseHistory::Configure(const PoseHistorySettings& settings)
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		size_t capacity = size_t(std::max(2, settings.capacity));
+		if (capacity != m_samples.size())
+		{
+			m_samples.assign(capacity, RigPose());
+			m_first = 0;
+			m_count = 0;
+		}
+		m_settings = settings;
+		m_settings.samplePeriod = std::max<int64_t>(10000, settings.samplePeriod);      // 1 ms at least
+	}
+
+	void RigPoseHistory::Start(RigPoseSource* source)
+	{
+		if (source == nullptr || m_running)
+		{
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> l(m_mutex);
+			if (m_samples.empty())
+			{
+				m_samples.assign(size_t(std::max(2, m_settings.capacity)), RigPose());
+			}
+		}
+		m_running = true;
+		m_thread = std::thread(RigPoseHistory::SampleLoop, this, source);
+	}
+
+	void RigPoseHistory::Stop()
+	{
+		{
+			std::lock_guard<std::mutex> l(m_mutex);
+			m_running = false;
+		}
+		m_wake.notify_all();
+		if (m_thread.joinable())
+		{
+			m_thread.join();
+		}
+	}
+
+	void RigPoseHistory::SampleLoop(RigPoseHistory* history, RigPoseSource* source)
+	{
+		while (history->m_running)
+		{
+			RigPose pose;
+			if (source->TryLocate(source->Now(), pose))
+			{
+				history->Add(pose);
+			}
+			else
+			{
+				std::lock_guard<std::mutex> l(history->m_mutex);
+				history->m_stats.lostSamples++;
+			}
+
+			// the source call took some of the period already, close enough at 200 Hz
+			std::unique_lock<std::mutex> l(history->m_mutex);
+			std::chrono::microseconds period(history->m_settings.samplePeriod / 10);
+			history->m_wake.wait_for(l, period, [history]() { return !history->m_running; });
+		}
+	}
+
+	void RigPoseHistory::Add(const RigPose& pose)
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		if (m_samples.empty())
+		{
+			m_samples.assign(size_t(std::max(2, m_settings.capacity)), RigPose());
+		}
+		if (m_count > 0 && pose.timestamp <= At(m_count - 1).timestamp)
+		{
+			return;
+		}
+
+		// the oldest sample is overwritten once the buffer is full
+		if (m_count == m_samples.size())
+		{
+			m_first = (m_first + 1) % m_samples.size();
+			m_count--;
+		}
+		m_samples[(m_first + m_count) % m_samples.size()] = pose;
+		m_count++;
+		m_stats.samples++;
+	}
+
+	bool RigPoseHistory::TryGetPose(int64_t timestamp, RigPose& pose)
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		if (m_count == 0 || timestamp < At(0).timestamp)
+		{
+			m_stats.missed++;
+			return false;
+		}
+
+		const RigPose& newest = At(m_count - 1);
+		if (timestamp >= newest.timestamp)
+		{
+			// past the newest sample: exact, or on with the motion of the last two samples
+			int64_t ahead = timestamp - newest.timestamp;
+			if (ahead == 0)
+			{
+				pose = newest;
+				m_stats.interpolated++;
+				return true;
+			}
+			if (ahead > m_settings.maxExtrapolation || m_count < 2 ||
+				newest.timestamp - At(m_count - 2).timestamp > m_settings.maxGap)
+			{
+				m_stats.missed++;
+				return false;
+			}
+
+			const RigPose& previous = At(m_count - 2);
+			double t = double(ahead) / double(newest.timestamp - previous.timestamp);
+			cv::Vec4d orientation = newest.orientation;
+			if (previous.orientation.dot(orientation) < 0.0)
+			{
+				orientation = orientation * -1.0;
+			}
+			cv::Vec3d rotation = Quaternion::Log(Quaternion::Multiply(orientation, Quaternion::Conjugate(previous.orientation)));
+			pose.timestamp = timestamp;
+			pose.position = newest.position + (newest.position - previous.position) * t;
+			pose.orientation = Quaternion::Normalized(Quaternion::Multiply(Quaternion::Exp(rotation * t), orientation));
+			m_stats.extrapolated++;
+			return true;
+		}
+
+		// first sample later than timestamp, the samples are in time order
+		size_t low = 1, high = m_count - 1;
+		while (low < high)
+		{
+			size_t middle = (low + high) / 2;
+			if (At(middle).timestamp <= timestamp)
+			{
+				low = middle + 1;
+			}
+			else
+			{
+				high = middle;
+			}
+		}
+
+		const RigPose& before = At(low - 1);
+		const RigPose& after = At(low);
+		if (before.timestamp == timestamp)
+		{
+			pose = before;      // exact, also next to a gap
+			m_stats.interpolated++;
+			return true;
+		}
+		if (after.timestamp - before.timestamp > m_settings.maxGap)
+		{
+			m_stats.missed++;
+			return false;
+		}
+
+		double t = double(timestamp - before.timestamp) / double(after.timestamp - before.timestamp);
+		cv::Vec4d orientation = after.orientation;
+		if (before.orientation.dot(orientation) < 0.0)
+		{
+			orientation = orientation * -1.0;       // q and -q are the same rotation, take the short way
+		}
+		pose.timestamp = timestamp;
+		pose.position = before.position + (after.position - before.position) * t;
+		pose.orientation = Quaternion::Slerp(before.orientation, orientation, t);
+		m_stats.interpolated++;
+		return true;
+	}
+
+	int64_t RigPoseHistory::Newest() const
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		return m_count > 0 ? At(m_count - 1).timestamp : 0;
+	}
+
+	void RigPoseHistory::Clear()
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		m_first = 0;
+		m_count = 0;
+	}
+
+	PoseHistoryStats RigPoseHistory::GetStats() const
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		return m_stats;
+	}
+
+	void RigPoseHistory::ResetStats()
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		m_stats = PoseHistoryStats();
+	}
+
+	cv::Matx44d RigPoseHistory::ToMatrix(const RigPose& pose)
+	{
+		return Quaternion::ToMatrix(pose.orientation, pose.position);
+	}
+}
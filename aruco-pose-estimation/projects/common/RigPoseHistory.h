@@ -0,0 +1,107 @@
+#pragma once
+// Time indexed history of the rig (head) pose. A sampler thread asks the pose
+// source for the current rig pose at its own cadence and keeps the samples in
+// a ring buffer; frames then look their pose up by time stamp, interpolated
+// between the two samples around it (LERP position, SLERP orientation) or
+// extrapolated a little past the newest one. This keeps the locator off the
+// acquisition loop, which used to call it for every frame.
+//
+// Time stamps are in 100 ns ticks, like the sensor frame time stamps.
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <opencv2/opencv.hpp>	// for opencv 4.8+
+
+namespace HoloLens2CV
+{
+    struct RigPose
+    {
+        int64_t timestamp = 0;
+        cv::Vec3d position;                         // rig to world translation
+        cv::Vec4d orientation{ 0, 0, 0, 1 };        // rig to world unit quaternion (x, y, z, w)
+    };
+
+    // where the rig poses come from: the spatial locator on the device, a synthetic trajectory on Linux
+    class RigPoseSource
+    {
+    public:
+        virtual ~RigPoseSource() = default;
+
+        // now on the clock of the frame time stamps
+        virtual int64_t Now() = 0;
+
+        // rig pose at timestamp, false while tracking is lost
+        virtual bool TryLocate(int64_t timestamp, RigPose& pose) = 0;
+    };
+
+    struct PoseHistorySettings
+    {
+        int capacity = 256;                 // samples kept, 1.28 s at the default period
+        int64_t samplePeriod = 50000;       // 5 ms, 200 Hz
+        int64_t maxExtrapolation = 200000;  // 20 ms past the newest sample at most
+        int64_t maxGap = 250000;            // samples further apart than 25 ms are not interpolated (tracking lost in between)
+    };
+
+    struct PoseHistoryStats
+    {
+        int64_t samples = 0;                // poses added
+        int64_t lostSamples = 0;            // source calls without a pose
+        int64_t interpolated = 0;
+        int64_t extrapolated = 0;
+        int64_t missed = 0;                 // lookups without a pose: too old, too far ahead or across a gap
+    };
+
+    class RigPoseHistory
+    {
+    public:
+        ~RigPoseHistory();
+
+        // resizes the ring buffer, which drops the samples when the capacity changes
+        void Configure(const PoseHistorySettings& settings);
+
+        // samples source every samplePeriod on a thread of its own until Stop, source must outlive it
+        void Start(RigPoseSource* source);
+        void Stop();
+        bool IsRunning() const { return m_running; }
+
+        // appends a sample, samples must come in time order (older ones are ignored)
+        void Add(const RigPose& pose);
+
+        // pose at timestamp from the samples around it, false if it can't be interpolated or
+        // extrapolated within the limits
+        bool TryGetPose(int64_t timestamp, RigPose& pose);
+
+        // timestamp of the newest sample, 0 if there is none
+        int64_t Newest() const;
+
+        void Clear();
+
+        PoseHistoryStats GetStats() const;
+        void ResetStats();
+
+        // rig to world (column vectors) of a pose
+        static cv::Matx44d ToMatrix(const RigPose& pose);
+
+    private:
+        static void SampleLoop(RigPoseHistory* history, RigPoseSource* source);
+
+        // i-th sample from the oldest one, m_mutex held
+        const RigPose& At(size_t i) const { return m_samples[(m_first + i) % m_samples.size()]; }
+
+        mutable std::mutex m_mutex;
+        PoseHistorySettings m_settings;
+        std::vector<RigPose> m_samples;     // ring buffer, capacity entries
+        size_t m_first = 0;                 // oldest sample
+        size_t m_count = 0;
+        PoseHistoryStats m_stats;
+
+        std::thread m_thread;
+        std::atomic_bool m_running = false;
+        std::condition_variable m_wake;     // cuts the sampling sleep short on Stop
+    };
+}
@@ -0,0 +1,423 @@
+#include "SessionRecording.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace HoloLens2CV
+{
+	static const char kFileMagic[8] = { 'H', 'L', '2', 'C', 'V', 'R', 'E', 'C' };
+	static const char kIndexMagic[8] = { 'H', 'L', '2', 'C', 'V', 'I', 'D', 'X' };
+	static const uint32_t kRecordMagic = 0x31524C48;       // "HLR1"
+	static const size_t kFileHeaderSize = 32;
+	static const size_t kAlignment = 16;
+
+	struct RecordHeader
+	{
+		uint32_t magic;
+		uint16_t stream;
+		uint16_t format;
+		int64_t timestamp;
+		uint32_t width;
+		uint32_t height;
+		uint64_t size;
+	};
+
+	struct RecordingTrailer
+	{
+		uint64_t indexOffset;
+		uint64_t count;
+		uint32_t entrySize;
+		uint32_t version;
+		char magic[8];
+	};
+
+	static_assert(sizeof(RecordHeader) == 32, "record header layout");
+	static_assert(sizeof(RecordingTrailer) == 32, "trailer layout");
+	static_assert(sizeof(RecordIndexEntry) == 24, "index entry layout");
+
+	static uint64_t Padded(uint64_t size)
+	{
+		return (size + kAlignment - 1) & ~uint64_t(kAlignment - 1);
+	}
+
+	static bool EntryBefore(const RecordIndexEntry& a, const RecordIndexEntry& b)
+	{
+		return a.stream != b.stream ? a.stream < b.stream : a.timestamp < b.timestamp;
+	}
+
+	// read only mapping of a whole file
+	struct MappedFile
+	{
+		const uint8_t* data = nullptr;
+		size_t size = 0;
+
+		bool Map(const std::string& path, std::string& error)
+		{
+			int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+			struct stat status;
+			if (fd < 0 || fstat(fd, &status) != 0)
+			{
+				error = path + ": " + std::strerror(errno);
+				if (fd >= 0)
+				{
+					close(fd);
+				}
+				return false;
+			}
+			size = size_t(status.st_size);
+			void* mapped = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+			close(fd);
+			if (mapped == MAP_FAILED)
+			{
+				error = path + (size > 0 ? std::string(": ") + std::strerror(errno) : std::string(": empty file"));
+				size = 0;
+				return false;
+			}
+			data = static_cast<const uint8_t*>(mapped);
+			return true;
+		}
+
+		void Unmap()
+		{
+			if (data != nullptr)
+			{
+				munmap(const_cast<uint8_t*>(data), size);
+			}
+			data = nullptr;
+			size = 0;
+		}
+	};
+
+	// The index of the trailer, else rebuilt from the complete records. end is where the
+	// records stop, the index offset of a closed file.
+	static bool LoadIndex(const uint8_t* data, size_t size, const RecordIndexEntry*& index, size_t& count,
+		std::vector<RecordIndexEntry>& recovered, uint64_t& end, bool& wasRecovered, std::string& error)
+	{
+		if (size < kFileHeaderSize || std::memcmp(data, kFileMagic, 8) != 0)
+		{
+			error = "not a session recording";
+			return false;
+		}
+		uint32_t version;
+		std::memcpy(&version, data + 8, 4);
+		if (version != kSessionRecordingVersion)
+		{
+			error = "session recording version " + std::to_string(version) + " is not supported";
+			return false;
+		}
+
+		if (size >= kFileHeaderSize + sizeof(RecordingTrailer))
+		{
+			RecordingTrailer trailer;
+			std::memcpy(&trailer, data + size - sizeof(RecordingTrailer), sizeof(trailer));
+			uint64_t indexBytes = size - sizeof(RecordingTrailer) - trailer.indexOffset;
+			if (std::memcmp(trailer.magic, kIndexMagic, 8) == 0 && trailer.version == kSessionRecordingVersion &&
+				trailer.entrySize == sizeof(RecordIndexEntry) && trailer.indexOffset >= kFileHeaderSize &&
+				trailer.indexOffset % kAlignment == 0 && trailer.indexOffset <= size - sizeof(RecordingTrailer) &&
+				trailer.count == indexBytes / sizeof(RecordIndexEntry) && indexBytes % sizeof(RecordIndexEntry) == 0)
+			{
+				index = reinterpret_cast<const RecordIndexEntry*>(data + trailer.indexOffset);
+				count = size_t(trailer.count);
+				end = trailer.indexOffset;
+				wasRecovered = false;
+				return true;
+			}
+		}
+
+		// not closed: every complete record, padding included
+		recovered.clear();
+		uint64_t offset = kFileHeaderSize;
+		while (offset + sizeof(RecordHeader) <= size)
+		{
+			RecordHeader header;
+			std::memcpy(&header, data + offset, sizeof(header));
+			uint64_t left = size - offset - sizeof(RecordHeader);
+			if (header.magic != kRecordMagic || header.stream >= kRecordStreams || header.size > left || Padded(header.size) > left)
+			{
+				break;
+			}
+			recovered.push_back({ header.timestamp, offset, header.stream, header.format, 0 });
+			offset += sizeof(RecordHeader) + Padded(header.size);
+		}
+		std::stable_sort(recovered.begin(), recovered.end(), EntryBefore);
+		index = recovered.data();
+		count = recovered.size();
+		end = offset;
+		wasRecovered = true;
+		return true;
+	}
+
+	SessionRecordingWriter::~SessionRecordingWriter()
+	{
+		Close();
+	}
+
+	bool SessionRecordingWriter::Open(const std::string& path)
+	{
+		Close();
+		std::lock_guard<std::mutex> l(m_mutex);
+		m_path = path;
+		m_index.clear();
+		m_lastTimestamp = 0;
+		m_failed = false;
+		m_error.clear();
+
+		std::error_code exists;
+		if (std::filesystem::exists(path, exists) && std::filesystem::file_size(path, exists) > 0)
+		{
+			// continue after the last complete record, never over a file of another kind
+			MappedFile file;
+			const RecordIndexEntry* index = nullptr;
+			size_t count = 0;
+			std::vector<RecordIndexEntry> recovered;
+			bool wasRecovered = false;
+			if (!file.Map(path, m_error))
+			{
+				return false;
+			}
+			if (!LoadIndex(file.data, file.size, index, count, recovered, m_end, wasRecovered, m_error))
+			{
+				file.Unmap();
+				m_error = path + ": " + m_error;
+				return false;
+			}
+			m_index.assign(index, index + count);
+			file.Unmap();
+			for (const RecordIndexEntry& entry : m_index)
+			{
+				m_lastTimestamp = std::max(m_lastTimestamp, entry.timestamp);
+			}
+
+			std::error_code error;
+			std::filesystem::resize_file(path, m_end, error);
+			m_file = error ? nullptr : std::fopen(path.c_str(), "ab");
+			if (m_file == nullptr)
+			{
+				m_error = path + ": " + (error ? error.message() : std::string(std::strerror(errno)));
+				return false;
+			}
+			return true;
+		}
+
+		m_file = std::fopen(path.c_str(), "wb");
+		if (m_file == nullptr)
+		{
+			m_error = path + ": " + std::strerror(errno);
+			return false;
+		}
+		uint8_t header[kFileHeaderSize] = {};
+		std::memcpy(header, kFileMagic, 8);
+		std::memcpy(header + 8, &kSessionRecordingVersion, 4);
+		m_end = kFileHeaderSize;
+		return Write(header, sizeof(header));
+	}
+
+	bool SessionRecordingWriter::Write(const void* data, size_t size)
+	{
+		if (size > 0 && std::fwrite(data, 1, size, m_file) != size)
+		{
+			m_failed = true;
+			m_error = m_path + ": " + std::strerror(errno);
+			return false;
+		}
+		return true;
+	}
+
+	bool SessionRecordingWriter::Append(RecordStream stream, RecordFormat format, int64_t timestamp, int width, int height,
+		const void* data, size_t size)
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		if (m_file == nullptr || m_failed || int(stream) >= kRecordStreams || width < 0 || height < 0)
+		{
+			return false;
+		}
+
+		RecordHeader header = { kRecordMagic, uint16_t(stream), uint16_t(format), timestamp, uint32_t(width), uint32_t(height), size };
+		static const uint8_t zeros[kAlignment] = {};
+		if (!Write(&header, sizeof(header)) || !Write(data, size) || !Write(zeros, size_t(Padded(size) - size)))
+		{
+			return false;
+		}
+		m_index.push_back({ timestamp, m_end, uint16_t(stream), uint16_t(format), 0 });
+		m_end += sizeof(header) + Padded(size);
+		m_lastTimestamp = std::max(m_lastTimestamp, timestamp);
+		return true;
+	}
+
+	bool SessionRecordingWriter::AppendImage(RecordStream stream, int64_t timestamp, int width, int height, int channels,
+		const uint8_t* pixels)
+	{
+		if (channels != 1 && channels != 3 && channels != 4)
+		{
+			return false;
+		}
+		RecordFormat format = channels == 1 ? RecordFormat::Gray8 : channels == 3 ? RecordFormat::Bgr8 : RecordFormat::Bgra8;
+		return Append(stream, format, timestamp, width, height, pixels, size_t(width) * size_t(height) * size_t(channels));
+	}
+
+	bool SessionRecordingWriter::Close()
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		if (m_file == nullptr)
+		{
+			return false;
+		}
+
+		std::stable_sort(m_index.begin(), m_index.end(), EntryBefore);
+		RecordingTrailer trailer = { m_end, uint64_t(m_index.size()), uint32_t(sizeof(RecordIndexEntry)), kSessionRecordingVersion, {} };
+		std::memcpy(trailer.magic, kIndexMagic, 8);
+		bool written = !m_failed && Write(m_index.data(), m_index.size() * sizeof(RecordIndexEntry)) && Write(&trailer, sizeof(trailer));
+		if (std::fclose(m_file) != 0 && written)
+		{
+			written = false;
+			m_error = m_path + ": " + std::strerror(errno);
+		}
+		m_file = nullptr;
+		return written;
+	}
+
+	size_t SessionRecordingWriter::Count() const
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		return m_index.size();
+	}
+
+	int64_t SessionRecordingWriter::Bytes() const
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		return int64_t(m_end);
+	}
+
+	int64_t SessionRecordingWriter::LastTimestamp() const
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		return m_lastTimestamp;
+	}
+
+	SessionRecordingReader::~SessionRecordingReader()
+	{
+		Close();
+	}
+
+	bool SessionRecordingReader::Open(const std::string& path)
+	{
+		Close();
+		MappedFile file;
+		uint64_t end = 0;
+		if (!file.Map(path, m_error))
+		{
+			return false;
+		}
+		if (!LoadIndex(file.data, file.size, m_index, m_count, m_recoveredIndex, end, m_recovered, m_error))
+		{
+			file.Unmap();
+			m_error = path + ": " + m_error;
+			m_index = nullptr;
+			m_count = 0;
+			return false;
+		}
+		m_data = file.data;
+		m_size = file.size;
+
+		// the index is sorted by stream, each stream is a range of it
+		for (int stream = 0; stream <= kRecordStreams; stream++)
+		{
+			m_begin[stream] = size_t(std::lower_bound(m_index, m_index + m_count, stream,
+				[](const RecordIndexEntry& entry, int s) { return entry.stream < s; }) - m_index);
+		}
+		return true;
+	}
+
+	void SessionRecordingReader::Close()
+	{
+		MappedFile file;
+		file.data = m_data;
+		file.size = m_size;
+		file.Unmap();
+		m_data = nullptr;
+		m_size = 0;
+		m_index = nullptr;
+		m_recoveredIndex.clear();
+		m_count = 0;
+		std::fill(std::begin(m_begin), std::end(m_begin), size_t(0));
+		m_recovered = false;
+	}
+
+	size_t SessionRecordingReader::Count(RecordStream stream) const
+	{
+		int s = int(stream);
+		return s < kRecordStreams ? m_begin[s + 1] - m_begin[s] : 0;
+	}
+
+	const RecordIndexEntry& SessionRecordingReader::Entry(RecordStream stream, size_t i) const
+	{
+		return m_index[m_begin[int(stream)] + i];
+	}
+
+	int64_t SessionRecordingReader::Timestamp(RecordStream stream, size_t i) const
+	{
+		return i < Count(stream) ? Entry(stream, i).timestamp : 0;
+	}
+
+	bool SessionRecordingReader::Get(RecordStream stream, size_t i, RecordView& record) const
+	{
+		if (i >= Count(stream))
+		{
+			return false;
+		}
+		const RecordIndexEntry& entry = Entry(stream, i);
+		if (entry.offset < kFileHeaderSize || entry.offset > m_size - sizeof(RecordHeader))
+		{
+			return false;
+		}
+		RecordHeader header;
+		std::memcpy(&header, m_data + entry.offset, sizeof(header));
+		if (header.magic != kRecordMagic || header.stream != entry.stream || header.size > m_size - entry.offset - sizeof(header))
+		{
+			return false;
+		}
+
+		record.stream = stream;
+		record.format = RecordFormat(header.format);
+		record.timestamp = header.timestamp;
+		record.width = int(header.width);
+		record.height = int(header.height);
+		record.data = m_data + entry.offset + sizeof(header);
+		record.size = size_t(header.size);
+		return true;
+	}
+
+	size_t SessionRecordingReader::LowerBound(RecordStream stream, int64_t timestamp) const
+	{
+		if (int(stream) >= kRecordStreams)
+		{
+			return 0;
+		}
+		const RecordIndexEntry* begin = m_index + m_begin[int(stream)];
+		const RecordIndexEntry* end = m_index + m_begin[int(stream) + 1];
+		return size_t(std::lower_bound(begin, end, timestamp,
+			[](const RecordIndexEntry& entry, int64_t t) { return entry.timestamp < t; }) - begin);
+	}
+
+	bool SessionRecordingReader::Nearest(RecordStream stream, int64_t timestamp, RecordView& record) const
+	{
+		size_t count = Count(stream);
+		if (count == 0)
+		{
+			return false;
+		}
+		size_t i = std::min(LowerBound(stream, timestamp), count - 1);
+		if (i > 0 && timestamp - Entry(stream, i - 1).timestamp <= Entry(stream, i).timestamp - timestamp)
+		{
+			i--;
+		}
+		return Get(stream, i, record);
+	}
+}
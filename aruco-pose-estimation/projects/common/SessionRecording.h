@@ -0,0 +1,182 @@
+#pragma once
+// A session in one file instead of a TIFF per frame: LF, RF & PV images,
+// marker text & poses and rig poses, appended as records in arrival order. On
+// close a footer is appended, an index of every record sorted by stream and
+// time stamp, so a reader maps the file and finds the record of a stream at
+// any time stamp by binary search, its pixels are used where they lie.
+//
+// Layout, little endian like x64 & ARM64 so nothing is converted on reading:
+//   file header   "HL2CVREC" | uint32 version | uint32 0 | 16 bytes 0
+//   record        uint32 magic | uint16 stream | uint16 format | int64 timestamp
+//                 | uint32 width | uint32 height | uint64 size | payload, padded to 16 bytes
+//   index         per record: int64 timestamp | uint64 record offset | uint16 stream
+//                 | uint16 format | uint32 0, sorted by stream, then time stamp
+//   trailer       uint64 index offset | uint64 records | uint32 index entry size
+//                 | uint32 version | "HL2CVIDX"
+// Payloads start 16 byte aligned. A file without a valid trailer (the writer
+// did not close it) is read by walking the records, up to the last complete
+// one; the writer appends to such a file after that record.
+//
+// Linux only (mmap). utilities/SessionRecording.py reads the same layout.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace HoloLens2CV
+{
+    // LF, RF & PV have the values of CameraType
+    enum class RecordStream : uint16_t
+    {
+        LeftFront = 0,
+        RightFront = 1,
+        PhotoVideo = 2,
+        Markers = 3,
+        RigPoses = 4
+    };
+
+    constexpr int kRecordStreams = 5;
+
+    enum class RecordFormat : uint16_t
+    {
+        Gray8 = 1,              // width x height, rows packed
+        Bgra8 = 2,
+        Bgr8 = 3,
+        MarkerText = 4,         // UTF-8 text of 'm' messages
+        MarkerPoses = 5,        // RecordedMarker array
+        RigPose = 6,            // one RecordedRigPose
+        MarkerTelemetry = 7     // a 't' batch (MarkerTelemetry.h), stamped with its frame
+    };
+
+    constexpr uint32_t kSessionRecordingVersion = 1;
+
+    // payload of MarkerPoses records
+    struct RecordedMarker
+    {
+        int32_t id;
+        int32_t camera;
+        double rvec[3];                 // Rodrigues rotation
+        double tvec[3];                 // meters
+        float corners[8];               // x, y clockwise from top left
+    };
+
+    // payload of RigPose records
+    struct RecordedRigPose
+    {
+        double position[3];             // rig to world translation
+        double orientation[4];          // rig to world unit quaternion (x, y, z, w)
+    };
+
+    struct RecordIndexEntry
+    {
+        int64_t timestamp;
+        uint64_t offset;                // of the record header
+        uint16_t stream;
+        uint16_t format;
+        uint32_t reserved;
+    };
+
+    // a record where it lies in the mapped file, valid while the reader is open
+    struct RecordView
+    {
+        RecordStream stream = RecordStream::LeftFront;
+        RecordFormat format = RecordFormat::Gray8;
+        int64_t timestamp = 0;
+        int width = 0;
+        int height = 0;
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+    };
+
+    class SessionRecordingWriter
+    {
+    public:
+        SessionRecordingWriter() = default;
+        SessionRecordingWriter(const SessionRecordingWriter&) = delete;
+        SessionRecordingWriter& operator=(const SessionRecordingWriter&) = delete;
+        ~SessionRecordingWriter();
+
+        // Creates the file, or appends to a recording there: a closed one loses its footer,
+        // an unclosed one what follows its last complete record.
+        bool Open(const std::string& path);
+
+        // thread safe, false on a write error or when not open
+        bool Append(RecordStream stream, RecordFormat format, int64_t timestamp, int width, int height,
+            const void* data, size_t size);
+
+        // 1, 3 or 4 channels
+        bool AppendImage(RecordStream stream, int64_t timestamp, int width, int height, int channels, const uint8_t* pixels);
+
+        // writes the index & trailer, false if a write failed at any point
+        bool Close();
+
+        bool IsOpen() const { return m_file != nullptr; }
+        size_t Count() const;
+        int64_t Bytes() const;
+
+        // largest time stamp appended, 0 before the first record
+        int64_t LastTimestamp() const;
+
+        const std::string& Error() const { return m_error; }
+
+    private:
+        bool Write(const void* data, size_t size);
+
+        mutable std::mutex m_mutex;
+        std::FILE* m_file = nullptr;
+        std::string m_path;
+        uint64_t m_end = 0;                         // offset of the next record
+        std::vector<RecordIndexEntry> m_index;      // in append order
+        int64_t m_lastTimestamp = 0;
+        bool m_failed = false;
+        std::string m_error;
+    };
+
+    class SessionRecordingReader
+    {
+    public:
+        SessionRecordingReader() = default;
+        SessionRecordingReader(const SessionRecordingReader&) = delete;
+        SessionRecordingReader& operator=(const SessionRecordingReader&) = delete;
+        ~SessionRecordingReader();
+
+        // maps the file, reads nothing but the trailer unless the index has to be recovered
+        bool Open(const std::string& path);
+        void Close();
+
+        bool IsOpen() const { return m_data != nullptr; }
+
+        // the footer was missing or invalid, the index was rebuilt from the records
+        bool Recovered() const { return m_recovered; }
+
+        size_t Count() const { return m_count; }
+        size_t Count(RecordStream stream) const;
+
+        // record i of a stream in time stamp order, false for a corrupt record
+        bool Get(RecordStream stream, size_t i, RecordView& record) const;
+        int64_t Timestamp(RecordStream stream, size_t i) const;
+
+        // first record of the stream at or after timestamp, Count(stream) if none, O(log n)
+        size_t LowerBound(RecordStream stream, int64_t timestamp) const;
+
+        // record of the stream closest to timestamp, false for an empty stream
+        bool Nearest(RecordStream stream, int64_t timestamp, RecordView& record) const;
+
+        const std::string& Error() const { return m_error; }
+
+    private:
+        const RecordIndexEntry& Entry(RecordStream stream, size_t i) const;
+
+        const uint8_t* m_data = nullptr;
+        size_t m_size = 0;
+        const RecordIndexEntry* m_index = nullptr;      // in the file, or m_recoveredIndex
+        std::vector<RecordIndexEntry> m_recoveredIndex;
+        size_t m_count = 0;
+        size_t m_begin[kRecordStreams + 1] = {};        // index range of each stream
+        bool m_recovered = false;
+        std::string m_error;
+    };
+}
@@ -0,0 +1,164 @@
+#include "SessionReplaySource.h"
+#include "FileFrameSource.h"
+
+#include <algorithm>
+#include <filesystem>
+
+namespace HoloLens2CV
+{
+	// gray image of a record, empty if it is not an image
+	static cv::Mat ReadRecord(const SessionRecordingReader& recording, int camera, size_t i)
+	{
+		RecordView record;
+		if (!recording.Get(RecordStream(camera), i, record))
+		{
+			return cv::Mat();
+		}
+		const int channels = record.format == RecordFormat::Gray8 ? 1 : record.format == RecordFormat::Bgr8 ? 3 :
+			record.format == RecordFormat::Bgra8 ? 4 : 0;
+		if (channels == 0 || record.size != size_t(record.width) * size_t(record.height) * size_t(channels))
+		{
+			return cv::Mat();
+		}
+
+		// the mapped pixels, converted or wrapped & copied out by Next
+		cv::Mat image(record.height, record.width, CV_8UC(channels), const_cast<uint8_t*>(record.data)), gray;
+		if (channels == 1)
+		{
+			return image;
+		}
+		cv::cvtColor(image, gray, channels == 3 ? cv::COLOR_BGR2GRAY : cv::COLOR_BGRA2GRAY);
+		return gray;
+	}
+
+	SessionReplaySource::SessionReplaySource(const std::string& directory, const ReplaySettings& settings)
+		: m_settings(settings), m_ticksPerUnit(TicksPer(settings.unit))
+	{
+		std::filesystem::path recording = std::filesystem::is_directory(directory) ?
+			std::filesystem::path(directory) / "session.hl2rec" : std::filesystem::path(directory);
+		if (std::filesystem::is_regular_file(recording) && m_recording.Open(recording.string()))
+		{
+			// the index holds the time stamps, nothing is read until Next
+			for (int camera = 0; camera < 3; camera++)
+			{
+				RecordStream stream = RecordStream(camera);
+				for (size_t i = 0; m_settings.cameras[camera] && i < m_recording.Count(stream); i++)
+				{
+					m_frames.push_back({ m_recording.Timestamp(stream, i), camera, std::string(), i });
+				}
+			}
+		}
+		else
+		{
+			// TCPServer.py folders, or everything in one directory
+			const char* folders[3] = { "leftfront", "rightfront", "photovideo" };
+			const char* suffixes[3] = { "_LF.tiff", "_RF.tiff", "_PV.tiff" };
+			for (int camera = 0; camera < 3; camera++)
+			{
+				if (!m_settings.cameras[camera])
+				{
+					continue;
+				}
+				std::filesystem::path folder = std::filesystem::path(directory) / folders[camera];
+				Collect(std::filesystem::is_directory(folder) ? folder.string() : directory, suffixes[camera], camera);
+			}
+		}
+
+		// LF before RF before PV at the same time stamp, like the sensor loop reads them
+		std::stable_sort(m_frames.begin(), m_frames.end(), [](const Entry& a, const Entry& b)
+			{
+				return a.timestamp != b.timestamp ? a.timestamp < b.timestamp : a.camera < b.camera;
+			});
+		m_settings.speed = m_settings.speed > 0.0 ? m_settings.speed : 1.0;
+	}
+
+	void SessionReplaySource::Collect(const std::string& directory, const std::string& suffix, int camera)
+	{
+		FileFrameSource files(directory, suffix);
+		for (const std::string& path : files.Files())
+		{
+			m_frames.push_back({ FileFrameSource::TimestampOf(path), camera, path, 0 });
+		}
+	}
+
+	size_t SessionReplaySource::Count(int camera) const
+	{
+		return size_t(std::count_if(m_frames.begin(), m_frames.end(), [camera](const Entry& e) { return e.camera == camera; }));
+	}
+
+	int64_t SessionReplaySource::Duration() const
+	{
+		return m_frames.empty() ? 0 : (m_frames.back().timestamp - m_frames.front().timestamp) * m_ticksPerUnit;
+	}
+
+	bool SessionReplaySource::Next(int& camera, CameraFrame& frame)
+	{
+		while (!m_stopped)
+		{
+			if (m_next == m_frames.size())
+			{
+				if (!m_settings.loop || m_frames.empty())
+				{
+					return false;
+				}
+				// one frame interval after the last one, so time stamps stay increasing
+				int64_t duration = m_frames.back().timestamp - m_frames.front().timestamp;
+				int64_t interval = m_frames.size() > 1 ? duration / int64_t(m_frames.size() - 1) : 333333 / m_ticksPerUnit;
+				m_loopOffset += duration + interval;
+				m_next = 0;
+			}
+
+			const Entry& entry = m_frames[m_next++];
+			int64_t timestamp = (entry.timestamp + m_loopOffset) * m_ticksPerUnit;
+			if (m_settings.pacing == ReplayPacing::Recorded)
+			{
+				if (!m_started)
+				{
+					m_start = std::chrono::steady_clock::now();
+					m_started = true;
+				}
+				// 100 ns ticks since the first frame, scaled to wall time
+				double elapsed = double(timestamp - m_frames.front().timestamp * m_ticksPerUnit) / m_settings.speed;
+				auto due = m_start + std::chrono::microseconds(int64_t(elapsed / 10.0));
+				std::unique_lock<std::mutex> l(m_mutex);
+				if (m_wake.wait_until(l, due, [this]() { return bool(m_stopped); }))
+				{
+					return false;
+				}
+			}
+
+			cv::Mat gray = entry.path.empty() ? ReadRecord(m_recording, entry.camera, entry.record) :
+				cv::imread(entry.path, cv::IMREAD_GRAYSCALE);
+			if (gray.empty() || !gray.isContinuous())
+			{
+				continue;       // not an image, skip it
+			}
+
+			camera = entry.camera;
+			frame.hostTicks = uint64_t(timestamp);
+			frame.timestamp = timestamp;
+			frame.width = gray.cols;
+			frame.height = gray.rows;
+			frame.image.assign(gray.data, gray.data + gray.total());
+			return true;
+		}
+		return false;
+	}
+
+	void SessionReplaySource::Stop()
+	{
+		{
+			std::lock_guard<std::mutex> l(m_mutex);
+			m_stopped = true;
+		}
+		m_wake.notify_all();
+	}
+
+	void SessionReplaySource::Rewind()
+	{
+		m_next = 0;
+		m_loopOffset = 0;
+		m_started = false;
+		m_stopped = false;
+	}
+}
@@ -0,0 +1,95 @@
+#pragma once
+// Replays a session recorded by TCPServer.py: <ts>_LF.tiff, <ts>_RF.tiff and
+// <ts>_PV.tiff images, either in the leftfront/, rightfront/ and photovideo/
+// folders it writes or all in one directory, or a SessionRecording file (given
+// itself, or as session.hl2rec in the directory). Frames of all cameras are merged
+// by time stamp and handed out at the recorded pace (scaled by a speed factor)
+// or as fast as they can be read.
+//
+// Images are loaded as 8 bit grayscale, PV frames included. Recorded sessions
+// hold no rig poses, hostTicks & timestamp are both set to the file time stamp
+// converted to 100 ns ticks. The headset stamps its frames in Unix milliseconds,
+// the default unit, so those are 100 ns ticks since 1970.
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "FrameSource.h"
+#include "SessionRecording.h"
+
+namespace HoloLens2CV
+{
+    enum class ReplayPacing
+    {
+        Recorded = 0,       // frames are due at their recorded time stamps divided by speed
+        Max = 1             // no waiting, for profiling & regression runs
+    };
+
+    enum class ReplayTimestampUnit
+    {
+        Milliseconds = 0,   // Unix ms, as CameraCalibration.cs sends them & TCPServer.py / HeadsetIngest name the files
+        Ticks = 1           // 100 ns ticks, for sessions stamped with sensor or file times
+    };
+
+    // 100 ns ticks in one time stamp unit
+    inline int64_t TicksPer(ReplayTimestampUnit unit)
+    {
+        return unit == ReplayTimestampUnit::Milliseconds ? 10000 : 1;
+    }
+
+    struct ReplaySettings
+    {
+        ReplayPacing pacing = ReplayPacing::Recorded;
+        ReplayTimestampUnit unit = ReplayTimestampUnit::Milliseconds;      // of the recorded time stamps
+        double speed = 1.0;
+        bool loop = false;                  // start over after the last frame, time stamps keep increasing
+        bool cameras[3] = { true, true, true };     // LF, RF, PV
+    };
+
+    class SessionReplaySource : public FrameSource
+    {
+    public:
+        SessionReplaySource(const std::string& directory, const ReplaySettings& settings = ReplaySettings());
+
+        size_t Count() const { return m_frames.size(); }
+        size_t Count(int camera) const;
+
+        // recorded length in 100 ns ticks, first to last frame
+        int64_t Duration() const;
+
+        bool Next(int& camera, CameraFrame& frame) override;
+        void Stop() override;
+
+        // back to the first frame, the pace restarts with the next frame
+        void Rewind();
+
+    private:
+        struct Entry
+        {
+            int64_t timestamp;              // as recorded, in m_settings.unit
+            int camera;
+            std::string path;               // empty for a record of m_recording
+            size_t record;                  // index in the camera's stream
+        };
+
+        void Collect(const std::string& directory, const std::string& suffix, int camera);
+
+        ReplaySettings m_settings;
+        SessionRecordingReader m_recording;
+        std::vector<Entry> m_frames;        // all cameras, by time stamp
+        size_t m_next = 0;
+        int64_t m_ticksPerUnit = 1;
+        int64_t m_loopOffset = 0;           // added to the recorded time stamps of later loops
+        bool m_started = false;
+        std::chrono::steady_clock::time_point m_start;
+
+        std::mutex m_mutex;                 // cuts the pacing wait short on Stop
+        std::condition_variable m_wake;
+        std::atomic_bool m_stopped = false;
+    };
+}
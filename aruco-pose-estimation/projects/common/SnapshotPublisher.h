@@ -0,0 +1,68 @@
+#pragma once
+// Publishes immutable result snapshots from one producer thread to any number
+// of reader threads. The producer fills a snapshot from a double buffer and
+// swaps it in with an atomic pointer store; readers keep the snapshot they
+// loaded alive, so it is never modified under them. A snapshot is only
+// recycled once no reader holds it anymore.
+//
+// T must have a uint64_t sequence member, it is stamped by Publish.
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace HoloLens2CV
+{
+    template <typename T>
+    class SnapshotPublisher
+    {
+    public:
+        SnapshotPublisher() = default;
+        SnapshotPublisher(const SnapshotPublisher&) = delete;
+        SnapshotPublisher& operator=(const SnapshotPublisher&) = delete;
+
+        // producer side: snapshot to be filled, reuses the older buffer if nobody references it
+        std::shared_ptr<T> Acquire()
+        {
+            std::shared_ptr<T>& buffer = m_buffers[m_next];
+            m_next ^= 1;
+
+            // use_count is 1 when only the double buffer owns it (not published, no reader)
+            if (!buffer || buffer.use_count() > 1)
+            {
+                buffer = std::make_shared<T>();
+            }
+            return buffer;
+        }
+
+        // producer side: makes snapshot the latest one, returns its sequence number
+        uint64_t Publish(std::shared_ptr<T> snapshot)
+        {
+            uint64_t sequence = m_sequence.load(std::memory_order_relaxed) + 1;
+            snapshot->sequence = sequence;
+            std::atomic_store_explicit(&m_latest, std::shared_ptr<const T>(std::move(snapshot)), std::memory_order_release);
+            m_sequence.store(sequence, std::memory_order_release);
+            return sequence;
+        }
+
+        // reader side: latest published snapshot, nullptr before the first Publish
+        std::shared_ptr<const T> Latest() const
+        {
+            return std::atomic_load_explicit(&m_latest, std::memory_order_acquire);
+        }
+
+        // sequence number of the latest published snapshot, 0 before the first Publish
+        uint64_t Sequence() const
+        {
+            return m_sequence.load(std::memory_order_acquire);
+        }
+
+    private:
+        std::array<std::shared_ptr<T>, 2> m_buffers;
+        int m_next = 0;
+
+        std::shared_ptr<const T> m_latest;
+        std::atomic<uint64_t> m_sequence{ 0 };
+    };
+}
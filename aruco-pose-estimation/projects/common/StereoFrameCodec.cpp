@@ -0,0 +1,496 @@
+#include "StereoFrameCodec.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace HoloLens2CV
+{
+	// LZ4 block format limits: the last 5 bytes are literals, the last match starts 12 bytes
+	// before the end at the latest, offsets fit 16 bits
+	static const size_t kMinMatch = 4;
+	static const size_t kLastLiterals = 5;
+	static const size_t kMatchLimit = 12;
+	static const size_t kMaxOffset = 65535;
+	static const int kHashBits = 14;
+
+	static uint32_t Read32(const uint8_t* p)
+	{
+		uint32_t value;
+		std::memcpy(&value, p, 4);
+		return value;
+	}
+
+	static uint64_t Read64(const uint8_t* p)
+	{
+		uint64_t value;
+		std::memcpy(&value, p, 8);
+		return value;
+	}
+
+	// equal leading bytes of a little endian difference, x64 & ARM64 both are
+	static size_t EqualBytes(uint64_t difference)
+	{
+#if defined(_MSC_VER)
+		unsigned long bit;
+		_BitScanForward64(&bit, difference);
+		return size_t(bit) >> 3;
+#else
+		return size_t(__builtin_ctzll(difference)) >> 3;
+#endif
+	}
+
+	// bytes a & b have in common, a stops at limit
+	static size_t MatchLength(const uint8_t* a, const uint8_t* b, const uint8_t* limit)
+	{
+		const uint8_t* start = a;
+		while (a + 8 <= limit)
+		{
+			uint64_t difference = Read64(a) ^ Read64(b);
+			if (difference != 0)
+			{
+				return size_t(a - start) + EqualBytes(difference);
+			}
+			a += 8;
+			b += 8;
+		}
+		while (a < limit && *a == *b)
+		{
+			a++;
+			b++;
+		}
+		return size_t(a - start);
+	}
+
+	static uint32_t Hash(uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - kHashBits);
+	}
+
+	// 15 in the token, then bytes of 255 & the rest
+	static uint8_t* WriteLength(size_t length, uint8_t* out)
+	{
+		for (length -= 15; length >= 255; length -= 255)
+		{
+			*out++ = 255;
+		}
+		*out++ = uint8_t(length);
+		return out;
+	}
+
+	static uint8_t* WriteSequence(const uint8_t* literals, size_t literalCount, size_t offset, size_t matchLength, uint8_t* out)
+	{
+		size_t matchCode = matchLength > 0 ? matchLength - kMinMatch : 0;
+		*out++ = uint8_t((std::min<size_t>(literalCount, 15) << 4) | std::min<size_t>(matchCode, 15));
+		if (literalCount >= 15)
+		{
+			out = WriteLength(literalCount, out);
+		}
+		std::memcpy(out, literals, literalCount);
+		out += literalCount;
+		if (matchLength == 0)
+		{
+			return out;
+		}
+		*out++ = uint8_t(offset);
+		*out++ = uint8_t(offset >> 8);
+		if (matchCode >= 15)
+		{
+			out = WriteLength(matchCode, out);
+		}
+		return out;
+	}
+
+	void Lz4CompressBlock(const uint8_t* data, size_t size, std::vector<uint8_t>& out, std::vector<int32_t>& table)
+	{
+		// the LZ4 bound, incompressible data grows by a length byte per 255 literals
+		const size_t start = out.size();
+		out.resize(start + size + size / 255 + 16);
+		uint8_t* op = out.data() + start;
+		table.assign(size_t(1) << kHashBits, -1);
+
+		size_t anchor = 0, position = 0;
+		unsigned misses = 0;
+		while (size > kMatchLimit && position < size - kMatchLimit)
+		{
+			uint32_t sequence = Read32(data + position);
+			int32_t& entry = table[Hash(sequence)];
+			size_t candidate = size_t(entry);
+			bool found = entry >= 0 && position - candidate <= kMaxOffset && Read32(data + candidate) == sequence;
+			entry = int32_t(position);
+			if (!found)
+			{
+				// skip faster through noise, as LZ4 does
+				position += 1 + (misses++ >> 6);
+				continue;
+			}
+			misses = 0;
+
+			// back over equal literals, then forward up to the last literals
+			while (position > anchor && candidate > 0 && data[position - 1] == data[candidate - 1])
+			{
+				position--;
+				candidate--;
+			}
+			size_t length = MatchLength(data + position, data + candidate, data + size - kLastLiterals);
+
+			op = WriteSequence(data + anchor, position - anchor, position - candidate, length, op);
+			position += length;
+			anchor = position;
+			if (position < size - kMatchLimit)
+			{
+				table[Hash(Read32(data + position - 2))] = int32_t(position - 2);
+			}
+		}
+		op = WriteSequence(data + anchor, size - anchor, 0, 0, op);
+		out.resize(size_t(op - out.data()));
+	}
+
+	bool Lz4DecompressBlock(const uint8_t* block, size_t blockSize, uint8_t* out, size_t size)
+	{
+		const uint8_t* in = block;
+		const uint8_t* end = block + blockSize;
+		size_t written = 0;
+
+		auto readLength = [&in, end](size_t& length)
+		{
+			uint8_t byte;
+			do
+			{
+				if (in >= end)
+				{
+					return false;
+				}
+				byte = *in++;
+				length += byte;
+			} while (byte == 255);
+			return true;
+		};
+
+		while (in < end)
+		{
+			uint8_t token = *in++;
+			size_t literals = token >> 4;
+			if (literals == 15 && !readLength(literals))
+			{
+				return false;
+			}
+			if (literals > size_t(end - in) || literals > size - written)
+			{
+				return false;
+			}
+			std::memcpy(out + written, in, literals);
+			in += literals;
+			written += literals;
+
+			// the last sequence has no match
+			if (in == end)
+			{
+				break;
+			}
+			if (end - in < 2)
+			{
+				return false;
+			}
+			size_t offset = size_t(in[0]) | (size_t(in[1]) << 8);
+			in += 2;
+			size_t length = token & 15;
+			if (length == 15 && !readLength(length))
+			{
+				return false;
+			}
+			length += kMinMatch;
+			if (offset == 0 || offset > written || length > size - written)
+			{
+				return false;
+			}
+
+			// a match closer than its length repeats what it writes, byte by byte
+			uint8_t* target = out + written;
+			const uint8_t* source = target - offset;
+			if (offset >= length)
+			{
+				std::memcpy(target, source, length);
+			}
+			else
+			{
+				for (size_t i = 0; i < length; i++)
+				{
+					target[i] = source[i];
+				}
+			}
+			written += length;
+		}
+		return written == size;
+	}
+
+	const char* FramePredictorName(FramePredictor predictor)
+	{
+		switch (predictor)
+		{
+		case FramePredictor::None: return "none";
+		case FramePredictor::Left: return "left";
+		case FramePredictor::Up: return "up";
+		case FramePredictor::Med: return "med";
+		}
+		return "unknown";
+	}
+
+	// a: left, b: above, c: above left
+	struct LeftPredictor
+	{
+		static int Predict(int a, int, int) { return a; }
+	};
+
+	struct UpPredictor
+	{
+		static int Predict(int, int b, int) { return b; }
+	};
+
+	// LOCO-I's median edge detector, branchless as the median of a, b & a + b - c
+	struct MedPredictor
+	{
+		static int Predict(int a, int b, int c)
+		{
+			return std::max(std::min(a, b), std::min(std::max(a, b), a + b - c));
+		}
+	};
+
+	// small residuals of either sign to small bytes: 0, -1, 1, -2, ... to 0, 1, 2, 3, ...
+	static inline uint8_t Zigzag(int residual)
+	{
+		int8_t value = int8_t(residual);
+		return uint8_t((value * 2) ^ (value >> 7));
+	}
+
+	static inline int Unzigzag(uint8_t code)
+	{
+		return int8_t((code >> 1) ^ -(code & 1));
+	}
+
+	// The first row is predicted from the left, the first column from above, the first
+	// pixel from 0. Lossless rows only read original pixels & vectorize.
+	template <typename Predictor>
+	static void LosslessResiduals(const uint8_t* image, int width, int height, uint8_t* residuals)
+	{
+		residuals[0] = Zigzag(image[0]);
+		for (int x = 1; x < width; x++)
+		{
+			residuals[x] = Zigzag(image[x] - image[x - 1]);
+		}
+		for (int y = 1; y < height; y++)
+		{
+			const uint8_t* row = image + size_t(y) * width;
+			const uint8_t* above = row - width;
+			uint8_t* out = residuals + size_t(y) * width;
+			out[0] = Zigzag(row[0] - above[0]);
+			for (int x = 1; x < width; x++)
+			{
+				out[x] = Zigzag(row[x] - Predictor::Predict(row[x - 1], above[x], above[x - 1]));
+			}
+		}
+	}
+
+	// near-lossless, predicted from the reconstructed pixels like the decoder does
+	template <typename Predictor>
+	static void QuantizedResiduals(const uint8_t* image, int width, int height, int step, const int8_t* quantize,
+		uint8_t* reconstructed, uint8_t* residuals)
+	{
+		for (int y = 0; y < height; y++)
+		{
+			const uint8_t* row = image + size_t(y) * width;
+			uint8_t* current = reconstructed + size_t(y) * width;
+			const uint8_t* above = current - width;
+			uint8_t* out = residuals + size_t(y) * width;
+			for (int x = 0; x < width; x++)
+			{
+				int prediction = y == 0 ? (x > 0 ? current[x - 1] : 0) :
+					x == 0 ? above[0] : Predictor::Predict(current[x - 1], above[x], above[x - 1]);
+				int quantized = quantize[row[x] - prediction + 255];
+				out[x] = Zigzag(quantized);
+				current[x] = uint8_t(std::clamp(prediction + quantized * step, 0, 255));
+			}
+		}
+	}
+
+	template <typename Predictor>
+	static void ReconstructImage(const uint8_t* residuals, int width, int height, int step, uint8_t* image)
+	{
+		for (int y = 0; y < height; y++)
+		{
+			uint8_t* row = image + size_t(y) * width;
+			const uint8_t* above = row - width;
+			const uint8_t* in = residuals + size_t(y) * width;
+			for (int x = 0; x < width; x++)
+			{
+				int prediction = y == 0 ? (x > 0 ? row[x - 1] : 0) :
+					x == 0 ? above[0] : Predictor::Predict(row[x - 1], above[x], above[x - 1]);
+				row[x] = step == 1 ? uint8_t(prediction + Unzigzag(in[x])) :
+					uint8_t(std::clamp(prediction + Unzigzag(in[x]) * step, 0, 255));
+			}
+		}
+	}
+
+	void StereoFrameCodec::Residuals(const uint8_t* image, int width, int height, const StereoCodecSettings& settings)
+	{
+		const size_t pixels = size_t(width) * size_t(height);
+		m_residuals.resize(pixels);
+		uint8_t* residuals = m_residuals.data();
+		if (settings.predictor == FramePredictor::None)
+		{
+			std::memcpy(residuals, image, pixels);
+			return;
+		}
+
+		if (settings.maxError == 0)
+		{
+			switch (settings.predictor)
+			{
+			case FramePredictor::Left: LosslessResiduals<LeftPredictor>(image, width, height, residuals); break;
+			case FramePredictor::Up: LosslessResiduals<UpPredictor>(image, width, height, residuals); break;
+			default: LosslessResiduals<MedPredictor>(image, width, height, residuals); break;
+			}
+			return;
+		}
+
+		// quantized error by error + 255, rounded to the nearest multiple of the step
+		const int step = 2 * settings.maxError + 1;
+		if (m_quantizeError != settings.maxError)
+		{
+			m_quantize.resize(511);
+			for (int error = -255; error <= 255; error++)
+			{
+				m_quantize[error + 255] = int8_t(error >= 0 ? (error + settings.maxError) / step : -((settings.maxError - error) / step));
+			}
+			m_quantizeError = settings.maxError;
+		}
+		m_reconstructed.resize(pixels);
+		switch (settings.predictor)
+		{
+		case FramePredictor::Left:
+			QuantizedResiduals<LeftPredictor>(image, width, height, step, m_quantize.data(), m_reconstructed.data(), residuals);
+			break;
+		case FramePredictor::Up:
+			QuantizedResiduals<UpPredictor>(image, width, height, step, m_quantize.data(), m_reconstructed.data(), residuals);
+			break;
+		default:
+			QuantizedResiduals<MedPredictor>(image, width, height, step, m_quantize.data(), m_reconstructed.data(), residuals);
+			break;
+		}
+	}
+
+	bool StereoFrameCodec::Reconstruct(uint8_t* image, int width, int height, FramePredictor predictor, int maxError)
+	{
+		const int step = 2 * maxError + 1;
+		switch (predictor)
+		{
+		case FramePredictor::None: std::memcpy(image, m_residuals.data(), size_t(width) * size_t(height)); return true;
+		case FramePredictor::Left: ReconstructImage<LeftPredictor>(m_residuals.data(), width, height, step, image); return true;
+		case FramePredictor::Up: ReconstructImage<UpPredictor>(m_residuals.data(), width, height, step, image); return true;
+		case FramePredictor::Med: ReconstructImage<MedPredictor>(m_residuals.data(), width, height, step, image); return true;
+		}
+		return false;
+	}
+
+	static void Put16(uint32_t value, uint8_t* out)
+	{
+		out[0] = uint8_t(value >> 8);
+		out[1] = uint8_t(value);
+	}
+
+	static void Put32(uint32_t value, uint8_t* out)
+	{
+		Put16(value >> 16, out);
+		Put16(value & 0xFFFF, out + 2);
+	}
+
+	static uint32_t Get16(const uint8_t* in)
+	{
+		return (uint32_t(in[0]) << 8) | in[1];
+	}
+
+	static uint32_t Get32(const uint8_t* in)
+	{
+		return (Get16(in) << 16) | Get16(in + 2);
+	}
+
+	bool StereoFrameCodec::Encode(const uint8_t* LF, const uint8_t* RF, int width, int height,
+		const StereoCodecSettings& settings, std::vector<uint8_t>& out)
+	{
+		if (width <= 0 || height <= 0 || width > 65535 || height > 65535 || size_t(width) * size_t(height) > kMaxStereoFramePixels ||
+			uint8_t(settings.predictor) > uint8_t(FramePredictor::Med) ||
+			settings.maxError < 0 || settings.maxError > kMaxStereoCodecError)
+		{
+			return false;
+		}
+
+		const size_t header = out.size();
+		out.resize(header + kStereoFrameHeaderSize, 0);
+		out[header] = uint8_t(kStereoCodecVersion);
+		out[header + 1] = uint8_t(settings.predictor);
+		out[header + 2] = uint8_t(settings.predictor == FramePredictor::None ? 0 : settings.maxError);
+		Put16(uint32_t(width), &out[header + 4]);
+		Put16(uint32_t(height), &out[header + 6]);
+
+		const uint8_t* images[2] = { LF, RF };
+		for (int i = 0; i < 2; i++)
+		{
+			Residuals(images[i], width, height, settings);
+			size_t start = out.size();
+			Lz4CompressBlock(m_residuals.data(), m_residuals.size(), out, m_table);
+			Put32(uint32_t(out.size() - start), &out[header + 8 + 4 * i]);
+		}
+		return true;
+	}
+
+	bool StereoFrameCodec::PeekSize(const uint8_t* data, size_t size, int& width, int& height)
+	{
+		if (size < kStereoFrameHeaderSize || data[0] != kStereoCodecVersion)
+		{
+			return false;
+		}
+		width = int(Get16(data + 4));
+		height = int(Get16(data + 6));
+		return width > 0 && height > 0;
+	}
+
+	bool StereoFrameCodec::Decode(const uint8_t* data, size_t size, int& width, int& height,
+		std::vector<uint8_t>& LF, std::vector<uint8_t>& RF)
+	{
+		if (!PeekSize(data, size, width, height))
+		{
+			return false;
+		}
+		FramePredictor predictor = FramePredictor(data[1]);
+		int maxError = data[2];
+		size_t blocks[2] = { Get32(data + 8), Get32(data + 12) };
+		if (uint8_t(predictor) > uint8_t(FramePredictor::Med) || maxError > kMaxStereoCodecError ||
+			blocks[0] > size - kStereoFrameHeaderSize || blocks[1] != size - kStereoFrameHeaderSize - blocks[0])
+		{
+			return false;
+		}
+
+		const size_t pixels = size_t(width) * size_t(height);
+		if (pixels > kMaxStereoFramePixels || pixels > blocks[0] * kMaxLz4Expansion || pixels > blocks[1] * kMaxLz4Expansion)
+		{
+			return false;
+		}
+		const uint8_t* block = data + kStereoFrameHeaderSize;
+		std::vector<uint8_t>* images[2] = { &LF, &RF };
+		m_residuals.resize(pixels);
+		for (int i = 0; i < 2; i++)
+		{
+			images[i]->resize(pixels);
+			if (!Lz4DecompressBlock(block, blocks[i], m_residuals.data(), pixels) ||
+				!Reconstruct(images[i]->data(), width, height, predictor, maxError))
+			{
+				return false;
+			}
+			block += blocks[i];
+		}
+		return true;
+	}
+}
@@ -0,0 +1,84 @@
+#pragma once
+// Compresses a LF/RF image pair for the 'c' message, the compressed version of
+// the 'f' message carrying two raw 640x480 images. Every pixel is predicted
+// from its neighbours (by default the median edge detector of LOCO-I / JPEG-LS),
+// the residuals are zigzag mapped so small ones of either sign become small
+// bytes, and the residual planes are LZ4 compressed. The blocks are in the LZ4
+// block format, LZ4_decompress_safe reads them.
+//
+// maxError 0 is lossless. Above 0 the residuals are quantized so every pixel
+// stays within maxError of the original (near-lossless, as JPEG-LS NEAR), the
+// prediction then runs on the reconstructed pixels like the decoder's.
+//
+// Encoded pair, big endian like the message headers:
+//   uint8 version | uint8 predictor | uint8 maxError | uint8 0 | uint16 width | uint16 height
+//   | uint32 LF block size | uint32 RF block size | LF block | RF block
+// Independent of OpenCV.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace HoloLens2CV
+{
+    enum class FramePredictor : uint8_t
+    {
+        None = 0,       // raw pixels, LZ4 alone
+        Left = 1,       // pixel to the left
+        Up = 2,         // pixel above, row delta
+        Med = 3         // median of left, above & their gradient
+    };
+
+    struct StereoCodecSettings
+    {
+        FramePredictor predictor = FramePredictor::Med;
+        int maxError = 0;               // 0 lossless, up to kMaxStereoCodecError
+    };
+
+    constexpr int kStereoCodecVersion = 1;
+    constexpr int kMaxStereoCodecError = 16;
+    constexpr size_t kStereoFrameHeaderSize = 16;
+
+    // largest image of a pair, far above the 640x480 front cameras: width & height come from
+    // the network, the decoder must not allocate what a crafted header asks for
+    constexpr size_t kMaxStereoFramePixels = 4096 * 4096;
+
+    // an LZ4 block decodes to at most this many bytes per byte of block (a match length byte adds 255)
+    constexpr size_t kMaxLz4Expansion = 255;
+
+    const char* FramePredictorName(FramePredictor predictor);
+
+    // LZ4 block format, table is scratch reused between calls. Appends to out
+    void Lz4CompressBlock(const uint8_t* data, size_t size, std::vector<uint8_t>& out, std::vector<int32_t>& table);
+
+    // false for a malformed block or one not decoding to exactly size bytes
+    bool Lz4DecompressBlock(const uint8_t* block, size_t blockSize, uint8_t* out, size_t size);
+
+    class StereoFrameCodec
+    {
+    public:
+        // Appends the encoded pair of width x height 8 bit images (rows packed) to out. false
+        // for sizes beyond 65535 or kMaxStereoFramePixels or an unknown predictor / maxError out of range
+        bool Encode(const uint8_t* LF, const uint8_t* RF, int width, int height,
+            const StereoCodecSettings& settings, std::vector<uint8_t>& out);
+
+        // LF & RF are resized to width x height. false for a truncated or corrupt pair, one larger
+        // than kMaxStereoFramePixels or than its blocks can decode to, checked before anything is resized
+        bool Decode(const uint8_t* data, size_t size, int& width, int& height,
+            std::vector<uint8_t>& LF, std::vector<uint8_t>& RF);
+
+        // width & height of an encoded pair without decoding it
+        static bool PeekSize(const uint8_t* data, size_t size, int& width, int& height);
+
+    private:
+        void Residuals(const uint8_t* image, int width, int height, const StereoCodecSettings& settings);
+        bool Reconstruct(uint8_t* image, int width, int height, FramePredictor predictor, int maxError);
+
+        // scratch, kept so steady state encoding does not allocate
+        std::vector<uint8_t> m_residuals;
+        std::vector<uint8_t> m_reconstructed;
+        std::vector<int32_t> m_table;
+        std::vector<int8_t> m_quantize;     // quantized residual by error + 255, for m_quantizeError
+        int m_quantizeError = -1;
+    };
+}
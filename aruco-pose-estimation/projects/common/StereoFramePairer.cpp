@@ -0,0 +1,128 @@
+#include "StereoFramePairer.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+namespace HoloLens2CV
+{
+	void StereoFramePairer::Configure(const PairingSettings& settings)
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		m_settings = settings;
+		m_settings.depth = std::max(1, settings.depth);
+	}
+
+	void StereoFramePairer::Push(int camera, CameraFrame& frame)
+	{
+		if (camera != 0 && camera != 1)
+		{
+			return;
+		}
+
+		// recycled buffers go back to the caller, no image copy
+		if (m_free.empty())
+		{
+			m_free.emplace_back();
+		}
+		std::swap(m_free.back(), frame);
+		m_pending[camera].push_back(std::move(m_free.back()));
+		m_free.pop_back();
+	}
+
+	bool StereoFramePairer::Pop(FrontCamerasFrame& frame)
+	{
+		PairingSettings settings;
+		{
+			std::lock_guard<std::mutex> l(m_mutex);
+			settings = m_settings;
+		}
+
+		std::deque<CameraFrame>& LF = m_pending[0];
+		std::deque<CameraFrame>& RF = m_pending[1];
+		while (true)
+		{
+			int unmatched = -1;
+			if (!LF.empty() && !RF.empty())
+			{
+				int64_t skew = int64_t(RF.front().hostTicks - LF.front().hostTicks);
+				if (std::llabs(skew) <= settings.tolerance)
+				{
+					std::swap(frame.LF, LF.front());
+					std::swap(frame.RF, RF.front());
+					frame.hasLF = frame.hasRF = true;
+					frame.skew = skew;
+					Recycle(0);
+					Recycle(1);
+
+					std::lock_guard<std::mutex> l(m_mutex);
+					m_stats.paired++;
+					m_stats.lastSkew = skew;
+					m_stats.maxSkew = std::max(m_stats.maxSkew, int64_t(std::llabs(skew)));
+					return true;
+				}
+
+				// frames arrive in order, so the older front can't be matched anymore
+				unmatched = skew > 0 ? 0 : 1;
+			}
+			else if (int(LF.size()) > settings.depth)
+			{
+				unmatched = 0;      // RF stalled
+			}
+			else if (int(RF.size()) > settings.depth)
+			{
+				unmatched = 1;      // LF stalled
+			}
+			else
+			{
+				return false;
+			}
+
+			if (settings.policy == UnpairedPolicy::Mono)
+			{
+				std::swap(unmatched == 0 ? frame.LF : frame.RF, m_pending[unmatched].front());
+				frame.hasLF = unmatched == 0;
+				frame.hasRF = unmatched == 1;
+				frame.skew = 0;
+				Recycle(unmatched);
+
+				std::lock_guard<std::mutex> l(m_mutex);
+				m_stats.mono++;
+				return true;
+			}
+
+			Recycle(unmatched);
+			std::lock_guard<std::mutex> l(m_mutex);
+			m_stats.dropped++;
+		}
+	}
+
+	void StereoFramePairer::Clear()
+	{
+		for (int camera = 0; camera < 2; camera++)
+		{
+			while (!m_pending[camera].empty())
+			{
+				Recycle(camera);
+			}
+		}
+	}
+
+	PairingStats StereoFramePairer::GetStats() const
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		return m_stats;
+	}
+
+	void StereoFramePairer::ResetStats()
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		m_stats = PairingStats();
+	}
+
+	void StereoFramePairer::Recycle(int camera)
+	{
+		m_free.push_back(std::move(m_pending[camera].front()));
+		m_pending[camera].pop_front();
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+// Pairs left front and right front frames by their host ticks. The research
+// mode sensors are read one after the other, so the n-th LF and RF buffers are
+// not guaranteed to be the same exposure. A few frames per camera are kept and
+// matched within a tolerance; frames without a partner are dropped or handed
+// on alone, depending on the policy.
+//
+// Used by the acquisition thread only, except for the stats.
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "FrontCamerasFrame.h"
+
+namespace HoloLens2CV
+{
+    enum class UnpairedPolicy
+    {
+        Drop = 0,           // frames without a partner are discarded
+        Mono = 1            // frames without a partner are handed on alone (hasLF / hasRF)
+    };
+
+    struct PairingSettings
+    {
+        int64_t tolerance = 10000;      // host ticks (100 ns), largest LF / RF difference of a pair
+        int depth = 4;                  // frames kept per camera while waiting for the other one
+        UnpairedPolicy policy = UnpairedPolicy::Mono;
+    };
+
+    struct PairingStats
+    {
+        int64_t paired = 0;
+        int64_t mono = 0;               // frames handed on alone
+        int64_t dropped = 0;            // frames discarded
+        int64_t lastSkew = 0;           // RF - LF host ticks of the last pair
+        int64_t maxSkew = 0;            // largest absolute skew since the last reset
+    };
+
+    class StereoFramePairer
+    {
+    public:
+        // pending frames are kept, the new settings apply from the next Pop
+        void Configure(const PairingSettings& settings);
+
+        // Takes the frame of camera (0: LF, 1: RF, same values as CameraType). Its content is swapped
+        // with a recycled frame, so frame keeps allocated buffers for the next capture.
+        // Frames of one camera must be pushed in capture order.
+        void Push(int camera, CameraFrame& frame);
+
+        // Next pair, or single frame with the Mono policy, swapped into frame. A frame is unmatched
+        // once the other camera has a frame later than it by more than the tolerance, or more
+        // than depth frames of its camera are waiting. False if nothing is ready yet.
+        bool Pop(FrontCamerasFrame& frame);
+
+        // pending frames are recycled
+        void Clear();
+
+        PairingStats GetStats() const;
+        void ResetStats();
+
+    private:
+        void Recycle(int camera);
+
+        PairingSettings m_settings;
+        std::deque<CameraFrame> m_pending[2];   // LF / RF in capture order
+        std::vector<CameraFrame> m_free;
+
+        mutable std::mutex m_mutex;             // settings & stats, read by other threads
+        PairingStats m_stats;
+    };
+}
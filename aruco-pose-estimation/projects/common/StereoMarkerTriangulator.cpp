@@ -0,0 +1,305 @@
+#include "StereoMarkerTriangulator.h"
+
+#include <cmath>
+
+namespace HoloLens2CV
+{
+	namespace
+	{
+		const int kIterations = 10;     // Gauss-Newton steps of the stereo refinement, it converges in 2-3
+
+		// number of markers with id on camera, ids printed twice can't be matched
+		int CountId(const std::vector<MarkerPose>& markers, int id, int camera)
+		{
+			int count = 0;
+			for (const MarkerPose& marker : markers)
+			{
+				count += marker.id == id && marker.camera == camera ? 1 : 0;
+			}
+			return count;
+		}
+
+		// Squared reprojection error of the marker corners on the unit planes of both cameras
+		// for the marker pose R, t relative to LF, and the normal equations of a Gauss-Newton
+		// step (rotation increment first, then translation). -1 if a corner is behind a camera.
+		double Linearize(const cv::Matx33d& R, const cv::Vec3d& t, const cv::Vec3d* object,
+			const cv::Point2f* LF, const cv::Point2f* RF, const cv::Matx33d& RFRotation, const cv::Vec3d& RFTranslation,
+			cv::Matx66d& A, cv::Matx61d& b)
+		{
+			A = cv::Matx66d::zeros();
+			b = cv::Matx61d::zeros();
+			double cost = 0.0;
+			for (int c = 0; c < 4; c++)
+			{
+				// dX/d(rotation) = -[R * object]x, dX/d(translation) = identity
+				cv::Vec3d o = R * object[c];
+				cv::Vec3d X = o + t;
+				cv::Matx<double, 3, 6> dX(
+					0, o[2], -o[1], 1, 0, 0,
+					-o[2], 0, o[0], 0, 1, 0,
+					o[1], -o[0], 0, 0, 0, 1);
+
+				for (int view = 0; view < 2; view++)
+				{
+					cv::Vec3d P = view == 0 ? X : RFRotation * X + RFTranslation;
+					cv::Matx33d dP = view == 0 ? cv::Matx33d::eye() : RFRotation;
+					const cv::Point2f& observed = view == 0 ? LF[c] : RF[c];
+					if (P[2] <= 1e-6)
+					{
+						return -1.0;
+					}
+
+					double rx = P[0] / P[2] - observed.x, ry = P[1] / P[2] - observed.y;
+					cv::Matx<double, 2, 3> dProjection(
+						1.0 / P[2], 0, -P[0] / (P[2] * P[2]),
+						0, 1.0 / P[2], -P[1] / (P[2] * P[2]));
+					cv::Matx<double, 2, 6> J = dProjection * dP * dX;
+					A += J.t() * J;
+					b += J.t() * cv::Matx21d(rx, ry);
+					cost += rx * rx + ry * ry;
+				}
+			}
+			return cost;
+		}
+	}
+
+	void StereoMarkerTriangulator::Configure(const StereoSettings& settings)
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		m_settings = settings;
+	}
+
+	void StereoMarkerTriangulator::SetMarkerLength(float markerLength)
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		m_markerLength = markerLength;
+	}
+
+	void StereoMarkerTriangulator::SetCameraIntrinsics(int camera, const CameraIntrinsics& intrinsics)
+	{
+		if (camera != LeftFrontCamera && camera != RightFrontCamera)
+		{
+			return;
+		}
+
+		std::lock_guard<std::mutex> l(m_mutex);
+		m_cameraMatrix[camera] = cv::Mat(cv::Matx33d(
+			intrinsics.fx, 0, intrinsics.cx,
+			0, intrinsics.fy, intrinsics.cy,
+			0, 0, 1));
+		m_distortionCoefficients[camera] = cv::Mat(cv::Matx<double, 1, 5>(
+			intrinsics.k1, intrinsics.k2, intrinsics.p1, intrinsics.p2, intrinsics.k3));
+		m_hasIntrinsics[camera] = true;
+	}
+
+	void StereoMarkerTriangulator::SetExtrinsics(const cv::Matx44d& RFFromLF)
+	{
+		cv::Matx33d R(
+			RFFromLF(0, 0), RFFromLF(0, 1), RFFromLF(0, 2),
+			RFFromLF(1, 0), RFFromLF(1, 1), RFFromLF(1, 2),
+			RFFromLF(2, 0), RFFromLF(2, 1), RFFromLF(2, 2));
+		cv::Vec3d t(RFFromLF(0, 3), RFFromLF(1, 3), RFFromLF(2, 3));
+
+		// rays are intersected in the LF camera, so the inverse is kept as well
+		std::lock_guard<std::mutex> l(m_mutex);
+		m_RFFromLFRotation = R;
+		m_RFFromLFTranslation = t;
+		m_LFFromRFRotation = R.t();
+		m_RFOrigin = (R.t() * t) * -1.0;
+		m_hasExtrinsics = true;
+	}
+
+	bool StereoMarkerTriangulator::IsReady() const
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		return m_settings.enabled && m_hasIntrinsics[LeftFrontCamera] && m_hasIntrinsics[RightFrontCamera] &&
+			m_hasExtrinsics && m_markerLength > 0.f;
+	}
+
+	void StereoMarkerTriangulator::Process(std::vector<MarkerPose>& markers)
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		if (!m_settings.enabled || !m_hasIntrinsics[LeftFrontCamera] || !m_hasIntrinsics[RightFrontCamera] ||
+			!m_hasExtrinsics || m_markerLength <= 0.f)
+		{
+			return;
+		}
+
+		// RF markers replaced by a stereo pose are marked 1 & dropped, those of a rejected pair 2 & kept
+		m_fused.clear();
+		m_used.assign(markers.size(), 0);
+		for (size_t i = 0; i < markers.size(); i++)
+		{
+			const MarkerPose& LF = markers[i];
+			if (LF.camera != LeftFrontCamera)
+			{
+				continue;
+			}
+
+			size_t match = markers.size();
+			if (CountId(markers, LF.id, LeftFrontCamera) == 1 && CountId(markers, LF.id, RightFrontCamera) == 1)
+			{
+				for (size_t j = 0; j < markers.size(); j++)
+				{
+					if (markers[j].camera == RightFrontCamera && markers[j].id == LF.id)
+					{
+						match = j;
+					}
+				}
+			}
+
+			MarkerPose fused;
+			if (match == markers.size())
+			{
+				m_fused.push_back(LF);
+				m_stats.mono++;
+			}
+			else if (TriangulateLocked(LF, markers[match], fused))
+			{
+				m_fused.push_back(fused);
+				m_used[match] = 1;
+				m_stats.stereo++;
+			}
+			else
+			{
+				// both mono poses stay, like markers seen by one camera
+				m_fused.push_back(LF);
+				m_used[match] = 2;
+				m_stats.rejected++;
+			}
+		}
+
+		for (size_t j = 0; j < markers.size(); j++)
+		{
+			if (markers[j].camera == LeftFrontCamera || m_used[j] == 1)
+			{
+				continue;
+			}
+			m_fused.push_back(markers[j]);
+			m_stats.mono += m_used[j] == 0 ? 1 : 0;
+		}
+
+		markers.swap(m_fused);
+	}
+
+	bool StereoMarkerTriangulator::Triangulate(const MarkerPose& LF, const MarkerPose& RF, MarkerPose& fused) const
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		if (!m_hasIntrinsics[LeftFrontCamera] || !m_hasIntrinsics[RightFrontCamera] || !m_hasExtrinsics || m_markerLength <= 0.f)
+		{
+			return false;
+		}
+		return TriangulateLocked(LF, RF, fused);
+	}
+
+	bool StereoMarkerTriangulator::TriangulateLocked(const MarkerPose& LF, const MarkerPose& RF, MarkerPose& fused) const
+	{
+		// corners on the unit plane of each camera
+		std::vector<cv::Point2f> LFCorners(LF.corners.begin(), LF.corners.end()), RFCorners(RF.corners.begin(), RF.corners.end());
+		std::vector<cv::Point2f> LFNormalized, RFNormalized;
+		cv::undistortPoints(LFCorners, LFNormalized, m_cameraMatrix[LeftFrontCamera], m_distortionCoefficients[LeftFrontCamera]);
+		cv::undistortPoints(RFCorners, RFNormalized, m_cameraMatrix[RightFrontCamera], m_distortionCoefficients[RightFrontCamera]);
+
+		// midpoint of the closest points of the LF ray s * d1 and the RF ray o2 + u * d2
+		std::array<cv::Vec3d, 4> points;
+		const cv::Vec3d& o2 = m_RFOrigin;
+		for (int c = 0; c < 4; c++)
+		{
+			cv::Vec3d d1(LFNormalized[c].x, LFNormalized[c].y, 1.0);
+			cv::Vec3d d2 = m_LFFromRFRotation * cv::Vec3d(RFNormalized[c].x, RFNormalized[c].y, 1.0);
+
+			double a = d1.dot(d1), b = d1.dot(d2), e = d2.dot(d2);
+			double f = d1.dot(o2), g = d2.dot(o2);
+			double denominator = a * e - b * b;
+			if (denominator < 1e-12)
+			{
+				return false;       // parallel rays
+			}
+			double s = (f * e - b * g) / denominator;
+			double u = (f * b - a * g) / denominator;
+			if (s <= 0.0 || u <= 0.0)
+			{
+				return false;       // behind one of the cameras
+			}
+			points[c] = (d1 * s + o2 + d2 * u) * 0.5;
+		}
+
+		// rigid fit of the marker corners (aruco order, centered on the marker) to the triangulated ones
+		const double h = m_markerLength / 2.0;
+		const cv::Vec3d object[4] = { { -h, h, 0 }, { h, h, 0 }, { h, -h, 0 }, { -h, -h, 0 } };
+		cv::Vec3d t = (points[0] + points[1] + points[2] + points[3]) * 0.25;
+		cv::Matx33d H = cv::Matx33d::zeros();
+		for (int c = 0; c < 4; c++)
+		{
+			cv::Vec3d q = points[c] - t;
+			for (int r = 0; r < 3; r++)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					H(r, k) += object[c][r] * q[k];
+				}
+			}
+		}
+
+		cv::Matx31d w;
+		cv::Matx33d U, Vt;
+		cv::SVD::compute(H, w, U, Vt);
+
+		// the corners are planar, the sign of the third axis is fixed so R is a rotation
+		cv::Matx33d V = Vt.t();
+		double sign = cv::determinant(V * U.t()) < 0.0 ? -1.0 : 1.0;
+		cv::Matx33d R = V * cv::Matx33d(1, 0, 0, 0, 1, 0, 0, 0, sign) * U.t();
+
+		// The triangulated depth of single corners is noisy at range, which makes the fitted
+		// orientation noisy. The pose is refined on the reprojection error in both images,
+		// the known marker size & the baseline constrain it together.
+		cv::Matx66d A;
+		cv::Matx61d b;
+		double cost = 0.0;
+		bool converged = false;
+		for (int iteration = 0; ; iteration++)
+		{
+			cost = Linearize(R, t, object, LFNormalized.data(), RFNormalized.data(), m_RFFromLFRotation, m_RFFromLFTranslation, A, b);
+			if (cost < 0.0)
+			{
+				return false;
+			}
+			if (converged || iteration == kIterations)
+			{
+				break;      // cost of the final pose only
+			}
+
+			cv::Matx61d delta = A.solve(b * -1.0, cv::DECOMP_CHOLESKY);
+			cv::Matx33d dR;
+			cv::Rodrigues(cv::Vec3d(delta(0), delta(1), delta(2)), dR);
+			R = dR * R;
+			t = t + cv::Vec3d(delta(3), delta(4), delta(5));
+			converged = delta.dot(delta) < 1e-16;
+		}
+
+		// rms over the 8 corner observations, in LF pixels
+		double rms = std::sqrt(cost / 8.0) * m_cameraMatrix[LeftFrontCamera].at<double>(0, 0);
+		if (rms > m_settings.maxReprojectionError)
+		{
+			return false;       // a wrong match, a bad corner or wrong extrinsics
+		}
+
+		fused = LF;
+		fused.camera = LeftFrontCamera;
+		cv::Rodrigues(R, fused.rvec);
+		fused.tvec = t;
+		return true;
+	}
+
+	StereoStats StereoMarkerTriangulator::GetStats() const
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		return m_stats;
+	}
+
+	void StereoMarkerTriangulator::ResetStats()
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		m_stats = StereoStats();
+	}
+}
@@ -0,0 +1,83 @@
+#pragma once
+// Stereo pose of markers seen by both front cameras. The corners of a marker
+// detected on the LF and RF images are triangulated with the known LF -> RF
+// extrinsics, the marker square is fitted to the 3D corners and the pose is
+// refined on the reprojection error in both images. Depth then comes from the
+// camera baseline instead of the apparent marker size, which is what limits
+// monocular PnP at range. Markers seen by one camera only keep their
+// monocular pose.
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <opencv2/opencv.hpp>	// for opencv 4.8+
+
+#include "ArUcoDetectorSession.h"
+
+namespace HoloLens2CV
+{
+    struct StereoSettings
+    {
+        bool enabled = false;
+        float maxReprojectionError = 2.f;   // pixels (rms over both images) beyond which the mono poses are kept
+    };
+
+    struct StereoStats
+    {
+        int64_t stereo = 0;             // markers triangulated from both cameras
+        int64_t mono = 0;               // markers seen by one camera only
+        int64_t rejected = 0;           // seen by both but the stereo fit failed, mono poses kept (not counted in mono)
+    };
+
+    class StereoMarkerTriangulator
+    {
+    public:
+        void Configure(const StereoSettings& settings);
+
+        // printed side of the markers in meters, the triangulated corners are fitted to it
+        void SetMarkerLength(float markerLength);
+
+        void SetCameraIntrinsics(int camera, const CameraIntrinsics& intrinsics);
+
+        // RFFromLF maps points from the LF camera to the RF camera (OpenCV camera axes)
+        void SetExtrinsics(const cv::Matx44d& RFFromLF);
+
+        // enabled, both intrinsics, the extrinsics & the marker length set
+        bool IsReady() const;
+
+        // markers of both cameras as merged by FrontCamerasDetector (one entry per camera).
+        // Every id found on both images is replaced by a single triangulated pose relative
+        // to the LF camera, tagged LeftFrontCamera with the LF corners; the rest is left as is.
+        void Process(std::vector<MarkerPose>& markers);
+
+        // pose relative to LF from one marker's LF & RF corners, false if it fails the checks
+        bool Triangulate(const MarkerPose& LF, const MarkerPose& RF, MarkerPose& fused) const;
+
+        StereoStats GetStats() const;
+        void ResetStats();
+
+    private:
+        bool TriangulateLocked(const MarkerPose& LF, const MarkerPose& RF, MarkerPose& fused) const;
+
+        mutable std::mutex m_mutex;
+
+        StereoSettings m_settings;
+        float m_markerLength = 0.f;
+        bool m_hasIntrinsics[2] = { false, false };
+        bool m_hasExtrinsics = false;
+
+        cv::Mat m_cameraMatrix[2];
+        cv::Mat m_distortionCoefficients[2];
+        cv::Matx33d m_RFFromLFRotation;
+        cv::Vec3d m_RFFromLFTranslation;
+        cv::Matx33d m_LFFromRFRotation;         // RF rays into the LF camera
+        cv::Vec3d m_RFOrigin;                   // RF camera center in the LF camera
+
+        StereoStats m_stats;
+
+        // scratch buffers kept between frames to avoid reallocations
+        std::vector<MarkerPose> m_fused;
+        std::vector<char> m_used;          // per input marker: 1 replaced by a stereo pose, 2 of a rejected pair
+    };
+}
@@ -0,0 +1,50 @@
+#include "SyntheticRigPoseSource.h"
+#include "Quaternion.h"
+
+#include <cmath>
+
+namespace HoloLens2CV
+{
+	namespace
+	{
+		const double kPi = 3.14159265358979323846;
+		const double kTicksPerSecond = 1e7;
+
+		// amplitude of a sine of frequency f reaching the peak rate
+		double Amplitude(double peakRate, double frequency)
+		{
+			return peakRate / (2.0 * kPi * frequency);
+		}
+	}
+
+	bool SyntheticRigPoseSource::TryLocate(int64_t timestamp, RigPose& pose)
+	{
+		if (!m_tracking)
+		{
+			return false;
+		}
+		pose = PoseAt(timestamp);
+		return true;
+	}
+
+	RigPose SyntheticRigPoseSource::PoseAt(int64_t timestamp) const
+	{
+		double t = double(timestamp) / kTicksPerSecond;
+		double w = m_settings.angularSpeed, v = m_settings.linearSpeed;
+
+		// yaw dominates, pitch & roll are smaller & slower, frequencies are not multiples of each other
+		double yaw = Amplitude(w, 0.35) * std::sin(2.0 * kPi * 0.35 * t);
+		double pitch = Amplitude(0.5 * w, 0.23) * std::sin(2.0 * kPi * 0.23 * t + 1.0);
+		double roll = Amplitude(0.2 * w, 0.17) * std::sin(2.0 * kPi * 0.17 * t + 2.0);
+
+		RigPose pose;
+		pose.timestamp = timestamp;
+		pose.orientation = Quaternion::Multiply(Quaternion::Exp(cv::Vec3d(0, yaw, 0)),
+			Quaternion::Multiply(Quaternion::Exp(cv::Vec3d(pitch, 0, 0)), Quaternion::Exp(cv::Vec3d(0, 0, roll))));
+		pose.position = cv::Vec3d(
+			Amplitude(v, 0.4) * std::sin(2.0 * kPi * 0.4 * t),
+			1.6 + Amplitude(0.3 * v, 0.9) * std::sin(2.0 * kPi * 0.9 * t + 0.5),
+			Amplitude(0.5 * v, 0.25) * std::sin(2.0 * kPi * 0.25 * t + 1.5));
+		return pose;
+	}
+}
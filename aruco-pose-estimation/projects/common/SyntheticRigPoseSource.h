@@ -0,0 +1,40 @@
+#pragma once
+// Rig pose source following a smooth synthetic head motion, for running the
+// pose history and the acquisition code off-device. Position & orientation are
+// sums of sines (a person looking around while swaying a little), tracking can
+// be switched off to simulate a loss. The clock is set by the caller, so runs
+// are repeatable and can go faster than real time.
+
+#include <atomic>
+#include <cstdint>
+
+#include "RigPoseHistory.h"
+
+namespace HoloLens2CV
+{
+    struct TrajectorySettings
+    {
+        double angularSpeed = 1.0;      // rad/s, peak yaw rate, head turns are around 1-3 rad/s
+        double linearSpeed = 0.3;       // m/s, peak speed of the sway
+    };
+
+    class SyntheticRigPoseSource : public RigPoseSource
+    {
+    public:
+        explicit SyntheticRigPoseSource(const TrajectorySettings& settings = TrajectorySettings()) : m_settings(settings) {}
+
+        int64_t Now() override { return m_now; }
+        bool TryLocate(int64_t timestamp, RigPose& pose) override;
+
+        void SetNow(int64_t timestamp) { m_now = timestamp; }
+        void SetTracking(bool tracking) { m_tracking = tracking; }
+
+        // exact pose of the trajectory, also while tracking is lost
+        RigPose PoseAt(int64_t timestamp) const;
+
+    private:
+        TrajectorySettings m_settings;
+        std::atomic<int64_t> m_now = 0;
+        std::atomic_bool m_tracking = true;
+    };
+}
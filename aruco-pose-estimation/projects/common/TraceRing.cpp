@@ -0,0 +1,156 @@
+#include "TraceRing.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <thread>
+
+namespace HoloLens2CV
+{
+	namespace
+	{
+		void AppendEscaped(std::string& json, const char* text)
+		{
+			for (const char* c = text; *c != '\0'; c++)
+			{
+				if (*c == '"' || *c == '\\')
+				{
+					json += '\\';
+				}
+				json += uint8_t(*c) < 0x20 ? ' ' : *c;
+			}
+		}
+	}
+
+	void TraceRing::Enable(size_t capacity)
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		m_enabled = false;
+
+		// writers that saw the ring enabled finish their slot, later ones return
+		while (m_writers.load(std::memory_order_seq_cst) != 0)
+		{
+			std::this_thread::yield();
+		}
+
+		size_t size = 1;
+		while (size < std::max<size_t>(capacity, 2))
+		{
+			size <<= 1;
+		}
+		if (!m_slots || size != m_mask + 1)
+		{
+			m_slots.reset(new Slot[size]);
+			m_mask = size - 1;
+		}
+		for (size_t i = 0; i <= m_mask; i++)
+		{
+			m_slots[i].version.store(0, std::memory_order_relaxed);
+		}
+		m_next = 0;
+		m_enabled = true;
+	}
+
+	void TraceRing::Disable()
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		m_enabled = false;
+	}
+
+	std::vector<TraceEvent> TraceRing::Snapshot() const
+	{
+		std::vector<TraceEvent> events;
+		std::lock_guard<std::mutex> l(m_mutex);
+		if (!m_slots)
+		{
+			return events;
+		}
+
+		uint64_t next = m_next.load(std::memory_order_acquire);
+		uint64_t first = next > m_mask + 1 ? next - (m_mask + 1) : 0;
+		events.reserve(size_t(next - first));
+		for (uint64_t index = first; index < next; index++)
+		{
+			const Slot& slot = m_slots[index & m_mask];
+			uint64_t version = slot.version.load(std::memory_order_acquire);
+			TraceEvent event;
+			event.name = slot.name.load(std::memory_order_relaxed);
+			event.begin = slot.begin.load(std::memory_order_relaxed);
+			event.end = slot.end.load(std::memory_order_relaxed);
+			event.thread = slot.thread.load(std::memory_order_relaxed);
+			event.sequence = slot.sequence.load(std::memory_order_relaxed);
+			event.timestamp = slot.timestamp.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+
+			// still being written or already overwritten by a newer event
+			if (version != 2 * index + 2 || slot.version.load(std::memory_order_relaxed) != version || event.name == nullptr)
+			{
+				continue;
+			}
+			events.push_back(event);
+		}
+
+		// scopes end in a different order than they begin
+		std::sort(events.begin(), events.end(), [](const TraceEvent& a, const TraceEvent& b) { return a.begin < b.begin; });
+		return events;
+	}
+
+	std::string TraceRing::ToChromeJson() const
+	{
+		std::vector<TraceEvent> events = Snapshot();
+		std::vector<std::pair<uint32_t, std::string>> threadNames;
+		{
+			std::lock_guard<std::mutex> l(m_mutex);
+			threadNames = m_threadNames;
+		}
+
+		std::string json;
+		json.reserve(128 + events.size() * 160);
+		json += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+		char line[256];
+		bool first = true;
+		for (const auto& thread : threadNames)
+		{
+			std::snprintf(line, sizeof(line), "%s\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"",
+				first ? "" : ",", thread.first);
+			json += line;
+			AppendEscaped(json, thread.second.c_str());
+			json += "\"}}";
+			first = false;
+		}
+
+		// microseconds with ns precision, the unit of the format
+		for (const TraceEvent& event : events)
+		{
+			std::snprintf(line, sizeof(line), "%s\n{\"ph\":\"X\",\"cat\":\"pipeline\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"name\":\"",
+				first ? "" : ",", event.thread, event.begin / 1000.0, (event.end - event.begin) / 1000.0);
+			json += line;
+			AppendEscaped(json, event.name);
+			json += '"';
+			if (event.sequence >= 0)
+			{
+				std::snprintf(line, sizeof(line), ",\"args\":{\"frame\":%" PRId64 ",\"sensorTimestamp\":%" PRId64 "}", event.sequence, event.timestamp);
+				json += line;
+			}
+			json += '}';
+			first = false;
+		}
+		json += "\n]}\n";
+		return json;
+	}
+
+	void TraceRing::NameThread(const char* name)
+	{
+		uint32_t id = ThreadId();
+		std::lock_guard<std::mutex> l(m_mutex);
+		for (auto& thread : m_threadNames)
+		{
+			if (thread.first == id)
+			{
+				thread.second = name;
+				return;
+			}
+		}
+		m_threadNames.emplace_back(id, name);
+	}
+}
@@ -0,0 +1,209 @@
+#pragma once
+// Opt-in timeline tracing of the capture & detection pipeline. Stages record
+// one event each (name, begin, end, thread, frame sequence number, sensor time
+// stamp) into a preallocated ring, the oldest events are overwritten. The ring
+// is dumped on demand as Chrome trace JSON, which chrome://tracing and the
+// Perfetto UI open directly.
+//
+// Disabled (the default) a TraceScope costs one relaxed atomic load. Enabled,
+// recording is lock-free: a writer announces itself in a counter, claims a
+// slot index with one atomic increment and the slot with a compare-exchange
+// of its sequence number, under which it writes the event, so a dump never
+// reads a half written event. The recording path is inline, only Enable &
+// the dump need TraceRing.cpp.
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace HoloLens2CV
+{
+    struct TraceEvent
+    {
+        const char* name = nullptr;     // string literal, only the pointer is kept
+        int64_t begin = 0;              // ns since the trace epoch, see TraceRing::Now
+        int64_t end = 0;
+        uint32_t thread = 0;            // small id per thread, see TraceRing::ThreadId
+        int64_t sequence = -1;          // frame sequence number, -1 if not known
+        int64_t timestamp = 0;          // sensor time stamp of the frame (100 ns ticks), 0 if not known
+    };
+
+    class TraceRing
+    {
+    public:
+        // the ring the plugins & the pipeline record into
+        static TraceRing& Global()
+        {
+            static TraceRing ring;
+            return ring;
+        }
+
+        TraceRing() = default;
+        TraceRing(const TraceRing&) = delete;
+        TraceRing& operator=(const TraceRing&) = delete;
+
+        // Starts an empty trace of capacity events (rounded up to a power of two). Recording stops
+        // first & the ring is reallocated, once no writer holds a slot, when the capacity changes.
+        void Enable(size_t capacity = 1 << 16);
+        void Disable();
+        bool IsEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+        void Record(const TraceEvent& event)
+        {
+            if (!m_enabled.load(std::memory_order_acquire))
+            {
+                return;
+            }
+
+            // counted before enabled is read again, so Enable either waits for this writer or it sees the stop
+            m_writers.fetch_add(1, std::memory_order_seq_cst);
+            if (!m_enabled.load(std::memory_order_seq_cst))
+            {
+                m_writers.fetch_sub(1, std::memory_order_release);
+                return;
+            }
+
+            // Odd version while the fields change, a reader seeing it (or another one after) skips the slot.
+            // A writer a whole lap behind finds the slot taken by a newer event or still being written
+            // and drops its event, so two writers never fill one slot.
+            uint64_t index = m_next.fetch_add(1, std::memory_order_relaxed);
+            Slot& slot = m_slots[index & m_mask];
+            uint64_t version = slot.version.load(std::memory_order_relaxed);
+            if ((version & 1) != 0 || version > 2 * index ||
+                !slot.version.compare_exchange_strong(version, 2 * index + 1, std::memory_order_relaxed))
+            {
+                m_writers.fetch_sub(1, std::memory_order_release);
+                return;
+            }
+            std::atomic_thread_fence(std::memory_order_release);
+            slot.name.store(event.name, std::memory_order_relaxed);
+            slot.begin.store(event.begin, std::memory_order_relaxed);
+            slot.end.store(event.end, std::memory_order_relaxed);
+            slot.thread.store(event.thread, std::memory_order_relaxed);
+            slot.sequence.store(event.sequence, std::memory_order_relaxed);
+            slot.timestamp.store(event.timestamp, std::memory_order_relaxed);
+            slot.version.store(2 * index + 2, std::memory_order_release);
+            m_writers.fetch_sub(1, std::memory_order_release);
+        }
+
+        // events currently held, oldest first, & the number recorded since Enable
+        std::vector<TraceEvent> Snapshot() const;
+        uint64_t Recorded() const { return m_next.load(std::memory_order_relaxed); }
+
+        // {"traceEvents": [...]} with complete ("X") events & the thread names
+        std::string ToChromeJson() const;
+
+        // steady clock in ns since the first call in the process
+        static int64_t Now()
+        {
+            static const auto epoch = std::chrono::steady_clock::now();
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+        }
+
+        // id of the calling thread in the trace, assigned on first use
+        static uint32_t ThreadId()
+        {
+            static std::atomic<uint32_t> next{ 1 };
+            thread_local uint32_t id = next.fetch_add(1, std::memory_order_relaxed);
+            return id;
+        }
+
+        // label of the calling thread in the trace
+        void NameThread(const char* name);
+
+    private:
+        struct Slot
+        {
+            std::atomic<uint64_t> version{ 0 };     // 2 * index + 1 while written, 2 * index + 2 once complete
+            std::atomic<const char*> name{ nullptr };
+            std::atomic<int64_t> begin{ 0 };
+            std::atomic<int64_t> end{ 0 };
+            std::atomic<uint32_t> thread{ 0 };
+            std::atomic<int64_t> sequence{ -1 };
+            std::atomic<int64_t> timestamp{ 0 };
+        };
+
+        std::atomic_bool m_enabled = false;
+        std::atomic<uint64_t> m_next = 0;
+        std::atomic<uint32_t> m_writers = 0;    // Record calls past the enabled check
+        std::unique_ptr<Slot[]> m_slots;
+        size_t m_mask = 0;
+
+        mutable std::mutex m_mutex;     // Enable / Disable, the slots for Snapshot & the thread names
+        std::vector<std::pair<uint32_t, std::string>> m_threadNames;
+    };
+
+    // Frame the calling thread is working on, picked up by the TraceScopes it opens. Restores
+    // the previous frame when it goes out of scope.
+    class TraceFrame
+    {
+    public:
+        TraceFrame(int64_t sequence, int64_t timestamp) : m_sequence(t_sequence), m_timestamp(t_timestamp)
+        {
+            t_sequence = sequence;
+            t_timestamp = timestamp;
+        }
+
+        ~TraceFrame()
+        {
+            t_sequence = m_sequence;
+            t_timestamp = m_timestamp;
+        }
+
+        TraceFrame(const TraceFrame&) = delete;
+        TraceFrame& operator=(const TraceFrame&) = delete;
+
+        static int64_t Sequence() { return t_sequence; }
+        static int64_t Timestamp() { return t_timestamp; }
+
+    private:
+        static inline thread_local int64_t t_sequence = -1;
+        static inline thread_local int64_t t_timestamp = 0;
+
+        int64_t m_sequence;
+        int64_t m_timestamp;
+    };
+
+    // one event from construction to destruction in the global ring, nothing while tracing is off
+    class TraceScope
+    {
+    public:
+        explicit TraceScope(const char* name)
+        {
+            if (TraceRing::Global().IsEnabled())
+            {
+                m_name = name;
+                m_begin = TraceRing::Now();
+            }
+        }
+
+        ~TraceScope()
+        {
+            if (m_name != nullptr)
+            {
+                TraceEvent event;
+                event.name = m_name;
+                event.begin = m_begin;
+                event.end = TraceRing::Now();
+                event.thread = TraceRing::ThreadId();
+                event.sequence = TraceFrame::Sequence();
+                event.timestamp = TraceFrame::Timestamp();
+                TraceRing::Global().Record(event);
+            }
+        }
+
+        TraceScope(const TraceScope&) = delete;
+        TraceScope& operator=(const TraceScope&) = delete;
+
+    private:
+        const char* m_name = nullptr;
+        int64_t m_begin = 0;
+    };
+}
@@ -0,0 +1,57 @@
+#pragma once
+// Lock-free triple buffer for publishing the latest value from one writer
+// thread to one reader thread. Neither side ever blocks: the writer fills its
+// back buffer and swaps it with the middle one, the reader swaps the middle
+// buffer with its front buffer when a newer value has been published.
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace HoloLens2CV
+{
+    template <typename T>
+    class TripleBuffer
+    {
+    public:
+        TripleBuffer() = default;
+        TripleBuffer(const TripleBuffer&) = delete;
+        TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+        // writer side: buffer to be filled, only valid until the next Publish
+        T& WriteBuffer() { return m_buffers[m_back]; }
+
+        // writer side: makes the filled buffer the latest one
+        void Publish()
+        {
+            uint8_t previous = m_middle.exchange(uint8_t(m_back | kDirty), std::memory_order_acq_rel);
+            m_back = previous & kIndexMask;
+        }
+
+        // reader side: switches to the latest published buffer, false if nothing new was published
+        bool Update()
+        {
+            if (!(m_middle.load(std::memory_order_acquire) & kDirty))
+            {
+                return false;
+            }
+            uint8_t previous = m_middle.exchange(m_front, std::memory_order_acq_rel);
+            m_front = previous & kIndexMask;
+            return true;
+        }
+
+        // reader side: latest complete value seen by Update, only valid until the next Update
+        const T& ReadBuffer() const { return m_buffers[m_front]; }
+
+    private:
+        static constexpr uint8_t kIndexMask = 0x3;
+        static constexpr uint8_t kDirty = 0x4;
+
+        std::array<T, 3> m_buffers;
+
+        // writer and reader indices live on separate cache lines
+        alignas(64) uint8_t m_back = 0;
+        alignas(64) std::atomic<uint8_t> m_middle{ 1 };
+        alignas(64) uint8_t m_front = 2;
+    };
+}
@@ -0,0 +1,62 @@
+#include "UndistortionTable.h"
+
+#include <algorithm>
+
+namespace HoloLens2CV
+{
+	void UndistortionTable::Build(const cv::Mat& cameraMatrix, const cv::Mat& distortionCoefficients, const cv::Size& imageSize)
+	{
+		m_cameraMatrix = cameraMatrix.clone();
+		m_distortionCoefficients = distortionCoefficients.clone();
+		m_imageSize = imageSize;
+		m_map1 = cv::Mat();
+		m_map2 = cv::Mat();
+
+		// every pixel center at once, the table has the same layout as the image
+		cv::Mat pixels(imageSize.height, imageSize.width, CV_32FC2);
+		for (int y = 0; y < imageSize.height; y++)
+		{
+			cv::Vec2f* row = pixels.ptr<cv::Vec2f>(y);
+			for (int x = 0; x < imageSize.width; x++)
+			{
+				row[x] = cv::Vec2f(float(x), float(y));
+			}
+		}
+		cv::undistortPoints(pixels.reshape(2, 1), m_table, m_cameraMatrix, m_distortionCoefficients);
+		m_table = m_table.reshape(2, imageSize.height);
+	}
+
+	void UndistortionTable::Reset()
+	{
+		m_table = cv::Mat();
+		m_map1 = cv::Mat();
+		m_map2 = cv::Mat();
+		m_imageSize = cv::Size();
+	}
+
+	cv::Point2f UndistortionTable::Normalize(const cv::Point2f& pixel) const
+	{
+		// bilinear interpolation between the 4 surrounding pixel centers
+		float x = std::min(std::max(pixel.x, 0.f), float(m_imageSize.width - 1));
+		float y = std::min(std::max(pixel.y, 0.f), float(m_imageSize.height - 1));
+		int x0 = std::min(int(x), m_imageSize.width - 2);
+		int y0 = std::min(int(y), m_imageSize.height - 2);
+		float ax = x - float(x0);
+		float ay = y - float(y0);
+
+		const cv::Vec2f* top = m_table.ptr<cv::Vec2f>(y0) + x0;
+		const cv::Vec2f* bottom = m_table.ptr<cv::Vec2f>(y0 + 1) + x0;
+		cv::Vec2f v = (top[0] * (1.f - ax) + top[1] * ax) * (1.f - ay) + (bottom[0] * (1.f - ax) + bottom[1] * ax) * ay;
+		return cv::Point2f(v[0], v[1]);
+	}
+
+	void UndistortionTable::Undistort(const cv::Mat& image, cv::Mat& undistorted)
+	{
+		if (m_map1.empty())
+		{
+			cv::initUndistortRectifyMap(m_cameraMatrix, m_distortionCoefficients, cv::noArray(), m_cameraMatrix,
+				m_imageSize, CV_16SC2, m_map1, m_map2);
+		}
+		cv::remap(image, undistorted, m_map1, m_map2, cv::INTER_LINEAR);
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+// Dense lookup table from sensor pixels to undistorted normalized image
+// coordinates (x/z, y/z of the camera ray), compiled once per intrinsics and
+// image size. Sub-pixel points are interpolated bilinearly, so corners can be
+// normalized without running the iterative 5 coefficient undistortion for
+// every solvePnP call.
+
+#include <opencv2/opencv.hpp>	// for opencv 4.8+
+
+namespace HoloLens2CV
+{
+    class UndistortionTable
+    {
+    public:
+        // one undistortPoints pass over every pixel center of an imageSize image,
+        // cameraMatrix is 3x3 and distortionCoefficients (k1, k2, p1, p2, k3) as given to solvePnP
+        void Build(const cv::Mat& cameraMatrix, const cv::Mat& distortionCoefficients, const cv::Size& imageSize);
+        void Reset();
+
+        bool IsBuilt() const { return !m_table.empty(); }
+        const cv::Size& ImageSize() const { return m_imageSize; }
+
+        // normalized ray of a sub-pixel image point, points outside the image are clamped to its border
+        cv::Point2f Normalize(const cv::Point2f& pixel) const;
+
+        // undistorted view of a full image with the same camera matrix, the remap
+        // tables are built on the first call
+        void Undistort(const cv::Mat& image, cv::Mat& undistorted);
+
+    private:
+        cv::Mat m_cameraMatrix;
+        cv::Mat m_distortionCoefficients;
+        cv::Size m_imageSize;
+        cv::Mat m_table;        // CV_32FC2, normalized x, y per pixel
+
+        cv::Mat m_map1;         // fixed point remap tables for Undistort
+        cv::Mat m_map2;
+    };
+}
@@ -20,9 +20,15 @@ public class ArUcoTracking : MonoBehaviour
     public GameObject markerGo;                                     // Game object that is rendered on top of detected markers
     public CameraUtils.MediaCaptureProfiles mediaCaptureProfile;    // Allows the selection of camera capture profiles with different resolutions || HL2_896x504 should be used!
     public bool autoReleaseMarkerGos;                               // After a preset time, every instace of the markerGo will be removed
-    public bool sendDetectedArUcoDataViaTCP;                        // Enables sending raw aruco data from OpenCV via TCP (position & rotation are relative to PV camera, no conversions done)
+    public bool sendDetectedArUcoDataViaTCP;                        // Enables sending raw aruco data from OpenCV via TCP, one binary batch per frame (position & rotation are relative to PV camera, see MarkerTelemetry.h)
     public bool useCustomCameraIntrinsics;                          // Enables custom camera calibration parameters instead of quierying it from frames
     public CameraIntrinsics customCameraIntrinsics;                 // Holds the user defined calibration data
+    [Range(0, 3)] public int pyramidLevel = 0;                      // Detects on the image downsampled this many times by 2, corners are refined at full resolution
+    public DetectorSettings detectorSettings = new DetectorSettings(); // Thresholding, candidate filtering & corner refinement of the detector, see DetectorTuner
+    public bool useIppeSquareSolver = false;                        // Closed form pose of square markers instead of the generic iterative solver
+    public bool warmStartPoses = false;                             // Refines from the marker's pose in the previous frame when it was seen
+    public bool useLumaInput = false;                               // Detects on the NV12 / YUY2 luma of the camera frames instead of having them converted to BGRA
+    public bool enableTracing = false;                              // Records a timeline of the detection stages, saved as trace.json to the persistent data path on focus loss
 
     List<GameObject> _markerGos = new List<GameObject>();
     int frameCounter = 0;
@@ -37,6 +43,7 @@ public class ArUcoTracking : MonoBehaviour
 
     Windows.Perception.Spatial.SpatialCoordinateSystem _unityCoordinateSystem = null;
     Windows.Perception.Spatial.SpatialCoordinateSystem _frameCoordinateSystem = null;
+    long _frameTimestamp = 0;
 #endif
 
     // Awake is called when an enabled script instance is being loaded
@@ -96,9 +103,15 @@ public class ArUcoTracking : MonoBehaviour
 	            }
 
                 _cvHelper = new OpenCVHelper();
+                _cvHelper.SetPyramidLevel(pyramidLevel);
+                _cvHelper.ConfigureDetector(detectorSettings.thresholdWindowMin, detectorSettings.thresholdWindowMax,
+                    detectorSettings.thresholdWindowStep, detectorSettings.thresholdConstant, detectorSettings.minPerimeterRate,
+                    detectorSettings.maxPerimeterRate, detectorSettings.polygonAccuracy, (int)detectorSettings.cornerRefinement);
+                _cvHelper.ConfigurePoseSolver(useIppeSquareSolver ? 1 : 0, warmStartPoses);
+                _cvHelper.EnableTracing(enableTracing, 65536);
 
                 _mediaCapturer = new MediaCapturer();
-                await _mediaCapturer.StartCapture(width, height, frameRate);
+                await _mediaCapturer.StartCapture(width, height, frameRate, useLumaInput);
 
                 HUD.text = "Camera started. Running!";
             }
@@ -156,6 +169,11 @@ public class ArUcoTracking : MonoBehaviour
     {
 #if ENABLE_WINMD_SUPPORT
        if (!focus) await _mediaCapturer.StopCapturing();
+       if (!focus && enableTracing && _cvHelper != null)
+       {
+           // open in chrome://tracing or ui.perfetto.dev
+           System.IO.File.WriteAllText(System.IO.Path.Combine(Application.persistentDataPath, "trace.json"), _cvHelper.GetTraceJson());
+       }
 #endif
     }
 
@@ -184,8 +202,9 @@ public class ArUcoTracking : MonoBehaviour
 
         if (softwareBitmap != null)
 	    {
-            // Cache frame coordinate system
+            // Cache frame coordinate system & time stamp (100 ns ticks of the system relative time)
             _frameCoordinateSystem = mediaFrameReference.CoordinateSystem;
+            _frameTimestamp = mediaFrameReference.SystemRelativeTime?.Ticks ?? 0;
 
             DetectMarkers(softwareBitmap, _cameraIntrinsics);
 	    }
@@ -211,6 +230,8 @@ public class ArUcoTracking : MonoBehaviour
 
         if (markers.Count != 0)
         {
+            UnityEngine.Matrix4x4 cameraToWorldUnity = CameraUtils.GetViewToUnityTransform(_frameCoordinateSystem, _unityCoordinateSystem);
+
             // Iterate through the detected markers & place markerGos
             foreach (var marker in markers)
 	        {
@@ -219,7 +240,6 @@ public class ArUcoTracking : MonoBehaviour
                 UnityEngine.Quaternion rotationUnity = ArUcoUtils.RotationQuatFromRodrigues(rotationRodrigues);
 
                 UnityEngine.Matrix4x4 markerTransformUnityCamera = ArUcoUtils.GetTransformInUnityCamera(translationUnity, rotationUnity);
-                UnityEngine.Matrix4x4 cameraToWorldUnity = CameraUtils.GetViewToUnityTransform(_frameCoordinateSystem, _unityCoordinateSystem);
 
                 UnityEngine.Matrix4x4 transformUnityWorld = cameraToWorldUnity * markerTransformUnityCamera;
 
@@ -256,19 +276,14 @@ public class ArUcoTracking : MonoBehaviour
                     Debug.Log("marker [" + marker.Id() + "] pos xyz: " + markerPos.x + " " + markerPos.y + " " + markerPos.z);
 
                 }, false);
-
-                if (sendDetectedArUcoDataViaTCP)
-                {
-                    if (_tcpClient != null)
-                    {
-                        // Sending detected marker's data via TCP
-                        string markerData = "Marker [" + marker.Id() + "] " +
-                        "\ntranslation (XYZ): " + translationUnity.x + " " + translationUnity.y + " " + translationUnity.z + " " + 
-                        "\nrotation (Rodrigues XYZ): " + + rotationRodrigues.x + " " + rotationRodrigues.y + " " + rotationRodrigues.z;
-                        _tcpClient.SendMarkerDataAsync(markerData);
-                    }      
-                }
 	        }
+
+            if (sendDetectedArUcoDataViaTCP && _tcpClient != null)
+            {
+                // Sending the frame's markers via TCP as one binary batch, serialized by the plugin
+                byte[] telemetry = _cvHelper.GetMarkerTelemetry(_frameTimestamp, ArUcoUtils.Float4x4FromMat4x4(cameraToWorldUnity));
+                _tcpClient.SendMarkerTelemetryAsync(telemetry);
+            }
         }
         else
 	    {
@@ -297,6 +312,23 @@ public class CameraIntrinsics
     // public int imageHeight;
 }
 
+// Detector parameters as in the native DetectionSettings, the defaults are OpenCV's,
+// DetectorTuner prints the fastest values reaching a recall on a recorded session
+[Serializable]
+public class DetectorSettings
+{
+    public enum CornerRefinement { None = 0, Subpix, Contour, AprilTag }
+
+    public int thresholdWindowMin = 3;
+    public int thresholdWindowMax = 23;
+    public int thresholdWindowStep = 10;
+    public float thresholdConstant = 7.0f;
+    public float minPerimeterRate = 0.03f;
+    public float maxPerimeterRate = 4.0f;
+    public float polygonAccuracy = 0.03f;
+    public CornerRefinement cornerRefinement = CornerRefinement.None;
+}
+
 // https://stackoverflow.com/questions/76442537/is-there-a-way-to-define-cast-from-system-numerics-vector2-to-unityengine-vector
 // https://learn.microsoft.com/en-us/dotnet/csharp/programming-guide/classes-and-structs/extension-methods
 public static class VectorExtensions
@@ -101,6 +101,17 @@ public abstract class ArUcoUtils
         };
     }
 
+    // Convert from unity to system numerics matrix 4x4, element by element as above
+    // (translation in M14, M24, M34)
+    public static System.Numerics.Matrix4x4 Float4x4FromMat4x4(Matrix4x4 m)
+    {
+        return new System.Numerics.Matrix4x4(
+            m.m00, m.m01, m.m02, m.m03,
+            m.m10, m.m11, m.m12, m.m13,
+            m.m20, m.m21, m.m22, m.m23,
+            m.m30, m.m31, m.m32, m.m33);
+    }
+
     // Get a rotation quaternion from rodrigues
     public static Quaternion RotationQuatFromRodrigues(Vector3 v)
     {
@@ -83,7 +83,9 @@ public class MediaCapturer
     */
 
     // Modified for HL2 with custom resolution and framerate
-    public async Task StartCapture(int width, int height, int frameRate)
+    // lumaInput: frames are delivered in the camera's own NV12 / YUY2 format instead of converted
+    // (and copied) to BGRA8 by the frame reader, for consumers that only need the luma
+    public async Task StartCapture(int width, int height, int frameRate, bool lumaInput = false)
     {
         if (_captureManager == null || _captureManager.CameraStreamState == CameraStreamState.Shutdown || _captureManager.CameraStreamState == CameraStreamState.NotStreaming)
         {
@@ -141,13 +143,24 @@ public class MediaCapturer
 
                 frameSource = _captureManager.FrameSources[sourceInfo.Id];
 
-                var selectedFormat = frameSource.SupportedFormats.FirstOrDefault(
+                var matchingFormats = frameSource.SupportedFormats.Where(
                     format => format.VideoFormat.Width == width && format.VideoFormat.Height == height &&
                     format.FrameRate.Numerator / format.FrameRate.Denominator == frameRate);
 
+                // with luma input prefer a format the detector can read without conversion
+                var lumaFormat = lumaInput ? matchingFormats.FirstOrDefault(
+                    format => string.Equals(format.Subtype, MediaEncodingSubtypes.Nv12, StringComparison.OrdinalIgnoreCase)) ??
+                    matchingFormats.FirstOrDefault(
+                    format => string.Equals(format.Subtype, MediaEncodingSubtypes.Yuy2, StringComparison.OrdinalIgnoreCase)) : null;
+                var selectedFormat = lumaFormat ?? matchingFormats.FirstOrDefault();
+
                 if (selectedFormat != null)
 	            {
                      await frameSource.SetFormatAsync(selectedFormat);
+                     if (lumaFormat != null)
+                     {
+                         subtype = lumaFormat.Subtype;   // same as the source, the reader hands the frames on as they are
+                     }
                      _frameReader = await _captureManager.CreateFrameReaderAsync(frameSource, subtype);
                      _frameReader.AcquisitionMode = MediaFrameReaderAcquisitionMode.Realtime;
 
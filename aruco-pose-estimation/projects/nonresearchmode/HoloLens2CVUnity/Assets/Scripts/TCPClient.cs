@@ -75,17 +75,22 @@ public class TCPClient : MonoBehaviour
     }
 
     bool lastMessageSent = true;
-    public async void SendMarkerDataAsync(string markerData)
+    // one batch of OpenCVHelper.GetMarkerTelemetry per frame, TCPServer.py prints it,
+    // HeadsetIngest appends it to telemetry.bin
+    public async void SendMarkerTelemetryAsync(byte[] telemetry)
     {
         if (!lastMessageSent) return;
         lastMessageSent = false;
         try
         {
             // Write header
-            dw.WriteString("m");    // header "m" for marker data
+            dw.WriteString("t");    // header "t" for marker telemetry
 
-            // Write marker data
-            dw.WriteString(markerData);
+            // Write Length
+            dw.WriteInt32(telemetry.Length);
+
+            // Write the batch, little endian records as the plugin encoded them
+            dw.WriteBytes(telemetry);
 
             // Send out
             await dw.StoreAsync();
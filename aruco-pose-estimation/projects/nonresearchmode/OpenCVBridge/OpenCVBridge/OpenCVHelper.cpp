@@ -11,6 +11,83 @@ using namespace winrt::Windows::Foundation::Collections;
 
 namespace winrt::OpenCVBridge::implementation
 {
+	void OpenCVHelper::SetPyramidLevel(int level)
+	{
+		m_detector.SetPyramidLevel(level);
+	}
+
+	void OpenCVHelper::ConfigureDetector(int thresholdWindowMin, int thresholdWindowMax, int thresholdWindowStep,
+		float thresholdConstant, float minPerimeterRate, float maxPerimeterRate,
+		float polygonAccuracy, int cornerRefinement)
+	{
+		HoloLens2CV::DetectionSettings settings;
+		settings.thresholdWindowMin = thresholdWindowMin;
+		settings.thresholdWindowMax = thresholdWindowMax;
+		settings.thresholdWindowStep = thresholdWindowStep;
+		settings.thresholdConstant = thresholdConstant;
+		settings.minPerimeterRate = minPerimeterRate;
+		settings.maxPerimeterRate = maxPerimeterRate;
+		settings.polygonAccuracyRate = polygonAccuracy;
+		settings.cornerRefinement = HoloLens2CV::CornerRefinement(cornerRefinement);
+		m_detector.ConfigureDetection(settings);
+	}
+
+	void OpenCVHelper::ConfigurePoseSolver(int solver, bool warmStart)
+	{
+		HoloLens2CV::PoseSettings pose;
+		pose.solver = solver == 1 ? HoloLens2CV::PoseSolver::IppeSquare : HoloLens2CV::PoseSolver::Iterative;
+		pose.warmStart = warmStart;
+		m_detector.ConfigurePose(pose);
+	}
+
+	com_array<uint8_t> OpenCVHelper::GetMarkerTelemetry(int64_t timestamp, float4x4 const& cameraToWorld)
+	{
+		HoloLens2CV::TraceScope trace("GetMarkerTelemetry");
+		m_telemetry.frameSequence = m_frameSequence - 1;
+		m_telemetry.timestamp = timestamp;
+		const float rows[12] = {
+			cameraToWorld.m11, cameraToWorld.m12, cameraToWorld.m13, cameraToWorld.m14,
+			cameraToWorld.m21, cameraToWorld.m22, cameraToWorld.m23, cameraToWorld.m24,
+			cameraToWorld.m31, cameraToWorld.m32, cameraToWorld.m33, cameraToWorld.m34 };
+		std::copy(std::begin(rows), std::end(rows), m_telemetry.cameraToWorld);
+
+		m_telemetry.markers.resize(m_markerPoses.size());
+		for (size_t i = 0; i < m_markerPoses.size(); i++)
+		{
+			const HoloLens2CV::MarkerPose& pose = m_markerPoses[i];
+			HoloLens2CV::MarkerTelemetry& marker = m_telemetry.markers[i];
+			marker.id = pose.id;
+			for (int k = 0; k < 3; k++)
+			{
+				marker.tvec[k] = (float)pose.tvec[k];
+				marker.rvec[k] = (float)pose.rvec[k];
+			}
+			marker.reprojectionError = m_detector.ReprojectionError(pose);
+		}
+
+		m_encodedTelemetry.clear();
+		HoloLens2CV::EncodeMarkerTelemetry(m_telemetry, m_encodedTelemetry);
+		return com_array<uint8_t>(m_encodedTelemetry.begin(), m_encodedTelemetry.end());
+	}
+
+	void OpenCVHelper::EnableTracing(bool enabled, int capacity)
+	{
+		auto& ring = HoloLens2CV::TraceRing::Global();
+		if (enabled)
+		{
+			ring.Enable((size_t)std::max(capacity, 1024));
+		}
+		else
+		{
+			ring.Disable();
+		}
+	}
+
+	hstring OpenCVHelper::GetTraceJson()
+	{
+		return winrt::to_hstring(HoloLens2CV::TraceRing::Global().ToChromeJson());
+	}
+
 	Windows::Foundation::Collections::IVector<DetectedMarker> OpenCVHelper::ProcessWithArUco(
 		Windows::Graphics::Imaging::SoftwareBitmap input, 
 		Windows::Foundation::Numerics::float2 focalLength, 
@@ -29,77 +106,60 @@ namespace winrt::OpenCVBridge::implementation
 
 		auto t1 = high_resolution_clock::now();
 
+		// the bitmap carries no sensor time stamp, the frames are told apart by the call count
+		HoloLens2CV::TraceFrame trace(m_frameSequence++, 0);
+		HoloLens2CV::TraceScope process("ProcessWithArUco");
+
 		Windows::Foundation::Collections::IVector<DetectedMarker> detectedMarkers = { winrt::single_threaded_vector<DetectedMarker>() };
 		frameProcessingTime = 0;
 
-		// https://github.com/opencv/opencv_contrib/blob/4.x/modules/aruco/samples/detect_markers.cpp
-		// aruco dictionary from id
-		cv::aruco::Dictionary dictionary = cv::aruco::getPredefinedDictionary(cv::aruco::PredefinedDictionaryType(dictionaryId));
-
-		// camera intrinsic parameters for aruco based pose estimation (camera matrix)
-		cv::Mat cameraMatrix(3, 3, CV_64F, cv::Scalar(0));
-
-		cameraMatrix.at<double>(0, 0) = focalLength.x;
-		cameraMatrix.at<double>(0, 2) = principalPoint.x;
-		cameraMatrix.at<double>(1, 1) = focalLength.y;
-		cameraMatrix.at<double>(1, 2) = principalPoint.y;
-		cameraMatrix.at<double>(2, 2) = 1.0;
-
-		// camera distortion matrix for aruco based pose estimation
-		cv::Mat distortionCoefficientsMatrix(1, 5, CV_64F);
-
-		distortionCoefficientsMatrix.at<double>(0, 0) = radialDistortion.x;
-		distortionCoefficientsMatrix.at<double>(0, 1) = radialDistortion.y;
-		distortionCoefficientsMatrix.at<double>(0, 2) = tangentialDistortion.x;
-		distortionCoefficientsMatrix.at<double>(0, 3) = tangentialDistortion.y;
-		distortionCoefficientsMatrix.at<double>(0, 4) = radialDistortion.z;
-
-		// https://stackoverflow.com/questions/76802576/how-to-estimate-pose-of-single-marker-in-opencv-python-4-8-0
-		// https://github.com/opencv/opencv_contrib/blob/4.x/modules/aruco/samples/detect_markers.cpp
-		// set marker corner points
-		cv::Mat objPoints(4, 1, CV_32FC3);
-		objPoints.ptr<cv::Vec3f>(0)[0] = cv::Vec3f(-markerLength / 2.f, markerLength / 2.f, 0);
-		objPoints.ptr<cv::Vec3f>(0)[1] = cv::Vec3f(markerLength / 2.f, markerLength / 2.f, 0);
-		objPoints.ptr<cv::Vec3f>(0)[2] = cv::Vec3f(markerLength / 2.f, -markerLength / 2.f, 0);
-		objPoints.ptr<cv::Vec3f>(0)[3] = cv::Vec3f(-markerLength / 2.f, -markerLength / 2.f, 0);
-
-		std::vector<int> ids;
-		std::vector<std::vector<cv::Point2f>> corners, rejected;
-
-		// load softwarebitmap to cv::Mat()
-		cv::Mat processed, gray;
-		TryConvert(input, processed);	// returns false if failed, but that is not used here
-
-		// convert to grayscale
-		cv::cvtColor(processed, gray, cv::COLOR_BGR2GRAY);
-
-		// initialize aruco detector
-		cv::aruco::DetectorParameters detectorParams = cv::aruco::DetectorParameters();
-		cv::aruco::ArucoDetector detector(dictionary, detectorParams);
-
-		// detect markers
-		detector.detectMarkers(gray, corners, ids, rejected);
-
-		size_t  nMarkers = corners.size();
-		std::vector<cv::Vec3d> rvecs(nMarkers), tvecs(nMarkers);
-
-		if (ids.size() > 0)
+		// update the persistent detector, these are no-ops unless the parameters changed
+		HoloLens2CV::CameraIntrinsics intrinsics;
+		intrinsics.fx = focalLength.x;
+		intrinsics.fy = focalLength.y;
+		intrinsics.cx = principalPoint.x;
+		intrinsics.cy = principalPoint.y;
+		intrinsics.k1 = radialDistortion.x;
+		intrinsics.k2 = radialDistortion.y;
+		intrinsics.k3 = radialDistortion.z;
+		intrinsics.p1 = tangentialDistortion.x;
+		intrinsics.p2 = tangentialDistortion.y;
+
+		m_detector.Configure(dictionaryId, markerLength);
+		m_detector.SetCameraIntrinsics(intrinsics);
+
+		// luma of the softwarebitmap, the NV12 luma plane is used in place, YUY2 & BGRA
+		// frames are converted. The buffer stays locked until detection is done.
+		BitmapBuffer buffer = input.LockBuffer(BitmapBufferAccessMode::Read);
+		IMemoryBufferReference reference = buffer.CreateReference();
+		HoloLens2CV::ImageView view;
+		cv::Mat gray;
 		{
-			// calculate pose for each marker
-			for (size_t i = 0; i < nMarkers; i++) {
-				cv::solvePnP(objPoints, corners.at(i), cameraMatrix, distortionCoefficientsMatrix, rvecs.at(i), tvecs.at(i));
-			}
-
-			// append detected markers to the ivector
-			for (size_t i = 0; i < ids.size(); i++)
+			HoloLens2CV::TraceScope convert("gray");
+			if (TryGetImageView(input, buffer, reference, view))
 			{
-				DetectedMarker marker = DetectedMarker(
-					ids[i],
-					Windows::Foundation::Numerics::float3((float)tvecs[i][0], (float)tvecs[i][1], (float)tvecs[i][2]),
-					Windows::Foundation::Numerics::float3((float)rvecs[i][0], (float)rvecs[i][1], (float)rvecs[i][2]));
-				detectedMarkers.Append(marker);
+				gray = HoloLens2CV::LumaOf(view, m_luma);
 			}
 		}
+		if (gray.empty())
+		{
+			m_markerPoses.clear();		// no telemetry of the previous frame either
+			return detectedMarkers;		// pixel format without a luma path
+		}
+
+		// detect markers & estimate their poses
+		m_detector.Process(gray, m_markerPoses);
+
+		// append detected markers to the ivector
+		HoloLens2CV::TraceScope package("package");
+		for (const auto& pose : m_markerPoses)
+		{
+			DetectedMarker marker = DetectedMarker(
+				pose.id,
+				Windows::Foundation::Numerics::float3((float)pose.tvec[0], (float)pose.tvec[1], (float)pose.tvec[2]),
+				Windows::Foundation::Numerics::float3((float)pose.rvec[0], (float)pose.rvec[1], (float)pose.rvec[2]));
+			detectedMarkers.Append(marker);
+		}
 
 		auto t2 = high_resolution_clock::now();
 		auto ms_int = duration_cast<milliseconds>(t2 - t1);
@@ -109,33 +169,48 @@ namespace winrt::OpenCVBridge::implementation
 
 	}
 	
-	bool OpenCVHelper::TryConvert(
+	bool OpenCVHelper::TryGetImageView(
 		Windows::Graphics::Imaging::SoftwareBitmap from, 
-		cv::Mat& convertedMat)
+		BitmapBuffer const& buffer,
+		IMemoryBufferReference const& reference,
+		HoloLens2CV::ImageView& view)
 	{
+		switch (from.BitmapPixelFormat())
+		{
+		case BitmapPixelFormat::Gray8: view.format = HoloLens2CV::PixelFormat::Gray8; break;
+		case BitmapPixelFormat::Nv12: view.format = HoloLens2CV::PixelFormat::Nv12; break;
+		case BitmapPixelFormat::Yuy2: view.format = HoloLens2CV::PixelFormat::Yuy2; break;
+		case BitmapPixelFormat::Bgra8: view.format = HoloLens2CV::PixelFormat::Bgra8; break;
+		default: return false;
+		}
+
 		unsigned char* pPixels = nullptr;
 		unsigned int capacity = 0;
-		if (!GetPointerToPixelData(from, &pPixels, &capacity))
+		if (!GetPointerToPixelData(reference, &pPixels, &capacity))
 		{
 			return false;
 		}
-		// assume input SoftwareBitmap is BGRA8 
-		cv::Mat mat(from.PixelHeight(), from.PixelWidth(), CV_8UC4, (void*)pPixels);
 
-		// shallow copy because we want convertedMat.data = pPixels
-		// don't use .copyTo or .clone
-		convertedMat = mat;
-		return true;
+		// plane 0 is the luma of NV12, the packed pixels otherwise. No shallow copy
+		// is made here either, the view points into the locked buffer.
+		BitmapPlaneDescription plane = buffer.GetPlaneDescription(0);
+		if (plane.StartIndex < 0 || plane.Stride <= 0 || (unsigned int)plane.StartIndex >= capacity)
+		{
+			return false;
+		}
+		view.width = plane.Width;
+		view.height = plane.Height;
+		view.data = pPixels + plane.StartIndex;
+		view.stride = (size_t)plane.Stride;
+		view.size = capacity - (unsigned int)plane.StartIndex;
+		return HoloLens2CV::IsValid(view);
 	}
 		
 	bool OpenCVHelper::GetPointerToPixelData(
-		Windows::Graphics::Imaging::SoftwareBitmap bitmap,
+		IMemoryBufferReference const& reference,
 		unsigned char** pPixelData, unsigned int* capacity)
 	{
-		BitmapBuffer bmpbuffer = bitmap.LockBuffer(BitmapBufferAccessMode::ReadWrite);
-		IMemoryBufferReference reference = bmpbuffer.CreateReference();
-
-		auto byteAccess = bmpbuffer.CreateReference().as<IMemoryBufferByteAccess>();
+		auto byteAccess = reference.as<IMemoryBufferByteAccess>();
 
 		if (byteAccess->GetBuffer(pPixelData, capacity) != S_OK)
 		{
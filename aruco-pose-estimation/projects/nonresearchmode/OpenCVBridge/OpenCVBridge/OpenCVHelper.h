@@ -1,5 +1,8 @@
 #pragma once
 #include "OpenCVHelper.g.h"
+#include "ArUcoDetectorSession.h"
+#include "ImageView.h"
+#include "MarkerTelemetry.h"
 
 namespace winrt::OpenCVBridge::implementation
 {
@@ -17,16 +20,37 @@ namespace winrt::OpenCVBridge::implementation
             float markerLength,
             int& frameProcessingTime);
 
+        void SetPyramidLevel(int level);
+        void ConfigureDetector(int thresholdWindowMin, int thresholdWindowMax, int thresholdWindowStep,
+            float thresholdConstant, float minPerimeterRate, float maxPerimeterRate,
+            float polygonAccuracy, int cornerRefinement);
+        void ConfigurePoseSolver(int solver, bool warmStart);
+        com_array<uint8_t> GetMarkerTelemetry(int64_t timestamp, Windows::Foundation::Numerics::float4x4 const& cameraToWorld);
+
+        void EnableTracing(bool enabled, int capacity);
+        hstring GetTraceJson();
+
     private:
+
+        // kept between calls, only rebuilt when the dictionary, marker size or intrinsics change
+        HoloLens2CV::ArUcoDetectorSession m_detector;
+        std::vector<HoloLens2CV::MarkerPose> m_markerPoses;
+        int64_t m_frameSequence = 0;
+        HoloLens2CV::MarkerTelemetryBatch m_telemetry;     // for GetMarkerTelemetry, reused between calls
+        std::vector<uint8_t> m_encodedTelemetry;
+        cv::Mat m_luma;     // YUY2 & BGRA frames are converted into it, NV12 & gray ones are used in place
      
+        // first plane of the locked bitmap, false for formats without a luma path
         // https://github.com/microsoft/Windows-universal-samples/blob/main/Samples/CameraOpenCV/shared/OpenCVBridge/OpenCVHelper.cpp#L150
-        bool TryConvert(
+        bool TryGetImageView(
             __in Windows::Graphics::Imaging::SoftwareBitmap from,
-            __out cv::Mat& convertedMat);
+            __in Windows::Graphics::Imaging::BitmapBuffer const& buffer,
+            __in Windows::Foundation::IMemoryBufferReference const& reference,
+            __out HoloLens2CV::ImageView& view);
 
            
         bool GetPointerToPixelData(
-            Windows::Graphics::Imaging::SoftwareBitmap bitmap,
+            Windows::Foundation::IMemoryBufferReference const& reference,
             unsigned char** pPixelData,
             unsigned int* capacity);
          
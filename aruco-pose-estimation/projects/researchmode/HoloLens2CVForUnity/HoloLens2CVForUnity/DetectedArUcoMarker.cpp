@@ -5,10 +5,13 @@
 namespace winrt::HoloLens2CVForUnity::implementation
 {
 	DetectedArUcoMarker::DetectedArUcoMarker(_In_ int32_t id,
+		_In_ int32_t camera,
 		_In_ Windows::Foundation::Numerics::float3 position,
 		_In_ Windows::Foundation::Numerics::float3 rotation,
 		_In_ Windows::Foundation::Numerics::float4x4 cameraToWorldUnity)
 	{
+		_id = id;
+		_camera = camera;
 		_position = position;
 		_rotation = rotation;
 		_cameraToWorldUnity = cameraToWorldUnity;
@@ -17,6 +20,10 @@ namespace winrt::HoloLens2CVForUnity::implementation
 	{
 		return _id;
 	}
+	int32_t DetectedArUcoMarker::Camera()
+	{
+		return _camera;
+	}
 	Windows::Foundation::Numerics::float3 DetectedArUcoMarker::Position()
 	{
 		return _position;
@@ -6,17 +6,20 @@ namespace winrt::HoloLens2CVForUnity::implementation
 	struct DetectedArUcoMarker : DetectedArUcoMarkerT<DetectedArUcoMarker>
 	{
 		DetectedArUcoMarker(_In_ int32_t id,
+			_In_ int32_t camera,
 			_In_ Windows::Foundation::Numerics::float3 position,
 			_In_ Windows::Foundation::Numerics::float3 rotation,
 			_In_ Windows::Foundation::Numerics::float4x4 cameraToWorldUnity);
 
 		int32_t Id();
+		int32_t Camera();
 		Windows::Foundation::Numerics::float3 Position();
 		Windows::Foundation::Numerics::float3 Rotation();
 		Windows::Foundation::Numerics::float4x4 CameraToWorldUnity();
 
 	private:
 		int32_t _id;
+		int32_t _camera;
 		Windows::Foundation::Numerics::float3 _position;
 		Windows::Foundation::Numerics::float3 _rotation;
 		Windows::Foundation::Numerics::float4x4 _cameraToWorldUnity;
@@ -136,6 +136,12 @@ namespace winrt::HoloLens2CVForUnity::implementation
 				m_RFCameraPoseInvMatrix = XMMatrixInverse(&det, cameraNodeToRigPose);
 			}
 		}
+
+		// camera -> rig for locating the frames, LF camera -> rig -> RF camera for the stereo triangulation,
+		// converted like the camera to world transforms
+		m_pipeline.SetCameraToRig(HoloLens2CV::LeftFrontCamera, ToOpenCV(m_LFCameraPoseInvMatrix));
+		m_pipeline.SetCameraToRig(HoloLens2CV::RightFrontCamera, ToOpenCV(m_RFCameraPoseInvMatrix));
+		m_pipeline.Stereo().SetExtrinsics(ToOpenCV(m_LFCameraPoseInvMatrix * XMLoadFloat4x4(&m_RFCameraPose)));
 	}
 
 	void ResearchModeCV::StartSpatialCamerasFrontLoop()
@@ -159,138 +165,24 @@ namespace winrt::HoloLens2CVForUnity::implementation
 			return;
 		}
 
-		pResearchModeCV->m_detectedMarkers = { winrt::single_threaded_vector<DetectedArUcoMarker>() };
-
 		pResearchModeCV->m_LFSensor->OpenStream();
 		pResearchModeCV->m_RFSensor->OpenStream();
 
-		try
-		{
-			while (pResearchModeCV->m_spatialCamerasFrontLoopStarted)
+		// the pipeline pairs, locates & detects, the images & results are published by the callbacks
+		pResearchModeCV->m_poseSource.locator = pResearchModeCV->m_locator;
+		pResearchModeCV->m_poseSource.refFrame = pResearchModeCV->m_refFrame;
+		pResearchModeCV->m_sensorSource.LF = pResearchModeCV->m_LFSensor;
+		pResearchModeCV->m_sensorSource.RF = pResearchModeCV->m_RFSensor;
+		pResearchModeCV->m_pipeline.SetFrameCallback([pResearchModeCV](const HoloLens2CV::FrontCamerasFrame& frame)
 			{
-				IResearchModeSensorFrame* pLFCameraFrame = nullptr;
-				IResearchModeSensorFrame* pRFCameraFrame = nullptr;
-				ResearchModeSensorResolution LFResolution;
-				ResearchModeSensorResolution RFResolution;
-				pResearchModeCV->m_LFSensor->GetNextBuffer(&pLFCameraFrame);
-				pResearchModeCV->m_RFSensor->GetNextBuffer(&pRFCameraFrame);
-
-				// process sensor frame
-				pLFCameraFrame->GetResolution(&LFResolution);
-				pResearchModeCV->m_LFResolution = LFResolution;
-				pRFCameraFrame->GetResolution(&RFResolution);
-				pResearchModeCV->m_RFResolution = RFResolution;
-
-				IResearchModeSensorVLCFrame* pLFFrame = nullptr;
-				winrt::check_hresult(pLFCameraFrame->QueryInterface(IID_PPV_ARGS(&pLFFrame)));
-				IResearchModeSensorVLCFrame* pRFFrame = nullptr;
-				winrt::check_hresult(pRFCameraFrame->QueryInterface(IID_PPV_ARGS(&pRFFrame)));
-
-				size_t LFOutBufferCount = 0;
-				const BYTE* pLFImage = nullptr;
-				pLFFrame->GetBuffer(&pLFImage, &LFOutBufferCount);
-				pResearchModeCV->m_LFbufferSize = LFOutBufferCount;
-				size_t RFOutBufferCount = 0;
-				const BYTE* pRFImage = nullptr;
-				pRFFrame->GetBuffer(&pRFImage, &RFOutBufferCount);
-				pResearchModeCV->m_RFbufferSize = RFOutBufferCount;
-
-				// get tracking transform
-				ResearchModeSensorTimestamp timestamp_left, timestamp_right;
-				pLFCameraFrame->GetTimeStamp(&timestamp_left);
-				pRFCameraFrame->GetTimeStamp(&timestamp_right);
-
-				auto ts_left = PerceptionTimestampHelper::FromSystemRelativeTargetTime(HundredsOfNanoseconds(checkAndConvertUnsigned(timestamp_left.HostTicks)));
-				auto ts_right = PerceptionTimestampHelper::FromSystemRelativeTargetTime(HundredsOfNanoseconds(checkAndConvertUnsigned(timestamp_right.HostTicks)));
-
-				// locate camera (location of camera rig to world origin)
-				auto rigToWorld_l = pResearchModeCV->m_locator.TryLocateAtTimestamp(ts_left, pResearchModeCV->m_refFrame);
-				auto rigToWorld_r = rigToWorld_l;
-				if (ts_left.TargetTime() != ts_right.TargetTime()) {
-					rigToWorld_r = pResearchModeCV->m_locator.TryLocateAtTimestamp(ts_right, pResearchModeCV->m_refFrame);
-				}
-
-				if (rigToWorld_l == nullptr || rigToWorld_r == nullptr)
-				{
-					continue;
-				}
-
-				// get camera to world transforms (camera node to rig inv * camera rig to world)
-				auto LfToWorld = pResearchModeCV->m_LFCameraPoseInvMatrix * SpatialLocationToDxMatrix(rigToWorld_l);
-				auto RfToWorld = pResearchModeCV->m_RFCameraPoseInvMatrix * SpatialLocationToDxMatrix(rigToWorld_r);
-
-				if (pResearchModeCV->m_enableArUcoDetector)
-				{
-					// clear previously detected markers
-					pResearchModeCV->m_detectedMarkers.Clear();
-
-					// detect & estimate pose of markers on left front camera image
-					if (pResearchModeCV->m_sensor == 0)
-					{
-						pResearchModeCV->ProcessSensorImageWithArUco(pLFImage, LFResolution, LfToWorld,
-							pResearchModeCV->m_LFCameraIntrinsics,
-							pResearchModeCV->m_dictId,
-							pResearchModeCV->m_markerLength,
-							pResearchModeCV->m_frameProcessingTime,
-							pResearchModeCV->m_detectedMarkers);
-					}
-					// detect & estimate pose of markers on right front camera image
-					if (pResearchModeCV->m_sensor == 1)
-					{
-						pResearchModeCV->ProcessSensorImageWithArUco(pRFImage, RFResolution, RfToWorld,
-							pResearchModeCV->m_RFCameraIntrinsics,
-							pResearchModeCV->m_dictId,
-							pResearchModeCV->m_markerLength,
-							pResearchModeCV->m_frameProcessingTime,
-							pResearchModeCV->m_detectedMarkers);
-					}
-
-					// markers ready to be queried
-					pResearchModeCV->m_ArUcoDetectionsUpdated = true;
-				}
-
-				{
-					std::lock_guard<std::mutex> l(pResearchModeCV->mu);
-
-					if (pResearchModeCV->m_enableBuffer)
-					{
-						// get time stamp for frames
-						pResearchModeCV->m_lastSpatialFrame.LFFrame.timestamp = timestamp_left.HostTicks;
-						pResearchModeCV->m_lastSpatialFrame.RFFrame.timestamp = timestamp_right.HostTicks;
-
-						pResearchModeCV->m_lastSpatialFrame.LFFrame.timestamp_ft = ts_left.TargetTime().time_since_epoch().count();
-						pResearchModeCV->m_lastSpatialFrame.RFFrame.timestamp_ft = ts_right.TargetTime().time_since_epoch().count();
-
-						// save LF and RF images
-						if (!pResearchModeCV->m_lastSpatialFrame.LFFrame.image)
-						{
-							OutputDebugString(L"Create Space for Left Front Image...\n");
-							pResearchModeCV->m_lastSpatialFrame.LFFrame.image = new UINT8[LFOutBufferCount];
-						}
-						memcpy(pResearchModeCV->m_lastSpatialFrame.LFFrame.image, pLFImage, LFOutBufferCount * sizeof(UINT8));
-
-						if (!pResearchModeCV->m_lastSpatialFrame.RFFrame.image)
-						{
-							OutputDebugString(L"Create Space for Right Front Image...\n");
-							pResearchModeCV->m_lastSpatialFrame.RFFrame.image = new UINT8[RFOutBufferCount];
-						}
-						memcpy(pResearchModeCV->m_lastSpatialFrame.RFFrame.image, pRFImage, RFOutBufferCount * sizeof(UINT8));
-
-						// images ready to be queried
-						pResearchModeCV->m_LFImageUpdated = true;
-						pResearchModeCV->m_RFImageUpdated = true;
-					}
-				}
-
-				// release space
-				if (pLFFrame) pLFFrame->Release();
-				if (pRFFrame) pRFFrame->Release();
-
-				if (pLFCameraFrame) pLFCameraFrame->Release();
-				if (pRFCameraFrame) pRFCameraFrame->Release();
-			}
-		}
-		catch (...) {}
+				pResearchModeCV->PublishImages(frame);
+			});
+		pResearchModeCV->m_pipeline.SetResultCallback([pResearchModeCV](const HoloLens2CV::FrontCamerasFrame& frame, const std::vector<HoloLens2CV::MarkerPose>& markers)
+			{
+				pResearchModeCV->PublishDetections(frame, markers);
+			});
+		pResearchModeCV->m_pipeline.Run(pResearchModeCV->m_sensorSource, &pResearchModeCV->m_poseSource, pResearchModeCV->m_usePoseHistory);
+
 		pResearchModeCV->m_LFSensor->CloseStream();
 		pResearchModeCV->m_LFSensor->Release();
 		pResearchModeCV->m_LFSensor = nullptr;
@@ -300,21 +192,101 @@ namespace winrt::HoloLens2CVForUnity::implementation
 		pResearchModeCV->m_RFSensor = nullptr;
 	}
 
-	// Stop the sensor loop and release buffer space.
-	// Sensor object should be released at the end of the loop function
-	void ResearchModeCV::StopAllSensorDevice()
+	bool ResearchModeCV::SensorFrameSource::Next(int& camera, HoloLens2CV::CameraFrame& frame)
 	{
-		if (m_lastSpatialFrame.LFFrame.image)
+		if (m_stopped)
 		{
-			delete[] m_lastSpatialFrame.LFFrame.image;
-			m_lastSpatialFrame.LFFrame.image = nullptr;
+			return false;
 		}
-		if (m_lastSpatialFrame.RFFrame.image)
+
+		// RF of the pair read by the previous call
+		if (m_hasRF)
 		{
-			delete[] m_lastSpatialFrame.RFFrame.image;
-			m_lastSpatialFrame.RFFrame.image = nullptr;
+			std::swap(frame, m_RF);
+			m_hasRF = false;
+			camera = HoloLens2CV::RightFrontCamera;
+			return true;
 		}
 
+		// both buffers are read one after the other, like before the pairing
+		if (!Read(LF, frame) || !Read(RF, m_RF))
+		{
+			return false;
+		}
+		m_hasRF = true;
+		camera = HoloLens2CV::LeftFrontCamera;
+		return true;
+	}
+
+	bool ResearchModeCV::SensorFrameSource::Read(IResearchModeSensor* sensor, HoloLens2CV::CameraFrame& frame)
+	{
+		HoloLens2CV::TraceScope trace("GetNextBuffer");
+		IResearchModeSensorFrame* pCameraFrame = nullptr;
+		if (FAILED(sensor->GetNextBuffer(&pCameraFrame)) || pCameraFrame == nullptr)
+		{
+			return false;
+		}
+
+		ResearchModeSensorResolution resolution;
+		pCameraFrame->GetResolution(&resolution);
+
+		IResearchModeSensorVLCFrame* pFrame = nullptr;
+		HRESULT hr = pCameraFrame->QueryInterface(IID_PPV_ARGS(&pFrame));
+		if (SUCCEEDED(hr))
+		{
+			size_t outBufferCount = 0;
+			const BYTE* pImage = nullptr;
+			pFrame->GetBuffer(&pImage, &outBufferCount);
+
+			ResearchModeSensorTimestamp timestamp;
+			pCameraFrame->GetTimeStamp(&timestamp);
+
+			// copy the image & hand the buffer straight back to the driver
+			StoreCameraFrame(frame, pImage, resolution, timestamp.HostTicks);
+			pFrame->Release();
+		}
+		pCameraFrame->Release();
+		return SUCCEEDED(hr);
+	}
+
+	void ResearchModeCV::StoreCameraFrame(HoloLens2CV::CameraFrame& frame, const BYTE* pImage,
+		ResearchModeSensorResolution resolution, UINT64 hostTicks)
+	{
+		auto ts = PerceptionTimestampHelper::FromSystemRelativeTargetTime(HundredsOfNanoseconds(checkAndConvertUnsigned(hostTicks)));
+		frame.hostTicks = hostTicks;
+		frame.timestamp = ts.TargetTime().time_since_epoch().count();
+		frame.width = resolution.Width;
+		frame.height = resolution.Height;
+		frame.image.assign(pImage, pImage + size_t(resolution.Width) * resolution.Height);
+	}
+
+	int64_t SpatialLocatorPoseSource::Now()
+	{
+		return winrt::clock::now().time_since_epoch().count();
+	}
+
+	bool SpatialLocatorPoseSource::TryLocate(int64_t timestamp, HoloLens2CV::RigPose& pose)
+	{
+		auto ts = PerceptionTimestampHelper::FromHistoricalTargetTime(winrt::clock::time_point(winrt::clock::duration(timestamp)));
+		auto location = locator.TryLocateAtTimestamp(ts, refFrame);
+		if (location == nullptr)
+		{
+			return false;
+		}
+
+		// same quaternion in the row vector matrices of DirectX & the column vector ones of the history
+		auto rot = location.Orientation();
+		auto pos = location.Position();
+		pose.timestamp = timestamp;
+		pose.position = cv::Vec3d(pos.x, pos.y, pos.z);
+		pose.orientation = cv::Vec4d(rot.x, rot.y, rot.z, rot.w);
+		return true;
+	}
+
+	// Stop the sensor loop.
+	// Sensor object should be released at the end of the loop function
+	void ResearchModeCV::StopAllSensorDevice()
+	{
 		m_pSensorDevice->Release();
 		m_pSensorDevice = nullptr;
 		m_pSensorDeviceConsent->Release();
@@ -333,31 +305,55 @@ namespace winrt::HoloLens2CVForUnity::implementation
 		Windows::Foundation::Numerics::float3 _radialDistortion,
 		Windows::Foundation::Numerics::float2 _tangentialDistortion)
 	{
+		HoloLens2CV::CameraIntrinsics intrinsics;
+		intrinsics.fx = _focalLength.x;
+		intrinsics.fy = _focalLength.y;
+		intrinsics.cx = _principalPoint.x;
+		intrinsics.cy = _principalPoint.y;
+		intrinsics.k1 = _radialDistortion.x;
+		intrinsics.k2 = _radialDistortion.y;
+		intrinsics.k3 = _radialDistortion.z;
+		intrinsics.p1 = _tangentialDistortion.x;
+		intrinsics.p2 = _tangentialDistortion.y;
+
+		// camera matrices are only rebuilt when the intrinsics change
 		if (_cameraType == 0)
 		{
 			// set LEFT Front camera's intrinsics
-			m_LFCameraIntrinsics.focalLength = _focalLength;
-			m_LFCameraIntrinsics.principalPoint = _principalPoint;
-			m_LFCameraIntrinsics.radialDistortion = _radialDistortion;
-			m_LFCameraIntrinsics.tangentialDistortion = _tangentialDistortion;
+			m_pipeline.LFDetector().SetCameraIntrinsics(intrinsics);
 		}
 		if (_cameraType == 1)
 		{
 			// set Right Front camera's intrinsics
-			m_RFCameraIntrinsics.focalLength = _focalLength;
-			m_RFCameraIntrinsics.principalPoint = _principalPoint;
-			m_RFCameraIntrinsics.radialDistortion = _radialDistortion;
-			m_RFCameraIntrinsics.tangentialDistortion = _tangentialDistortion;
+			m_pipeline.RFDetector().SetCameraIntrinsics(intrinsics);
 		}
+		m_pipeline.Stereo().SetCameraIntrinsics(_cameraType, intrinsics);
 	}
 
-	void ResearchModeCV::Configure(int _sensor, bool _enableBuffer, bool _enableArUcoDetector, float _markerLength, int _dictId)
+	void ResearchModeCV::Configure(int _sensor, bool _enableBuffer, bool _enableArUcoDetector, float _markerLength, int _dictId,
+		int _poseSolver, bool _warmStart)
 	{
 		m_sensor = _sensor;
 		m_enableBuffer = _enableBuffer;
 		m_enableArUcoDetector = _enableArUcoDetector;
 		m_markerLength = _markerLength;
 		m_dictId = _dictId;
+
+		HoloLens2CV::PipelineSettings settings;
+		settings.sensor = _sensor;
+		settings.detect = _enableArUcoDetector;
+		m_pipeline.Configure(settings);
+
+		// detectors are only rebuilt when the dictionary or the marker size changes
+		m_pipeline.LFDetector().Configure(_dictId, _markerLength);
+		m_pipeline.RFDetector().Configure(_dictId, _markerLength);
+		m_pipeline.Stereo().SetMarkerLength(_markerLength);
+
+		HoloLens2CV::PoseSettings pose;
+		pose.solver = _poseSolver == 1 ? HoloLens2CV::PoseSolver::IppeSquare : HoloLens2CV::PoseSolver::Iterative;
+		pose.warmStart = _warmStart;
+		m_pipeline.LFDetector().ConfigurePose(pose);
+		m_pipeline.RFDetector().ConfigurePose(pose);
 		/*
 		std::stringstream ss;
 		ss << "Configured ArUco Detector with: \n" <<
@@ -368,180 +364,441 @@ namespace winrt::HoloLens2CVForUnity::implementation
 		*/
 	}
 
+	void ResearchModeCV::ConfigureFrameQueue(int _capacity, int _dropPolicy)
+	{
+		m_pipeline.Queue().Configure(_capacity, _dropPolicy == 1 ? HoloLens2CV::DropPolicy::Fifo : HoloLens2CV::DropPolicy::LatestOnly);
+	}
+
+	int32_t ResearchModeCV::GetFrameQueueDepth()
+	{
+		return m_pipeline.Queue().GetStats().depth;
+	}
+
+	int32_t ResearchModeCV::GetFrameQueueMaxDepth()
+	{
+		return m_pipeline.Queue().GetStats().maxDepth;
+	}
+
+	int64_t ResearchModeCV::GetDroppedFrameCount()
+	{
+		return m_pipeline.Queue().GetStats().dropped;
+	}
+
+	void ResearchModeCV::ResetFrameQueueStats()
+	{
+		m_pipeline.Queue().ResetStats();
+	}
+
+	void ResearchModeCV::ConfigureTracking(bool _enabled, int _reacquireInterval, float _padding)
+	{
+		HoloLens2CV::TrackingSettings settings;
+		settings.enabled = _enabled;
+		settings.reacquireInterval = _reacquireInterval;
+		settings.padding = _padding;
+		m_pipeline.LFDetector().ConfigureTracking(settings);
+		m_pipeline.RFDetector().ConfigureTracking(settings);
+	}
+
+	void ResearchModeCV::ConfigureDetector(int _thresholdWindowMin, int _thresholdWindowMax, int _thresholdWindowStep,
+		float _thresholdConstant, float _minPerimeterRate, float _maxPerimeterRate,
+		float _polygonAccuracy, int _cornerRefinement)
+	{
+		HoloLens2CV::DetectionSettings settings;
+		settings.thresholdWindowMin = _thresholdWindowMin;
+		settings.thresholdWindowMax = _thresholdWindowMax;
+		settings.thresholdWindowStep = _thresholdWindowStep;
+		settings.thresholdConstant = _thresholdConstant;
+		settings.minPerimeterRate = _minPerimeterRate;
+		settings.maxPerimeterRate = _maxPerimeterRate;
+		settings.polygonAccuracyRate = _polygonAccuracy;
+		settings.cornerRefinement = HoloLens2CV::CornerRefinement(_cornerRefinement);
+		m_pipeline.LFDetector().ConfigureDetection(settings);
+		m_pipeline.RFDetector().ConfigureDetection(settings);
+	}
+
+	int64_t ResearchModeCV::GetFullScanCount()
+	{
+		return m_pipeline.LFDetector().GetTrackingStats().fullScans + m_pipeline.RFDetector().GetTrackingStats().fullScans;
+	}
+
+	int64_t ResearchModeCV::GetRegionScanCount()
+	{
+		return m_pipeline.LFDetector().GetTrackingStats().regionScans + m_pipeline.RFDetector().GetTrackingStats().regionScans;
+	}
+
+	void ResearchModeCV::SetPyramidLevel(int _level)
+	{
+		m_pipeline.LFDetector().SetPyramidLevel(_level);
+		m_pipeline.RFDetector().SetPyramidLevel(_level);
+	}
+
+	void ResearchModeCV::ConfigureStereo(bool _enabled)
+	{
+		HoloLens2CV::StereoSettings settings;
+		settings.enabled = _enabled;
+		m_pipeline.Stereo().Configure(settings);
+	}
+
+	int64_t ResearchModeCV::GetStereoMarkerCount()
+	{
+		return m_pipeline.Stereo().GetStats().stereo;
+	}
+
+	int64_t ResearchModeCV::GetMonoMarkerCount()
+	{
+		return m_pipeline.Stereo().GetStats().mono;
+	}
+
+	void ResearchModeCV::ConfigureFramePairing(float _toleranceMs, int _unpairedPolicy)
+	{
+		HoloLens2CV::PairingSettings settings;
+		settings.tolerance = int64_t(_toleranceMs * 10000.f);
+		settings.policy = _unpairedPolicy == 0 ? HoloLens2CV::UnpairedPolicy::Drop : HoloLens2CV::UnpairedPolicy::Mono;
+		m_pipeline.Pairer().Configure(settings);
+		m_pairTolerance = settings.tolerance;
+	}
+
+	// Rig poses are sampled at _sampleRate (Hz) & frames are interpolated between them, or extrapolated
+	// at most _maxExtrapolationMs past the newest sample. Takes effect when the sensor loop starts.
+	void ResearchModeCV::ConfigurePoseHistory(bool _enabled, float _sampleRate, float _maxExtrapolationMs)
+	{
+		HoloLens2CV::PoseHistorySettings settings;
+		settings.samplePeriod = int64_t(1e7f / std::max(_sampleRate, 1.f));
+		settings.maxExtrapolation = int64_t(_maxExtrapolationMs * 10000.f);
+		settings.maxGap = std::max(settings.maxGap, 2 * settings.samplePeriod);
+		m_pipeline.PoseHistory().Configure(settings);
+		m_usePoseHistory = _enabled;
+	}
+
+	int64_t ResearchModeCV::GetPoseHistoryMissCount()
+	{
+		return m_pipeline.PoseHistory().GetStats().missed;
+	}
+
+	int64_t ResearchModeCV::GetUnpairedFrameCount()
+	{
+		auto stats = m_pipeline.Pairer().GetStats();
+		return stats.mono + stats.dropped;
+	}
+
+	float ResearchModeCV::GetMaxPairSkew()
+	{
+		return m_pipeline.Pairer().GetStats().maxSkew / 10000.f;
+	}
+
 	inline bool ResearchModeCV::LFImageUpdated() { return m_LFImageUpdated; }
 	inline bool ResearchModeCV::RFImageUpdated() { return m_RFImageUpdated; }
-	inline bool ResearchModeCV::ArUcoDetectionsUpdated() { return m_ArUcoDetectionsUpdated; }
+	inline bool ResearchModeCV::ArUcoDetectionsUpdated() { return m_detections.Sequence() != m_lastReadSequence; }
 
 	int32_t ResearchModeCV::GetDetectedMarkersCount()
 	{
-		m_ArUcoDetectionsUpdated = false;
-		return m_detectedMarkers.Size();
+		auto snapshot = m_detections.Latest();
+		if (!snapshot)
+		{
+			return 0;
+		}
+		m_lastReadSequence = snapshot->sequence;
+		return snapshot->markers.Size();
+	}
+
+	void ResearchModeCV::ConfigurePoseFilter(float _minCutoff, float _beta, float _maxPrediction)
+	{
+		HoloLens2CV::PoseFilterSettings settings;
+		settings.minCutoff = _minCutoff;
+		settings.beta = _beta;
+		settings.maxPrediction = _maxPrediction;
+		m_pipeline.PoseFilter().Configure(settings);
+	}
+
+	// Filtered pose of marker _id extrapolated to _targetTimestamp (e.g. GetCurrentTimestamp plus the
+	// render latency), as the marker to world matrix the Unity scripts used to compose themselves:
+	// CameraToWorldUnity * marker to camera.
+	bool ResearchModeCV::TryGetPredictedMarkerPose(int32_t _id, int64_t _targetTimestamp, Windows::Foundation::Numerics::float4x4& _markerToWorldUnity)
+	{
+		HoloLens2CV::TraceScope trace("TryGetPredictedMarkerPose");
+		cv::Matx44d markerToWorld;
+		if (!m_pipeline.PoseFilter().Predict(_id, _targetTimestamp, markerToWorld))
+		{
+			return false;
+		}
+
+		// same convention as CameraToWorldUnity: row major for Unity, z row negated
+		float m[16];
+		for (int r = 0; r < 4; r++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				m[r * 4 + c] = float(r == 2 ? -markerToWorld(r, c) : markerToWorld(r, c));
+			}
+		}
+		std::memcpy(&_markerToWorldUnity, m, sizeof(m));
+		return true;
+	}
+
+	int64_t ResearchModeCV::GetCurrentTimestamp()
+	{
+		// same clock as the sensor frame time stamps
+		return winrt::clock::now().time_since_epoch().count();
+	}
+
+	int64_t ResearchModeCV::GetDetectionSequence()
+	{
+		return m_detections.Sequence();
+	}
+
+	int32_t ResearchModeCV::GetMarkerBufferSize(int32_t markerCount)
+	{
+		return (int32_t)HoloLens2CV::MarkerBufferWords((size_t)std::max(markerCount, 0));
+	}
+
+	// Packs the latest snapshot into the caller's buffer, one ABI call for the whole frame.
+	// Returns the number of floats written, 0 if the buffer is smaller than the header.
+	int32_t ResearchModeCV::GetDetectedMarkersBuffer(array_view<float> buffer)
+	{
+		static const std::vector<HoloLens2CV::MarkerPose> noMarkers;
+		HoloLens2CV::TraceScope trace("GetDetectedMarkersBuffer");
+
+		HoloLens2CV::MarkerFrameInfo info;
+		auto snapshot = m_detections.Latest();
+		if (snapshot)
+		{
+			info.sequence = snapshot->sequence;
+			info.timestamp = snapshot->timestamp;
+			std::memcpy(info.cameraToWorld, snapshot->cameraToWorldUnity, sizeof(info.cameraToWorld));
+			m_lastReadSequence = snapshot->sequence;
+		}
+
+		return (int32_t)HoloLens2CV::PackMarkerBuffer(info, snapshot ? snapshot->poses : noMarkers, buffer.data(), buffer.size());
 	}
 
 	int32_t ResearchModeCV::GetFrameProcessingTime()
 	{
-		return m_frameProcessingTime;
+		return int32_t(m_pipeline.GetStats().lastProcessingTime);
+	}
+
+	// p50, p95, p99 & max of a stage in microseconds since the last reset, zero for unknown stages
+	Windows::Foundation::Numerics::float4 ResearchModeCV::GetStageLatency(int32_t _stage)
+	{
+		if (_stage < 0 || _stage >= HoloLens2CV::kLatencyStageCount)
+		{
+			return Windows::Foundation::Numerics::float4(0.f, 0.f, 0.f, 0.f);
+		}
+		auto summary = m_pipeline.Latencies().Summarize(HoloLens2CV::LatencyStage(_stage));
+		return Windows::Foundation::Numerics::float4(summary.p50, summary.p95, summary.p99, summary.max);
+	}
+
+	int64_t ResearchModeCV::GetStageLatencyCount(int32_t _stage)
+	{
+		if (_stage < 0 || _stage >= HoloLens2CV::kLatencyStageCount)
+		{
+			return 0;
+		}
+		return m_pipeline.Latencies().Summarize(HoloLens2CV::LatencyStage(_stage)).count;
+	}
+
+	void ResearchModeCV::ResetStageLatencies()
+	{
+		m_pipeline.Latencies().Reset();
+	}
+
+	void ResearchModeCV::EnableTracing(bool _enabled, int32_t _capacity)
+	{
+		auto& ring = HoloLens2CV::TraceRing::Global();
+		if (_enabled)
+		{
+			ring.Enable((size_t)std::max(_capacity, 1024));
+		}
+		else
+		{
+			ring.Disable();
+		}
 	}
 
-	Windows::Foundation::Collections::IVector<DetectedArUcoMarker> ResearchModeCV::GetDetectedMarkers()
+	// also readable after tracing was disabled, until the next enable
+	hstring ResearchModeCV::GetTraceJson()
 	{
-		m_ArUcoDetectionsUpdated = false;
-		return m_detectedMarkers;
+		return winrt::to_hstring(HoloLens2CV::TraceRing::Global().ToChromeJson());
 	}
 
+	// Returns the markers of the latest processed frame. The view is never modified
+	// afterwards, the next frame is published as a new snapshot.
+	Windows::Foundation::Collections::IVectorView<DetectedArUcoMarker> ResearchModeCV::GetDetectedMarkers()
+	{
+		HoloLens2CV::TraceScope trace("GetDetectedMarkers");
+		auto snapshot = m_detections.Latest();
+		if (!snapshot)
+		{
+			return winrt::single_threaded_vector<DetectedArUcoMarker>().GetView();
+		}
+		m_lastReadSequence = snapshot->sequence;
+		return snapshot->markers;
+	}
+
+	// Only one thread may read each camera buffer; it never blocks the sensor loop.
 	com_array<uint8_t> ResearchModeCV::GetLFCameraBuffer(int64_t& ts)
 	{
-		std::lock_guard<std::mutex> l(mu);
-		if (!m_lastSpatialFrame.LFFrame.image)
+		HoloLens2CV::TraceScope trace("GetLFCameraBuffer");
+		m_LFPublisher.Update();
+		const auto& frame = m_LFPublisher.ReadBuffer();
+		if (frame.image.empty())
 		{
 			return com_array<UINT8>();
 		}
-		com_array<UINT8> tempBuffer = com_array<UINT8>(std::move_iterator(m_lastSpatialFrame.LFFrame.image), std::move_iterator(m_lastSpatialFrame.LFFrame.image + m_LFbufferSize));
-		ts = m_lastSpatialFrame.LFFrame.timestamp_ft;
+		com_array<UINT8> tempBuffer = com_array<UINT8>(frame.image.begin(), frame.image.end());
+		ts = frame.timestamp;
 		m_LFImageUpdated = false;
 		return tempBuffer;
 	}
 
 	com_array<uint8_t> ResearchModeCV::GetRFCameraBuffer(int64_t& ts)
 	{
-		std::lock_guard<std::mutex> l(mu);
-		if (!m_lastSpatialFrame.RFFrame.image)
+		HoloLens2CV::TraceScope trace("GetRFCameraBuffer");
+		m_RFPublisher.Update();
+		const auto& frame = m_RFPublisher.ReadBuffer();
+		if (frame.image.empty())
 		{
 			return com_array<UINT8>();
 		}
-		com_array<UINT8> tempBuffer = com_array<UINT8>(std::move_iterator(m_lastSpatialFrame.RFFrame.image), std::move_iterator(m_lastSpatialFrame.RFFrame.image + m_RFbufferSize));
-		ts = m_lastSpatialFrame.RFFrame.timestamp_ft;
+		com_array<UINT8> tempBuffer = com_array<UINT8>(frame.image.begin(), frame.image.end());
+		ts = frame.timestamp;
 		m_RFImageUpdated = false;
 		return tempBuffer;
 	}
 
+	// The latest LF & RF frames, from the thread reading GetLFCameraBuffer / GetRFCameraBuffer, which it
+	// replaces: it consumes the same buffers, so its frames may be newer than the ones read before.
+	// LFts & RFts are the time stamps of the encoded frames. The two buffers are read one after the
+	// other while the sensor loop publishes, empty if they hold frames of different pairs.
+	com_array<uint8_t> ResearchModeCV::GetCompressedFrontCameraBuffers(int32_t _maxError, int64_t& LFts, int64_t& RFts)
+	{
+		HoloLens2CV::TraceScope trace("GetCompressedFrontCameraBuffers");
+		m_LFPublisher.Update();
+		m_RFPublisher.Update();
+		const auto& LF = m_LFPublisher.ReadBuffer();
+		const auto& RF = m_RFPublisher.ReadBuffer();
+		if (LF.image.empty() || LF.width != RF.width || LF.height != RF.height || LF.image.size() != RF.image.size())
+		{
+			return com_array<UINT8>();
+		}
+		const int64_t skew = int64_t(RF.hostTicks - LF.hostTicks);
+		if (skew > m_pairTolerance || -skew > m_pairTolerance)
+		{
+			return com_array<UINT8>();
+		}
+
+		HoloLens2CV::StereoCodecSettings settings;
+		settings.maxError = std::clamp(int(_maxError), 0, HoloLens2CV::kMaxStereoCodecError);
+		m_encodedPair.clear();
+		if (!m_codec.Encode(LF.image.data(), RF.image.data(), LF.width, LF.height, settings, m_encodedPair))
+		{
+			return com_array<UINT8>();
+		}
+		LFts = LF.timestamp;
+		RFts = RF.timestamp;
+		m_LFImageUpdated = false;
+		m_RFImageUpdated = false;
+		return com_array<UINT8>(m_encodedPair.begin(), m_encodedPair.end());
+	}
+
 	long long ResearchModeCV::checkAndConvertUnsigned(UINT64 val)
 	{
 		assert(val <= kMaxLongLong);
 		return static_cast<long long>(val);
 	}
 
-	XMMATRIX ResearchModeCV::SpatialLocationToDxMatrix(SpatialLocation location) {
-		auto rot = location.Orientation();
-		auto quatInDx = XMFLOAT4(rot.x, rot.y, rot.z, rot.w);
-		auto rotMat = XMMatrixRotationQuaternion(XMLoadFloat4(&quatInDx));
-		auto pos = location.Position();
-		auto posMat = XMMatrixTranslation(pos.x, pos.y, pos.z);
-		return rotMat * posMat;
-	}
-
-	void ResearchModeCV::ProcessSensorImageWithArUco(const BYTE* pImage,
-		ResearchModeSensorResolution resolution,
-		DirectX::XMMATRIX cameraToWorld,
-		CameraIntrinsics cameraIntrinsics,
-		int dictId,
-		float markerLenght,
-		int& frameProcessingTime,
-		Windows::Foundation::Collections::IVector<DetectedArUcoMarker>& detectedMarkers)
+	void ResearchModeCV::PublishImages(const HoloLens2CV::FrontCamerasFrame& frame)
 	{
-		// https://stackoverflow.com/questions/22387586/measuring-execution-time-of-a-function-in-c
-		using std::chrono::high_resolution_clock;
-		using std::chrono::duration_cast;
-		using std::chrono::duration;
-		using std::chrono::milliseconds;
-
-		auto t1 = high_resolution_clock::now();
-
-		// https://github.com/opencv/opencv_contrib/blob/4.x/modules/aruco/samples/detect_markers.cpp
-		// arucu dictionary from id
-		cv::aruco::Dictionary dictionary = 
-			cv::aruco::getPredefinedDictionary(cv::aruco::PredefinedDictionaryType(dictId));
-
-		// size of the printed marker's side in meters
-		float mlenght = markerLenght;
+		if (!m_enableBuffer)
+		{
+			return;
+		}
 
-		// camera intrinsic parameters for aruco based pose estimation (camera matrix)
-		cv::Mat cameraMatrix(3, 3, CV_64F, cv::Scalar(0));
+		// publish LF and RF images, never waits for the reader
+		if (frame.hasLF)
+		{
+			m_LFPublisher.WriteBuffer() = frame.LF;
+			m_LFPublisher.Publish();
+			m_LFImageUpdated = true;
+		}
+		if (frame.hasRF)
+		{
+			m_RFPublisher.WriteBuffer() = frame.RF;
+			m_RFPublisher.Publish();
+			m_RFImageUpdated = true;
+		}
+	}
 
-		cameraMatrix.at<double>(0, 0) = cameraIntrinsics.focalLength.x;
-		cameraMatrix.at<double>(0, 2) = cameraIntrinsics.principalPoint.x;
-		cameraMatrix.at<double>(1, 1) = cameraIntrinsics.focalLength.y;
-		cameraMatrix.at<double>(1, 2) = cameraIntrinsics.principalPoint.y;
-		cameraMatrix.at<double>(2, 2) = 1.0;
+	void ResearchModeCV::PublishDetections(const HoloLens2CV::FrontCamerasFrame& frame, const std::vector<HoloLens2CV::MarkerPose>& poses)
+	{
+		// snapshot recycled from the double buffer, filled here & published at the end
+		auto snapshot = m_detections.Acquire();
+		snapshot->poses = poses;
+		auto markers = winrt::single_threaded_vector<DetectedArUcoMarker>();
+
+		auto LfToUnity = CameraToWorldUnity(DirectX::XMLoadFloat4x4(reinterpret_cast<const DirectX::XMFLOAT4X4*>(frame.LF.cameraToWorld.data())));
+		auto RfToUnity = CameraToWorldUnity(DirectX::XMLoadFloat4x4(reinterpret_cast<const DirectX::XMFLOAT4X4*>(frame.RF.cameraToWorld.data())));
+		std::memcpy(snapshot->cameraToWorldUnity[HoloLens2CV::LeftFrontCamera], &LfToUnity, sizeof(LfToUnity));
+		std::memcpy(snapshot->cameraToWorldUnity[HoloLens2CV::RightFrontCamera], &RfToUnity, sizeof(RfToUnity));
+
+		// append detected markers to the ivector
+		for (const auto& pose : poses)
+		{
+			// X Y Z position
+			// X Y Z orientation (Rodrigues)
+			// camera to world unity of the camera the marker was seen by
+			DetectedArUcoMarker marker = DetectedArUcoMarker(
+				pose.id,
+				pose.camera,
+				Windows::Foundation::Numerics::float3((float)pose.tvec[0], (float)pose.tvec[1], (float)pose.tvec[2]),
+				Windows::Foundation::Numerics::float3((float)pose.rvec[0], (float)pose.rvec[1], (float)pose.rvec[2]),
+				pose.camera == HoloLens2CV::RightFrontCamera ? RfToUnity : LfToUnity);
+			markers.Append(marker);
+		}
 
-		// camera distortion matrix for aruco based pose estimation
-		cv::Mat distortionCoefficientsMatrix(1, 5, CV_64F);
+		// readers holding the previous snapshot keep seeing it unchanged
+		snapshot->timestamp = frame.hasLF ? frame.LF.timestamp : frame.RF.timestamp;
+		snapshot->markers = markers.GetView();
+		m_detections.Publish(std::move(snapshot));
+	}
 
-		distortionCoefficientsMatrix.at<double>(0, 0) = cameraIntrinsics.radialDistortion.x;
-		distortionCoefficientsMatrix.at<double>(0, 1) = cameraIntrinsics.radialDistortion.y;
-		distortionCoefficientsMatrix.at<double>(0, 2) = cameraIntrinsics.tangentialDistortion.x;
-		distortionCoefficientsMatrix.at<double>(0, 3) = cameraIntrinsics.tangentialDistortion.y;
-		distortionCoefficientsMatrix.at<double>(0, 4) = cameraIntrinsics.radialDistortion.z;
+	cv::Matx44d ResearchModeCV::ToOpenCV(DirectX::XMMATRIX transform)
+	{
+		// DirectX row vector matrix transposed for column vectors. The research mode camera
+		// unit plane is at z = 1, so the camera axes already match OpenCV's.
+		DirectX::XMFLOAT4X4 m;
+		DirectX::XMStoreFloat4x4(&m, transform);
+		cv::Matx44d result;
+		for (int r = 0; r < 4; r++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				result(r, c) = m.m[c][r];
+			}
+		}
+		return result;
+	}
 
+	Windows::Foundation::Numerics::float4x4 ResearchModeCV::CameraToWorldUnity(DirectX::XMMATRIX cameraToWorld)
+	{
 		// camera to world transposed
 		DirectX::XMMATRIX cameraToWorldT;
 
 		// camera to world unity transform float4x4
 		Windows::Foundation::Numerics::float4x4 viewToUnity;
 
-		// https://stackoverflow.com/questions/76802576/how-to-estimate-pose-of-single-marker-in-opencv-python-4-8-0
-		// https://github.com/opencv/opencv_contrib/blob/4.x/modules/aruco/samples/detect_markers.cpp
-		// set marker corner points
-		cv::Mat objPoints(4, 1, CV_32FC3);
-		objPoints.ptr<cv::Vec3f>(0)[0] = cv::Vec3f(-mlenght / 2.f, mlenght / 2.f, 0);
-		objPoints.ptr<cv::Vec3f>(0)[1] = cv::Vec3f(mlenght / 2.f, mlenght / 2.f, 0);
-		objPoints.ptr<cv::Vec3f>(0)[2] = cv::Vec3f(mlenght / 2.f, -mlenght / 2.f, 0);
-		objPoints.ptr<cv::Vec3f>(0)[3] = cv::Vec3f(-mlenght / 2.f, -mlenght / 2.f, 0);
-
-		std::vector<int> ids;
-		std::vector<std::vector<cv::Point2f>> corners, rejected;
+		// https://gamedev.stackexchange.com/questions/153816/why-do-these-directxmath-functions-seem-like-they-return-column-major-matrics
+		// transposing camera to world -> row major to column major matrix
+		cameraToWorldT = DirectX::XMMatrixTranspose(cameraToWorld);
 
-		// load sensor image
-		cv::Mat processed(resolution.Height, resolution.Width, CV_8U, (void*)pImage);
-
-		// initialize aruco detector
-		cv::aruco::DetectorParameters detectorParams = cv::aruco::DetectorParameters();
-		cv::aruco::ArucoDetector detector(dictionary, detectorParams);
-
-		// detect markers
-		detector.detectMarkers(processed, corners, ids, rejected);
-
-		size_t  nMarkers = corners.size();
-		std::vector<cv::Vec3d> rvecs(nMarkers), tvecs(nMarkers);
-
-		if (ids.size() > 0)
-		{
-			// https://gamedev.stackexchange.com/questions/153816/why-do-these-directxmath-functions-seem-like-they-return-column-major-matrics
-			// transposing camera to world -> row major to column major matrix
-			cameraToWorldT = DirectX::XMMatrixTranspose(cameraToWorld);
-
-			// store as float4x4 for Unity
-			DirectX::XMStoreFloat4x4(&viewToUnity, cameraToWorldT);
-
-			// invert Z axis to match Unity coordinate system
-			viewToUnity.m31 *= -1.0f;
-			viewToUnity.m32 *= -1.0f;
-			viewToUnity.m33 *= -1.0f;
-			viewToUnity.m34 *= -1.0f;
-
-			// calculate pose for each marker
-			for (size_t i = 0; i < nMarkers; i++) {
-				cv::solvePnP(objPoints, corners.at(i), cameraMatrix, distortionCoefficientsMatrix, rvecs.at(i), tvecs.at(i));
-			}
-
-			// append detected markers to the ivector
-			for (size_t i = 0; i < ids.size(); i++)
-			{
-				// X Y Z position
-				// X Y Z orientation (Rodrigues)
-				// camera to world unity
-				DetectedArUcoMarker marker = DetectedArUcoMarker(
-					ids[i],
-					Windows::Foundation::Numerics::float3((float)tvecs[i][0], (float)tvecs[i][1], (float)tvecs[i][2]),
-					Windows::Foundation::Numerics::float3((float)rvecs[i][0], (float)rvecs[i][1], (float)rvecs[i][2]),
-					viewToUnity);
-				detectedMarkers.Append(marker);
-			}
-		}
+		// store as float4x4 for Unity
+		DirectX::XMStoreFloat4x4(&viewToUnity, cameraToWorldT);
 
-		auto t2 = high_resolution_clock::now();
-		auto ms_int = duration_cast<milliseconds>(t2 - t1);
+		// invert Z axis to match Unity coordinate system
+		viewToUnity.m31 *= -1.0f;
+		viewToUnity.m32 *= -1.0f;
+		viewToUnity.m33 *= -1.0f;
+		viewToUnity.m34 *= -1.0f;
 
-		frameProcessingTime = ms_int.count();
+		return viewToUnity;
 	}
 }
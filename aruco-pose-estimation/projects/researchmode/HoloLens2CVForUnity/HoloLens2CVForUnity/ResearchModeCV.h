@@ -1,8 +1,23 @@
 #pragma once
 #include "ResearchModeCV.g.h"
+#include "FrontCamerasPipeline.h"
+#include "TripleBuffer.h"
+#include "SnapshotPublisher.h"
+#include "MarkerResultBuffer.h"
+#include "StereoFrameCodec.h"
 
 namespace winrt::HoloLens2CVForUnity::implementation
 {
+    // rig poses of the spatial locator, on the clock of the frame time stamps
+    struct SpatialLocatorPoseSource : HoloLens2CV::RigPoseSource
+    {
+        Windows::Perception::Spatial::SpatialLocator locator = nullptr;
+        Windows::Perception::Spatial::SpatialCoordinateSystem refFrame = nullptr;
+
+        int64_t Now() override;
+        bool TryLocate(int64_t timestamp, HoloLens2CV::RigPose& pose) override;
+    };
+
     struct ResearchModeCV : ResearchModeCVT<ResearchModeCV>
     {
         ResearchModeCV();
@@ -15,10 +30,32 @@ namespace winrt::HoloLens2CVForUnity::implementation
         int32_t GetDetectedMarkersCount();
         int32_t GetFrameProcessingTime();
 
-        Windows::Foundation::Collections::IVector<DetectedArUcoMarker> GetDetectedMarkers();
+        Windows::Foundation::Numerics::float4 GetStageLatency(int32_t _stage);
+        int64_t GetStageLatencyCount(int32_t _stage);
+        void ResetStageLatencies();
+
+        void EnableTracing(bool _enabled, int32_t _capacity);
+        hstring GetTraceJson();
+
+        int32_t GetFrameQueueDepth();
+        int32_t GetFrameQueueMaxDepth();
+        int64_t GetDroppedFrameCount();
+        void ResetFrameQueueStats();
+
+        int64_t GetDetectionSequence();
+
+        Windows::Foundation::Collections::IVectorView<DetectedArUcoMarker> GetDetectedMarkers();
+
+        void ConfigurePoseFilter(float _minCutoff, float _beta, float _maxPrediction);
+        bool TryGetPredictedMarkerPose(int32_t _id, int64_t _targetTimestamp, Windows::Foundation::Numerics::float4x4& _markerToWorldUnity);
+        int64_t GetCurrentTimestamp();
+
+        int32_t GetMarkerBufferSize(int32_t markerCount);
+        int32_t GetDetectedMarkersBuffer(array_view<float> buffer);
 
         com_array<uint8_t> GetLFCameraBuffer(int64_t& ts);
         com_array<uint8_t> GetRFCameraBuffer(int64_t& ts);
+        com_array<uint8_t> GetCompressedFrontCameraBuffers(int32_t _maxError, int64_t& LFts, int64_t& RFts);
 
         void SetReferenceCoordinateSystem(Windows::Perception::Spatial::SpatialCoordinateSystem refCoord);
 
@@ -27,7 +64,32 @@ namespace winrt::HoloLens2CVForUnity::implementation
             bool _enableBuffer, 
             bool _enableArUcoDetector,
             float _markerSize, 
-            int _dictId);
+            int _dictId,
+            int _poseSolver,
+            bool _warmStart);
+
+        void ConfigureFrameQueue(int _capacity, int _dropPolicy);
+
+        void ConfigureTracking(bool _enabled, int _reacquireInterval, float _padding);
+        int64_t GetFullScanCount();
+        int64_t GetRegionScanCount();
+
+        void SetPyramidLevel(int _level);
+
+        void ConfigureDetector(int _thresholdWindowMin, int _thresholdWindowMax, int _thresholdWindowStep,
+            float _thresholdConstant, float _minPerimeterRate, float _maxPerimeterRate,
+            float _polygonAccuracy, int _cornerRefinement);
+
+        void ConfigureStereo(bool _enabled);
+        int64_t GetStereoMarkerCount();
+        int64_t GetMonoMarkerCount();
+
+        void ConfigureFramePairing(float _toleranceMs, int _unpairedPolicy);
+        int64_t GetUnpairedFrameCount();
+        float GetMaxPairSkew();
+
+        void ConfigurePoseHistory(bool _enabled, float _sampleRate, float _maxExtrapolationMs);
+        int64_t GetPoseHistoryMissCount();
 
         void SetCameraIntrinsics(  
             int _cameraType,                                                           
@@ -40,27 +102,40 @@ namespace winrt::HoloLens2CVForUnity::implementation
         void StartSpatialCamerasFrontLoop();
         void StopAllSensorDevice();
 
-        std::mutex mu;
-
     private:
 
         float m_markerLength;
         int m_sensor;
         int m_dictId;
-        int m_frameProcessingTime = 0;
         bool m_enableBuffer;
         bool m_enableArUcoDetector;
 
-        struct CameraIntrinsics
+        // LF & RF frames of the research mode sensors, read as pairs of GetNextBuffer calls
+        struct SensorFrameSource : HoloLens2CV::FrameSource
         {
-            Windows::Foundation::Numerics::float2 focalLength;
-            Windows::Foundation::Numerics::float2 principalPoint;
-            Windows::Foundation::Numerics::float3 radialDistortion;
-            Windows::Foundation::Numerics::float2 tangentialDistortion;
+            IResearchModeSensor* LF = nullptr;
+            IResearchModeSensor* RF = nullptr;
+
+            bool Next(int& camera, HoloLens2CV::CameraFrame& frame) override;
+            void Stop() override { m_stopped = true; }
+
+        private:
+            static bool Read(IResearchModeSensor* sensor, HoloLens2CV::CameraFrame& frame);
+
+            HoloLens2CV::CameraFrame m_RF;      // read with LF, handed out by the next call
+            bool m_hasRF = false;
+            std::atomic_bool m_stopped = false;
         };
 
-        CameraIntrinsics m_LFCameraIntrinsics;
-        CameraIntrinsics m_RFCameraIntrinsics;
+        // Pairing, rig poses, frame queue, detectors (built by Configure & SetCameraIntrinsics and reused
+        // for every frame), stereo & pose filter. The same pipeline runs off-device on replayed sessions.
+        HoloLens2CV::FrontCamerasPipeline m_pipeline;
+        SensorFrameSource m_sensorSource;
+
+        // rig poses sampled at their own cadence while the sensor loop runs, frames are
+        // located from them & only fall back to the locator when there is no pose for them
+        SpatialLocatorPoseSource m_poseSource;
+        std::atomic_bool m_usePoseHistory = true;
 
         UINT8* m_LFImage = nullptr;
         UINT8* m_RFImage = nullptr;
@@ -78,9 +153,6 @@ namespace winrt::HoloLens2CVForUnity::implementation
         Windows::Perception::Spatial::SpatialLocator m_locator = 0;
         Windows::Perception::Spatial::SpatialCoordinateSystem m_refFrame = nullptr;
 
-        std::atomic_int m_LFbufferSize = 0;
-        std::atomic_int m_RFbufferSize = 0;
-
         std::atomic_bool m_LFImageUpdated = false;
         std::atomic_bool m_RFImageUpdated = false;
 
@@ -89,14 +161,15 @@ namespace winrt::HoloLens2CVForUnity::implementation
         static void SpatialCamerasFrontLoop(ResearchModeCV* pResearchModeCV);
         static void CamAccessOnComplete(ResearchModeSensorConsent consent);
 
-        static void ProcessSensorImageWithArUco(const BYTE* pImage,
-            ResearchModeSensorResolution resolution, 
-            DirectX::XMMATRIX cameraToWorld, 
-            CameraIntrinsics camIntrinsics, 
-            int dictId, 
-            float markerLenght, 
-            int& frameProcessingTime,
-            Windows::Foundation::Collections::IVector<DetectedArUcoMarker>& detectedMarkers);
+        static void StoreCameraFrame(HoloLens2CV::CameraFrame& frame, const BYTE* pImage,
+            ResearchModeSensorResolution resolution, UINT64 hostTicks);
+
+        // pipeline callbacks: latest images for GetLFCameraBuffer / GetRFCameraBuffer, results as a new snapshot
+        void PublishImages(const HoloLens2CV::FrontCamerasFrame& frame);
+        void PublishDetections(const HoloLens2CV::FrontCamerasFrame& frame, const std::vector<HoloLens2CV::MarkerPose>& poses);
+
+        static Windows::Foundation::Numerics::float4x4 CameraToWorldUnity(DirectX::XMMATRIX cameraToWorld);
+        static cv::Matx44d ToOpenCV(DirectX::XMMATRIX transform);
 
         DirectX::XMFLOAT4X4 m_LFCameraPose;
         DirectX::XMMATRIX m_LFCameraPoseInvMatrix;
@@ -107,21 +180,29 @@ namespace winrt::HoloLens2CVForUnity::implementation
 
         std::thread* m_pSpatialCamerasFrontUpdateThread;
 
-        static DirectX::XMMATRIX ResearchModeCV::SpatialLocationToDxMatrix(Windows::Perception::Spatial::SpatialLocation location);
 
-        struct Frame {
-            UINT64 timestamp;     // QPC 
-            int64_t timestamp_ft; // FileTime
-            UINT8* image = nullptr;
+        // latest LF and RF frames for GetLFCameraBuffer / GetRFCameraBuffer, lock-free
+        HoloLens2CV::TripleBuffer<HoloLens2CV::CameraFrame> m_LFPublisher;
+        HoloLens2CV::TripleBuffer<HoloLens2CV::CameraFrame> m_RFPublisher;
+
+        // for GetCompressedFrontCameraBuffers, scratch reused between calls
+        HoloLens2CV::StereoFrameCodec m_codec;
+        std::vector<uint8_t> m_encodedPair;
+        std::atomic<int64_t> m_pairTolerance = 10000;                  // host ticks, as set by ConfigureFramePairing
+
+        // results of one processed frame, immutable once published
+        struct DetectionSnapshot
+        {
+            uint64_t sequence = 0;
+            int64_t timestamp = 0;                                  // FileTime of the processed frame
+            std::vector<HoloLens2CV::MarkerPose> poses;
+            float cameraToWorldUnity[2][16] = {};                   // LF / RF, row major float4x4
+            Windows::Foundation::Collections::IVectorView<DetectedArUcoMarker> markers{ nullptr };
         };
 
-        struct SpatialCameraFrame {
-            Frame LFFrame;
-            Frame RFFrame;
-        } m_lastSpatialFrame;
+        HoloLens2CV::SnapshotPublisher<DetectionSnapshot> m_detections;
+        std::atomic<uint64_t> m_lastReadSequence = 0;
 
-        std::atomic_bool m_ArUcoDetectionsUpdated = false;
-        Windows::Foundation::Collections::IVector<DetectedArUcoMarker> m_detectedMarkers;
     };
 }
 namespace winrt::HoloLens2CVForUnity::factory_implementation
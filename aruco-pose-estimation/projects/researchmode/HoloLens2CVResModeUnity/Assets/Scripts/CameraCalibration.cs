@@ -25,6 +25,9 @@ public class CameraCalibration : MonoBehaviour
 
     bool captureImages = false;
 
+    public bool compressImages = false;                   // send the pairs as 'c' messages, HeadsetIngest reads them, TCPServer.py does not
+    public int compressionMaxError = 0;                   // 0 lossless, up to 16 gray levels per pixel
+
 #if ENABLE_WINMD_SUPPORT
 ResearchModeCV resModeCV;
 Windows.Perception.Spatial.SpatialCoordinateSystem unityWorldOrigin;
@@ -72,7 +75,7 @@ Debug.Log("Obtained reference coordinate system");
 
        resModeCV = new ResearchModeCV();
        resModeCV.SetReferenceCoordinateSystem(unityWorldOrigin);
-       resModeCV.Configure(1, true, false, 0.55f, 0);
+       resModeCV.Configure(1, true, false, 0.55f, 0, 0, false);
        resModeCV.InitializeSpatialCamerasFront();
        resModeCV.StartSpatialCamerasFrontLoop();
 
@@ -117,9 +120,11 @@ resModeCV.StopAllSensorDevice();
         byte[] RFImage = null;
 
 #if ENABLE_WINMD_SUPPORT
+        // a compressed capture reads the pair in the plugin, the preview keeps its images for that frame
+        bool captureCompressed = captureImages && compressImages && tcpClient.Connected;
 
         // update LF camera texture
-        if (LFPreviewPlane != null && resModeCV.LFImageUpdated())
+        if (LFPreviewPlane != null && !captureCompressed && resModeCV.LFImageUpdated())
         {
             LFImage = resModeCV.GetLFCameraBuffer(out ts_ft_left);
             if (LFImage.Length > 0)
@@ -139,7 +144,7 @@ resModeCV.StopAllSensorDevice();
         }
 
         // update RF camera texture
-        if (RFPreviewPlane != null && resModeCV.RFImageUpdated())
+        if (RFPreviewPlane != null && !captureCompressed && resModeCV.RFImageUpdated())
         {
 
             RFImage = resModeCV.GetRFCameraBuffer(out ts_ft_right);
@@ -165,19 +170,27 @@ resModeCV.StopAllSensorDevice();
            if (tcpClient.Connected)
 	       {
 #if WINDOWS_UWP
-               // get time stamp from file time
-               Windows.Perception.PerceptionTimestamp ts_left = Windows.Perception.PerceptionTimestampHelper.FromHistoricalTargetTime(DateTime.FromFileTime(ts_ft_left));
-               Windows.Perception.PerceptionTimestamp ts_right = Windows.Perception.PerceptionTimestampHelper.FromHistoricalTargetTime(DateTime.FromFileTime(ts_ft_right));
-
-               // convert to unix time
-               long ts_unix_left = ts_left.TargetTime.ToUnixTimeMilliseconds();
-               long ts_unix_right = ts_right.TargetTime.ToUnixTimeMilliseconds();
+               // convert file time to unix time
+               long ts_unix_left = FileTimeToUnixMilliseconds(ts_ft_left);
+               long ts_unix_right = FileTimeToUnixMilliseconds(ts_ft_right);
                long ts_unix_current = GetCurrentTimestampUnix();
 
                // send images
                if (tcpClient != null)
                {
-                    if (LFImage != null && RFImage != null)
+                    if (captureCompressed)
+                    {
+                          // the latest pair, read & encoded in the plugin, sent with the time stamps of the encoded frames
+                          long ts_ft_compressed_left, ts_ft_compressed_right;
+                          byte[] LRFCompressed = resModeCV.GetCompressedFrontCameraBuffers(compressionMaxError, out ts_ft_compressed_left, out ts_ft_compressed_right);
+                          if (LRFCompressed.Length == 0)
+                          {
+                              return;     // LF & RF of different pairs, the capture waits for the next ones
+                          }
+                          tcpClient.SendCompressedSpatialImageAsync(LRFCompressed, FileTimeToUnixMilliseconds(ts_ft_compressed_left),
+                              FileTimeToUnixMilliseconds(ts_ft_compressed_right));
+                    }
+                    else if (LFImage != null && RFImage != null)
 	                {
                           tcpClient.SendSpatialImageAsync(LFImage, RFImage, ts_unix_left, ts_unix_right);
 	                }
@@ -197,6 +210,12 @@ resModeCV.StopAllSensorDevice();
     }
 
 #if WINDOWS_UWP
+    private long FileTimeToUnixMilliseconds(long fileTime)
+    {
+        // get time stamp from file time
+        Windows.Perception.PerceptionTimestamp ts = Windows.Perception.PerceptionTimestampHelper.FromHistoricalTargetTime(DateTime.FromFileTime(fileTime));
+        return ts.TargetTime.ToUnixTimeMilliseconds();
+    }
     private long GetCurrentTimestampUnix()
     {
         // Get the current time, in order to create a PerceptionTimestamp. 
@@ -27,10 +27,70 @@ public class MarkerTracker : MonoBehaviour
     public CameraIntrinsics LeftFrontCameraIntrinsics;    // LEFT Front camera intrinsics holder
     public CameraIntrinsics RightFrontCameraIntrinsics;   // RIGHT Front camera intrinsics holder
 
+    [Tooltip("Solver used for the marker poses")]
+    public PoseSolver poseSolver = PoseSolver.Iterative;
+
+    [Tooltip("Refine from the marker's pose in the previous frame when it was seen")]
+    public bool warmStartPoses = false;
+
     public TextMeshPro HUD;                               // hud to display the current status
 
+    [Tooltip("Read the detections through one flat buffer instead of one runtime object per marker")]
+    public bool useMarkerBuffer = false;
+
+    [Tooltip("Maximum number of markers read per frame from the flat buffer")]
+    public int maxMarkers = 32;
+
+    [Tooltip("Search only around the markers found in the previous frame")]
+    public bool enableTracking = false;
+
+    [Tooltip("Frames between two full image scans while tracking")]
+    public int reacquireInterval = 15;
+
+    [Tooltip("Detect on the image downsampled this many times by 2, corners are refined at full resolution")]
+    [Range(0, 3)]
+    public int pyramidLevel = 0;
+
+    [Tooltip("Thresholding, candidate filtering & corner refinement of the detector, see DetectorTuner")]
+    public DetectorSettings detectorSettings = new DetectorSettings();
+
+    [Tooltip("With Sensor = Both, triangulate markers seen by both front cameras for a more accurate depth")]
+    public bool useStereo = false;
+
+    [Tooltip("Largest host time difference in ms between a LF and a RF frame of one pair")]
+    public float pairingToleranceMs = 1.0f;
+
+    [Tooltip("Process LF or RF frames without partner alone instead of dropping them")]
+    public bool processUnpairedFrames = true;
+
+    [Tooltip("Sample the head pose at its own rate and interpolate it for every frame instead of asking the locator per frame")]
+    public bool usePoseHistory = false;
+
+    [Tooltip("Head pose samples per second of the pose history")]
+    public float poseSampleRate = 200.0f;
+
+    [Tooltip("Smooth the marker pose natively and predict it to the render time every frame")]
+    public bool usePoseFilter = false;
+
+    [Tooltip("Smoothing of a still marker in Hz, lower is smoother")]
+    public float filterMinCutoff = 1.0f;
+
+    [Tooltip("How fast the smoothing opens up with the marker's speed, higher is less lag when moving")]
+    public float filterBeta = 20.0f;
+
+    [Tooltip("Time in ms after now the marker pose is predicted to, roughly the display latency")]
+    public float predictionMs = 20.0f;
+
+    [Tooltip("Record a timeline of the pipeline stages, saved as trace.json to the persistent data path when the app loses focus")]
+    public bool enableTracing = false;
+
+    [Tooltip("Events kept by the trace, the oldest are overwritten")]
+    public int traceCapacity = 65536;
+
 #if ENABLE_WINMD_SUPPORT
     ResearchModeCV _resModeCV = null;
+    float[] _markerBuffer = null;
+    int _filteredMarkerId = -1;
     Windows.Perception.Spatial.SpatialCoordinateSystem _unityCoordinateSystem = null;
 #endif
 
@@ -65,7 +125,18 @@ public class MarkerTracker : MonoBehaviour
                 VectorExtensions.ToNumerics(RightFrontCameraIntrinsics.radialDistortion),
                 VectorExtensions.ToNumerics(RightFrontCameraIntrinsics.tangentialDistortion));
 
-            _resModeCV.Configure((int)sensor, false, true, markerSize, (int)arUcoDictionary);
+            _resModeCV.Configure((int)sensor, false, true, markerSize, (int)arUcoDictionary, (int)poseSolver, warmStartPoses);
+            _markerBuffer = new float[_resModeCV.GetMarkerBufferSize(maxMarkers)];
+            _resModeCV.ConfigureTracking(enableTracking, reacquireInterval, 0.5f);
+            _resModeCV.SetPyramidLevel(pyramidLevel);
+            _resModeCV.ConfigureDetector(detectorSettings.thresholdWindowMin, detectorSettings.thresholdWindowMax,
+                detectorSettings.thresholdWindowStep, detectorSettings.thresholdConstant, detectorSettings.minPerimeterRate,
+                detectorSettings.maxPerimeterRate, detectorSettings.polygonAccuracy, (int)detectorSettings.cornerRefinement);
+            _resModeCV.ConfigureStereo(useStereo);
+            _resModeCV.ConfigureFramePairing(pairingToleranceMs, processUnpairedFrames ? 1 : 0);
+            _resModeCV.ConfigurePoseHistory(usePoseHistory, poseSampleRate, 20.0f);
+            _resModeCV.ConfigurePoseFilter(filterMinCutoff, filterBeta, 0.1f);
+            _resModeCV.EnableTracing(enableTracing, traceCapacity);
 
             _resModeCV.InitializeSpatialCamerasFront();
             _resModeCV.StartSpatialCamerasFrontLoop();
@@ -81,18 +152,80 @@ public class MarkerTracker : MonoBehaviour
         markerGo.SetActive(false);
     }
 
+#if ENABLE_WINMD_SUPPORT
+    // p50 / p99 of a pipeline stage since the start, in microseconds
+    private string StageLatency(int stage)
+    {
+        System.Numerics.Vector4 latency = _resModeCV.GetStageLatency(stage);
+        return latency.X.ToString("F0") + " / " + latency.Z.ToString("F0") + " us";
+    }
+#endif
+
     // Update is called once per frame
     void LateUpdate()
     {
 #if ENABLE_WINMD_SUPPORT
         HUD.text = "ArUco detection count: " + _resModeCV.GetDetectedMarkersCount() +
         "\nLast camera frame processing time: " + _resModeCV.GetFrameProcessingTime() + " ms" +
+        "\nFrame queue depth: " + _resModeCV.GetFrameQueueDepth() + " (max " + _resModeCV.GetFrameQueueMaxDepth() + "), dropped: " + _resModeCV.GetDroppedFrameCount() +
+        "\nFull / region scans: " + _resModeCV.GetFullScanCount() + " / " + _resModeCV.GetRegionScanCount() +
+        "\nStereo / mono markers: " + _resModeCV.GetStereoMarkerCount() + " / " + _resModeCV.GetMonoMarkerCount() +
+        "\nUnpaired frames: " + _resModeCV.GetUnpairedFrameCount() + ", max pair skew: " + _resModeCV.GetMaxPairSkew().ToString("F2") + " ms" +
+        "\nPose history misses: " + _resModeCV.GetPoseHistoryMissCount() +
+        "\nDetection p50 / p99: " + StageLatency(2) + ", PnP: " + StageLatency(3) + ", acquisition wait: " + StageLatency(0) +
         "\n Sensor: " + sensor;
 #endif
         try
         {
 #if ENABLE_WINMD_SUPPORT
-            IList<DetectedArUcoMarker> detectedArUcoMarkers = _resModeCV.GetDetectedMarkers();
+            if (usePoseFilter)
+            {
+                // follow one marker, its filtered pose is predicted every render frame even without a new camera frame;
+                // once the latest frame has markers but not this one, or it cannot be predicted, the first marker of the frame is followed
+                _resModeCV.GetDetectedMarkersBuffer(_markerBuffer);
+                int markerCount = MarkerBuffer.MarkerCount(_markerBuffer);
+                bool detected = markerCount == 0;
+                for (int i = 0; i < markerCount && !detected; i++)
+                {
+                    detected = MarkerBuffer.Id(_markerBuffer, i) == _filteredMarkerId;
+                }
+
+                long target = _resModeCV.GetCurrentTimestamp() + (long)(predictionMs * 10000.0f);
+                System.Numerics.Matrix4x4 markerToWorld = System.Numerics.Matrix4x4.Identity;
+                bool predicted = detected && _filteredMarkerId >= 0 && _resModeCV.TryGetPredictedMarkerPose(_filteredMarkerId, target, out markerToWorld);
+                if (!predicted && markerCount != 0)
+                {
+                    _filteredMarkerId = MarkerBuffer.Id(_markerBuffer, 0);
+                    predicted = _resModeCV.TryGetPredictedMarkerPose(_filteredMarkerId, target, out markerToWorld);
+                }
+                if (predicted)
+                {
+                    UnityEngine.Matrix4x4 markerLocationUnity = MatrixExtensions.ToUnity(markerToWorld);
+                    markerGo.transform.SetPositionAndRotation(VectorExtensions.GetTranslation(markerLocationUnity), VectorExtensions.GetRotation(markerLocationUnity));
+                    markerGo.SetActive(true);
+                }
+                return;
+            }
+
+            if (useMarkerBuffer)
+            {
+                // whole frame in one call, currently only the first marker is displayed
+                _resModeCV.GetDetectedMarkersBuffer(_markerBuffer);
+                if (MarkerBuffer.MarkerCount(_markerBuffer) != 0)
+                {
+                    UnityEngine.Vector3 markerPosUnity = MarkerBuffer.Position(_markerBuffer, 0);
+                    UnityEngine.Quaternion markerRotUnity = VectorExtensions.GetRotation(MarkerBuffer.Rotation(_markerBuffer, 0));
+
+                    UnityEngine.Matrix4x4 cameraToWorld = MarkerBuffer.CameraToWorldUnity(_markerBuffer, MarkerBuffer.Camera(_markerBuffer, 0));
+                    UnityEngine.Matrix4x4 markerLocationUnity = cameraToWorld * MatrixExtensions.TransformInUnitySpace(markerPosUnity, markerRotUnity);
+
+                    markerGo.transform.SetPositionAndRotation(VectorExtensions.GetTranslation(markerLocationUnity), VectorExtensions.GetRotation(markerLocationUnity));
+                    markerGo.SetActive(true);
+                }
+                return;
+            }
+
+            IReadOnlyList<DetectedArUcoMarker> detectedArUcoMarkers = _resModeCV.GetDetectedMarkers();
             if (detectedArUcoMarkers.Count != 0)
 	        {   
                 // currently only marker 0 is displayed
@@ -133,9 +266,20 @@ public class MarkerTracker : MonoBehaviour
     {
 #if ENABLE_WINMD_SUPPORT
         _resModeCV.StopAllSensorDevice();
+        if (enableTracing)
+        {
+            // open in chrome://tracing or ui.perfetto.dev
+            System.IO.File.WriteAllText(System.IO.Path.Combine(Application.persistentDataPath, "trace.json"), _resModeCV.GetTraceJson());
+        }
 #endif
     }
 
+    public enum PoseSolver
+    {
+        Iterative = 0,
+        IppeSquare = 1
+    }
+
     public enum ArUcoDictionary
     {
         DICT_4X4_50 = 0,
@@ -161,7 +305,7 @@ public class MarkerTracker : MonoBehaviour
         DICT_APRILTAG_36h11
     }
 
-    public enum Sensor { LeftFront = 0, RightFront }
+    public enum Sensor { LeftFront = 0, RightFront, Both }
 }
 
 // unity engine vector version of camera intrinsics class
@@ -178,6 +322,23 @@ public class CameraIntrinsics
     // public int imageHeight; Not required, queried directly from sensor
 }
 
+// detector parameters as in the native DetectionSettings, the defaults are OpenCV's,
+// DetectorTuner prints the fastest values reaching a recall on a recorded session
+[Serializable]
+public class DetectorSettings
+{
+    public enum CornerRefinement { None = 0, Subpix, Contour, AprilTag }
+
+    public int thresholdWindowMin = 3;
+    public int thresholdWindowMax = 23;
+    public int thresholdWindowStep = 10;
+    public float thresholdConstant = 7.0f;
+    public float minPerimeterRate = 0.03f;
+    public float maxPerimeterRate = 4.0f;
+    public float polygonAccuracy = 0.03f;
+    public CornerRefinement cornerRefinement = CornerRefinement.None;
+}
+
 // https://stackoverflow.com/questions/76442537/is-there-a-way-to-define-cast-from-system-numerics-vector2-to-unityengine-vector
 // https://learn.microsoft.com/en-us/dotnet/csharp/programming-guide/classes-and-structs/extension-methods
 public static class VectorExtensions
@@ -290,3 +451,47 @@ public static class MatrixExtensions
     }
 }
 
+// Reads the flat result buffer filled by ResearchModeCV.GetDetectedMarkersBuffer,
+// the layout is defined in projects/common/MarkerResultBuffer.h
+public static class MarkerBuffer
+{
+    const int HeaderSize = 41;          // 9 header values + 2 camera to world matrices
+    const int RecordSize = 16;          // id, camera, tvec, rvec, 4 corners
+    const int CameraToWorldOffset = 9;
+
+    static int Int(float[] buffer, int index) => BitConverter.SingleToInt32Bits(buffer[index]);
+
+    public static int MarkerCount(float[] buffer) => buffer.Length < HeaderSize ? 0 : Int(buffer, 3);
+    public static long Sequence(float[] buffer) => (long)(uint)Int(buffer, 5) | ((long)Int(buffer, 6) << 32);
+    public static long Timestamp(float[] buffer) => (long)(uint)Int(buffer, 7) | ((long)Int(buffer, 8) << 32);
+
+    public static int Id(float[] buffer, int marker) => Int(buffer, HeaderSize + marker * RecordSize);
+    public static int Camera(float[] buffer, int marker) => Int(buffer, HeaderSize + marker * RecordSize + 1);
+
+    public static UnityEngine.Vector3 Position(float[] buffer, int marker)
+    {
+        int i = HeaderSize + marker * RecordSize + 2;
+        return new UnityEngine.Vector3(buffer[i], buffer[i + 1], buffer[i + 2]);
+    }
+
+    public static UnityEngine.Vector3 Rotation(float[] buffer, int marker)
+    {
+        int i = HeaderSize + marker * RecordSize + 5;
+        return new UnityEngine.Vector3(buffer[i], buffer[i + 1], buffer[i + 2]);
+    }
+
+    public static UnityEngine.Matrix4x4 CameraToWorldUnity(float[] buffer, int camera)
+    {
+        // stored row major, same element order as MatrixExtensions.ToUnity
+        int i = CameraToWorldOffset + camera * 16;
+        var m = new UnityEngine.Matrix4x4();
+        for (int r = 0; r < 4; r++)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                m[r, c] = buffer[i + r * 4 + c];
+            }
+        }
+        return m;
+    }
+}
@@ -135,6 +135,36 @@ public class TCPClient : MonoBehaviour
         lastMessageSent = true;
     }
 
+    // LF & RF pair of GetCompressedFrontCameraBuffers, only HeadsetIngest reads "c"
+    public async void SendCompressedSpatialImageAsync(byte[] LRFCompressed, long ts_left, long ts_right)
+    {
+        if (!lastMessageSent) return;
+        lastMessageSent = false;
+        try
+        {
+            // Write header
+            dw.WriteString("c"); // header "c"
+
+            // Write Length
+            dw.WriteInt32(LRFCompressed.Length);
+            dw.WriteInt64(ts_left);
+            dw.WriteInt64(ts_right);
+
+            // Write actual data
+            dw.WriteBytes(LRFCompressed);
+
+            // Send out
+            await dw.StoreAsync();
+            await dw.FlushAsync();
+        }
+        catch (Exception ex)
+        {
+            SocketErrorStatus webErrorStatus = SocketError.GetStatus(ex.GetBaseException().HResult);
+            Debug.Log(webErrorStatus.ToString() != "Unknown" ? webErrorStatus.ToString() : ex.Message);
+        }
+        lastMessageSent = true;
+    }
+
 #endif
 
     public void ConnectToServerEvent()
@@ -4,15 +4,25 @@
 import numpy as np
 import cv2
 import glob
+import os
 import yaml
 
+import SessionRecording
+
 data_folder = 'data/photovideo/'
+recording = 'data/session.hl2rec'
 
 criteria = (cv2.TERM_CRITERIA_EPS + cv2.TERM_CRITERIA_MAX_ITER, 30, 0.001)
 # Arrays to store object points and image points from all the images.
 objpoints = [] # 3d point in real world 
 imgpoints = [] # 2d points in image plane.
-images = glob.glob(data_folder + '*.tiff')
+
+# a session recording (HeadsetIngest --record, native/SessionConvert) is mapped
+# instead of loading a TIFF per image
+if os.path.exists(recording):
+    images = (gray for ts, gray in SessionRecording.SessionRecording(recording).gray_images(SessionRecording.PHOTO_VIDEO))
+else:
+    images = (cv2.imread(fname, cv2.IMREAD_GRAYSCALE) for fname in glob.glob(data_folder + '*.tiff'))
 
 # https://longervision.github.io/2017/03/16/ComputerVision/OpenCV/opencv-internal-calibration-chessboard/
 # https://stackoverflow.com/questions/31249037/calibrating-webcam-using-python-and-opencv-error
@@ -30,8 +40,7 @@ objp[:, :2] = np.mgrid[0:cbcol, 0:cbrow].T.reshape(-1, 2)
 objp = objp * squareLength
 
 
-for fname in images:
-    gray = cv2.imread(fname, cv2.IMREAD_GRAYSCALE)
+for gray in images:
     ret = False
     ret, corners = cv2.findChessboardCorners(gray, (cbcol, cbrow), None)
     if ret == True:
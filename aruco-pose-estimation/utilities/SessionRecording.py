@@ -0,0 +1,157 @@
+# Reads the session.hl2rec files written by HeadsetIngest --record and
+# native/SessionConvert (projects/common/SessionRecording.h has the layout).
+# The file is memory mapped: image() returns a numpy view of the pixels where
+# they lie in the file, seek() finds a time stamp by binary search in the index.
+# Only numpy is needed, cv2 only to convert color images in gray_images().
+
+import numpy as np
+
+LEFT_FRONT = 0
+RIGHT_FRONT = 1
+PHOTO_VIDEO = 2
+MARKERS = 3
+RIG_POSES = 4
+STREAMS = 5
+
+GRAY8 = 1
+BGRA8 = 2
+BGR8 = 3
+MARKER_TEXT = 4
+MARKER_POSES = 5
+RIG_POSE = 6
+MARKER_TELEMETRY = 7  # 't' batches, decoded by native/TelemetryColumns
+
+VERSION = 1
+
+_FILE_HEADER_SIZE = 32
+_RECORD_MAGIC = 0x31524C48  # "HLR1"
+
+_record_header = np.dtype([('magic', '<u4'), ('stream', '<u2'), ('format', '<u2'), ('timestamp', '<i8'),
+                           ('width', '<u4'), ('height', '<u4'), ('size', '<u8')])
+_index_entry = np.dtype([('timestamp', '<i8'), ('offset', '<u8'), ('stream', '<u2'), ('format', '<u2'),
+                         ('reserved', '<u4')])
+_trailer = np.dtype([('index_offset', '<u8'), ('count', '<u8'), ('entry_size', '<u4'), ('version', '<u4'),
+                     ('magic', 'S8')])
+
+# payload of MARKER_POSES records, RecordedMarker
+marker_dtype = np.dtype([('id', '<i4'), ('camera', '<i4'), ('rvec', '<f8', 3), ('tvec', '<f8', 3),
+                         ('corners', '<f4', 8)])
+# payload of RIG_POSE records, RecordedRigPose (quaternion x, y, z, w)
+rig_pose_dtype = np.dtype([('position', '<f8', 3), ('orientation', '<f8', 4)])
+
+
+def _padded(size):
+    return (size + 15) & ~15
+
+
+class SessionRecording:
+    def __init__(self, path):
+        # copy on write: views can be drawn on, the file is never changed
+        self.data = np.memmap(path, dtype=np.uint8, mode='c')
+        size = len(self.data)
+        if size < _FILE_HEADER_SIZE or bytes(self.data[:8]) != b'HL2CVREC':
+            raise ValueError(path + ': not a session recording')
+        version = int(self.data[8:12].view('<u4')[0])
+        if version != VERSION:
+            raise ValueError(path + ': session recording version %d is not supported' % version)
+
+        self.recovered = False
+        self.index = self._footer_index(size)
+        if self.index is None:
+            self.index = self._recover_index(size)
+            self.recovered = True
+
+        # records of a stream are a range of the index, sorted by time stamp
+        self.begin = np.searchsorted(self.index['stream'], np.arange(STREAMS + 1), side='left')
+
+    def _footer_index(self, size):
+        if size < _FILE_HEADER_SIZE + _trailer.itemsize:
+            return None
+        trailer = self.data[size - _trailer.itemsize:].view(_trailer)[0]
+        offset = int(trailer['index_offset'])
+        if (trailer['magic'] != b'HL2CVIDX' or trailer['version'] != VERSION or
+                trailer['entry_size'] != _index_entry.itemsize or offset < _FILE_HEADER_SIZE or offset % 16 != 0 or
+                offset > size - _trailer.itemsize):
+            return None
+        index_bytes = size - _trailer.itemsize - offset
+        if index_bytes % _index_entry.itemsize != 0 or trailer['count'] != index_bytes // _index_entry.itemsize:
+            return None
+        return self.data[offset:offset + index_bytes].view(_index_entry)
+
+    def _recover_index(self, size):
+        # not closed: every complete record, as the C++ reader does
+        entries = []
+        offset = _FILE_HEADER_SIZE
+        while offset + _record_header.itemsize <= size:
+            header = self.data[offset:offset + _record_header.itemsize].view(_record_header)[0]
+            left = size - offset - _record_header.itemsize
+            if header['magic'] != _RECORD_MAGIC or header['stream'] >= STREAMS or _padded(int(header['size'])) > left:
+                break
+            entries.append((header['timestamp'], offset, header['stream'], header['format'], 0))
+            offset += _record_header.itemsize + _padded(int(header['size']))
+        index = np.array(entries, dtype=_index_entry)
+        return index[np.lexsort((index['timestamp'], index['stream']))]
+
+    def count(self, stream):
+        return int(self.begin[stream + 1] - self.begin[stream])
+
+    def timestamps(self, stream):
+        return self.index['timestamp'][self.begin[stream]:self.begin[stream + 1]]
+
+    def seek(self, stream, timestamp):
+        # first record of the stream at or after timestamp, count(stream) if none
+        return int(np.searchsorted(self.timestamps(stream), timestamp, side='left'))
+
+    def nearest(self, stream, timestamp):
+        # record number of the stream closest to timestamp, None for an empty stream
+        stamps = self.timestamps(stream)
+        if len(stamps) == 0:
+            return None
+        i = min(self.seek(stream, timestamp), len(stamps) - 1)
+        if i > 0 and timestamp - stamps[i - 1] <= stamps[i] - timestamp:
+            i -= 1
+        return i
+
+    def record(self, stream, i):
+        # (header, payload) of record i of a stream, the payload a view into the file
+        entry = self.index[self.begin[stream] + i]
+        offset = int(entry['offset'])
+        header = self.data[offset:offset + _record_header.itemsize].view(_record_header)[0]
+        start = offset + _record_header.itemsize
+        if header['magic'] != _RECORD_MAGIC or header['stream'] != stream or start + int(header['size']) > len(self.data):
+            raise ValueError('record %d of stream %d is corrupt' % (i, stream))
+        return header, self.data[start:start + int(header['size'])]
+
+    def image(self, stream, i):
+        # (timestamp, image) with the channels recorded, no pixel is copied
+        header, payload = self.record(stream, i)
+        channels = {GRAY8: 1, BGRA8: 4, BGR8: 3}[int(header['format'])]
+        shape = (int(header['height']), int(header['width'])) + ((channels,) if channels > 1 else ())
+        return int(header['timestamp']), payload.reshape(shape)
+
+    def images(self, stream):
+        for i in range(self.count(stream)):
+            yield self.image(stream, i)
+
+    def gray_images(self, stream):
+        # 8 bit gray like cv2.IMREAD_GRAYSCALE, the LF & RF images as they lie in the file
+        for timestamp, image in self.images(stream):
+            if image.ndim == 3:
+                import cv2
+                image = cv2.cvtColor(image, cv2.COLOR_BGRA2GRAY if image.shape[2] == 4 else cv2.COLOR_BGR2GRAY)
+            yield timestamp, image
+
+    def marker_text(self):
+        # the 'm' messages, a text per record
+        records = (self.record(MARKERS, i) for i in range(self.count(MARKERS)))
+        return [bytes(payload).decode('utf-8', 'replace') for header, payload in records if header['format'] == MARKER_TEXT]
+
+    def marker_poses(self, i):
+        header, payload = self.record(MARKERS, i)
+        if header['format'] != MARKER_POSES:
+            raise ValueError('record %d of the markers is no pose array' % i)
+        return int(header['timestamp']), payload.view(marker_dtype)
+
+    def rig_pose(self, i):
+        header, payload = self.record(RIG_POSES, i)
+        return int(header['timestamp']), payload.view(rig_pose_dtype)[0]
@@ -1,5 +1,7 @@
 # based on Wenhao's https://github.com/petergu684/HoloLens2-ResearchMode-Unity/blob/master/python/TCPServer.py
 # modified to support PV & aruco data
+# utilities/native/HeadsetIngest.cpp is a native replacement which reassembles
+# messages split over several recv calls and serves multiple headsets at once
 
 from email.headerregistry import HeaderRegistry
 import socket
@@ -93,15 +95,40 @@ def tcp_server():
                 cv2.imwrite(save_folder_rf + str(ts_right)+'_RF.tiff', RF_img_np)
                 print('Image with ts %d and %d is saved' % (ts_left, ts_right))
 
+            if header == 'c':
+                # compressed spatial camera images (compressImages in CameraCalibration.cs),
+                # decoded only by utilities/native/HeadsetIngest.cpp
+                data_length = struct.unpack(">i", data[1:5])[0]
+                ts_left, ts_right = struct.unpack(">qq", data[5:21])
+                print('Compressed images with ts %d and %d skipped, run HeadsetIngest to save them' % (ts_left, ts_right))
+
             if  header == 'm':
-                # print out detected aruco marker data
-                # values can be extracted from the string and further
-                # processed via this or other script
-                # format can be adjusted inside the HoloLens2CVUnity project's
-                # ArUcoTracking.cs script at line 260
-                output = data[1:].decode('utf-8')
+                # print out detected aruco marker data as text, sent by
+                # earlier builds of the HoloLens2CVUnity project, which
+                # now sends 't' batches instead. The first builds sent the
+                # text right after the header, the builds with the ingest
+                # server's framing an Int32 length before it, whose high
+                # byte is 0 where the text starts with a printable character
+                if data[1:2] == b'\x00':
+                    data_length = struct.unpack(">i", data[1:5])[0]
+                    output = data[5:5+data_length].decode('utf-8')
+                else:
+                    output = data[1:].decode('utf-8')
                 print(output)
 
+            if header == 't':
+                # marker telemetry, one binary batch per frame (projects/common/MarkerTelemetry.h),
+                # utilities/native/TelemetryColumns.cpp turns what HeadsetIngest saves into columns
+                data_length = struct.unpack(">i", data[1:5])[0]
+                batch = data[5:5+data_length]
+                magic, version, record_size, count, _, frame, ts = struct.unpack("<IHHIIqq", batch[0:32])
+                print('Frame %d with ts %d, %d markers' % (frame, ts, count))
+                for i in range(count):
+                    offset = 80 + i * record_size
+                    marker_id, tx, ty, tz, rx, ry, rz, error = struct.unpack("<i7f", batch[offset:offset+32])
+                    print('Marker [%d] translation (XYZ): %f %f %f rotation (Rodrigues XYZ): %f %f %f reprojection error: %.2f px'
+                          % (marker_id, tx, ty, tz, rx, ry, rz, error))
+
         except Exception as e:
             print(str(e))
             break
@@ -0,0 +1,100 @@
+// Compares the per-frame cost of rebuilding the ArUco detector on every frame
+// (old ProcessSensorImageWithArUco / ProcessWithArUco behaviour) against a
+// persistent ArUcoDetectorSession, using frames saved by TCPServer.py.
+//
+// Build on Linux (one command):
+//   g++ -O2 -std=c++17 -I../../projects/common -o ArUcoSessionBench ArUcoSessionBench.cpp
+//       ../../projects/common/ArUcoDetectorSession.cpp ../../projects/common/UndistortionTable.cpp ../../projects/common/FileFrameSource.cpp
+//       $(pkg-config --cflags --libs opencv4)
+//
+// Usage:
+//   ./ArUcoSessionBench <image dir> <fx> <fy> <cx> <cy> [dictId] [markerLength] [iterations]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "ArUcoDetectorSession.h"
+#include "FileFrameSource.h"
+
+using namespace HoloLens2CV;
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char** argv)
+{
+	if (argc < 6)
+	{
+		std::fprintf(stderr, "usage: %s <image dir> <fx> <fy> <cx> <cy> [dictId] [markerLength] [iterations]\n", argv[0]);
+		return 1;
+	}
+
+	CameraIntrinsics intrinsics;
+	intrinsics.fx = std::strtof(argv[2], nullptr);
+	intrinsics.fy = std::strtof(argv[3], nullptr);
+	intrinsics.cx = std::strtof(argv[4], nullptr);
+	intrinsics.cy = std::strtof(argv[5], nullptr);
+	int dictId = argc > 6 ? std::atoi(argv[6]) : 0;
+	float markerLength = argc > 7 ? std::strtof(argv[7], nullptr) : 0.05f;
+	int iterations = argc > 8 ? std::atoi(argv[8]) : 5;
+
+	// preload frames so disk I/O is not part of the measurement
+	FileFrameSource source(argv[1]);
+	std::vector<cv::Mat> frames;
+	cv::Mat gray;
+	int64_t ts;
+	while (source.Next(gray, ts))
+	{
+		frames.push_back(gray.clone());
+	}
+	if (frames.empty())
+	{
+		std::fprintf(stderr, "no frames found in %s\n", argv[1]);
+		return 1;
+	}
+
+	std::vector<MarkerPose> markers;
+	size_t detections = 0;
+
+	// before: detector, matrices and object points rebuilt for every frame
+	auto t1 = Clock::now();
+	for (int it = 0; it < iterations; it++)
+	{
+		for (const cv::Mat& frame : frames)
+		{
+			ArUcoDetectorSession perFrame;
+			perFrame.Configure(dictId, markerLength);
+			perFrame.SetCameraIntrinsics(intrinsics);
+			perFrame.Process(frame, markers);
+			detections += markers.size();
+		}
+	}
+	auto t2 = Clock::now();
+
+	// after: one session, only detection and pose estimation per frame
+	ArUcoDetectorSession session;
+	session.Configure(dictId, markerLength);
+	session.SetCameraIntrinsics(intrinsics);
+	for (int it = 0; it < iterations; it++)
+	{
+		for (const cv::Mat& frame : frames)
+		{
+			session.Configure(dictId, markerLength);
+			session.SetCameraIntrinsics(intrinsics);
+			session.Process(frame, markers);
+			detections += markers.size();
+		}
+	}
+	auto t3 = Clock::now();
+
+	double n = double(frames.size()) * iterations;
+	double rebuildUs = std::chrono::duration<double, std::micro>(t2 - t1).count() / n;
+	double sessionUs = std::chrono::duration<double, std::micro>(t3 - t2).count() / n;
+
+	std::printf("frames: %zu x %d iterations, detections: %zu\n", frames.size(), iterations, detections);
+	std::printf("rebuild per frame: %10.1f us/frame\n", rebuildUs);
+	std::printf("persistent session: %9.1f us/frame\n", sessionUs);
+	std::printf("speedup: %.2fx\n", rebuildUs / sessionUs);
+	return 0;
+}
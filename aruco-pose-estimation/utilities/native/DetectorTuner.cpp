@@ -0,0 +1,360 @@
+// Finds the fastest detector parameters that still find the markers of a
+// recorded session (LF, RF & PV images as written by TCPServer.py). Every frame
+// is first detected with a permissive reference configuration: many threshold
+// windows, small markers allowed, subpixel corners. Candidate configurations
+// are then timed over the same frames and scored by their recall of the
+// reference markers (same id, center within 4 px) & their mean corner offset.
+//
+// The search is a coordinate descent from OpenCV's defaults over the threshold
+// windows, threshold constant, perimeter range, polygon accuracy and corner
+// refinement: per group the fastest value reaching the target recall is kept,
+// until a pass changes nothing. Detection runs on a bare ArucoDetector per
+// frame, region tracking & the pyramid of ArUcoDetectorSession would hide the
+// cost of a configuration.
+//
+// Every evaluated configuration is written as CSV, the chosen one & its
+// speedup over the defaults are printed along with the ConfigureDetector
+// arguments (and the DetectorSettings fields of the Unity scripts).
+//
+// Build on Linux (one command):
+//   g++ -O2 -std=c++17 -I../../projects/common -o DetectorTuner DetectorTuner.cpp
+//       ../../projects/common/ArUcoDetectorSession.cpp ../../projects/common/UndistortionTable.cpp
+//       ../../projects/common/SessionReplaySource.cpp ../../projects/common/FileFrameSource.cpp
+//       ../../projects/common/SessionRecording.cpp $(pkg-config --cflags --libs opencv4)
+//
+// Usage:
+//   ./DetectorTuner <session dir> [dictId] [target recall] [max frames] [repeats] > configs.csv
+// Exits with 1 if the session holds no frames, the reference finds no marker
+// or no configuration reaches the target recall.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "ArUcoDetectorSession.h"
+#include "SessionReplaySource.h"
+
+using namespace HoloLens2CV;
+using Clock = std::chrono::steady_clock;
+
+static const char* kCameraNames[] = { "LF", "RF", "PV" };
+static const char* kRefinementNames[] = { "none", "subpix", "contour", "apriltag" };
+
+struct Detection
+{
+	int id;
+	cv::Point2f corners[4];
+	cv::Point2f center;
+};
+
+struct Score
+{
+	double recall = 0.0;            // reference markers found
+	double cornerPx = 0.0;          // mean corner offset of the found ones
+	int extra = 0;                  // detections the reference does not have
+	double microseconds = 0.0;      // per frame, best of the repeats
+};
+
+static std::vector<Detection> Detect(cv::aruco::ArucoDetector& detector, const cv::Mat& image)
+{
+	std::vector<std::vector<cv::Point2f>> corners;
+	std::vector<int> ids;
+	detector.detectMarkers(image, corners, ids);
+
+	std::vector<Detection> detections(ids.size());
+	for (size_t i = 0; i < ids.size(); i++)
+	{
+		detections[i].id = ids[i];
+		detections[i].center = cv::Point2f(0.f, 0.f);
+		for (int c = 0; c < 4; c++)
+		{
+			detections[i].corners[c] = corners[i][c];
+			detections[i].center += corners[i][c] * 0.25f;
+		}
+	}
+	return detections;
+}
+
+static double Distance(const cv::Point2f& a, const cv::Point2f& b)
+{
+	cv::Point2f d = a - b;
+	return std::sqrt(double(d.x) * d.x + double(d.y) * d.y);
+}
+
+// one line of the CSV & the key of the evaluated configurations
+static std::string Describe(const DetectionSettings& s)
+{
+	char text[160];
+	std::snprintf(text, sizeof(text), "%d,%d,%d,%g,%g,%g,%g,%s", s.thresholdWindowMin, s.thresholdWindowMax,
+		s.thresholdWindowStep, s.thresholdConstant, s.minPerimeterRate, s.maxPerimeterRate, s.polygonAccuracyRate,
+		kRefinementNames[int(s.cornerRefinement)]);
+	return text;
+}
+
+class Tuner
+{
+public:
+	Tuner(const std::vector<cv::Mat>& frames, int dictId, int repeats)
+		: m_frames(frames), m_dictionary(cv::aruco::getPredefinedDictionary(dictId)), m_repeats(repeats)
+	{
+	}
+
+	void SetReference(const DetectionSettings& settings)
+	{
+		cv::aruco::ArucoDetector detector(m_dictionary, settings.ToDetectorParameters());
+		m_reference.clear();
+		m_markers = 0;
+		for (const cv::Mat& frame : m_frames)
+		{
+			m_reference.push_back(Detect(detector, frame));
+			m_markers += m_reference.back().size();
+		}
+	}
+
+	size_t ReferenceMarkers() const { return m_markers; }
+
+	// cached, the descent comes back to the same configurations
+	const Score& Evaluate(const DetectionSettings& settings)
+	{
+		std::string key = Describe(settings);
+		auto known = m_scores.find(key);
+		if (known != m_scores.end())
+		{
+			return known->second;
+		}
+
+		cv::aruco::ArucoDetector detector(m_dictionary, settings.ToDetectorParameters());
+		std::vector<std::vector<Detection>> results(m_frames.size());
+		double best = 0.0;
+		for (int r = 0; r < m_repeats; r++)
+		{
+			auto t1 = Clock::now();
+			for (size_t f = 0; f < m_frames.size(); f++)
+			{
+				results[f] = Detect(detector, m_frames[f]);
+			}
+			double elapsed = std::chrono::duration<double, std::micro>(Clock::now() - t1).count();
+			best = r == 0 ? elapsed : std::min(best, elapsed);
+		}
+
+		Score score;
+		score.microseconds = best / std::max<size_t>(1, m_frames.size());
+		size_t found = 0;
+		double cornerSum = 0.0;
+		for (size_t f = 0; f < m_frames.size(); f++)
+		{
+			std::vector<bool> used(results[f].size(), false);
+			for (const Detection& expected : m_reference[f])
+			{
+				// nearest unused detection of the same id
+				int match = -1;
+				double nearest = 4.0;
+				for (size_t d = 0; d < results[f].size(); d++)
+				{
+					double distance = Distance(results[f][d].center, expected.center);
+					if (!used[d] && results[f][d].id == expected.id && distance < nearest)
+					{
+						match = int(d);
+						nearest = distance;
+					}
+				}
+				if (match < 0)
+				{
+					continue;
+				}
+				used[match] = true;
+				found++;
+				for (int c = 0; c < 4; c++)
+				{
+					cornerSum += Distance(results[f][match].corners[c], expected.corners[c]) * 0.25;
+				}
+			}
+			score.extra += int(std::count(used.begin(), used.end(), false));
+		}
+		score.recall = m_markers > 0 ? double(found) / double(m_markers) : 1.0;
+		score.cornerPx = found > 0 ? cornerSum / double(found) : 0.0;
+
+		std::printf("%s,%.4f,%.3f,%d,%.1f\n", key.c_str(), score.recall, score.cornerPx, score.extra, score.microseconds);
+		return m_scores.emplace(key, score).first->second;
+	}
+
+private:
+	const std::vector<cv::Mat>& m_frames;
+	cv::aruco::Dictionary m_dictionary;
+	int m_repeats;
+	std::vector<std::vector<Detection>> m_reference;
+	size_t m_markers = 0;
+	std::map<std::string, Score> m_scores;
+};
+
+// the variations of one group of parameters around the current configuration
+static std::vector<DetectionSettings> Group(int group, const DetectionSettings& current)
+{
+	std::vector<DetectionSettings> candidates;
+	DetectionSettings s = current;
+	switch (group)
+	{
+	case 0:
+		// fewer & smaller windows are the largest saving, each one is a threshold & contour pass
+		for (int min : { 3, 5, 7, 9, 13 })
+		{
+			for (int step : { 4, 6, 10, 14 })
+			{
+				// one window is the same for any step
+				for (int windows = step == 4 ? 1 : 2; windows <= 3; windows++)
+				{
+					s.thresholdWindowMin = min;
+					s.thresholdWindowStep = step;
+					s.thresholdWindowMax = min + step * (windows - 1);
+					candidates.push_back(s);
+				}
+			}
+		}
+		break;
+	case 1:
+		for (double constant : { 5.0, 7.0, 9.0, 12.0 })
+		{
+			s.thresholdConstant = constant;
+			candidates.push_back(s);
+		}
+		break;
+	case 2:
+		for (double rate : { 0.01, 0.02, 0.03, 0.05, 0.08 })
+		{
+			s.minPerimeterRate = rate;
+			candidates.push_back(s);
+		}
+		break;
+	case 3:
+		for (double rate : { 1.0, 2.0, 4.0 })
+		{
+			s.maxPerimeterRate = rate;
+			candidates.push_back(s);
+		}
+		break;
+	case 4:
+		for (double rate : { 0.02, 0.03, 0.05, 0.08 })
+		{
+			s.polygonAccuracyRate = rate;
+			candidates.push_back(s);
+		}
+		break;
+	case 5:
+		for (CornerRefinement refinement : { CornerRefinement::None, CornerRefinement::Subpix })
+		{
+			s.cornerRefinement = refinement;
+			candidates.push_back(s);
+		}
+		break;
+	}
+	return candidates;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::fprintf(stderr, "usage: %s <session dir> [dictId] [target recall] [max frames] [repeats]\n", argv[0]);
+		return 1;
+	}
+	const int dictId = argc > 2 ? std::atoi(argv[2]) : 0;
+	const double target = argc > 3 ? std::atof(argv[3]) : 0.99;
+	const size_t maxFrames = size_t(std::max(1, argc > 4 ? std::atoi(argv[4]) : 300));
+	const int repeats = std::max(1, argc > 5 ? std::atoi(argv[5]) : 3);
+
+	// every n-th frame so the whole session is covered, kept in memory so file reads are not timed
+	ReplaySettings replay;
+	replay.pacing = ReplayPacing::Max;
+	SessionReplaySource source(argv[1], replay);
+	const size_t stride = std::max<size_t>(1, (source.Count() + maxFrames - 1) / maxFrames);
+	std::vector<cv::Mat> frames;
+	size_t perCamera[3] = { 0, 0, 0 };
+	int camera = 0;
+	CameraFrame frame;
+	for (size_t i = 0; source.Next(camera, frame) && frames.size() < maxFrames; i++)
+	{
+		if (i % stride == 0 && frame.width > 0 && frame.height > 0)
+		{
+			frames.push_back(cv::Mat(frame.height, frame.width, CV_8U, frame.image.data()).clone());
+			perCamera[camera]++;
+		}
+	}
+	if (frames.empty())
+	{
+		std::fprintf(stderr, "no frames in %s\n", argv[1]);
+		return 1;
+	}
+	std::fprintf(stderr, "%zu frames (%s %zu, %s %zu, %s %zu), dictionary %d, target recall %.3f\n", frames.size(),
+		kCameraNames[0], perCamera[0], kCameraNames[1], perCamera[1], kCameraNames[2], perCamera[2], dictId, target);
+
+	// wider than any candidate, what the tuned detector is measured against
+	DetectionSettings reference;
+	reference.thresholdWindowMin = 3;
+	reference.thresholdWindowMax = 33;
+	reference.thresholdWindowStep = 5;
+	reference.minPerimeterRate = 0.01;
+	reference.polygonAccuracyRate = 0.05;
+	reference.cornerRefinement = CornerRefinement::Subpix;
+
+	Tuner tuner(frames, dictId, repeats);
+	tuner.SetReference(reference);
+	std::fprintf(stderr, "reference finds %zu markers\n", tuner.ReferenceMarkers());
+	if (tuner.ReferenceMarkers() == 0)
+	{
+		return 1;
+	}
+
+	std::printf("window_min,window_max,window_step,constant,min_perimeter,max_perimeter,polygon,refinement,recall,corner_px,extra,us_per_frame\n");
+	const DetectionSettings defaults;
+	const Score base = tuner.Evaluate(defaults);
+
+	DetectionSettings best = defaults;
+	Score bestScore = base;
+	bool reached = base.recall >= target;
+	for (int pass = 0; pass < 4; pass++)
+	{
+		bool changed = false;
+		for (int group = 0; group < 6; group++)
+		{
+			for (const DetectionSettings& candidate : Group(group, best))
+			{
+				const Score& score = tuner.Evaluate(candidate);
+				// once a configuration reaches the target only faster ones that do too replace it,
+				// until then the one closest to it
+				bool better = reached ? score.recall >= target && score.microseconds < bestScore.microseconds :
+					score.recall > bestScore.recall;
+				if (better && candidate != best)
+				{
+					best = candidate;
+					bestScore = score;
+					reached = score.recall >= target;
+					changed = true;
+				}
+			}
+		}
+		if (!changed)
+		{
+			break;
+		}
+	}
+
+	std::fprintf(stderr, "defaults: %s, recall %.4f, %.1f us per frame\n", Describe(defaults).c_str(), base.recall, base.microseconds);
+	std::fprintf(stderr, "fastest:  %s, recall %.4f, corners %.3f px, %.1f us per frame, %.2fx the defaults\n",
+		Describe(best).c_str(), bestScore.recall, bestScore.cornerPx, bestScore.microseconds,
+		bestScore.microseconds > 0.0 ? base.microseconds / bestScore.microseconds : 0.0);
+	std::fprintf(stderr, "ConfigureDetector(%d, %d, %d, %gf, %gf, %gf, %gf, %d)\n", best.thresholdWindowMin, best.thresholdWindowMax,
+		best.thresholdWindowStep, best.thresholdConstant, best.minPerimeterRate, best.maxPerimeterRate,
+		best.polygonAccuracyRate, int(best.cornerRefinement));
+
+	if (!reached)
+	{
+		std::fprintf(stderr, "no configuration reaches recall %.3f\n", target);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,135 @@
+// Replays synthetic 30 Hz LF/RF streams through the stereo frame pairing.
+// Both cameras see the same exposures with a little host tick jitter, single
+// frames of either camera go missing, and the two streams are delivered with
+// a random lag between them, like consecutive GetNextBuffer calls do. Every
+// pair must hold the same exposure on both sides, every exposure delivered by
+// both cameras must be paired, and no frame may be lost or handed on twice.
+//
+// Build on Linux (one command):
+//   g++ -O2 -std=c++17 -I../../projects/common -o FramePairingStress FramePairingStress.cpp
+//       ../../projects/common/StereoFramePairer.cpp
+//
+// Usage:
+//   ./FramePairingStress [frames] [drop probability]
+// Exits with 1 if a check failed.
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "StereoFramePairer.h"
+
+using namespace HoloLens2CV;
+
+static const int64_t kFrameTicks = 333333;      // 30 Hz in 100 ns ticks
+
+int main(int argc, char** argv)
+{
+	const int frames = argc > 1 ? std::atoi(argv[1]) : 100000;
+	const double dropProbability = argc > 2 ? std::strtod(argv[2], nullptr) : 0.02;
+
+	bool ok = true;
+	for (UnpairedPolicy policy : { UnpairedPolicy::Drop, UnpairedPolicy::Mono })
+	{
+		PairingSettings settings;
+		settings.policy = policy;
+		StereoFramePairer pairer;
+		pairer.Configure(settings);
+
+		std::mt19937 rng(11);
+		std::uniform_int_distribution<int> jitter(-2000, 2000);     // +-0.2 ms
+		std::uniform_int_distribution<int> lag(0, settings.depth - 1);
+		std::bernoulli_distribution drop(dropProbability);
+
+		// exposures captured per camera, the exposure index travels in the timestamp
+		std::vector<CameraFrame> captured[2];
+		std::vector<char> both(frames, 0);
+		for (int i = 0; i < frames; i++)
+		{
+			bool seen[2] = { !drop(rng), !drop(rng) };
+			for (int camera = 0; camera < 2; camera++)
+			{
+				if (seen[camera])
+				{
+					CameraFrame frame;
+					frame.hostTicks = uint64_t(1000000000 + i * kFrameTicks + jitter(rng));
+					frame.timestamp = i;
+					frame.image.assign(640 * 480 / 64, uint8_t(i));
+					captured[camera].push_back(std::move(frame));
+				}
+			}
+			both[i] = seen[0] && seen[1];
+		}
+
+		// deliver both streams in order per camera, one of them running up to depth - 1 exposures ahead
+		int64_t pushed = 0, paired = 0, mono = 0, wrong = 0, missed = 0;
+		std::vector<char> handed(size_t(frames) * 2, 0);
+		size_t next[2] = { 0, 0 };
+		FrontCamerasFrame out;
+		CameraFrame scratch;
+		auto drain = [&]()
+		{
+			while (pairer.Pop(out))
+			{
+				if (out.hasLF && out.hasRF)
+				{
+					paired++;
+					if (out.LF.timestamp != out.RF.timestamp || std::llabs(out.skew) > settings.tolerance)
+					{
+						wrong++;
+					}
+				}
+				else
+				{
+					mono++;
+				}
+				for (int camera = 0; camera < 2; camera++)
+				{
+					const CameraFrame& frame = camera == 0 ? out.LF : out.RF;
+					if ((camera == 0 ? out.hasLF : out.hasRF) && handed[size_t(frame.timestamp) * 2 + camera]++)
+					{
+						wrong++;        // handed on twice
+					}
+				}
+			}
+		};
+		for (int64_t t = 0; t < frames + settings.depth; t++)
+		{
+			int ahead = std::uniform_int_distribution<int>(0, 1)(rng);
+			int64_t until[2];
+			until[ahead] = t;
+			until[1 - ahead] = t - lag(rng);
+			for (int camera : { ahead, 1 - ahead })
+			{
+				while (next[camera] < captured[camera].size() && captured[camera][next[camera]].timestamp <= until[camera])
+				{
+					scratch = captured[camera][next[camera]++];
+					pairer.Push(camera, scratch);
+					pushed++;
+				}
+			}
+			drain();
+		}
+
+		for (int i = 0; i < frames; i++)
+		{
+			if (both[i] && !(handed[size_t(i) * 2] && handed[size_t(i) * 2 + 1]))
+			{
+				missed++;
+			}
+		}
+
+		PairingStats stats = pairer.GetStats();
+		// the last few frames may still wait for a partner
+		int64_t handedOn = stats.paired * 2 + stats.mono + stats.dropped;
+		bool conserved = handedOn <= pushed && pushed - handedOn <= 2 * settings.depth &&
+			(policy == UnpairedPolicy::Drop || stats.dropped == 0) && stats.paired == paired && stats.mono == mono;
+		std::printf("%s: pushed %lld, pairs %lld, mono %lld, dropped %lld, max skew %.2f ms, wrong %lld, missed pairs %lld\n",
+			policy == UnpairedPolicy::Drop ? "drop" : "mono",
+			(long long)pushed, (long long)stats.paired, (long long)stats.mono, (long long)stats.dropped,
+			stats.maxSkew / 10000.0, (long long)wrong, (long long)missed);
+		ok = ok && conserved && wrong == 0 && missed == 0;
+	}
+	return ok ? 0 : 1;
+}
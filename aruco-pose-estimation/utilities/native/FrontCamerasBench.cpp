@@ -0,0 +1,104 @@
+// Feeds recorded left front / right front image pairs through the serial
+// (LF then RF on one thread) and the concurrent FrontCamerasDetector paths and
+// reports the per-pair latency and the merged, camera tagged detections.
+// Pairs are formed from the n-th LF and n-th RF image, ordered by time stamp.
+//
+// Build on Linux (one command):
+//   g++ -O2 -std=c++17 -pthread -I../../projects/common -o FrontCamerasBench FrontCamerasBench.cpp
+//       ../../projects/common/ArUcoDetectorSession.cpp ../../projects/common/UndistortionTable.cpp ../../projects/common/FrontCamerasDetector.cpp
+//       ../../projects/common/FileFrameSource.cpp $(pkg-config --cflags --libs opencv4)
+//
+// Usage (both VLC cameras use the same intrinsics here):
+//   ./FrontCamerasBench <LF dir> <RF dir> <fx> <fy> <cx> <cy> [dictId] [markerLength]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "ArUcoDetectorSession.h"
+#include "FileFrameSource.h"
+#include "FrontCamerasDetector.h"
+
+using namespace HoloLens2CV;
+using Clock = std::chrono::steady_clock;
+
+static std::vector<cv::Mat> LoadFrames(const char* directory)
+{
+	FileFrameSource source(directory);
+	std::vector<cv::Mat> frames;
+	cv::Mat gray;
+	int64_t ts;
+	while (source.Next(gray, ts))
+	{
+		frames.push_back(gray.clone());
+	}
+	return frames;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 7)
+	{
+		std::fprintf(stderr, "usage: %s <LF dir> <RF dir> <fx> <fy> <cx> <cy> [dictId] [markerLength]\n", argv[0]);
+		return 1;
+	}
+
+	CameraIntrinsics intrinsics;
+	intrinsics.fx = std::strtof(argv[3], nullptr);
+	intrinsics.fy = std::strtof(argv[4], nullptr);
+	intrinsics.cx = std::strtof(argv[5], nullptr);
+	intrinsics.cy = std::strtof(argv[6], nullptr);
+	int dictId = argc > 7 ? std::atoi(argv[7]) : 0;
+	float markerLength = argc > 8 ? std::strtof(argv[8], nullptr) : 0.05f;
+
+	std::vector<cv::Mat> LFFrames = LoadFrames(argv[1]);
+	std::vector<cv::Mat> RFFrames = LoadFrames(argv[2]);
+	size_t pairs = std::min(LFFrames.size(), RFFrames.size());
+	if (pairs == 0)
+	{
+		std::fprintf(stderr, "no LF/RF frame pairs found\n");
+		return 1;
+	}
+
+	ArUcoDetectorSession LFDetector(LeftFrontCamera);
+	ArUcoDetectorSession RFDetector(RightFrontCamera);
+	for (ArUcoDetectorSession* detector : { &LFDetector, &RFDetector })
+	{
+		detector->Configure(dictId, markerLength);
+		detector->SetCameraIntrinsics(intrinsics);
+	}
+	FrontCamerasDetector frontCamerasDetector(LFDetector, RFDetector);
+
+	std::vector<MarkerPose> LFMarkers, RFMarkers, merged;
+
+	// serial: both cameras on the calling thread
+	auto t1 = Clock::now();
+	for (size_t i = 0; i < pairs; i++)
+	{
+		LFDetector.Process(LFFrames[i], LFMarkers);
+		RFDetector.Process(RFFrames[i], RFMarkers);
+	}
+	auto t2 = Clock::now();
+
+	// concurrent: LF on the worker, RF on the calling thread, merged result
+	size_t seen[2] = { 0, 0 };
+	for (size_t i = 0; i < pairs; i++)
+	{
+		frontCamerasDetector.Process(LFFrames[i], RFFrames[i], merged);
+		for (const MarkerPose& marker : merged)
+		{
+			seen[marker.camera == RightFrontCamera ? 1 : 0]++;
+		}
+	}
+	auto t3 = Clock::now();
+
+	double serialUs = std::chrono::duration<double, std::micro>(t2 - t1).count() / pairs;
+	double concurrentUs = std::chrono::duration<double, std::micro>(t3 - t2).count() / pairs;
+
+	std::printf("pairs: %zu, merged detections: %zu LF + %zu RF\n", pairs, seen[0], seen[1]);
+	std::printf("serial:     %10.1f us/pair\n", serialUs);
+	std::printf("concurrent: %10.1f us/pair\n", concurrentUs);
+	return 0;
+}
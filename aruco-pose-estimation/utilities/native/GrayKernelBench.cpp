@@ -0,0 +1,140 @@
+// Times the fused BGRA to gray & decimation kernels against the cvtColor +
+// resize (INTER_AREA) pair they replace, at the PV resolutions and factors 1,
+// 2 and 4. Every kernel supported by the CPU is run and checked first: all
+// must equal the scalar reference bit by bit, at factor 1 cvtColor too, and
+// decimated they may differ from the two OpenCV passes by one gray level (the
+// block mean is rounded once instead of twice). Odd sizes & padded rows check
+// the tails.
+//
+// Build on Linux (one command):
+//   g++ -O2 -std=c++17 -I../../projects/common -o GrayKernelBench GrayKernelBench.cpp
+//       ../../projects/common/GrayConversion.cpp $(pkg-config --cflags --libs opencv4)
+//
+// Usage:
+//   ./GrayKernelBench [iterations] > kernels.csv
+// Exits with 1 if a kernel differs from the reference or from OpenCV.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "GrayConversion.h"
+
+using namespace HoloLens2CV;
+using Clock = std::chrono::steady_clock;
+
+static const GrayKernel kKernels[] = { GrayKernel::Scalar, GrayKernel::Sse2, GrayKernel::Avx2, GrayKernel::Neon };
+
+// the two OpenCV passes, factor 1 is the conversion alone
+static void OpenCVGray(const cv::Mat& bgra, cv::Mat& gray, cv::Mat& small, int factor)
+{
+	cv::cvtColor(bgra, gray, cv::COLOR_BGRA2GRAY);
+	if (factor > 1)
+	{
+		cv::resize(gray, small, cv::Size(bgra.cols / factor, bgra.rows / factor), 0, 0, cv::INTER_AREA);
+	}
+}
+
+static cv::Mat Kernel(const cv::Mat& bgra, int factor, GrayKernel kernel)
+{
+	cv::Mat gray(bgra.rows / factor, bgra.cols / factor, CV_8U, cv::Scalar(0));
+	BgraToGray(bgra.data, bgra.step, bgra.cols, bgra.rows, gray.data, gray.step, factor, kernel);
+	return gray;
+}
+
+static double Median(std::vector<double>& samples)
+{
+	std::sort(samples.begin(), samples.end());
+	return samples[samples.size() / 2];
+}
+
+// random pixels, so every rounding case is hit
+static cv::Mat RandomBgra(int width, int height, int padding)
+{
+	cv::Mat padded(height, width + padding, CV_8UC4);
+	cv::randu(padded, cv::Scalar::all(0), cv::Scalar::all(256));
+	return padded(cv::Rect(0, 0, width, height));
+}
+
+int main(int argc, char** argv)
+{
+	const int iterations = std::max(1, argc > 1 ? std::atoi(argv[1]) : 100);
+	bool ok = true;
+
+	std::vector<GrayKernel> kernels;
+	for (GrayKernel kernel : kKernels)
+	{
+		if (IsGrayKernelSupported(kernel))
+		{
+			kernels.push_back(kernel);
+		}
+	}
+	std::fprintf(stderr, "best kernel %s\n", GrayKernelName(BestGrayKernel()));
+
+	// exactness, including tails shorter than a vector & rows with padding
+	cv::Mat gray, small;
+	for (cv::Size size : { cv::Size(1, 1), cv::Size(7, 5), cv::Size(33, 9), cv::Size(127, 65), cv::Size(896, 504) })
+	{
+		cv::Mat bgra = RandomBgra(size.width, size.height, 3);
+		for (int factor : { 1, 2, 4 })
+		{
+			if (size.width < factor || size.height < factor)
+			{
+				continue;
+			}
+			cv::Mat reference = Kernel(bgra, factor, GrayKernel::Scalar);
+			for (GrayKernel kernel : kernels)
+			{
+				ok = ok && cv::norm(Kernel(bgra, factor, kernel), reference, cv::NORM_INF) == 0.0;
+			}
+
+			// OpenCV's INTER_AREA only averages whole blocks when the size divides
+			if (size.width % factor == 0 && size.height % factor == 0)
+			{
+				OpenCVGray(bgra, gray, small, factor);
+				double difference = cv::norm(reference, factor == 1 ? gray : small, cv::NORM_INF);
+				ok = ok && difference <= (factor == 1 ? 0.0 : 1.0);
+			}
+		}
+	}
+	std::fprintf(stderr, "kernels match the reference & OpenCV: %s\n", ok ? "ok" : "FAILED");
+
+	std::printf("resolution,factor,implementation,median_us,speedup\n");
+	for (cv::Size size : { cv::Size(896, 504), cv::Size(1280, 720), cv::Size(1920, 1080) })
+	{
+		cv::Mat bgra = RandomBgra(size.width, size.height, 0);
+		for (int factor : { 1, 2, 4 })
+		{
+			std::vector<double> samples;
+			for (int i = 0; i < iterations; i++)
+			{
+				auto t1 = Clock::now();
+				OpenCVGray(bgra, gray, small, factor);
+				samples.push_back(std::chrono::duration<double, std::micro>(Clock::now() - t1).count());
+			}
+			double opencv = Median(samples);
+			std::printf("%dx%d,%d,cvtColor+resize,%.1f,1.00\n", size.width, size.height, factor, opencv);
+
+			cv::Mat out(size.height / factor, size.width / factor, CV_8U);
+			for (GrayKernel kernel : kernels)
+			{
+				samples.clear();
+				for (int i = 0; i < iterations; i++)
+				{
+					auto t1 = Clock::now();
+					BgraToGray(bgra.data, bgra.step, bgra.cols, bgra.rows, out.data, out.step, factor, kernel);
+					samples.push_back(std::chrono::duration<double, std::micro>(Clock::now() - t1).count());
+				}
+				double median = Median(samples);
+				std::printf("%dx%d,%d,%s,%.1f,%.2f\n", size.width, size.height, factor, GrayKernelName(kernel), median,
+					median > 0.0 ? opencv / median : 0.0);
+			}
+		}
+	}
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,144 @@
+// Receives the PV images, front camera image pairs (raw or compressed), marker texts & marker
+// telemetry batches the TCPClient scripts send, from any number of headsets at once, and writes them on a pool
+// of threads in the folders TCPServer.py writes (one directory per headset
+// address unless --shared), so SessionReplay & the other tools read them. With
+// --record everything goes to one session.hl2rec (SessionRecording) per
+// directory instead of a file per image.
+// Messages split over reads or sharing one are reassembled, a corrupt stream
+// closes only its headset. Prints the received & written rates every second
+// and per headset totals on exit.
+//
+// Build on Linux (one command):
+//   g++ -O2 -std=c++17 -pthread -I../../projects/common -o HeadsetIngest HeadsetIngest.cpp
+//       ../../projects/common/IngestServer.cpp ../../projects/common/IngestProtocol.cpp
+//       ../../projects/common/FrameWriterPool.cpp ../../projects/common/StereoFrameCodec.cpp
+//       ../../projects/common/SessionRecording.cpp ../../projects/common/MarkerTelemetry.cpp $(pkg-config --cflags --libs opencv4)
+//
+// Usage:
+//   ./HeadsetIngest [host] [port] [data dir] [writer threads] [--shared] [--record] [--once]
+// Runs until Ctrl+C, with --once until the last headset disconnects. Exits
+// with 1 if the address cannot be bound or a message could not be written.
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FrameWriterPool.h"
+#include "IngestServer.h"
+
+using namespace HoloLens2CV;
+using Clock = std::chrono::steady_clock;
+
+static std::atomic_bool g_interrupted = false;
+
+static void OnSignal(int)
+{
+	g_interrupted = true;
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> arguments;
+	bool shared = false, record = false, once = false;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--shared") == 0)
+		{
+			shared = true;
+		}
+		else if (std::strcmp(argv[i], "--record") == 0)
+		{
+			record = true;
+		}
+		else if (std::strcmp(argv[i], "--once") == 0)
+		{
+			once = true;
+		}
+		else
+		{
+			arguments.push_back(argv[i]);
+		}
+	}
+
+	IngestServerSettings settings;
+	settings.host = arguments.size() > 0 ? arguments[0] : "0.0.0.0";
+	settings.port = arguments.size() > 1 ? std::atoi(arguments[1].c_str()) : 9090;
+
+	WriterSettings writing;
+	writing.directory = arguments.size() > 2 ? arguments[2] : "data";
+	writing.threads = arguments.size() > 3 ? std::atoi(arguments[3].c_str()) : 4;
+	writing.perHeadsetDirectories = !shared;
+	writing.recording = record;
+
+	FrameWriterPool writer;
+	writer.Start(writing);
+
+	IngestServer server;
+	server.SetConnectionCallback([](int connection, const std::string& peer, const std::string& event)
+		{
+			std::fprintf(stderr, "headset %d (%s): %s\n", connection, peer.c_str(), event.c_str());
+		});
+	server.SetMessageCallback([&writer](int, const std::string& peer, IngestMessage&& message)
+		{
+			writer.Submit(peer, std::move(message));
+		});
+	if (!server.Start(settings))
+	{
+		std::fprintf(stderr, "cannot listen on %s:%d, %s\n", settings.host.c_str(), settings.port, server.LastError().c_str());
+		return 1;
+	}
+	std::fprintf(stderr, "listening on %s:%d, writing to %s with %d threads\n", settings.host.c_str(), server.Port(),
+		writing.directory.c_str(), writing.threads);
+
+	std::signal(SIGINT, OnSignal);
+	std::signal(SIGTERM, OnSignal);
+
+	int64_t lastBytes = 0, lastWritten = 0;
+	auto last = Clock::now();
+	while (!g_interrupted && !(once && server.Accepted() > 0 && server.OpenConnections() == 0))
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		if (Clock::now() - last < std::chrono::seconds(1))
+		{
+			continue;
+		}
+
+		int64_t bytes = 0;
+		for (const IngestConnectionStats& stats : server.Stats())
+		{
+			bytes += stats.bytes;
+		}
+		WriterStats written = writer.Stats();
+		double seconds = std::chrono::duration<double>(Clock::now() - last).count();
+		std::fprintf(stderr, "%d headsets, %.1f MB/s received, %.1f messages/s written, %lld failed, queue max %d, blocked %.0f ms\n",
+			server.OpenConnections(), (bytes - lastBytes) / seconds / 1e6, (written.written - lastWritten) / seconds,
+			(long long)written.failed, written.maxDepth, written.blockedMs);
+		lastBytes = bytes;
+		lastWritten = written.written;
+		last = Clock::now();
+	}
+
+	// what was received is written before exiting
+	server.Stop();
+	writer.Flush();
+	writer.Stop();
+
+	std::printf("headset,peer,pv_images,spatial_images,compressed_spatial_images,marker_texts,marker_telemetry,bytes,reads,closed\n");
+	for (const IngestConnectionStats& stats : server.Stats())
+	{
+		std::printf("%d,%s,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%s\n", stats.id, stats.peer.c_str(), (long long)stats.pvImages,
+			(long long)stats.spatialImages, (long long)stats.compressedSpatialImages, (long long)stats.markerTexts,
+			(long long)stats.markerTelemetry, (long long)stats.bytes, (long long)stats.reads,
+			stats.closeReason.c_str());
+	}
+	WriterStats written = writer.Stats();
+	std::fprintf(stderr, "%lld messages written (%.1f MB), %lld failed\n", (long long)written.written, written.bytes / 1e6,
+		(long long)written.failed);
+	return written.failed > 0 ? 1 : 0;
+}
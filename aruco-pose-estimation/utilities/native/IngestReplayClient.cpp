@@ -0,0 +1,558 @@
+// Sends 'p', 'f', 'c', 'm' & 't' messages like the TCPClient scripts, over several
+// connections standing in for headsets. Writes are cut at random sizes and
+// often hold more than one message, the way TCP may deliver them.
+//
+// With a session directory, the recorded LF/RF images are sent as 'f' pairs &
+// the PV images as 'p' BGRA frames, at the recorded pace or as fast as
+// possible (speed 0), to HeadsetIngest or any server speaking the protocol.
+// With --compress the pairs go out as 'c' messages, lossless or within the
+// given max error.
+//
+// With --loopback, HeadsetIngest's server & writer pool run in this process on
+// a free loopback port and synthetic messages are sent. Every message must
+// arrive once, in order & unchanged, the written images must read back equal
+// to the sent ones (compressed pairs decoded), and the marker texts must all be in markers.txt &
+// the telemetry batches in telemetry.bin. A stream
+// with an unknown message type and one ending inside a message must close
+// only their own connection.
+//
+// Build on Linux (one command):
+//   g++ -O2 -std=c++17 -pthread -I../../projects/common -o IngestReplayClient IngestReplayClient.cpp
+//       ../../projects/common/IngestServer.cpp ../../projects/common/IngestProtocol.cpp
+//       ../../projects/common/FrameWriterPool.cpp ../../projects/common/SessionReplaySource.cpp
+//       ../../projects/common/FileFrameSource.cpp ../../projects/common/StereoFrameCodec.cpp
+//       ../../projects/common/SessionRecording.cpp ../../projects/common/MarkerTelemetry.cpp $(pkg-config --cflags --libs opencv4)
+//
+// Usage:
+//   ./IngestReplayClient <host> <port> <session dir> [headsets] [speed] [--compress [max error]]
+//   ./IngestReplayClient --loopback [messages per headset] [headsets]
+// Exits with 1 if a connection fails, or in loopback mode a message is lost,
+// altered or reordered, an image reads back different or a bad stream is not
+// closed with the right reason.
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "FrameWriterPool.h"
+#include "IngestServer.h"
+#include "MarkerTelemetry.h"
+#include "SessionReplaySource.h"
+#include "StereoFrameCodec.h"
+
+using namespace HoloLens2CV;
+using Clock = std::chrono::steady_clock;
+
+static int Connect(const std::string& host, int port)
+{
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_port = htons(uint16_t(port));
+	if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1)
+	{
+		return -1;
+	}
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+	{
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+// encodes messages into a buffer & sends it in chunks of random size, sometimes after
+// several messages were appended
+class ChunkedSender
+{
+public:
+	ChunkedSender(int fd, uint32_t seed) : m_fd(fd), m_random(seed) {}
+
+	bool Send(const IngestMessage& message)
+	{
+		EncodeIngestMessage(message, m_pending);
+		return m_random() % 3 == 0 || Flush();
+	}
+
+	bool Flush()
+	{
+		size_t sent = 0;
+		while (sent < m_pending.size())
+		{
+			// mostly large writes, some tiny ones that end inside headers
+			size_t chunk = m_random() % 4 == 0 ? 1 + m_random() % 16 : 1 + m_random() % (256 * 1024);
+			if (!SendAll(m_pending.data() + sent, std::min(chunk, m_pending.size() - sent)))
+			{
+				return false;
+			}
+			sent += std::min(chunk, m_pending.size() - sent);
+		}
+		m_pending.clear();
+		return true;
+	}
+
+	bool SendAll(const uint8_t* data, size_t size)
+	{
+		while (size > 0)
+		{
+			ssize_t sent = send(m_fd, data, size, MSG_NOSIGNAL);
+			if (sent <= 0)
+			{
+				return false;
+			}
+			data += sent;
+			size -= size_t(sent);
+			m_bytes += sent;
+		}
+		return true;
+	}
+
+	int64_t Bytes() const { return m_bytes; }
+
+private:
+	int m_fd;
+	std::mt19937 m_random;
+	std::vector<uint8_t> m_pending;
+	int64_t m_bytes = 0;
+};
+
+static uint64_t Fnv1a(const IngestMessage& message)
+{
+	uint64_t hash = 1469598103934665603ull;
+	auto mix = [&hash](uint8_t byte) { hash = (hash ^ byte) * 1099511628211ull; };
+	mix(uint8_t(message.type));
+	for (int64_t timestamp : message.timestamps)
+	{
+		for (int i = 0; i < 8; i++)
+		{
+			mix(uint8_t(timestamp >> (8 * i)));
+		}
+	}
+	for (uint8_t byte : message.payload)
+	{
+		mix(byte);
+	}
+	return hash;
+}
+
+// message i of a headset, the same every time it is built: a hello naming the headset first,
+// then PV images, front camera pairs raw & compressed, marker texts & telemetry batches. raw gives the pairs as 'f'
+static IngestMessage Synthetic(int headset, int i, bool raw = false)
+{
+	IngestMessage message;
+	if (i == 0)
+	{
+		std::string hello = "headset " + std::to_string(headset);
+		message.payload.assign(hello.begin(), hello.end());
+		return message;
+	}
+
+	int64_t timestamp = 133000000000000000ll + int64_t(headset) * 1000000000ll + int64_t(i) * 333333;
+	std::mt19937 random(uint32_t(headset * 100003 + i));
+	switch (i % 4)
+	{
+	case 1:
+		message.type = IngestMessageType::PvImage;
+		message.timestamps[0] = timestamp;
+		message.payload.resize(896 * 504 * 4);
+		break;
+	case 2:
+	case 3:
+		message.type = IngestMessageType::SpatialImages;
+		message.timestamps[0] = timestamp;
+		message.timestamps[1] = timestamp + 1;
+		message.payload.resize(2 * 640 * 480);
+		break;
+	default:
+	{
+		if (i % 8 == 4)
+		{
+			MarkerTelemetryBatch batch;
+			batch.frameSequence = i;
+			batch.timestamp = timestamp;
+			batch.markers.resize(size_t(1 + i % 5));
+			for (size_t m = 0; m < batch.markers.size(); m++)
+			{
+				batch.markers[m].id = int32_t((i + m) % 50);
+				batch.markers[m].tvec[2] = float(i);
+				batch.markers[m].reprojectionError = 0.25f * float(m);
+			}
+			message.type = IngestMessageType::MarkerTelemetry;
+			EncodeMarkerTelemetry(batch, message.payload);
+			return message;
+		}
+		std::string text = "Marker [" + std::to_string(i % 50) + "] \ntranslation (XYZ): 0.1 0.2 " + std::to_string(i) +
+			" \nrotation (Rodrigues XYZ): 0.01 0.02 0.03";
+		message.payload.assign(text.begin(), text.end());
+		return message;
+	}
+	}
+
+	// blocks of noise, so the images are neither constant nor too slow to build
+	uint8_t value = 0;
+	for (size_t p = 0; p < message.payload.size(); p++)
+	{
+		if (p % 64 == 0)
+		{
+			value = uint8_t(random());
+		}
+		message.payload[p] = uint8_t(value + p % 7);
+	}
+
+	if (i % 4 == 3 && !raw)
+	{
+		StereoFrameCodec codec;
+		std::vector<uint8_t> encoded;
+		codec.Encode(message.payload.data(), message.payload.data() + 640 * 480, 640, 480, StereoCodecSettings(), encoded);
+		message.type = IngestMessageType::CompressedSpatialImages;
+		message.payload = std::move(encoded);
+	}
+	return message;
+}
+
+static bool ReadsBack(const std::string& path, const uint8_t* data, int width, int height, int channels)
+{
+	cv::Mat image = cv::imread(path, cv::IMREAD_UNCHANGED);
+	if (image.cols != width || image.rows != height || image.channels() != channels || image.depth() != CV_8U)
+	{
+		return false;
+	}
+	cv::Mat expected(height, width, CV_8UC(channels), const_cast<uint8_t*>(data));
+	return cv::norm(image, expected, cv::NORM_INF) == 0.0;
+}
+
+static int Loopback(int messages, int headsets)
+{
+	const std::string directory = (std::filesystem::temp_directory_path() / ("IngestReplayClient_" + std::to_string(getpid()))).string();
+	WriterSettings writing;
+	writing.directory = directory;
+	FrameWriterPool writer;
+	writer.Start(writing);
+
+	// hashes in arrival order by connection, the hello says which headset sent them
+	std::mutex mutex;
+	std::map<int, std::vector<uint64_t>> received;
+	std::map<int, int> headsetOf;
+	IngestServer server;
+	server.SetMessageCallback([&](int connection, const std::string& peer, IngestMessage&& message)
+		{
+			{
+				std::lock_guard<std::mutex> l(mutex);
+				received[connection].push_back(Fnv1a(message));
+				std::string text(message.payload.begin(), message.payload.end());
+				if (received[connection].size() == 1 && text.rfind("headset ", 0) == 0)
+				{
+					headsetOf[connection] = std::atoi(text.c_str() + 8);
+					return;
+				}
+			}
+			writer.Submit(peer, std::move(message));
+		});
+
+	IngestServerSettings settings;
+	settings.host = "127.0.0.1";
+	settings.port = 0;
+	if (!server.Start(settings))
+	{
+		std::fprintf(stderr, "cannot listen, %s\n", server.LastError().c_str());
+		return 1;
+	}
+
+	auto t1 = Clock::now();
+	std::atomic<int64_t> bytes = 0;
+	std::atomic_bool sent = true;
+	std::vector<std::thread> clients;
+	for (int h = 0; h < headsets; h++)
+	{
+		clients.emplace_back([&, h]
+			{
+				int fd = Connect(settings.host, server.Port());
+				ChunkedSender sender(fd, uint32_t(h + 1));
+				bool ok = fd >= 0;
+				for (int i = 0; i < messages && ok; i++)
+				{
+					ok = sender.Send(Synthetic(h, i));
+				}
+				ok = ok && sender.Flush();
+				sent = sent && ok;
+				bytes += sender.Bytes();
+				if (fd >= 0)
+				{
+					close(fd);
+				}
+			});
+	}
+
+	// a stream the server cannot parse and one cut inside a PV image
+	for (int bad = 0; bad < 2; bad++)
+	{
+		int fd = Connect(settings.host, server.Port());
+		ChunkedSender sender(fd, 99);
+		std::vector<uint8_t> stream;
+		EncodeIngestMessage(Synthetic(headsets, 1), stream);
+		stream.resize(bad == 0 ? 8 : stream.size() / 2);
+		if (bad == 0)
+		{
+			stream[0] = 'x';
+		}
+		sent = sent && fd >= 0 && sender.SendAll(stream.data(), stream.size());
+		if (fd >= 0)
+		{
+			close(fd);
+		}
+	}
+	for (auto& client : clients)
+	{
+		client.join();
+	}
+
+	// the server reads what is left in the sockets, then sees every connection closed
+	auto deadline = Clock::now() + std::chrono::seconds(30);
+	while ((server.Accepted() < headsets + 2 || server.OpenConnections() > 0) && Clock::now() < deadline)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+	double seconds = std::chrono::duration<double>(Clock::now() - t1).count();
+	server.Stop();
+	writer.Flush();
+	writer.Stop();
+	std::printf("%d headsets x %d messages, %.1f MB in %.2f s, %.0f MB/s\n", headsets, messages, bytes / 1e6, seconds,
+		bytes / 1e6 / seconds);
+
+	bool ok = sent;
+	std::printf("all sent: %s\n", sent ? "ok" : "FAILED");
+
+	// every headset's messages in order & unchanged
+	bool intact = int(headsetOf.size()) == headsets;
+	for (const auto& entry : headsetOf)
+	{
+		const std::vector<uint64_t>& hashes = received[entry.first];
+		intact = intact && int(hashes.size()) == messages;
+		for (int i = 0; intact && i < messages; i++)
+		{
+			intact = hashes[i] == Fnv1a(Synthetic(entry.second, i));
+		}
+	}
+	std::printf("messages intact & in order: %s\n", intact ? "ok" : "FAILED");
+	ok = ok && intact;
+
+	// the bad streams closed with their reasons, the headsets by themselves
+	int protocolErrors = 0, cut = 0, clean = 0;
+	for (const IngestConnectionStats& stats : server.Stats())
+	{
+		protocolErrors += stats.closeReason.rfind("protocol error", 0) == 0;
+		cut += stats.closeReason == "closed by the headset inside a message";
+		clean += stats.closeReason == "closed by the headset";
+	}
+	bool closed = protocolErrors == 1 && cut == 1 && clean == headsets;
+	std::printf("bad streams closed alone: %s\n", closed ? "ok" : "FAILED");
+	ok = ok && closed;
+
+	// the images as files, all headsets share the loopback address & so the directory
+	WriterStats written = writer.Stats();
+	bool files = written.failed == 0;
+	const std::string root = writer.DirectoryOf("127.0.0.1");
+	for (int h = 0; h < headsets && files; h++)
+	{
+		for (int i = 1; i < std::min(messages, 9) && files; i++)
+		{
+			IngestMessage message = Synthetic(h, i, true);
+			if (message.type == IngestMessageType::PvImage)
+			{
+				files = ReadsBack(root + "/photovideo/" + std::to_string(message.timestamps[0]) + "_PV.tiff",
+					message.payload.data(), 896, 504, 4);
+			}
+			else if (message.type == IngestMessageType::SpatialImages)
+			{
+				files = ReadsBack(root + "/leftfront/" + std::to_string(message.timestamps[0]) + "_LF.tiff",
+					message.payload.data(), 640, 480, 1) &&
+					ReadsBack(root + "/rightfront/" + std::to_string(message.timestamps[1]) + "_RF.tiff",
+						message.payload.data() + 640 * 480, 640, 480, 1);
+			}
+		}
+	}
+	int texts = 0;
+	std::ifstream markers(root + "/markers.txt");
+	for (std::string line; std::getline(markers, line);)
+	{
+		texts += line.rfind("Marker [", 0) == 0;
+	}
+	int expectedTexts = 0, expectedBatches = 0;
+	for (int i = 1; i < messages; i++)
+	{
+		expectedTexts += i % 8 == 0;
+		expectedBatches += i % 8 == 4;
+	}
+
+	// every batch decodes back to one a headset sent
+	int batches = 0;
+	std::ifstream telemetry(root + "/telemetry.bin", std::ios::binary);
+	std::vector<uint8_t> stored((std::istreambuf_iterator<char>(telemetry)), std::istreambuf_iterator<char>());
+	MarkerTelemetryBatch batch;
+	std::vector<uint8_t> encoded;
+	for (size_t at = 0, size = 0; at < stored.size() && files; at += size)
+	{
+		size = DecodeMarkerTelemetry(stored.data() + at, stored.size() - at, batch);
+		encoded.clear();
+		EncodeMarkerTelemetry(batch, encoded);
+		bool known = false;
+		for (int h = 0; h < headsets && size > 0; h++)
+		{
+			known = known || Synthetic(h, int(batch.frameSequence)).payload == encoded;
+		}
+		files = known;
+		batches++;
+	}
+	files = files && texts == expectedTexts * headsets && batches == expectedBatches * headsets;
+	std::printf("written files read back: %s (%lld written, queue max %d, blocked %.0f ms)\n", files ? "ok" : "FAILED",
+		(long long)written.written, written.maxDepth, written.blockedMs);
+	ok = ok && files;
+
+	std::error_code error;
+	std::filesystem::remove_all(directory, error);
+	return ok ? 0 : 1;
+}
+
+static int Replay(const std::string& host, int port, const std::string& session, int headsets, double speed, int maxError)
+{
+	std::atomic_bool ok = true;
+	std::atomic<int64_t> bytes = 0, messages = 0;
+	auto t1 = Clock::now();
+	std::vector<std::thread> clients;
+	for (int h = 0; h < headsets; h++)
+	{
+		clients.emplace_back([&, h]
+			{
+				ReplaySettings replay;
+				replay.pacing = speed > 0.0 ? ReplayPacing::Recorded : ReplayPacing::Max;
+				replay.speed = speed > 0.0 ? speed : 1.0;
+				SessionReplaySource source(session, replay);
+
+				int fd = Connect(host, port);
+				if (fd < 0)
+				{
+					ok = false;
+					return;
+				}
+				ChunkedSender sender(fd, uint32_t(h + 1));
+				bool sending = true;
+				StereoFrameCodec codec;
+				StereoCodecSettings compression;
+				compression.maxError = std::max(0, maxError);
+
+				// a LF frame waits for the next RF one, the pair goes out as one 'f' message
+				IngestMessage pair;
+				bool hasLF = false;
+				int camera = 0;
+				CameraFrame frame;
+				while (sending && source.Next(camera, frame))
+				{
+					// back to the Unix ms the headset sends
+					const int64_t timestamp = frame.timestamp / TicksPer(replay.unit);
+					IngestMessage message;
+					if (camera == 0)
+					{
+						pair.payload = frame.image;
+						pair.timestamps[0] = timestamp;
+						hasLF = true;
+						continue;
+					}
+					if (camera == 1)
+					{
+						if (!hasLF || frame.image.size() != pair.payload.size())
+						{
+							continue;
+						}
+						message.type = IngestMessageType::SpatialImages;
+						message.timestamps[0] = pair.timestamps[0];
+						message.timestamps[1] = timestamp;
+						message.payload = pair.payload;
+						message.payload.insert(message.payload.end(), frame.image.begin(), frame.image.end());
+						hasLF = false;
+						if (maxError >= 0)
+						{
+							message.type = IngestMessageType::CompressedSpatialImages;
+							message.payload.clear();
+							codec.Encode(pair.payload.data(), frame.image.data(), frame.width, frame.height, compression, message.payload);
+						}
+					}
+					else
+					{
+						// the plugin sends BGRA, sessions hold the PV frames as gray
+						cv::Mat gray(frame.height, frame.width, CV_8U, frame.image.data()), bgra;
+						cv::cvtColor(gray, bgra, cv::COLOR_GRAY2BGRA);
+						message.type = IngestMessageType::PvImage;
+						message.timestamps[0] = timestamp;
+						message.payload.assign(bgra.data, bgra.data + bgra.total() * 4);
+					}
+					sending = sender.Send(message);
+					messages++;
+				}
+				sending = sending && sender.Flush();
+				ok = ok && sending;
+				bytes += sender.Bytes();
+				close(fd);
+			});
+	}
+	for (auto& client : clients)
+	{
+		client.join();
+	}
+
+	double seconds = std::chrono::duration<double>(Clock::now() - t1).count();
+	std::printf("%d headsets, %lld messages, %.1f MB in %.2f s, %.1f MB/s: %s\n", headsets, (long long)messages.load(),
+		bytes / 1e6, seconds, bytes / 1e6 / seconds, ok ? "ok" : "FAILED");
+	return ok && messages > 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1 && std::strcmp(argv[1], "--loopback") == 0)
+	{
+		int messages = std::max(2, argc > 2 ? std::atoi(argv[2]) : 200);
+		int headsets = std::max(1, argc > 3 ? std::atoi(argv[3]) : 4);
+		return Loopback(messages, headsets);
+	}
+
+	// -1 sends raw 'f' pairs
+	std::vector<std::string> arguments;
+	int maxError = -1;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--compress") == 0)
+		{
+			maxError = i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0])) ? std::atoi(argv[++i]) : 0;
+		}
+		else
+		{
+			arguments.push_back(argv[i]);
+		}
+	}
+	if (arguments.size() < 3 || maxError > kMaxStereoCodecError)
+	{
+		std::fprintf(stderr, "usage: %s <host> <port> <session dir> [headsets] [speed] [--compress [max error, up to %d]]\n"
+			"       %s --loopback [messages per headset] [headsets]\n", argv[0], kMaxStereoCodecError, argv[0]);
+		return 1;
+	}
+	int headsets = std::max(1, arguments.size() > 3 ? std::atoi(arguments[3].c_str()) : 1);
+	double speed = arguments.size() > 4 ? std::atof(arguments[4].c_str()) : 1.0;
+	return Replay(arguments[0], std::atoi(arguments[1].c_str()), arguments[2], headsets, speed, maxError);
+}
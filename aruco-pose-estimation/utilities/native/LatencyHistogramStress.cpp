@@ -0,0 +1,117 @@
+// Records known latency distributions into the stage histograms from several
+// threads at once and checks them: no value may be lost, the percentiles must
+// lie within one bucket (12.5%) of the exact ones and the maximum must be
+// exact. Also reports the cost of one record.
+//
+// Build on Linux (one command):
+//   g++ -O2 -std=c++17 -pthread -I../../projects/common -o LatencyHistogramStress LatencyHistogramStress.cpp
+//
+// Usage:
+//   ./LatencyHistogramStress [values per thread] [threads]
+// Exits with 1 if a count, percentile or maximum is wrong.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "LatencyHistogram.h"
+
+using namespace HoloLens2CV;
+using Clock = std::chrono::steady_clock;
+
+static bool Close(float measured, int64_t exact)
+{
+	// upper bound of the bucket of exact, never below it
+	return measured >= float(exact) && measured <= float(exact) * 1.125f + 1.f;
+}
+
+int main(int argc, char** argv)
+{
+	const int values = argc > 1 ? std::atoi(argv[1]) : 1000000;
+	const int threads = std::max(1, argc > 2 ? std::atoi(argv[2]) : 4);
+	bool ok = true;
+
+	// bucket bounds must be contiguous & every value must fall into a bucket whose upper bound covers it
+	for (int i = 1; i < LatencyHistogram::kBuckets; i++)
+	{
+		int64_t lower = LatencyHistogram::UpperBound(i - 1) + 1;
+		ok = ok && LatencyHistogram::Bucket(lower) == i && LatencyHistogram::Bucket(LatencyHistogram::UpperBound(i)) == i;
+	}
+	std::printf("bucket bounds: %s, largest %lld us\n", ok ? "ok" : "FAILED",
+		(long long)LatencyHistogram::UpperBound(LatencyHistogram::kBuckets - 1));
+
+	// log-normal like frame times: mostly a few ms, a long tail
+	std::vector<std::vector<int64_t>> recorded(threads);
+	for (int t = 0; t < threads; t++)
+	{
+		std::mt19937 rng(t + 1);
+		std::lognormal_distribution<double> latency(std::log(3000.0), 0.6);
+		recorded[t].resize(values);
+		for (int64_t& value : recorded[t])
+		{
+			value = int64_t(latency(rng));
+		}
+	}
+
+	StageLatencies latencies;
+	std::vector<std::thread> writers;
+	auto t1 = Clock::now();
+	for (int t = 0; t < threads; t++)
+	{
+		writers.emplace_back([&, t]()
+			{
+				for (int64_t value : recorded[t])
+				{
+					latencies.Record(LatencyStage::Detection, std::chrono::microseconds(value));
+				}
+			});
+	}
+
+	// readers summarize while the writers run, counts must never go back
+	int64_t lastCount = 0;
+	bool monotonic = true;
+	for (int i = 0; i < 1000; i++)
+	{
+		int64_t count = latencies.Summarize(LatencyStage::Detection).count;
+		monotonic = monotonic && count >= lastCount;
+		lastCount = count;
+	}
+	for (std::thread& writer : writers)
+	{
+		writer.join();
+	}
+	double seconds = std::chrono::duration<double>(Clock::now() - t1).count();
+
+	std::vector<int64_t> all;
+	for (const std::vector<int64_t>& thread : recorded)
+	{
+		all.insert(all.end(), thread.begin(), thread.end());
+	}
+	std::sort(all.begin(), all.end());
+	auto exact = [&](double share) { return all[std::min(all.size() - 1, size_t(std::ceil(share * all.size())) - 1)]; };
+
+	LatencySummary summary = latencies.Summarize(LatencyStage::Detection);
+	bool counted = summary.count == int64_t(all.size());
+	bool percentiles = Close(summary.p50, exact(0.50)) && Close(summary.p95, exact(0.95)) && Close(summary.p99, exact(0.99));
+	bool max = summary.max == float(all.back());
+	std::printf("count %lld of %zu, p50 %.0f (%lld), p95 %.0f (%lld), p99 %.0f (%lld), max %.0f (%lld) us\n",
+		(long long)summary.count, all.size(), summary.p50, (long long)exact(0.50), summary.p95, (long long)exact(0.95),
+		summary.p99, (long long)exact(0.99), summary.max, (long long)all.back());
+	std::printf("%d threads, %.1f ns per record\n", threads, seconds * 1e9 * threads / double(all.size()));
+
+	// other stages untouched, a reset empties all of them
+	bool separate = latencies.Summarize(LatencyStage::Pnp).count == 0;
+	latencies.Reset();
+	bool reset = latencies.Summarize(LatencyStage::Detection).count == 0 && latencies.Summarize(LatencyStage::Detection).max == 0.f;
+	std::printf("counted %s, percentiles %s, max %s, monotonic %s, stages separate %s, reset %s\n",
+		counted ? "ok" : "FAILED", percentiles ? "ok" : "FAILED", max ? "ok" : "FAILED",
+		monotonic ? "ok" : "FAILED", separate ? "ok" : "FAILED", reset ? "ok" : "FAILED");
+
+	ok = ok && counted && percentiles && max && monotonic && separate && reset;
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,206 @@
+// Feeds the same synthetic scenes to the detector as gray, NV12, YUY2 and BGRA
+// frames with padded rows, the way the PV camera delivers them, through the
+// ImageView luma path of OpenCVHelper. Gray & NV12 must be detected in place
+// (no copy), every format must find the same markers at the same corners, and
+// views that do not fit their buffer must be refused. Reports the time to get
+// the luma of each format.
+//
+// Build on Linux (one command):
+//   g++ -O2 -std=c++17 -I../../projects/common -o LumaInputCheck LumaInputCheck.cpp
+//       ../../projects/common/ImageView.cpp ../../projects/common/GrayConversion.cpp
+//       ../../projects/common/ArUcoDetectorSession.cpp ../../projects/common/UndistortionTable.cpp
+//       $(pkg-config --cflags --libs opencv4)
+//
+// Usage:
+//   ./LumaInputCheck [iterations]
+// Exits with 1 if a format misses a marker, moves a corner, copies a luma plane
+// or accepts an invalid view.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "ArUcoDetectorSession.h"
+#include "ImageView.h"
+
+using namespace HoloLens2CV;
+using Clock = std::chrono::steady_clock;
+
+static const PixelFormat kFormats[] = { PixelFormat::Gray8, PixelFormat::Nv12, PixelFormat::Yuy2, PixelFormat::Bgra8 };
+static const char* kFormatNames[] = { "gray", "NV12", "YUY2", "BGRA" };
+
+// a frame buffer in one format, rows padded to 64 bytes like the camera buffers
+struct Frame
+{
+	std::vector<uint8_t> bytes;
+	ImageView view;
+};
+
+// markers on a grid with a white quiet zone, a soft gradient & blur
+static cv::Mat MakeScene(const cv::Size& size, int dictId, int markers)
+{
+	cv::Mat scene(size, CV_8U);
+	for (int y = 0; y < size.height; y++)
+	{
+		for (int x = 0; x < size.width; x++)
+		{
+			scene.at<uint8_t>(y, x) = uint8_t(90 + 60 * x / size.width + 30 * y / size.height);
+		}
+	}
+
+	cv::aruco::Dictionary dictionary = cv::aruco::getPredefinedDictionary(dictId);
+	int side = int(std::ceil(std::sqrt(double(markers))));
+	int cell = std::min(size.width, size.height) / side;
+	int x0 = (size.width - cell * side) / 2, y0 = (size.height - cell * side) / 2;
+	for (int i = 0; i < markers; i++)
+	{
+		int length = int(cell * 0.55);
+		int quiet = length / 6;
+		cv::Rect area(x0 + (i % side) * cell + (cell - length) / 2, y0 + (i / side) * cell + (cell - length) / 2, length, length);
+		cv::Rect border(area.x - quiet, area.y - quiet, length + 2 * quiet, length + 2 * quiet);
+		scene(border).setTo(cv::Scalar(235));
+
+		cv::Mat marker, target = scene(area);
+		cv::aruco::generateImageMarker(dictionary, i, length, marker, 1);
+		marker.copyTo(target);
+	}
+	cv::GaussianBlur(scene, scene, cv::Size(3, 3), 0.8);
+	return scene;
+}
+
+static Frame Encode(const cv::Mat& gray, PixelFormat format)
+{
+	Frame frame;
+	int bytesPerPixel = PlaneBytesPerPixel(format);
+	size_t stride = (size_t(gray.cols) * bytesPerPixel + 63) / 64 * 64;
+	size_t planeSize = stride * gray.rows;
+	frame.bytes.assign(format == PixelFormat::Nv12 ? planeSize + stride * (gray.rows / 2) : planeSize, 128);
+
+	for (int y = 0; y < gray.rows; y++)
+	{
+		uint8_t* row = frame.bytes.data() + y * stride;
+		for (int x = 0; x < gray.cols; x++)
+		{
+			uint8_t value = gray.at<uint8_t>(y, x);
+			uint8_t video = uint8_t(16 + (value * 219 + 127) / 255);      // video range luma
+			switch (format)
+			{
+			case PixelFormat::Gray8: row[x] = value; break;
+			case PixelFormat::Nv12: row[x] = video; break;                  // chroma plane stays neutral
+			case PixelFormat::Yuy2: row[2 * x] = video; break;              // Y0 U Y1 V, chroma neutral
+			case PixelFormat::Bgra8: row[4 * x] = row[4 * x + 1] = row[4 * x + 2] = value; row[4 * x + 3] = 255; break;
+			}
+		}
+	}
+
+	frame.view.format = format;
+	frame.view.width = gray.cols;
+	frame.view.height = gray.rows;
+	frame.view.data = frame.bytes.data();
+	frame.view.stride = stride;
+	frame.view.size = frame.bytes.size();
+	return frame;
+}
+
+static double MedianMicroseconds(std::vector<double>& samples)
+{
+	std::sort(samples.begin(), samples.end());
+	return samples.empty() ? 0.0 : samples[samples.size() / 2];
+}
+
+int main(int argc, char** argv)
+{
+	const int iterations = std::max(1, argc > 1 ? std::atoi(argv[1]) : 200);
+	bool ok = true;
+
+	// a buffer too short, a stride too narrow, an odd YUY2 width, no data & an unknown format are refused
+	std::vector<uint8_t> bytes(640 * 480 * 4);
+	ImageView view;
+	view.format = PixelFormat::Nv12;
+	view.width = 640;
+	view.height = 480;
+	view.data = bytes.data();
+	view.stride = 640;
+	view.size = 640 * 480;
+	ImageView shortBuffer = view, narrow = view, odd = view, noData = view, unknown = view;
+	shortBuffer.size = 640 * 480 - 1;
+	narrow.stride = 639;
+	odd.format = PixelFormat::Yuy2;
+	odd.width = 319;
+	odd.stride = 640;
+	noData.data = nullptr;
+	unknown.format = PixelFormat(0);
+	cv::Mat scratch;
+	bool refused = IsValid(view) && !IsValid(shortBuffer) && !IsValid(narrow) && !IsValid(odd) && !IsValid(noData) && !IsValid(unknown) &&
+		LumaOf(shortBuffer, scratch).empty() && LumaOf(unknown, scratch).empty();
+	std::printf("invalid views refused: %s\n", refused ? "ok" : "FAILED");
+	ok = ok && refused;
+
+	CameraIntrinsics intrinsics;
+	std::printf("resolution,dictionary,markers,format,detected,in_place,max_corner_px,luma_us\n");
+	for (cv::Size size : { cv::Size(896, 504), cv::Size(1920, 1080) })
+	{
+		intrinsics.fx = intrinsics.fy = float(size.width);
+		intrinsics.cx = size.width / 2.f;
+		intrinsics.cy = size.height / 2.f;
+		for (int dictId : { 0, 10 })
+		{
+			for (int count : { 1, 9 })
+			{
+				cv::Mat scene = MakeScene(size, dictId, count);
+				std::vector<MarkerPose> reference;
+				for (size_t f = 0; f < sizeof(kFormats) / sizeof(kFormats[0]); f++)
+				{
+					Frame frame = Encode(scene, kFormats[f]);
+
+					// one session per format, the tracking state of one must not help another
+					ArUcoDetectorSession session;
+					session.Configure(dictId, 0.05f);
+					session.SetCameraIntrinsics(intrinsics);
+
+					std::vector<double> samples;
+					cv::Mat luma;
+					for (int i = 0; i < iterations; i++)
+					{
+						auto t1 = Clock::now();
+						luma = LumaOf(frame.view, scratch);
+						samples.push_back(std::chrono::duration<double, std::micro>(Clock::now() - t1).count());
+					}
+					bool inPlace = luma.data == frame.view.data;
+
+					std::vector<MarkerPose> markers;
+					session.Process(luma, markers);
+					std::sort(markers.begin(), markers.end(), [](const MarkerPose& a, const MarkerPose& b) { return a.id < b.id; });
+					if (f == 0)
+					{
+						reference = markers;
+					}
+
+					// same ids at the same corners as the gray frame
+					bool same = markers.size() == reference.size() && int(markers.size()) == count;
+					double maxCorner = 0.0;
+					for (size_t m = 0; same && m < markers.size(); m++)
+					{
+						same = markers[m].id == reference[m].id;
+						for (int c = 0; c < 4; c++)
+						{
+							cv::Point2f d = markers[m].corners[c] - reference[m].corners[c];
+							maxCorner = std::max(maxCorner, double(std::sqrt(d.x * d.x + d.y * d.y)));
+						}
+					}
+					bool placed = HasLumaPlane(kFormats[f]) == inPlace;
+					ok = ok && same && placed && maxCorner < 0.5;
+
+					std::printf("%dx%d,%d,%d,%s,%zu,%s,%.3f,%.1f\n", size.width, size.height, dictId, count, kFormatNames[f],
+						markers.size(), inPlace ? "yes" : "no", maxCorner, MedianMicroseconds(samples));
+				}
+			}
+		}
+	}
+
+	std::printf("all formats %s\n", ok ? "ok" : "FAILED");
+	return ok ? 0 : 1;
+}
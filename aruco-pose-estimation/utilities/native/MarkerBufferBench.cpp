@@ -0,0 +1,164 @@
+// Checks and times the flat marker result layout returned by
+// GetDetectedMarkersBuffer. Synthetic marker sets are packed into one buffer
+// and read back, every field must survive the round trip. The packing cost is
+// compared with building one heap object per marker that carries its own copy
+// of the camera to world matrix, like the DetectedArUcoMarker path does.
+//
+// Build on Linux (one command):
+//   g++ -O2 -std=c++17 -I../../projects/common -o MarkerBufferBench MarkerBufferBench.cpp
+//       ../../projects/common/MarkerResultBuffer.cpp $(pkg-config --cflags --libs opencv4)
+//
+// Usage:
+//   ./MarkerBufferBench [iterations]
+// Exits with 1 if a round trip did not reproduce the packed markers.
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "MarkerResultBuffer.h"
+
+using namespace HoloLens2CV;
+using Clock = std::chrono::steady_clock;
+
+// what a DetectedArUcoMarker holds
+struct MarkerObject
+{
+	int id;
+	int camera;
+	float position[3];
+	float rotation[3];
+	std::array<float, 16> cameraToWorld;
+};
+
+static std::vector<MarkerPose> MakeMarkers(size_t count)
+{
+	std::vector<MarkerPose> markers(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		MarkerPose& pose = markers[i];
+		pose.id = int(i * 7 % 250);
+		pose.camera = int(i % 2);
+		pose.tvec = cv::Vec3d(0.01 * i, -0.02 * i, 0.5 + 0.1 * i);
+		pose.rvec = cv::Vec3d(0.1, 0.2 * i, -0.3);
+		for (int c = 0; c < 4; c++)
+		{
+			pose.corners[c] = cv::Point2f(10.f * i + c, 20.f * i - c);
+		}
+	}
+	return markers;
+}
+
+static bool SameMarkers(const std::vector<MarkerPose>& a, const std::vector<MarkerPose>& b)
+{
+	if (a.size() != b.size())
+	{
+		return false;
+	}
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		if (a[i].id != b[i].id || a[i].camera != b[i].camera)
+		{
+			return false;
+		}
+		for (int k = 0; k < 3; k++)
+		{
+			if (float(a[i].tvec[k]) != float(b[i].tvec[k]) || float(a[i].rvec[k]) != float(b[i].rvec[k]))
+			{
+				return false;
+			}
+		}
+		for (int c = 0; c < 4; c++)
+		{
+			if (a[i].corners[c] != b[i].corners[c])
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	const int iterations = argc > 1 ? std::atoi(argv[1]) : 100000;
+	int failures = 0;
+
+	MarkerFrameInfo frame;
+	frame.sequence = 0x100000002ull;
+	frame.timestamp = 133000000000000000ll;
+	for (int m = 0; m < 16; m++)
+	{
+		frame.cameraToWorld[0][m] = float(m);
+		frame.cameraToWorld[1][m] = float(-m);
+	}
+
+	std::printf("markers   flat (ns/frame)   objects (ns/frame)   buffer (bytes)\n");
+	for (size_t count : { 0, 1, 4, 16, 64 })
+	{
+		std::vector<MarkerPose> markers = MakeMarkers(count);
+		std::vector<float> buffer(MarkerBufferWords(count));
+
+		// round trip
+		MarkerFrameInfo readFrame;
+		std::vector<MarkerPose> readMarkers;
+		size_t written = PackMarkerBuffer(frame, markers, buffer.data(), buffer.size());
+		if (written != buffer.size() || !UnpackMarkerBuffer(buffer.data(), written, readFrame, readMarkers) ||
+			readFrame.sequence != frame.sequence || readFrame.timestamp != frame.timestamp ||
+			readFrame.cameraToWorld[1][15] != frame.cameraToWorld[1][15] || !SameMarkers(markers, readMarkers))
+		{
+			std::printf("round trip failed for %zu markers\n", count);
+			failures++;
+		}
+
+		// a buffer too small for every marker keeps the complete ones and reports the detected count
+		if (count > 1)
+		{
+			std::vector<float> small(MarkerBufferWords(1) + 5);
+			const MarkerBufferHeader* header = reinterpret_cast<const MarkerBufferHeader*>(small.data());
+			if (PackMarkerBuffer(frame, markers, small.data(), small.size()) != MarkerBufferWords(1) ||
+				header->markerCount != 1 || header->detectedCount != count)
+			{
+				std::printf("truncation failed for %zu markers\n", count);
+				failures++;
+			}
+		}
+
+		auto t1 = Clock::now();
+		for (int i = 0; i < iterations; i++)
+		{
+			PackMarkerBuffer(frame, markers, buffer.data(), buffer.size());
+		}
+		auto t2 = Clock::now();
+
+		std::vector<std::shared_ptr<MarkerObject>> objects;
+		for (int i = 0; i < iterations; i++)
+		{
+			objects.clear();
+			for (const MarkerPose& pose : markers)
+			{
+				auto object = std::make_shared<MarkerObject>();
+				object->id = pose.id;
+				object->camera = pose.camera;
+				for (int k = 0; k < 3; k++)
+				{
+					object->position[k] = float(pose.tvec[k]);
+					object->rotation[k] = float(pose.rvec[k]);
+				}
+				std::copy(frame.cameraToWorld[pose.camera], frame.cameraToWorld[pose.camera] + 16, object->cameraToWorld.begin());
+				objects.push_back(std::move(object));
+			}
+		}
+		auto t3 = Clock::now();
+
+		std::printf("%7zu   %15.1f   %18.1f   %14zu\n", count,
+			std::chrono::duration<double, std::nano>(t2 - t1).count() / iterations,
+			std::chrono::duration<double, std::nano>(t3 - t2).count() / iterations,
+			buffer.size() * sizeof(float));
+	}
+
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+// Throughput of the pose stage for a growing number of visible markers.
+// Synthetic markers are placed in front of a 640x480 VLC like camera, their
+// corners projected with a little pixel noise, and solved with every solver
+// setting: iterative with and without the undistortion table, IPPE square,
+// warm started from the previous frame, and each of them serial and across
+// cores. Reports markers per second and the mean translation error against
+// the true poses.
+//
+// Build on Linux (one command):
+//   g++ -O2 -std=c++17 -I../../projects/common -o PoseBench PoseBench.cpp
+//       ../../projects/common/ArUcoDetectorSession.cpp ../../projects/common/UndistortionTable.cpp $(pkg-config --cflags --libs opencv4)
+//
+// Usage:
+//   ./PoseBench [frames]
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "ArUcoDetectorSession.h"
+
+using namespace HoloLens2CV;
+using Clock = std::chrono::steady_clock;
+
+static const float kMarkerLength = 0.05f;
+
+// truth poses & noisy corners of count markers for one frame, drift moves every marker a bit per frame
+static void MakeFrame(const CameraIntrinsics& intrinsics, size_t count, int frame, std::mt19937& rng,
+	std::vector<MarkerPose>& truth, std::vector<MarkerPose>& observed)
+{
+	cv::Matx33d K(intrinsics.fx, 0, intrinsics.cx, 0, intrinsics.fy, intrinsics.cy, 0, 0, 1);
+	cv::Matx<double, 1, 5> distortion(intrinsics.k1, intrinsics.k2, intrinsics.p1, intrinsics.p2, intrinsics.k3);
+	std::vector<cv::Point3f> object = {
+		{ -kMarkerLength / 2.f, kMarkerLength / 2.f, 0 }, { kMarkerLength / 2.f, kMarkerLength / 2.f, 0 },
+		{ kMarkerLength / 2.f, -kMarkerLength / 2.f, 0 }, { -kMarkerLength / 2.f, -kMarkerLength / 2.f, 0 } };
+	std::normal_distribution<float> noise(0.f, 0.3f);
+	std::vector<cv::Point2f> projected;
+
+	truth.resize(count);
+	observed.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		// markers on a grid in front of the camera, slowly turning
+		double x = (double(i % 8) - 3.5) * 0.07, y = (double(i / 8 % 8) - 3.5) * 0.05;
+		MarkerPose& pose = truth[i];
+		pose.id = int(i);
+		pose.tvec = cv::Vec3d(x + 0.001 * frame, y, 0.6 + 0.05 * double(i / 64));
+		pose.rvec = cv::Vec3d(3.0 + 0.002 * frame, 0.2 * std::sin(0.3 * i), 0.1);
+
+		cv::projectPoints(object, pose.rvec, pose.tvec, K, distortion, projected);
+		observed[i].id = pose.id;
+		for (int c = 0; c < 4; c++)
+		{
+			pose.corners[c] = projected[c];
+			observed[i].corners[c] = projected[c] + cv::Point2f(noise(rng), noise(rng));
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const int frames = argc > 1 ? std::atoi(argv[1]) : 200;
+
+	CameraIntrinsics intrinsics;
+	intrinsics.fx = intrinsics.fy = 450.f;
+	intrinsics.cx = 320.f;
+	intrinsics.cy = 240.f;
+	intrinsics.k1 = -0.12f;
+	intrinsics.k2 = 0.03f;
+	const cv::Size imageSize(640, 480);
+
+	struct Setting { const char* name; PoseSolver solver; bool warmStart; bool table; };
+	const Setting settings[] = {
+		{ "iterative", PoseSolver::Iterative, false, false },
+		{ "iterative+table", PoseSolver::Iterative, false, true },
+		{ "ippe_square+table", PoseSolver::IppeSquare, false, true },
+		{ "ippe_square+warm", PoseSolver::IppeSquare, true, true },
+	};
+
+	std::printf("markers   solver             threads   markers/s   tvec err (mm)\n");
+	for (size_t count : { 1, 4, 16, 64, 256 })
+	{
+		for (const Setting& setting : settings)
+		{
+			for (bool parallel : { false, true })
+			{
+				ArUcoDetectorSession session;
+				session.Configure(0, kMarkerLength);
+				session.SetCameraIntrinsics(intrinsics);
+
+				PoseSettings pose;
+				pose.solver = setting.solver;
+				pose.warmStart = setting.warmStart;
+				pose.undistortionTable = setting.table;
+				pose.parallelThreshold = parallel ? 1 : 0;
+				session.ConfigurePose(pose);
+
+				// the first call builds the undistortion table, outside of the timing
+				std::mt19937 rng(42);
+				std::vector<MarkerPose> truth, markers;
+				session.EstimatePoses(markers, imageSize);
+				double seconds = 0, error = 0;
+				for (int f = 0; f < frames; f++)
+				{
+					MakeFrame(intrinsics, count, f, rng, truth, markers);
+
+					auto t1 = Clock::now();
+					session.EstimatePoses(markers, imageSize);
+					auto t2 = Clock::now();
+					seconds += std::chrono::duration<double>(t2 - t1).count();
+
+					for (size_t i = 0; i < count; i++)
+					{
+						cv::Vec3d d = markers[i].tvec - truth[i].tvec;
+						error += std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]) * 1000.0;
+					}
+				}
+
+				std::printf("%7zu   %-17s  %7s   %11.0f   %13.2f\n", count, setting.name, parallel ? "all" : "1",
+					double(count) * frames / seconds, error / (double(count) * frames));
+			}
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,114 @@
+// Evaluates the per-marker pose filter on a synthetic 30 Hz trajectory: the
+// marker rests, then moves & turns at constant speed, then stops, with
+// detection noise on every pose. The error of the raw poses (held until the
+// next detection, like MarkerTracker did) is compared with the filtered poses
+// predicted to the render time, latency frames after the sensor time stamp.
+//
+// Build on Linux (one command):
+//   g++ -O2 -std=c++17 -I../../projects/common -o PoseFilterBench PoseFilterBench.cpp
+//       ../../projects/common/MarkerPoseFilter.cpp $(pkg-config --cflags --libs opencv4)
+//
+// Usage:
+//   ./PoseFilterBench [minCutoff] [beta] [latency ms]
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#include "MarkerPoseFilter.h"
+
+using namespace HoloLens2CV;
+
+// true pose at time t (seconds): rest, 1.5 s of motion, rest
+static void TruePose(double t, cv::Vec3d& position, double& angle)
+{
+	double moving = std::min(std::max(t - 1.0, 0.0), 1.5);
+	position = cv::Vec3d(0.3 * moving, 0.0, 0.6);
+	angle = 0.8 * moving;                       // rad around the y axis
+}
+
+static cv::Matx44d PoseMatrix(const cv::Vec3d& position, double angle)
+{
+	double c = std::cos(angle), s = std::sin(angle);
+	return cv::Matx44d(
+		c, 0, s, position[0],
+		0, 1, 0, position[1],
+		-s, 0, c, position[2],
+		0, 0, 0, 1);
+}
+
+static double AngleOf(const cv::Matx44d& m)
+{
+	return std::atan2(m(0, 2), m(0, 0));
+}
+
+int main(int argc, char** argv)
+{
+	PoseFilterSettings settings;
+	settings.minCutoff = argc > 1 ? std::strtod(argv[1], nullptr) : settings.minCutoff;
+	settings.beta = argc > 2 ? std::strtod(argv[2], nullptr) : settings.beta;
+	const double latency = (argc > 3 ? std::strtod(argv[3], nullptr) : 50.0) / 1000.0;
+
+	MarkerPoseFilter filter;
+	filter.Configure(settings);
+
+	const double rate = 30.0, renderRate = 60.0, duration = 4.0;
+	std::mt19937 rng(1);
+	std::normal_distribution<double> positionNoise(0.0, 0.002), angleNoise(0.0, 0.01);
+
+	// error sums: [raw, filtered] x [resting, moving, stopped], position in mm & angle in degrees
+	double positionError[2][3] = {}, angleError[2][3] = {};
+	int samples[3] = {};
+
+	cv::Matx44d raw = PoseMatrix(cv::Vec3d(0, 0, 0.6), 0.0);
+	int frame = 0;
+	for (double render = 0.0; render < duration; render += 1.0 / renderRate)
+	{
+		// detections that finished processing by now, latency after their sensor time
+		while (frame / rate + latency <= render)
+		{
+			double t = frame / rate;
+			cv::Vec3d position;
+			double angle;
+			TruePose(t, position, angle);
+			position = position + cv::Vec3d(positionNoise(rng), positionNoise(rng), positionNoise(rng));
+			raw = PoseMatrix(position, angle + angleNoise(rng));
+			filter.Update(7, raw, int64_t(t * 1e7));
+			frame++;
+		}
+
+		cv::Matx44d predicted;
+		if (frame == 0 || !filter.Predict(7, int64_t(render * 1e7), predicted))
+		{
+			continue;
+		}
+
+		cv::Vec3d truth;
+		double trueAngle;
+		TruePose(render, truth, trueAngle);
+		int phase = render < 1.0 ? 0 : render < 2.5 ? 1 : 2;
+		const cv::Matx44d* poses[2] = { &raw, &predicted };
+		for (int k = 0; k < 2; k++)
+		{
+			cv::Vec3d d((*poses[k])(0, 3) - truth[0], (*poses[k])(1, 3) - truth[1], (*poses[k])(2, 3) - truth[2]);
+			positionError[k][phase] += std::sqrt(d.dot(d)) * 1000.0;
+			angleError[k][phase] += std::fabs(AngleOf(*poses[k]) - trueAngle) * 180.0 / 3.14159265358979323846;
+		}
+		samples[phase]++;
+	}
+
+	std::printf("minCutoff %.2f Hz, beta %.2f, latency %.0f ms\n", settings.minCutoff, settings.beta, latency * 1000.0);
+	std::printf("mean error (mm / deg)   resting            moving             stopped\n");
+	const char* names[2] = { "raw, held:", "filtered:" };
+	for (int k = 0; k < 2; k++)
+	{
+		std::printf("%-22s", names[k]);
+		for (int phase = 0; phase < 3; phase++)
+		{
+			std::printf("  %7.2f / %6.2f", positionError[k][phase] / samples[phase], angleError[k][phase] / samples[phase]);
+		}
+		std::printf("\n");
+	}
+	return 0;
+}
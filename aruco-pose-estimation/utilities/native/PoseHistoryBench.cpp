@@ -0,0 +1,168 @@
+// Evaluates the rig pose history against a synthetic head trajectory. The
+// history is filled at several sample rates, then looked up at 30 Hz frame
+// times: in between samples (interpolated) and past the newest one
+// (extrapolated by a few ms). Position & rotation errors are measured against
+// the exact trajectory, along with the lookup time. A tracking loss must make
+// the lookups inside it fail instead of interpolating across it, and the
+// sampler thread must fill the history on its own.
+//
+// Build on Linux (one command):
+//   g++ -O2 -std=c++17 -pthread -I../../projects/common -o PoseHistoryBench PoseHistoryBench.cpp
+//       ../../projects/common/RigPoseHistory.cpp ../../projects/common/SyntheticRigPoseSource.cpp
+//       $(pkg-config --cflags --libs opencv4)
+//
+// Usage:
+//   ./PoseHistoryBench [angular speed rad/s]
+// Exits with 1 if the interpolation error at 200 Hz exceeds 0.01 deg / 0.1 mm,
+// a lookup inside a tracking loss succeeds or the sampler thread adds nothing.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "Quaternion.h"
+#include "RigPoseHistory.h"
+#include "SyntheticRigPoseSource.h"
+
+using namespace HoloLens2CV;
+using Clock = std::chrono::steady_clock;
+
+static const int64_t kTicksPerSecond = 10000000;
+static const int64_t kFrameTicks = 333333;          // 30 Hz
+static const double kPi = 3.14159265358979323846;
+
+static double RotationError(const cv::Vec4d& a, const cv::Vec4d& b)
+{
+	cv::Vec3d v = Quaternion::Log(Quaternion::Multiply(a, Quaternion::Conjugate(b)));
+	return std::sqrt(v.dot(v)) * 180.0 / kPi;
+}
+
+static double PositionError(const cv::Vec3d& a, const cv::Vec3d& b)
+{
+	cv::Vec3d d = a - b;
+	return std::sqrt(d.dot(d)) * 1000.0;
+}
+
+int main(int argc, char** argv)
+{
+	TrajectorySettings trajectory;
+	trajectory.angularSpeed = argc > 1 ? std::strtod(argv[1], nullptr) : 1.0;
+	SyntheticRigPoseSource source(trajectory);
+	bool ok = true;
+
+	std::printf("peak angular speed %.2f rad/s, peak linear speed %.2f m/s\n", trajectory.angularSpeed, trajectory.linearSpeed);
+	std::printf("rate (Hz)   lookup        rot err mean / max (deg)   pos err mean / max (mm)   ns / lookup\n");
+	for (int rate : { 30, 60, 100, 200, 500 })
+	{
+		PoseHistorySettings settings;
+		settings.samplePeriod = kTicksPerSecond / rate;
+		settings.maxGap = 2 * settings.samplePeriod;
+		settings.capacity = 2 * rate;
+		for (int64_t ahead : { int64_t(0), int64_t(50000), int64_t(100000), int64_t(200000) })
+		{
+			RigPoseHistory history;
+			history.Configure(settings);
+
+			// 10 s of samples, frames looked up 'ahead' past the newest sample or at the middle of a period
+			double rotation[2] = {}, position[2] = {};
+			int lookups = 0, missed = 0;
+			Clock::duration elapsed(0);
+			int64_t now = kTicksPerSecond;
+			int64_t nextFrame = now + kFrameTicks;
+			for (; now < 11 * kTicksPerSecond; now += settings.samplePeriod)
+			{
+				history.Add(source.PoseAt(now));
+				if (now < nextFrame)
+				{
+					continue;
+				}
+				int64_t query = ahead > 0 ? now + ahead : nextFrame - settings.samplePeriod / 2;
+				nextFrame += kFrameTicks;
+
+				RigPose pose;
+				auto t0 = Clock::now();
+				bool found = history.TryGetPose(query, pose);
+				elapsed += Clock::now() - t0;
+				if (!found)
+				{
+					missed++;
+					continue;
+				}
+
+				RigPose truth = source.PoseAt(query);
+				double r = RotationError(pose.orientation, truth.orientation), p = PositionError(pose.position, truth.position);
+				rotation[0] += r;
+				rotation[1] = std::max(rotation[1], r);
+				position[0] += p;
+				position[1] = std::max(position[1], p);
+				lookups++;
+			}
+
+			double n = lookups > 0 ? double(lookups) : 1.0;
+			char label[32];
+			std::snprintf(label, sizeof(label), ahead > 0 ? "+%.0f ms" : "between", ahead / 10000.0);
+			std::printf("%9d   %-10s   %11.4f / %-11.4f   %10.3f / %-10.3f   %11.0f%s\n", rate, label,
+				rotation[0] / n, rotation[1], position[0] / n, position[1],
+				std::chrono::duration<double, std::nano>(elapsed).count() / n, missed > 0 ? "   (missed)" : "");
+
+			if (rate == 200 && ahead == 0 && (rotation[1] > 0.01 || position[1] > 0.1 || missed > 0))
+			{
+				ok = false;
+			}
+		}
+	}
+
+	// tracking lost for 200 ms: lookups inside the loss fail, lookups around it still work
+	{
+		PoseHistorySettings settings;
+		RigPoseHistory history;
+		history.Configure(settings);
+		int inside = 0, outside = 0;
+		for (int64_t now = kTicksPerSecond; now < 2 * kTicksPerSecond; now += settings.samplePeriod)
+		{
+			source.SetTracking(now < 1300 * 10000 || now > 1500 * 10000);
+			RigPose pose;
+			if (source.TryLocate(now, pose))
+			{
+				history.Add(pose);
+			}
+		}
+		for (int64_t query = kTicksPerSecond; query < 2 * kTicksPerSecond - settings.samplePeriod; query += 10000)
+		{
+			RigPose pose;
+			// between the last sample before the loss and the first one after it
+			bool lost = query > 1300 * 10000 - settings.samplePeriod && query < 1500 * 10000 + settings.samplePeriod;
+			if (history.TryGetPose(query, pose) == lost)
+			{
+				(lost ? inside : outside)++;
+			}
+		}
+		source.SetTracking(true);
+		std::printf("tracking loss: %s (%d lookups inside the loss found, %d around it missed)\n",
+			inside == 0 && outside == 0 ? "ok" : "FAILED", inside, outside);
+		ok = ok && inside == 0 && outside == 0;
+	}
+
+	// the sampler thread on its own, the clock advanced in real time
+	{
+		RigPoseHistory history;
+		history.Configure(PoseHistorySettings());
+		auto start = Clock::now();
+		source.SetNow(kTicksPerSecond);
+		history.Start(&source);
+		while (Clock::now() - start < std::chrono::milliseconds(200))
+		{
+			source.SetNow(kTicksPerSecond + std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count() * 10);
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		history.Stop();
+		PoseHistoryStats stats = history.GetStats();
+		std::printf("sampler thread: %lld samples in 200 ms\n", (long long)stats.samples);
+		ok = ok && stats.samples > 0;
+	}
+
+	return ok ? 0 : 1;
+}
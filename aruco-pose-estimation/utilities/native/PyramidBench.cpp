@@ -0,0 +1,120 @@
+// Measures the accuracy / latency tradeoff of the coarse to fine detection
+// on recorded frames. Every pyramid level is run over the same frames and
+// compared with full resolution detection (level 0): recall, corner RMS
+// difference in pixels and translation difference in millimeters, next to
+// the per-frame latency. Use it to pick the pyramid level of a deployment.
+//
+// Build on Linux (one command):
+//   g++ -O2 -std=c++17 -I../../projects/common -o PyramidBench PyramidBench.cpp
+//       ../../projects/common/ArUcoDetectorSession.cpp ../../projects/common/UndistortionTable.cpp ../../projects/common/FileFrameSource.cpp
+//       $(pkg-config --cflags --libs opencv4)
+//
+// Usage:
+//   ./PyramidBench <image dir> <fx> <fy> <cx> <cy> [dictId] [markerLength]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "ArUcoDetectorSession.h"
+#include "FileFrameSource.h"
+
+using namespace HoloLens2CV;
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char** argv)
+{
+	if (argc < 6)
+	{
+		std::fprintf(stderr, "usage: %s <image dir> <fx> <fy> <cx> <cy> [dictId] [markerLength]\n", argv[0]);
+		return 1;
+	}
+
+	CameraIntrinsics intrinsics;
+	intrinsics.fx = std::strtof(argv[2], nullptr);
+	intrinsics.fy = std::strtof(argv[3], nullptr);
+	intrinsics.cx = std::strtof(argv[4], nullptr);
+	intrinsics.cy = std::strtof(argv[5], nullptr);
+	int dictId = argc > 6 ? std::atoi(argv[6]) : 0;
+	float markerLength = argc > 7 ? std::strtof(argv[7], nullptr) : 0.05f;
+
+	FileFrameSource source(argv[1]);
+	std::vector<cv::Mat> frames;
+	cv::Mat gray;
+	int64_t ts;
+	while (source.Next(gray, ts))
+	{
+		frames.push_back(gray.clone());
+	}
+	if (frames.empty())
+	{
+		std::fprintf(stderr, "no frames found in %s\n", argv[1]);
+		return 1;
+	}
+
+	ArUcoDetectorSession session;
+	session.Configure(dictId, markerLength);
+	session.SetCameraIntrinsics(intrinsics);
+
+	// full resolution results are the reference
+	std::vector<std::vector<MarkerPose>> reference(frames.size());
+	for (size_t i = 0; i < frames.size(); i++)
+	{
+		session.Process(frames[i], reference[i]);
+	}
+
+	std::printf("level   mean (us)    p95 (us)   recall   corner rms (px)   tvec diff (mm)\n");
+	std::vector<MarkerPose> markers;
+	for (int level = 0; level <= ArUcoDetectorSession::kMaxPyramidLevel; level++)
+	{
+		session.SetPyramidLevel(level);
+
+		std::vector<double> us;
+		size_t expected = 0, found = 0, corners = 0;
+		double cornerSq = 0, tvecDiff = 0;
+		for (size_t i = 0; i < frames.size(); i++)
+		{
+			auto t1 = Clock::now();
+			session.Process(frames[i], markers);
+			auto t2 = Clock::now();
+			us.push_back(std::chrono::duration<double, std::micro>(t2 - t1).count());
+
+			for (const MarkerPose& ref : reference[i])
+			{
+				expected++;
+				auto match = std::find_if(markers.begin(), markers.end(), [&ref](const MarkerPose& m) { return m.id == ref.id; });
+				if (match == markers.end())
+				{
+					continue;
+				}
+				found++;
+				for (int c = 0; c < 4; c++)
+				{
+					float dx = match->corners[c].x - ref.corners[c].x;
+					float dy = match->corners[c].y - ref.corners[c].y;
+					cornerSq += dx * dx + dy * dy;
+					corners++;
+				}
+				double dt[3] = { match->tvec[0] - ref.tvec[0], match->tvec[1] - ref.tvec[1], match->tvec[2] - ref.tvec[2] };
+				tvecDiff += std::sqrt(dt[0] * dt[0] + dt[1] * dt[1] + dt[2] * dt[2]) * 1000.0;
+			}
+		}
+
+		std::sort(us.begin(), us.end());
+		double mean = 0;
+		for (double v : us)
+		{
+			mean += v;
+		}
+		mean /= us.size();
+
+		std::printf("%5d   %9.1f   %9.1f   %6.3f   %15.3f   %14.2f\n", level, mean, us[us.size() * 95 / 100],
+			expected ? double(found) / expected : 1.0,
+			corners ? std::sqrt(cornerSq / corners) : 0.0,
+			found ? tvecDiff / found : 0.0);
+	}
+	return 0;
+}
@@ -0,0 +1,219 @@
+// Converts a session recorded by TCPServer.py (the <ts>_LF.tiff, <ts>_RF.tiff
+// & <ts>_PV.tiff images in leftfront/, rightfront/ & photovideo/ or all in one
+// directory, and markers.txt) to one SessionRecording file, so the calibration
+// scripts, SessionReplay & the other tools map it instead of decoding a TIFF per
+// frame. Images keep their channels (the PV ones BGRA or BGR), markers.txt is
+// stored whole as one marker text record.
+//
+// Prints the time the TIFFs took to load against the time the recording takes
+// to open & read every record, and the time of a seek by time stamp. With
+// --verify every record is compared to its TIFF.
+//
+// Build on Linux (one command):
+//   g++ -O2 -std=c++17 -I../../projects/common -o SessionConvert SessionConvert.cpp
+//       ../../projects/common/FileFrameSource.cpp ../../projects/common/SessionRecording.cpp $(pkg-config --cflags --libs opencv4)
+//
+// Usage:
+//   ./SessionConvert <session dir> [recording, default <session dir>/session.hl2rec] [--verify]
+// Exits with 1 if an image cannot be read or written, or a record differs from its TIFF.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "FileFrameSource.h"
+#include "SessionRecording.h"
+
+using namespace HoloLens2CV;
+using Clock = std::chrono::steady_clock;
+
+static const char* kFolders[3] = { "leftfront", "rightfront", "photovideo" };
+static const char* kSuffixes[3] = { "_LF.tiff", "_RF.tiff", "_PV.tiff" };
+
+// the TIFFs of a camera, in its folder if there is one
+static std::vector<std::string> FilesOf(const std::string& session, int camera)
+{
+	std::filesystem::path folder = std::filesystem::path(session) / kFolders[camera];
+	return FileFrameSource(std::filesystem::is_directory(folder) ? folder.string() : session, kSuffixes[camera]).Files();
+}
+
+static bool Matches(const cv::Mat& image, const RecordView& record)
+{
+	if (!image.isContinuous() || image.depth() != CV_8U || image.cols != record.width || image.rows != record.height ||
+		image.total() * image.elemSize() != record.size)
+	{
+		return false;
+	}
+	return std::memcmp(image.data, record.data, record.size) == 0;
+}
+
+static double Seconds(Clock::time_point from)
+{
+	return std::chrono::duration<double>(Clock::now() - from).count();
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> arguments;
+	bool verify = false;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--verify") == 0)
+		{
+			verify = true;
+		}
+		else
+		{
+			arguments.push_back(argv[i]);
+		}
+	}
+	if (arguments.empty())
+	{
+		std::fprintf(stderr, "usage: %s <session dir> [recording] [--verify]\n", argv[0]);
+		return 1;
+	}
+	const std::string session = arguments[0];
+	const std::string path = arguments.size() > 1 ? arguments[1] : (std::filesystem::path(session) / "session.hl2rec").string();
+	if (std::filesystem::exists(path))
+	{
+		// the writer would append to it
+		std::fprintf(stderr, "%s exists\n", path.c_str());
+		return 1;
+	}
+
+	SessionRecordingWriter writer;
+	if (!writer.Open(path))
+	{
+		std::fprintf(stderr, "%s\n", writer.Error().c_str());
+		return 1;
+	}
+
+	bool ok = true;
+	size_t images = 0;
+	double loadSeconds = 0.0;
+	int64_t tiffBytes = 0;
+	for (int camera = 0; camera < 3; camera++)
+	{
+		for (const std::string& file : FilesOf(session, camera))
+		{
+			auto t1 = Clock::now();
+			cv::Mat image = cv::imread(file, cv::IMREAD_UNCHANGED);
+			loadSeconds += Seconds(t1);
+			tiffBytes += int64_t(std::filesystem::file_size(file));
+			if (image.empty() || image.depth() != CV_8U || !image.isContinuous() ||
+				!writer.AppendImage(RecordStream(camera), FileFrameSource::TimestampOf(file), image.cols, image.rows,
+					image.channels(), image.data))
+			{
+				std::fprintf(stderr, "cannot convert %s\n", file.c_str());
+				ok = false;
+				continue;
+			}
+			images++;
+		}
+	}
+
+	std::ifstream markers((std::filesystem::path(session) / "markers.txt").string(), std::ios::binary);
+	if (markers)
+	{
+		std::string text((std::istreambuf_iterator<char>(markers)), std::istreambuf_iterator<char>());
+		ok = writer.Append(RecordStream::Markers, RecordFormat::MarkerText, writer.LastTimestamp(), 0, 0,
+			text.data(), text.size()) && ok;
+	}
+	if (!writer.Close())
+	{
+		std::fprintf(stderr, "%s\n", writer.Error().c_str());
+		return 1;
+	}
+	if (images == 0)
+	{
+		std::fprintf(stderr, "no images in %s\n", session.c_str());
+		return 1;
+	}
+
+	// read back: every cache line of every payload touched once, as a replay would
+	auto t1 = Clock::now();
+	SessionRecordingReader reader;
+	if (!reader.Open(path))
+	{
+		std::fprintf(stderr, "%s\n", reader.Error().c_str());
+		return 1;
+	}
+	uint64_t sum = 0;
+	for (int stream = 0; stream < kRecordStreams; stream++)
+	{
+		for (size_t i = 0; i < reader.Count(RecordStream(stream)); i++)
+		{
+			RecordView record;
+			if (!reader.Get(RecordStream(stream), i, record))
+			{
+				std::fprintf(stderr, "record %zu of stream %d is corrupt\n", i, stream);
+				return 1;
+			}
+			for (size_t b = 0; b < record.size; b += 64)
+			{
+				sum += record.data[b];
+			}
+		}
+	}
+	double readSeconds = Seconds(t1);
+
+	// seeks to random time stamps within the LF stream, or whichever has records
+	RecordStream seekStream = RecordStream::LeftFront;
+	for (int stream = 2; stream >= 0; stream--)
+	{
+		if (reader.Count(RecordStream(stream)) > 0)
+		{
+			seekStream = RecordStream(stream);
+		}
+	}
+	const size_t count = reader.Count(seekStream);
+	const int seeks = 100000;
+	std::mt19937_64 random(1);
+	std::uniform_int_distribution<int64_t> stamps(reader.Timestamp(seekStream, 0), reader.Timestamp(seekStream, count - 1));
+	size_t found = 0;
+	auto t2 = Clock::now();
+	for (int s = 0; s < seeks; s++)
+	{
+		found += reader.LowerBound(seekStream, stamps(random));
+	}
+	double seekNs = Seconds(t2) * 1e9 / seeks;
+
+	if (verify)
+	{
+		size_t differing = 0;
+		for (int camera = 0; camera < 3; camera++)
+		{
+			std::vector<std::string> files = FilesOf(session, camera);
+			std::sort(files.begin(), files.end(), [](const std::string& a, const std::string& b)
+				{ return FileFrameSource::TimestampOf(a) < FileFrameSource::TimestampOf(b); });
+			for (size_t i = 0; i < files.size(); i++)
+			{
+				RecordView record;
+				if (i >= reader.Count(RecordStream(camera)) || !reader.Get(RecordStream(camera), i, record) ||
+					record.timestamp != FileFrameSource::TimestampOf(files[i]) ||
+					!Matches(cv::imread(files[i], cv::IMREAD_UNCHANGED), record))
+				{
+					std::fprintf(stderr, "%s differs from its record\n", files[i].c_str());
+					differing++;
+				}
+			}
+		}
+		std::fprintf(stderr, "verified %zu images, %zu differ\n", images, differing);
+		ok = ok && differing == 0;
+	}
+
+	std::printf("images,tiff_mb,recording_mb,tiff_load_s,recording_read_s,speedup,seek_ns,recovered\n");
+	std::printf("%zu,%.1f,%.1f,%.3f,%.3f,%.1f,%.0f,%d\n", images, tiffBytes / 1e6, std::filesystem::file_size(path) / 1e6, loadSeconds,
+		readSeconds, readSeconds > 0.0 ? loadSeconds / readSeconds : 0.0, seekNs, int(reader.Recovered()));
+	std::fprintf(stderr, "checksum %llu, mean seek position %zu of %zu\n", (unsigned long long)sum, found / seeks, count);
+	return ok ? 0 : 1;
+}
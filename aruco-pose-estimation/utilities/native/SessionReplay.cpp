@@ -0,0 +1,179 @@
+// Replays a session recorded by TCPServer.py through the front camera pipeline
+// of the research mode plugin: LF/RF frames are paired by time stamp, located,
+// queued, detected & filtered by the same code that runs on the device. PV
+// frames of the session go through a detector session of their own. Sessions
+// hold no rig poses, the rig stays at the world origin unless the synthetic head
+// motion is switched on. Reports frames per camera, pairs, markers, the
+// latency of every stage and the achieved replay rate, at the recorded pace or
+// as fast as possible (speed 0, detection on the reading thread so no frame is
+// dropped). With --trace the stages are recorded & written as a Chrome trace.
+//
+// Build on Linux (one command):
+//   g++ -O2 -std=c++17 -pthread -I../../projects/common -o SessionReplay SessionReplay.cpp
+//       ../../projects/common/FrontCamerasPipeline.cpp ../../projects/common/SessionReplaySource.cpp
+//       ../../projects/common/FileFrameSource.cpp ../../projects/common/ArUcoDetectorSession.cpp
+//       ../../projects/common/UndistortionTable.cpp ../../projects/common/FrontCamerasDetector.cpp
+//       ../../projects/common/StereoMarkerTriangulator.cpp ../../projects/common/StereoFramePairer.cpp
+//       ../../projects/common/MarkerPoseFilter.cpp ../../projects/common/RigPoseHistory.cpp
+//       ../../projects/common/SyntheticRigPoseSource.cpp ../../projects/common/TraceRing.cpp
+//       ../../projects/common/SessionRecording.cpp $(pkg-config --cflags --libs opencv4)
+//
+// Usage (all cameras use the same intrinsics here):
+//   ./SessionReplay <session dir> <fx> <fy> <cx> <cy> [dictId] [markerLength] [speed] [--motion] [--trace <file>]
+// Exits with 1 if the session holds no LF/RF frames.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "ArUcoDetectorSession.h"
+#include "FrontCamerasPipeline.h"
+#include "SessionReplaySource.h"
+#include "SyntheticRigPoseSource.h"
+
+using namespace HoloLens2CV;
+using Clock = std::chrono::steady_clock;
+
+// hands LF/RF frames on to the pipeline, detects PV frames on the way
+class PhotoVideoTap : public FrameSource
+{
+public:
+	PhotoVideoTap(FrameSource& source, ArUcoDetectorSession& detector) : m_source(source), m_detector(detector) {}
+
+	bool Next(int& camera, CameraFrame& frame) override
+	{
+		while (m_source.Next(camera, frame))
+		{
+			if (camera != PhotoVideoCamera)
+			{
+				return true;
+			}
+			cv::Mat gray(frame.height, frame.width, CV_8U, frame.image.data());
+			m_detector.Process(gray, m_markers);
+			frames++;
+			markers += int64_t(m_markers.size());
+		}
+		return false;
+	}
+
+	void Stop() override { m_source.Stop(); }
+
+	int64_t frames = 0;
+	int64_t markers = 0;
+
+private:
+	FrameSource& m_source;
+	ArUcoDetectorSession& m_detector;
+	std::vector<MarkerPose> m_markers;
+};
+
+int main(int argc, char** argv)
+{
+	if (argc < 6)
+	{
+		std::fprintf(stderr, "usage: %s <session dir> <fx> <fy> <cx> <cy> [dictId] [markerLength] [speed] [--motion] [--trace <file>]\n", argv[0]);
+		return 1;
+	}
+
+	CameraIntrinsics intrinsics;
+	intrinsics.fx = std::strtof(argv[2], nullptr);
+	intrinsics.fy = std::strtof(argv[3], nullptr);
+	intrinsics.cx = std::strtof(argv[4], nullptr);
+	intrinsics.cy = std::strtof(argv[5], nullptr);
+	int dictId = argc > 6 ? std::atoi(argv[6]) : 0;
+	float markerLength = argc > 7 ? std::strtof(argv[7], nullptr) : 0.05f;
+	double speed = argc > 8 ? std::strtod(argv[8], nullptr) : 0.0;
+	bool motion = false;
+	const char* tracePath = nullptr;
+	for (int i = 9; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--motion") == 0)
+		{
+			motion = true;
+		}
+		else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+		{
+			tracePath = argv[++i];
+		}
+	}
+
+	ReplaySettings replay;
+	replay.pacing = speed > 0.0 ? ReplayPacing::Recorded : ReplayPacing::Max;
+	replay.speed = speed;
+	SessionReplaySource source(argv[1], replay);
+	if (source.Count(LeftFrontCamera) + source.Count(RightFrontCamera) == 0)
+	{
+		std::fprintf(stderr, "no LF/RF frames found in %s\n", argv[1]);
+		return 1;
+	}
+	std::printf("%zu LF, %zu RF, %zu PV frames over %.1f s\n", source.Count(LeftFrontCamera), source.Count(RightFrontCamera),
+		source.Count(PhotoVideoCamera), source.Duration() / 1e7);
+
+	// at the recorded pace frames may be dropped by the queue like on the device, at max speed none is
+	FrontCamerasPipeline pipeline;
+	PipelineSettings settings;
+	settings.synchronous = replay.pacing == ReplayPacing::Max;
+	pipeline.Configure(settings);
+	for (ArUcoDetectorSession* detector : { &pipeline.LFDetector(), &pipeline.RFDetector() })
+	{
+		detector->Configure(dictId, markerLength);
+		detector->SetCameraIntrinsics(intrinsics);
+	}
+
+	ArUcoDetectorSession PVDetector(PhotoVideoCamera);
+	PVDetector.Configure(dictId, markerLength);
+	PVDetector.SetCameraIntrinsics(intrinsics);
+	PhotoVideoTap tap(source, PVDetector);
+
+	// located directly, the synthetic clock has no relation to the recorded one
+	SyntheticRigPoseSource poses;
+
+	if (tracePath != nullptr)
+	{
+		TraceRing::Global().Enable(1 << 20);
+	}
+
+	auto t1 = Clock::now();
+	pipeline.Run(tap, motion ? &poses : nullptr, false);
+	double seconds = std::chrono::duration<double>(Clock::now() - t1).count();
+
+	PipelineStats stats = pipeline.GetStats();
+	PairingStats pairing = pipeline.Pairer().GetStats();
+	FrameQueueStats queue = pipeline.Queue().GetStats();
+	std::printf("pairs %lld, single frames %lld, dropped unpaired %lld, max skew %.2f ms\n",
+		(long long)pairing.paired, (long long)pairing.mono, (long long)pairing.dropped, pairing.maxSkew / 10000.0);
+	std::printf("located %lld, unlocated %lld, processed %lld, dropped by the queue %lld, markers %lld (%.2f per frame)\n",
+		(long long)stats.located, (long long)stats.unlocated, (long long)stats.processed, (long long)queue.dropped,
+		(long long)stats.markers, stats.processed > 0 ? double(stats.markers) / double(stats.processed) : 0.0);
+	std::printf("PV frames %lld, markers %lld\n", (long long)tap.frames, (long long)tap.markers);
+	const char* stages[kLatencyStageCount] = { "acquisition wait", "pose lookup", "detection", "pnp", "buffer copy", "publication" };
+	for (int stage = 0; stage < kLatencyStageCount; stage++)
+	{
+		LatencySummary latency = pipeline.Latencies().Summarize(LatencyStage(stage));
+		std::printf("%-16s  n %8lld   p50 %7.0f   p95 %7.0f   p99 %7.0f   max %7.0f us\n", stages[stage], (long long)latency.count,
+			latency.p50, latency.p95, latency.p99, latency.max);
+	}
+	std::printf("replayed in %.2f s, %.1f frames/s, %.1fx the recorded pace\n", seconds, seconds > 0.0 ? stats.frames / seconds : 0.0,
+		seconds > 0.0 ? source.Duration() / 1e7 / seconds : 0.0);
+
+	if (tracePath != nullptr)
+	{
+		TraceRing::Global().Disable();
+		std::string json = TraceRing::Global().ToChromeJson();
+		FILE* file = std::fopen(tracePath, "wb");
+		if (file == nullptr || std::fwrite(json.data(), 1, json.size(), file) != json.size())
+		{
+			std::fprintf(stderr, "cannot write %s\n", tracePath);
+		}
+		if (file != nullptr)
+		{
+			std::fclose(file);
+		}
+		std::printf("%llu trace events, written to %s\n", (unsigned long long)TraceRing::Global().Recorded(), tracePath);
+	}
+
+	return 0;
+}
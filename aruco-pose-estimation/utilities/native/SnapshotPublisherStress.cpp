@@ -0,0 +1,96 @@
+// Contention stress run for the detection result snapshots returned by
+// GetDetectedMarkers. A producer publishes marker sets of varying size as fast
+// as it can while several readers keep loading the latest snapshot and walking
+// it, like Unity does every frame. Every marker of a snapshot carries the
+// snapshot's sequence number, so a snapshot modified while a reader holds it
+// (or a mix of two frames) is detected.
+//
+// Build on Linux (one command):
+//   g++ -O2 -std=c++17 -pthread -I../../projects/common -o SnapshotPublisherStress SnapshotPublisherStress.cpp
+//
+// Usage:
+//   ./SnapshotPublisherStress [seconds] [readers]
+// Exits with 1 if an inconsistent or out of order snapshot was observed.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "SnapshotPublisher.h"
+
+using namespace HoloLens2CV;
+using Clock = std::chrono::steady_clock;
+
+struct Snapshot
+{
+	uint64_t sequence = 0;
+	std::vector<uint64_t> markers;      // every entry is the sequence the snapshot was filled for
+};
+
+int main(int argc, char** argv)
+{
+	const int seconds = argc > 1 ? std::atoi(argv[1]) : 5;
+	const int readerCount = argc > 2 ? std::max(1, std::atoi(argv[2])) : 2;
+
+	SnapshotPublisher<Snapshot> publisher;
+	std::atomic_bool running = true;
+	std::atomic<uint64_t> reads = 0, inconsistent = 0, outOfOrder = 0;
+
+	std::vector<std::thread> readers;
+	for (int r = 0; r < readerCount; r++)
+	{
+		readers.emplace_back([&] {
+			uint64_t lastSeen = 0;
+			while (running)
+			{
+				auto snapshot = publisher.Latest();
+				if (!snapshot)
+				{
+					continue;
+				}
+				reads++;
+
+				// walk the set twice, it must not change in between
+				uint64_t sequence = snapshot->sequence;
+				size_t count = snapshot->markers.size();
+				bool consistent = std::all_of(snapshot->markers.begin(), snapshot->markers.end(),
+					[sequence](uint64_t v) { return v == sequence; });
+				if (!consistent || count != snapshot->markers.size() || snapshot->sequence != sequence)
+				{
+					inconsistent++;
+				}
+				if (sequence < lastSeen)
+				{
+					outOfOrder++;
+				}
+				lastSeen = sequence;
+			}
+		});
+	}
+
+	uint64_t published = 0;
+	auto end = Clock::now() + std::chrono::seconds(seconds);
+	while (Clock::now() < end)
+	{
+		auto snapshot = publisher.Acquire();
+		uint64_t sequence = publisher.Sequence() + 1;
+		snapshot->markers.assign(size_t(sequence % 17), sequence);
+		publisher.Publish(std::move(snapshot));
+		published++;
+	}
+	running = false;
+	for (auto& reader : readers)
+	{
+		reader.join();
+	}
+
+	std::printf("published: %llu, reads: %llu (%d readers)\n",
+		(unsigned long long)published, (unsigned long long)reads.load(), readerCount);
+	std::printf("inconsistent snapshots: %llu, out of order: %llu\n",
+		(unsigned long long)inconsistent.load(), (unsigned long long)outOfOrder.load());
+	return inconsistent == 0 && outOfOrder == 0 ? 0 : 1;
+}
@@ -0,0 +1,280 @@
+// Times every stage of the detection & pose hot path separately on synthetic
+// scenes: BGRA to grayscale conversion (the vectorized BGRA fallback of the
+// OpenCVHelper input path), thresholding & candidate search, marker decoding,
+// the pose stage and the packing into the flat result buffer. Scenes cover the
+// 320x240 and 896x504 PV and the 640x480 VLC resolutions, 1 to 16 markers and
+// dictionaries from 4x4_50 to APRILTAG_36h11.
+//
+// The ArUco detector does not expose its stages. The candidate stage repeats
+// its adaptive thresholding, contour search & polygon fit at the window sizes
+// of the detector parameters, the decoding stage is the full detectMarkers
+// time minus the candidate stage.
+//
+// Results are written as CSV (times in microseconds, median / p95 / min over
+// the iterations). Passing the CSV of an earlier build compares the medians.
+//
+// Build on Linux (one command):
+//   g++ -O2 -std=c++17 -I../../projects/common -o StageBench StageBench.cpp
+//       ../../projects/common/ArUcoDetectorSession.cpp ../../projects/common/UndistortionTable.cpp
+//       ../../projects/common/MarkerResultBuffer.cpp ../../projects/common/GrayConversion.cpp
+//       $(pkg-config --cflags --libs opencv4)
+//
+// Usage:
+//   ./StageBench [iterations] [baseline csv] [tolerance] > stages.csv
+// Exits with 1 if a stage median is slower than tolerance (default 1.25) times
+// the baseline one.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ArUcoDetectorSession.h"
+#include "GrayConversion.h"
+#include "MarkerResultBuffer.h"
+
+using namespace HoloLens2CV;
+using Clock = std::chrono::steady_clock;
+
+struct DictionaryCase
+{
+	int id;
+	const char* name;
+};
+
+static const DictionaryCase kDictionaries[] = {
+	{ 0, "4X4_50" }, { 6, "5X5_250" }, { 10, "6X6_250" }, { 15, "7X7_1000" },
+	{ 16, "ARUCO_ORIGINAL" }, { 17, "APRILTAG_16h5" }, { 20, "APRILTAG_36h11" } };
+
+static const char* kStages[] = { "gray", "candidates", "decode", "pose", "package" };
+static const int kStageCount = 5;
+
+// markers on a grid with a white quiet zone, a soft gradient, blur & sensor noise
+static cv::Mat MakeScene(const cv::Size& size, int dictId, int markers)
+{
+	cv::Mat scene(size, CV_8U);
+	for (int y = 0; y < size.height; y++)
+	{
+		for (int x = 0; x < size.width; x++)
+		{
+			scene.at<uint8_t>(y, x) = uint8_t(90 + 60 * x / size.width + 30 * y / size.height);
+		}
+	}
+
+	cv::aruco::Dictionary dictionary = cv::aruco::getPredefinedDictionary(dictId);
+	int side = int(std::ceil(std::sqrt(double(markers))));
+	int cell = std::min(size.width, size.height) / side;
+	int x0 = (size.width - cell * side) / 2, y0 = (size.height - cell * side) / 2;
+	for (int i = 0; i < markers; i++)
+	{
+		// a little smaller towards the end, like markers further away
+		int length = int(cell * (0.6 - 0.15 * i / markers));
+		int quiet = length / 6;
+		cv::Rect area(x0 + (i % side) * cell + (cell - length) / 2, y0 + (i / side) * cell + (cell - length) / 2, length, length);
+		cv::Rect border(area.x - quiet, area.y - quiet, length + 2 * quiet, length + 2 * quiet);
+		scene(border).setTo(cv::Scalar(235));
+
+		cv::Mat marker, target = scene(area);
+		cv::aruco::generateImageMarker(dictionary, i, length, marker, 1);
+		marker.copyTo(target);
+	}
+
+	cv::GaussianBlur(scene, scene, cv::Size(3, 3), 0.8);
+	cv::Mat noise(size, CV_8U);
+	cv::randu(noise, cv::Scalar(0), cv::Scalar(6));
+	cv::add(scene, noise, scene);
+	return scene;
+}
+
+// adaptive thresholding, contours & quadrilateral fit of the ArUco candidate search, number of candidates
+static size_t FindCandidates(const cv::Mat& gray, const cv::aruco::DetectorParameters& parameters,
+	cv::Mat& thresholded, std::vector<std::vector<cv::Point>>& contours, std::vector<cv::Point>& polygon)
+{
+	size_t candidates = 0;
+	int maxDimension = std::max(gray.cols, gray.rows);
+	double minPerimeter = parameters.minMarkerPerimeterRate * maxDimension;
+	double maxPerimeter = parameters.maxMarkerPerimeterRate * maxDimension;
+	for (int window = parameters.adaptiveThreshWinSizeMin; window <= parameters.adaptiveThreshWinSizeMax;
+		window += parameters.adaptiveThreshWinSizeStep)
+	{
+		int size = window | 1;
+		cv::adaptiveThreshold(gray, thresholded, 255, cv::ADAPTIVE_THRESH_MEAN_C, cv::THRESH_BINARY_INV, size,
+			parameters.adaptiveThreshConstant);
+		cv::findContours(thresholded, contours, cv::RETR_LIST, cv::CHAIN_APPROX_NONE);
+		for (const std::vector<cv::Point>& contour : contours)
+		{
+			if (contour.size() < minPerimeter || contour.size() > maxPerimeter)
+			{
+				continue;
+			}
+			cv::approxPolyDP(contour, polygon, double(contour.size()) * parameters.polygonalApproxAccuracyRate, true);
+			candidates += polygon.size() == 4 && cv::isContourConvex(polygon) ? 1 : 0;
+		}
+	}
+	return candidates;
+}
+
+struct Row
+{
+	std::string key;        // resolution, dictionary, markers, stage
+	int detected;
+	double median, p95, min;
+};
+
+static void Summarize(std::vector<double>& samples, double& median, double& p95, double& min)
+{
+	std::sort(samples.begin(), samples.end());
+	median = samples[samples.size() / 2];
+	p95 = samples[std::min(samples.size() - 1, samples.size() * 95 / 100)];
+	min = samples.front();
+}
+
+// median per key of an earlier run
+static std::map<std::string, double> LoadBaseline(const char* path)
+{
+	std::map<std::string, double> baseline;
+	std::ifstream file(path);
+	std::string line;
+	std::getline(file, line);       // header
+	while (std::getline(file, line))
+	{
+		std::vector<std::string> fields;
+		std::stringstream stream(line);
+		std::string field;
+		while (std::getline(stream, field, ','))
+		{
+			fields.push_back(field);
+		}
+		if (fields.size() >= 6)
+		{
+			baseline[fields[0] + "," + fields[1] + "," + fields[2] + "," + fields[4]] = std::strtod(fields[5].c_str(), nullptr);
+		}
+	}
+	return baseline;
+}
+
+int main(int argc, char** argv)
+{
+	const int iterations = std::max(1, argc > 1 ? std::atoi(argv[1]) : 50);
+	const char* baselinePath = argc > 2 ? argv[2] : nullptr;
+	const double tolerance = argc > 3 ? std::strtod(argv[3], nullptr) : 1.25;
+	const float markerLength = 0.05f;
+
+	const cv::aruco::DetectorParameters parameters;
+	std::vector<Row> rows;
+	std::vector<double> samples[kStageCount];
+	cv::Mat bgra, gray, thresholded;
+	std::vector<std::vector<cv::Point>> contours;
+	std::vector<cv::Point> polygon;
+	std::vector<std::vector<cv::Point2f>> corners, rejected;
+	std::vector<int> ids;
+	std::vector<MarkerPose> markers;
+	std::vector<uint32_t> buffer;
+	MarkerFrameInfo frame;
+
+	std::printf("resolution,dictionary,markers,detected,stage,median_us,p95_us,min_us\n");
+	for (cv::Size size : { cv::Size(320, 240), cv::Size(640, 480), cv::Size(896, 504) })
+	{
+		CameraIntrinsics intrinsics;
+		intrinsics.fx = intrinsics.fy = 0.9f * size.width;
+		intrinsics.cx = size.width / 2.f;
+		intrinsics.cy = size.height / 2.f;
+
+		for (const DictionaryCase& dictionary : kDictionaries)
+		{
+			ArUcoDetectorSession session;
+			session.Configure(dictionary.id, markerLength);
+			session.SetCameraIntrinsics(intrinsics);
+
+			// same dictionary & parameters as the session, detection without the pose stage
+			cv::aruco::ArucoDetector detector(cv::aruco::getPredefinedDictionary(dictionary.id), parameters);
+
+			for (int count : { 1, 4, 16 })
+			{
+				cv::cvtColor(MakeScene(size, dictionary.id, count), bgra, cv::COLOR_GRAY2BGRA);
+				for (std::vector<double>& s : samples)
+				{
+					s.clear();
+				}
+
+				for (int i = 0; i < iterations; i++)
+				{
+					auto t0 = Clock::now();
+					gray.create(bgra.rows, bgra.cols, CV_8U);
+					BgraToGray(bgra.data, bgra.step, bgra.cols, bgra.rows, gray.data, gray.step);
+					auto t1 = Clock::now();
+					FindCandidates(gray, parameters, thresholded, contours, polygon);
+					auto t2 = Clock::now();
+					detector.detectMarkers(gray, corners, ids, rejected);
+					auto t3 = Clock::now();
+
+					markers.resize(ids.size());
+					for (size_t m = 0; m < ids.size(); m++)
+					{
+						markers[m].id = ids[m];
+						std::copy(corners[m].begin(), corners[m].end(), markers[m].corners.begin());
+					}
+					auto t4 = Clock::now();
+					session.EstimatePoses(markers, size);
+					auto t5 = Clock::now();
+					buffer.resize(MarkerBufferWords(markers.size()));
+					PackMarkerBuffer(frame, markers, buffer.data(), buffer.size());
+					auto t6 = Clock::now();
+
+					double candidates = std::chrono::duration<double, std::micro>(t2 - t1).count();
+					double detect = std::chrono::duration<double, std::micro>(t3 - t2).count();
+					samples[0].push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+					samples[1].push_back(candidates);
+					samples[2].push_back(std::max(0.0, detect - candidates));
+					samples[3].push_back(std::chrono::duration<double, std::micro>(t5 - t4).count());
+					samples[4].push_back(std::chrono::duration<double, std::micro>(t6 - t5).count());
+				}
+
+				for (int stage = 0; stage < kStageCount; stage++)
+				{
+					Row row;
+					row.key = std::to_string(size.width) + "x" + std::to_string(size.height) + "," + dictionary.name + "," +
+						std::to_string(count) + "," + kStages[stage];
+					row.detected = int(ids.size());
+					Summarize(samples[stage], row.median, row.p95, row.min);
+					std::printf("%dx%d,%s,%d,%d,%s,%.1f,%.1f,%.1f\n", size.width, size.height, dictionary.name, count,
+						row.detected, kStages[stage], row.median, row.p95, row.min);
+					rows.push_back(row);
+				}
+				std::fflush(stdout);
+			}
+		}
+	}
+
+	if (baselinePath == nullptr)
+	{
+		return 0;
+	}
+
+	// stages below 5 us are timer noise, they are listed but not judged
+	std::map<std::string, double> baseline = LoadBaseline(baselinePath);
+	int slower = 0, compared = 0;
+	for (const Row& row : rows)
+	{
+		auto it = baseline.find(row.key);
+		if (it == baseline.end() || it->second <= 0.0)
+		{
+			continue;
+		}
+		compared++;
+		double ratio = row.median / it->second;
+		if (ratio > tolerance && row.median > 5.0)
+		{
+			slower++;
+			std::fprintf(stderr, "slower: %s %.1f -> %.1f us (%.2fx)\n", row.key.c_str(), it->second, row.median, ratio);
+		}
+	}
+	std::fprintf(stderr, "%d of %d stages slower than %.2fx the baseline\n", slower, compared, tolerance);
+	return slower > 0 ? 1 : 0;
+}
@@ -0,0 +1,202 @@
+// Monocular PnP against stereo triangulation on synthetic stereo pairs. A
+// marker is placed at growing distances in front of a rig of two 640x480
+// VLC like cameras (10 cm baseline, RF turned 5 degrees outwards), its
+// corners projected into both images with pixel noise, and its pose solved
+// from the LF corners alone and from both views. Reports the mean depth,
+// position and rotation error of both, then checks the id matching of
+// StereoMarkerTriangulator::Process on a merged LF/RF marker set.
+//
+// Build on Linux (one command):
+//   g++ -O2 -std=c++17 -I../../projects/common -o StereoBench StereoBench.cpp
+//       ../../projects/common/StereoMarkerTriangulator.cpp ../../projects/common/ArUcoDetectorSession.cpp
+//       ../../projects/common/UndistortionTable.cpp $(pkg-config --cflags --libs opencv4)
+//
+// Usage:
+//   ./StereoBench [pixel noise] [trials]
+// Exits with 1 if the stereo depth is not more accurate than the mono one for
+// markers smaller than the baseline from 1 m on, or the id matching is wrong.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "ArUcoDetectorSession.h"
+#include "StereoMarkerTriangulator.h"
+
+using namespace HoloLens2CV;
+
+static const double kBaseline = 0.10;
+static const double kPi = 3.14159265358979323846;
+
+static cv::Matx44d Transform(const cv::Vec3d& rvec, const cv::Vec3d& tvec)
+{
+	cv::Matx33d R;
+	cv::Rodrigues(rvec, R);
+	return cv::Matx44d(
+		R(0, 0), R(0, 1), R(0, 2), tvec[0],
+		R(1, 0), R(1, 1), R(1, 2), tvec[1],
+		R(2, 0), R(2, 1), R(2, 2), tvec[2],
+		0, 0, 0, 1);
+}
+
+// corners of a marker with pose markerToCamera projected into a camera, plus noise
+static void Project(const cv::Matx44d& markerToCamera, float markerLength, const cv::Matx33d& K, const cv::Matx<double, 1, 5>& distortion,
+	std::normal_distribution<float>& noise, std::mt19937& rng, MarkerPose& marker)
+{
+	float h = markerLength / 2.f;
+	std::vector<cv::Point3f> object = { { -h, h, 0 }, { h, h, 0 }, { h, -h, 0 }, { -h, -h, 0 } };
+	cv::Matx33d R(
+		markerToCamera(0, 0), markerToCamera(0, 1), markerToCamera(0, 2),
+		markerToCamera(1, 0), markerToCamera(1, 1), markerToCamera(1, 2),
+		markerToCamera(2, 0), markerToCamera(2, 1), markerToCamera(2, 2));
+	cv::Vec3d rvec, tvec(markerToCamera(0, 3), markerToCamera(1, 3), markerToCamera(2, 3));
+	cv::Rodrigues(R, rvec);
+
+	std::vector<cv::Point2f> projected;
+	cv::projectPoints(object, rvec, tvec, K, distortion, projected);
+	for (int c = 0; c < 4; c++)
+	{
+		marker.corners[c] = projected[c] + cv::Point2f(noise(rng), noise(rng));
+	}
+}
+
+static double RotationError(const cv::Vec3d& estimated, const cv::Vec3d& truth)
+{
+	cv::Matx33d A, B;
+	cv::Rodrigues(estimated, A);
+	cv::Rodrigues(truth, B);
+	cv::Matx33d D = A.t() * B;
+	double c = std::min(std::max((D(0, 0) + D(1, 1) + D(2, 2) - 1.0) / 2.0, -1.0), 1.0);
+	return std::acos(c) * 180.0 / kPi;
+}
+
+int main(int argc, char** argv)
+{
+	const float pixelNoise = argc > 1 ? float(std::strtod(argv[1], nullptr)) : 0.3f;
+	const int trials = argc > 2 ? std::atoi(argv[2]) : 500;
+
+	CameraIntrinsics intrinsics;
+	intrinsics.fx = intrinsics.fy = 450.f;
+	intrinsics.cx = 320.f;
+	intrinsics.cy = 240.f;
+	intrinsics.k1 = -0.12f;
+	intrinsics.k2 = 0.03f;
+	const cv::Size imageSize(640, 480);
+	cv::Matx33d K(intrinsics.fx, 0, intrinsics.cx, 0, intrinsics.fy, intrinsics.cy, 0, 0, 1);
+	cv::Matx<double, 1, 5> distortion(intrinsics.k1, intrinsics.k2, intrinsics.p1, intrinsics.p2, intrinsics.k3);
+
+	// RF sits on the right of LF, turned outwards around its y axis
+	const double yaw = 5.0 * kPi / 180.0;
+	cv::Matx44d RFToLF = Transform(cv::Vec3d(0, yaw, 0), cv::Vec3d(kBaseline, 0, 0));
+	cv::Matx44d RFFromLF = RFToLF.inv();
+
+	std::mt19937 rng(3);
+	std::normal_distribution<float> noise(0.f, pixelNoise);
+	std::uniform_real_distribution<double> jitter(-1.0, 1.0);
+	bool better = true;
+
+	std::printf("pixel noise %.2f px, baseline %.0f mm, %d trials\n", pixelNoise, kBaseline * 1000.0, trials);
+	std::printf("marker (mm)   distance (m)   depth err mono / stereo (mm)   pos err mono / stereo (mm)   rot err mono / stereo (deg)   rejected\n");
+	for (float markerLength : { 0.03f, 0.05f, 0.10f })
+	{
+		ArUcoDetectorSession session;
+		session.Configure(0, markerLength);
+		session.SetCameraIntrinsics(intrinsics);
+		PoseSettings pose;
+		pose.solver = PoseSolver::IppeSquare;
+		session.ConfigurePose(pose);
+
+		StereoSettings settings;
+		settings.enabled = true;
+		StereoMarkerTriangulator stereo;
+		stereo.Configure(settings);
+		stereo.SetMarkerLength(markerLength);
+		stereo.SetCameraIntrinsics(LeftFrontCamera, intrinsics);
+		stereo.SetCameraIntrinsics(RightFrontCamera, intrinsics);
+		stereo.SetExtrinsics(RFFromLF);
+
+		for (double distance : { 0.3, 0.5, 1.0, 1.5, 2.0, 3.0 })
+		{
+			double depthError[2] = {}, positionError[2] = {}, rotationError[2] = {};
+			int rejected = 0, solved = 0;
+			std::vector<MarkerPose> markers(1);
+			for (int t = 0; t < trials; t++)
+			{
+				// between both cameras, facing the rig (rvec ~ pi around x) with some tilt
+				cv::Vec3d rvec(kPi + 0.3 * jitter(rng), 0.3 * jitter(rng), 0.1 * jitter(rng));
+				cv::Vec3d tvec(kBaseline / 2.0 + 0.05 * jitter(rng), 0.05 * jitter(rng), distance);
+				cv::Matx44d markerToLF = Transform(rvec, tvec);
+
+				MarkerPose LF, RF;
+				LF.id = RF.id = 1;
+				RF.camera = RightFrontCamera;
+				Project(markerToLF, markerLength, K, distortion, noise, rng, LF);
+				Project(RFFromLF * markerToLF, markerLength, K, distortion, noise, rng, RF);
+
+				MarkerPose fused;
+				if (!stereo.Triangulate(LF, RF, fused))
+				{
+					rejected++;
+					continue;
+				}
+				markers[0] = LF;
+				session.EstimatePoses(markers, imageSize);
+
+				const MarkerPose* estimates[2] = { &markers[0], &fused };
+				for (int k = 0; k < 2; k++)
+				{
+					cv::Vec3d d = estimates[k]->tvec - tvec;
+					depthError[k] += std::fabs(d[2]) * 1000.0;
+					positionError[k] += std::sqrt(d.dot(d)) * 1000.0;
+					rotationError[k] += RotationError(estimates[k]->rvec, rvec);
+				}
+				solved++;
+			}
+
+			double n = solved > 0 ? double(solved) : 1.0;
+			std::printf("%11.0f   %12.1f   %13.1f / %-13.1f   %12.1f / %-12.1f   %12.2f / %-12.2f   %8d\n",
+				markerLength * 1000.0, distance, depthError[0] / n, depthError[1] / n, positionError[0] / n, positionError[1] / n,
+				rotationError[0] / n, rotationError[1] / n, rejected);
+
+			if (markerLength < kBaseline && distance >= 1.0 && depthError[1] >= depthError[0])
+			{
+				better = false;
+			}
+		}
+	}
+
+	// merged set: id 1 on both cameras, id 2 on LF only, id 3 on RF only
+	StereoSettings settings;
+	settings.enabled = true;
+	StereoMarkerTriangulator stereo;
+	stereo.Configure(settings);
+	stereo.SetMarkerLength(0.05f);
+	stereo.SetCameraIntrinsics(LeftFrontCamera, intrinsics);
+	stereo.SetCameraIntrinsics(RightFrontCamera, intrinsics);
+	stereo.SetExtrinsics(RFFromLF);
+
+	std::normal_distribution<float> none(0.f, 1e-6f);
+	std::vector<MarkerPose> merged(4);
+	cv::Matx44d markerToLF = Transform(cv::Vec3d(kPi, 0, 0), cv::Vec3d(kBaseline / 2.0, 0, 0.8));
+	merged[0].id = 1;
+	Project(markerToLF, 0.05f, K, distortion, none, rng, merged[0]);
+	merged[1].id = 2;
+	merged[2].id = 1;
+	merged[2].camera = RightFrontCamera;
+	Project(RFFromLF * markerToLF, 0.05f, K, distortion, none, rng, merged[2]);
+	merged[3].id = 3;
+	merged[3].camera = RightFrontCamera;
+	stereo.Process(merged);
+
+	StereoStats stats = stereo.GetStats();
+	bool matched = merged.size() == 3 && stats.stereo == 1 && stats.mono == 2 &&
+		merged[0].id == 1 && merged[0].camera == LeftFrontCamera && std::fabs(merged[0].tvec[2] - 0.8) < 1e-3 &&
+		merged[1].id == 2 && merged[2].id == 3 && merged[2].camera == RightFrontCamera;
+	std::printf("id matching: %s (stereo %lld, mono %lld, rejected %lld)\n", matched ? "ok" : "FAILED",
+		(long long)stats.stereo, (long long)stats.mono, (long long)stats.rejected);
+
+	return better && matched ? 0 : 1;
+}
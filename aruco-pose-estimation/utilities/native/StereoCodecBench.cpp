@@ -0,0 +1,210 @@
+// Measures the compression of the front camera pairs sent as 'c' messages:
+// for every predictor and max error 0, 1, 2 & 4 the compression ratio against
+// the raw 'f' payload, the median encode & decode time per pair, the pairs per
+// second one thread encodes and how many times that is the 30 pairs per second
+// of the cameras. Every pair is decoded & compared: lossless must give the
+// images back bit by bit, lossy must keep every pixel within the max error.
+//
+// The pairs come from a recorded session (a LF image & the next RF one), or
+// are synthetic with --synthetic. Run it on an ARM64 board too, the plugin
+// encodes on the headset's ARM64 cores.
+//
+// Build on Linux (one command, -O3 as GCC vectorizes the lossless predictors
+// only there, MSVC's /O2 of the plugin does):
+//   g++ -O3 -std=c++17 -I../../projects/common -o StereoCodecBench StereoCodecBench.cpp
+//       ../../projects/common/StereoFrameCodec.cpp ../../projects/common/SessionReplaySource.cpp
+//       ../../projects/common/FileFrameSource.cpp ../../projects/common/SessionRecording.cpp $(pkg-config --cflags --libs opencv4)
+//
+// Usage:
+//   ./StereoCodecBench <session dir | --synthetic> [max pairs] [repeats] > codec.csv
+// Exits with 1 if a pair does not decode or decodes beyond its max error.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "SessionReplaySource.h"
+#include "StereoFrameCodec.h"
+
+using namespace HoloLens2CV;
+using Clock = std::chrono::steady_clock;
+
+// the research mode streams of the visible light cameras
+static const double kCameraPairsPerSecond = 30.0;
+
+struct StereoPair
+{
+	int width = 0;
+	int height = 0;
+	std::vector<uint8_t> LF;
+	std::vector<uint8_t> RF;
+};
+
+static std::vector<StereoPair> LoadSession(const std::string& session, size_t maxPairs)
+{
+	ReplaySettings replay;
+	replay.pacing = ReplayPacing::Max;
+	SessionReplaySource source(session, replay);
+
+	// a LF frame waits for the next RF one, as IngestReplayClient pairs them
+	std::vector<StereoPair> pairs;
+	StereoPair pair;
+	bool hasLF = false;
+	int camera = 0;
+	CameraFrame frame;
+	while (pairs.size() < maxPairs && source.Next(camera, frame))
+	{
+		if (camera == 0)
+		{
+			pair.width = frame.width;
+			pair.height = frame.height;
+			pair.LF = frame.image;
+			hasLF = true;
+		}
+		else if (camera == 1 && hasLF && frame.width == pair.width && frame.height == pair.height)
+		{
+			pair.RF = frame.image;
+			pairs.push_back(pair);
+			hasLF = false;
+		}
+	}
+	return pairs;
+}
+
+// smooth shading, a checkerboard & sensor noise, the RF image a shifted LF one
+static std::vector<StereoPair> Synthetic(size_t count)
+{
+	std::vector<StereoPair> pairs;
+	std::mt19937 random(1);
+	std::normal_distribution<double> noise(0.0, 2.0);
+	for (size_t i = 0; i < count; i++)
+	{
+		StereoPair pair;
+		pair.width = 640;
+		pair.height = 480;
+		for (int camera = 0; camera < 2; camera++)
+		{
+			std::vector<uint8_t>& image = camera == 0 ? pair.LF : pair.RF;
+			image.resize(640 * 480);
+			for (int y = 0; y < 480; y++)
+			{
+				for (int x = 0; x < 640; x++)
+				{
+					int sx = x + (camera == 0 ? 40 : 0) + int(i);
+					double value = 110.0 + 60.0 * std::sin(sx * 0.011) * std::cos(y * 0.017);
+					if (sx >= 280 && sx < 400 && y >= 160 && y < 240)
+					{
+						value = ((sx - 280) / 20 + (y - 160) / 20) % 2 ? 230.0 : 20.0;
+					}
+					image[size_t(y) * 640 + x] = uint8_t(std::clamp(value + noise(random), 0.0, 255.0));
+				}
+			}
+		}
+		pairs.push_back(std::move(pair));
+	}
+	return pairs;
+}
+
+static double Median(std::vector<double>& samples)
+{
+	std::sort(samples.begin(), samples.end());
+	return samples.empty() ? 0.0 : samples[samples.size() / 2];
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::fprintf(stderr, "usage: %s <session dir | --synthetic> [max pairs] [repeats]\n", argv[0]);
+		return 1;
+	}
+	const size_t maxPairs = size_t(std::max(1, argc > 2 ? std::atoi(argv[2]) : 200));
+	const int repeats = std::max(1, argc > 3 ? std::atoi(argv[3]) : 3);
+	std::vector<StereoPair> pairs = std::strcmp(argv[1], "--synthetic") == 0 ? Synthetic(std::min<size_t>(maxPairs, 30)) :
+		LoadSession(argv[1], maxPairs);
+	if (pairs.empty())
+	{
+		std::fprintf(stderr, "no LF/RF pairs in %s\n", argv[1]);
+		return 1;
+	}
+	std::fprintf(stderr, "%zu pairs of %dx%d\n", pairs.size(), pairs[0].width, pairs[0].height);
+
+	bool ok = true;
+	StereoFrameCodec encoder, decoder;
+	std::vector<uint8_t> encoded, LF, RF;
+	std::printf("predictor,max_error,ratio,encode_us,decode_us,pairs_per_s,realtime_x,max_abs_error,psnr_db\n");
+	for (FramePredictor predictor : { FramePredictor::None, FramePredictor::Left, FramePredictor::Up, FramePredictor::Med })
+	{
+		for (int maxError : { 0, 1, 2, 4 })
+		{
+			// the predictor is what makes the error bounded, raw pixels are only sent lossless
+			if (predictor == FramePredictor::None && maxError > 0)
+			{
+				continue;
+			}
+			StereoCodecSettings settings;
+			settings.predictor = predictor;
+			settings.maxError = maxError;
+
+			std::vector<double> encodeUs, decodeUs;
+			double raw = 0.0, compressed = 0.0, squaredError = 0.0;
+			int worst = 0;
+			bool decoded = true;
+			for (const StereoPair& pair : pairs)
+			{
+				for (int r = 0; r < repeats; r++)
+				{
+					encoded.clear();
+					auto t1 = Clock::now();
+					encoder.Encode(pair.LF.data(), pair.RF.data(), pair.width, pair.height, settings, encoded);
+					auto t2 = Clock::now();
+					int width = 0, height = 0;
+					decoded = decoder.Decode(encoded.data(), encoded.size(), width, height, LF, RF) && decoded &&
+						width == pair.width && height == pair.height;
+					auto t3 = Clock::now();
+					encodeUs.push_back(std::chrono::duration<double, std::micro>(t2 - t1).count());
+					decodeUs.push_back(std::chrono::duration<double, std::micro>(t3 - t2).count());
+				}
+				if (!decoded)
+				{
+					break;
+				}
+
+				raw += double(pair.LF.size() + pair.RF.size());
+				compressed += double(encoded.size());
+				for (size_t p = 0; p < pair.LF.size(); p++)
+				{
+					int errors[2] = { std::abs(int(LF[p]) - int(pair.LF[p])), std::abs(int(RF[p]) - int(pair.RF[p])) };
+					worst = std::max(worst, std::max(errors[0], errors[1]));
+					squaredError += double(errors[0] * errors[0] + errors[1] * errors[1]);
+				}
+			}
+
+			bool bounded = decoded && worst <= maxError;
+			if (!bounded)
+			{
+				std::fprintf(stderr, "%s max error %d: %s\n", FramePredictorName(predictor), maxError,
+					decoded ? "pixels beyond the max error" : "a pair did not decode");
+			}
+			ok = ok && bounded;
+
+			double encode = Median(encodeUs), decode = Median(decodeUs);
+			double pairsPerSecond = encode > 0.0 ? 1e6 / encode : 0.0;
+			double mse = raw > 0.0 ? squaredError / raw : 0.0;
+			std::printf("%s,%d,%.2f,%.0f,%.0f,%.0f,%.1f,%d,%.1f\n", FramePredictorName(predictor), maxError,
+				compressed > 0.0 ? raw / compressed : 0.0, encode, decode, pairsPerSecond, pairsPerSecond / kCameraPairsPerSecond,
+				worst, mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0);
+		}
+	}
+
+	std::fprintf(stderr, "round trips within the max error: %s\n", ok ? "ok" : "FAILED");
+	return ok ? 0 : 1;
+}
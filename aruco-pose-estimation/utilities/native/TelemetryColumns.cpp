@@ -0,0 +1,345 @@
+// Decodes the marker telemetry batches ('t' messages, MarkerTelemetry.h) that
+// HeadsetIngest saves, into one column per field for analysis: a directory of
+// .npy files, frame, timestamp, id, tvec (n x 3), rvec (n x 3),
+// reprojection_error and camera_to_world (n x 3 x 4), a row per marker. Load
+// them with numpy.load(path, mmap_mode='r'), or as a pandas DataFrame.
+//
+// The input is a telemetry.bin, a SessionRecording (HeadsetIngest --record), or
+// a session directory holding either. It is streamed in chunks, the columns
+// are written as the batches are decoded. With --synthetic, batches of random
+// markers are encoded & decoded instead, to measure both and the bytes the
+// same markers take as 'm' text messages.
+//
+// Build on Linux (one command):
+//   g++ -O2 -std=c++17 -I../../projects/common -o TelemetryColumns TelemetryColumns.cpp
+//       ../../projects/common/MarkerTelemetry.cpp ../../projects/common/SessionRecording.cpp
+//
+// Usage:
+//   ./TelemetryColumns <telemetry.bin | recording | session dir> <output dir> > telemetry.csv
+//   ./TelemetryColumns --synthetic [frames] [markers per frame] <output dir> > telemetry.csv
+// Exits with 1 if the input holds a corrupt batch or a column cannot be written.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "MarkerTelemetry.h"
+#include "SessionRecording.h"
+
+using namespace HoloLens2CV;
+using Clock = std::chrono::steady_clock;
+
+// a .npy file written row by row, the shape in its header is set on Close
+class NpyColumn
+{
+public:
+	NpyColumn(const std::string& path, const char* descr, size_t itemSize, const char* rowShape)
+		: m_path(path), m_descr(descr), m_itemSize(itemSize), m_rowShape(rowShape)
+	{
+		m_file = std::fopen(path.c_str(), "wb");
+		m_failed = m_file == nullptr || std::fwrite(Header().data(), 1, kHeaderSize, m_file) != kHeaderSize;
+	}
+
+	~NpyColumn()
+	{
+		Close();
+	}
+
+	void Append(const void* values, size_t bytes)
+	{
+		const uint8_t* data = static_cast<const uint8_t*>(values);
+		m_staged.insert(m_staged.end(), data, data + bytes);
+		m_bytes += bytes;
+		if (m_staged.size() >= (1 << 20))
+		{
+			Drain();
+		}
+	}
+
+	// false if a write failed
+	bool Close()
+	{
+		if (m_file == nullptr)
+		{
+			return !m_failed;
+		}
+		Drain();
+		m_failed = m_failed || std::fseek(m_file, 0, SEEK_SET) != 0 ||
+			std::fwrite(Header().data(), 1, kHeaderSize, m_file) != kHeaderSize;
+		m_failed = std::fclose(m_file) != 0 || m_failed;
+		m_file = nullptr;
+		return !m_failed;
+	}
+
+	const std::string& Path() const { return m_path; }
+
+private:
+	static const size_t kHeaderSize = 128;      // room for any row count
+
+	void Drain()
+	{
+		m_failed = m_failed || m_file == nullptr ||
+			(!m_staged.empty() && std::fwrite(m_staged.data(), 1, m_staged.size(), m_file) != m_staged.size());
+		m_staged.clear();
+	}
+
+	// version 1.0: magic, header length, a dict padded with spaces & ending in a newline
+	std::string Header() const
+	{
+		std::string dict = "{'descr': '" + m_descr + "', 'fortran_order': False, 'shape': (" +
+			std::to_string(m_bytes / m_itemSize) + (m_rowShape.empty() ? "," : ", " + m_rowShape) + "), }";
+		std::string header("\x93NUMPY\x01\x00", 8);
+		header.push_back(char((kHeaderSize - 10) & 0xFF));
+		header.push_back(char((kHeaderSize - 10) >> 8));
+		header += dict;
+		header.resize(kHeaderSize - 1, ' ');
+		header.push_back('\n');
+		return header;
+	}
+
+	std::string m_path;
+	std::string m_descr;
+	size_t m_itemSize;                  // bytes per row
+	std::string m_rowShape;
+	std::FILE* m_file = nullptr;
+	std::vector<uint8_t> m_staged;
+	size_t m_bytes = 0;
+	bool m_failed = false;
+};
+
+// the 'm' message ArUcoTracking.cs sent per marker before the batches
+static size_t TextBytes(const MarkerTelemetry& marker)
+{
+	char text[256];
+	int length = std::snprintf(text, sizeof(text), "Marker [%d] \ntranslation (XYZ): %.7g %.7g %.7g \nrotation (Rodrigues XYZ): %.7g %.7g %.7g",
+		marker.id, marker.tvec[0], marker.tvec[1], marker.tvec[2], marker.rvec[0], marker.rvec[1], marker.rvec[2]);
+	return 5 + size_t(std::max(length, 0));
+}
+
+struct TelemetryColumns
+{
+	explicit TelemetryColumns(const std::string& directory)
+	{
+		auto add = [&](const char* name, const char* descr, size_t itemSize, const char* rowShape)
+		{
+			columns.push_back(std::make_unique<NpyColumn>((std::filesystem::path(directory) / name).string(), descr, itemSize, rowShape));
+			return columns.back().get();
+		};
+		frame = add("frame.npy", "<i8", 8, "");
+		timestamp = add("timestamp.npy", "<i8", 8, "");
+		id = add("id.npy", "<i4", 4, "");
+		tvec = add("tvec.npy", "<f4", 12, "3");
+		rvec = add("rvec.npy", "<f4", 12, "3");
+		error = add("reprojection_error.npy", "<f4", 4, "");
+		cameraToWorld = add("camera_to_world.npy", "<f4", 48, "3, 4");
+	}
+
+	void Append(const MarkerTelemetryBatch& batch)
+	{
+		for (const MarkerTelemetry& marker : batch.markers)
+		{
+			frame->Append(&batch.frameSequence, 8);
+			timestamp->Append(&batch.timestamp, 8);
+			id->Append(&marker.id, 4);
+			tvec->Append(marker.tvec, 12);
+			rvec->Append(marker.rvec, 12);
+			error->Append(&marker.reprojectionError, 4);
+			cameraToWorld->Append(batch.cameraToWorld, 48);
+			textBytes += int64_t(TextBytes(marker));
+		}
+		batches++;
+		markers += int64_t(batch.markers.size());
+	}
+
+	bool Close()
+	{
+		bool ok = true;
+		for (auto& column : columns)
+		{
+			if (!column->Close())
+			{
+				std::fprintf(stderr, "cannot write %s\n", column->Path().c_str());
+				ok = false;
+			}
+		}
+		return ok;
+	}
+
+	std::vector<std::unique_ptr<NpyColumn>> columns;
+	NpyColumn* frame;
+	NpyColumn* timestamp;
+	NpyColumn* id;
+	NpyColumn* tvec;
+	NpyColumn* rvec;
+	NpyColumn* error;
+	NpyColumn* cameraToWorld;
+	int64_t batches = 0;
+	int64_t markers = 0;
+	int64_t textBytes = 0;              // had they been sent as 'm' messages
+};
+
+// decodes the batches of a telemetry.bin chunk by chunk, false on a corrupt or cut batch
+static bool DecodeFile(const std::string& path, TelemetryColumns& columns, int64_t& bytes)
+{
+	std::FILE* file = std::fopen(path.c_str(), "rb");
+	if (file == nullptr)
+	{
+		std::fprintf(stderr, "cannot open %s\n", path.c_str());
+		return false;
+	}
+	std::vector<uint8_t> buffer(1 << 20);
+	size_t filled = 0;
+	bool ok = true, end = false;
+	MarkerTelemetryBatch batch;
+	while (ok && !end)
+	{
+		size_t read = std::fread(buffer.data() + filled, 1, buffer.size() - filled, file);
+		end = read == 0;
+		filled += read;
+		bytes += int64_t(read);
+
+		size_t at = 0;
+		for (size_t size; (size = DecodeMarkerTelemetry(buffer.data() + at, filled - at, batch)) > 0; at += size)
+		{
+			columns.Append(batch);
+		}
+		std::memmove(buffer.data(), buffer.data() + at, filled - at);
+		filled -= at;
+
+		// what is left must be the start of a batch the next chunk completes
+		ok = !(end && filled > 0) && filled < buffer.size();
+	}
+	std::fclose(file);
+	if (!ok)
+	{
+		std::fprintf(stderr, "corrupt batch after %lld batches in %s\n", (long long)columns.batches, path.c_str());
+	}
+	return ok;
+}
+
+static bool DecodeRecording(const SessionRecordingReader& recording, TelemetryColumns& columns, int64_t& bytes)
+{
+	MarkerTelemetryBatch batch;
+	for (size_t i = 0; i < recording.Count(RecordStream::Markers); i++)
+	{
+		RecordView record;
+		if (!recording.Get(RecordStream::Markers, i, record))
+		{
+			return false;
+		}
+		if (record.format != RecordFormat::MarkerTelemetry)
+		{
+			continue;
+		}
+		if (DecodeMarkerTelemetry(record.data, record.size, batch) != record.size)
+		{
+			std::fprintf(stderr, "corrupt batch at %lld\n", (long long)record.timestamp);
+			return false;
+		}
+		columns.Append(batch);
+		bytes += int64_t(record.size);
+	}
+	return true;
+}
+
+// frames of markers at random poses, ids from a 4x4_50 dictionary
+static std::vector<uint8_t> Synthetic(int frames, int markersPerFrame, double& encodeUs)
+{
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> position(-1.f, 1.f), angle(-3.f, 3.f);
+	std::vector<uint8_t> encoded;
+	MarkerTelemetryBatch batch;
+	double seconds = 0.0;
+	for (int f = 0; f < frames; f++)
+	{
+		batch.frameSequence = f;
+		batch.timestamp = 133000000000000000ll + int64_t(f) * 333333;
+		batch.cameraToWorld[3] = position(random);
+		batch.markers.resize(size_t(markersPerFrame));
+		for (size_t m = 0; m < batch.markers.size(); m++)
+		{
+			MarkerTelemetry& marker = batch.markers[m];
+			marker.id = int32_t(m % 50);
+			marker.tvec[0] = position(random);
+			marker.tvec[1] = position(random);
+			marker.tvec[2] = 0.5f + 2.f * std::abs(position(random));
+			marker.rvec[0] = angle(random);
+			marker.rvec[1] = angle(random);
+			marker.rvec[2] = angle(random);
+			marker.reprojectionError = 0.5f * std::abs(position(random));
+		}
+
+		auto t1 = Clock::now();
+		EncodeMarkerTelemetry(batch, encoded);
+		seconds += std::chrono::duration<double>(Clock::now() - t1).count();
+	}
+	encodeUs = frames > 0 ? seconds * 1e6 / frames : 0.0;
+	return encoded;
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> arguments(argv + 1, argv + argc);
+	const bool synthetic = !arguments.empty() && arguments[0] == "--synthetic";
+	if (arguments.size() < 2)
+	{
+		std::fprintf(stderr, "usage: %s <telemetry.bin | recording | session dir> <output dir>\n"
+			"       %s --synthetic [frames] [markers per frame] <output dir>\n", argv[0], argv[0]);
+		return 1;
+	}
+	const std::string output = arguments.back();
+	std::error_code error;
+	std::filesystem::create_directories(output, error);
+
+	TelemetryColumns columns(output);
+	bool ok = true;
+	int64_t bytes = 0;
+	double encodeUs = 0.0;
+	auto t1 = Clock::now();
+	if (synthetic)
+	{
+		int frames = std::max(1, arguments.size() > 2 ? std::atoi(arguments[1].c_str()) : 10000);
+		int markersPerFrame = std::clamp(arguments.size() > 3 ? std::atoi(arguments[2].c_str()) : 20, 0, int(kMaxTelemetryRecords));
+		std::vector<uint8_t> encoded = Synthetic(frames, markersPerFrame, encodeUs);
+		t1 = Clock::now();
+		MarkerTelemetryBatch batch;
+		size_t at = 0;
+		for (size_t size; (size = DecodeMarkerTelemetry(encoded.data() + at, encoded.size() - at, batch)) > 0; at += size)
+		{
+			columns.Append(batch);
+		}
+		ok = at == encoded.size();
+		bytes = int64_t(encoded.size());
+	}
+	else
+	{
+		// a directory holds telemetry.bin, or a recording with the batches in it
+		std::filesystem::path input = arguments[0];
+		if (std::filesystem::is_directory(input))
+		{
+			input = std::filesystem::exists(input / "telemetry.bin") ? input / "telemetry.bin" : input / "session.hl2rec";
+		}
+		SessionRecordingReader recording;
+		ok = recording.Open(input.string()) ? DecodeRecording(recording, columns, bytes) : DecodeFile(input.string(), columns, bytes);
+	}
+	ok = columns.Close() && ok;
+	double seconds = std::chrono::duration<double>(Clock::now() - t1).count();
+
+	// framing of a 't' message per batch, as sent
+	int64_t sent = bytes + 5 * columns.batches;
+	std::printf("batches,markers,bytes_sent,bytes_per_marker,text_bytes,text_ratio,encode_us_per_batch,decode_mb_s,markers_per_s\n");
+	std::printf("%lld,%lld,%lld,%.1f,%lld,%.2f,%.2f,%.1f,%.0f\n", (long long)columns.batches, (long long)columns.markers,
+		(long long)sent, columns.markers > 0 ? double(sent) / double(columns.markers) : 0.0, (long long)columns.textBytes,
+		sent > 0 ? double(columns.textBytes) / double(sent) : 0.0, encodeUs, seconds > 0.0 ? bytes / seconds / 1e6 : 0.0,
+		seconds > 0.0 ? columns.markers / seconds : 0.0);
+	std::fprintf(stderr, "%lld markers of %lld frames in %s\n", (long long)columns.markers, (long long)columns.batches, output.c_str());
+	return ok ? 0 : 1;
+}
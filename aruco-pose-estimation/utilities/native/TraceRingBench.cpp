@@ -0,0 +1,251 @@
+// Measures the cost of a trace scope with tracing off & on, then records from
+// several threads at once into a small ring while a reader keeps taking
+// snapshots and checks them: no event may be torn (fields of two different
+// events), a snapshot never holds more than the capacity and, once the
+// writers are done, it holds exactly the newest events. Enabling again with
+// other capacities while they record must reallocate the ring safely. The Chrome trace JSON
+// of a short synthetic pipeline is checked for balance & written to a file.
+//
+// Build on Linux (one command):
+//   g++ -O2 -std=c++17 -pthread -I../../projects/common -o TraceRingBench TraceRingBench.cpp
+//       ../../projects/common/TraceRing.cpp
+//
+// Usage:
+//   ./TraceRingBench [events per thread] [threads] [trace.json]
+// Exits with 1 if an event is torn, lost or the JSON is malformed.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "TraceRing.h"
+
+using namespace HoloLens2CV;
+using Clock = std::chrono::steady_clock;
+
+static const char* const kNames[4] = { "acquire", "detect", "pnp", "publish" };
+
+// every field follows from begin & the thread, a torn event breaks the relation
+static TraceEvent Synthetic(uint32_t thread, int64_t n)
+{
+	TraceEvent event;
+	event.name = kNames[n & 3];
+	event.begin = n * 16 + thread;
+	event.end = event.begin + 1000 + thread;
+	event.thread = thread;
+	event.sequence = n;
+	event.timestamp = ~event.begin;
+	return event;
+}
+
+static bool Intact(const TraceEvent& event)
+{
+	if (event.thread == 0 || event.sequence < 0)
+	{
+		return false;
+	}
+	TraceEvent expected = Synthetic(event.thread, event.sequence);
+	return event.name == expected.name && event.begin == expected.begin && event.end == expected.end && event.timestamp == expected.timestamp;
+}
+
+static double ScopeCost(int count)
+{
+	auto t1 = Clock::now();
+	for (int i = 0; i < count; i++)
+	{
+		TraceScope scope(kNames[i & 3]);
+	}
+	return std::chrono::duration<double, std::nano>(Clock::now() - t1).count() / count;
+}
+
+int main(int argc, char** argv)
+{
+	const int events = argc > 1 ? std::atoi(argv[1]) : 1000000;
+	const int threads = std::max(1, argc > 2 ? std::atoi(argv[2]) : 4);
+	const char* tracePath = argc > 3 ? argv[3] : nullptr;
+	bool ok = true;
+
+	// off, the scope must cost next to nothing; on, one clock read on each end & the slot
+	TraceRing& global = TraceRing::Global();
+	double off = ScopeCost(events);
+	global.Enable(1 << 16);
+	double on = ScopeCost(events);
+	global.Disable();
+	std::printf("trace scope: off %.1f ns, on %.1f ns\n", off, on);
+
+	// writers overwrite a small ring many times over while the snapshots run
+	const size_t capacity = 4096;
+	TraceRing ring;
+	ring.Enable(capacity);
+	std::vector<std::thread> writers;
+	auto t1 = Clock::now();
+	for (int t = 0; t < threads; t++)
+	{
+		writers.emplace_back([&, t]()
+			{
+				for (int64_t n = 0; n < events; n++)
+				{
+					ring.Record(Synthetic(uint32_t(t + 1), n));
+				}
+			});
+	}
+	int64_t snapshots = 0;
+	int64_t checked = 0;
+	bool intact = true;
+	bool bounded = true;
+	for (int i = 0; i < 200; i++)
+	{
+		std::vector<TraceEvent> snapshot = ring.Snapshot();
+		bounded = bounded && snapshot.size() <= capacity;
+		for (const TraceEvent& event : snapshot)
+		{
+			intact = intact && Intact(event);
+		}
+		checked += int64_t(snapshot.size());
+		snapshots++;
+	}
+	for (std::thread& writer : writers)
+	{
+		writer.join();
+	}
+	double seconds = std::chrono::duration<double>(Clock::now() - t1).count();
+
+	// quiet again: the newest capacity events, of each thread an unbroken run up to its last
+	// one (a thread done early may have been overwritten completely)
+	std::vector<TraceEvent> last = ring.Snapshot();
+	bool full = last.size() == capacity && ring.Recorded() == uint64_t(events) * uint64_t(threads);
+	std::vector<int64_t> previous(threads + 1, -1);
+	bool newest = true;
+	for (const TraceEvent& event : last)
+	{
+		int64_t& before = previous[event.thread <= uint32_t(threads) ? event.thread : 0];
+		newest = newest && (before < 0 || event.sequence == before + 1);
+		before = event.sequence;
+	}
+	for (int t = 1; t <= threads; t++)
+	{
+		newest = newest && (previous[t] < 0 || previous[t] == events - 1);
+	}
+	newest = newest && previous[0] < 0 && std::count(previous.begin(), previous.end(), events - 1) > 0;
+	for (const TraceEvent& event : last)
+	{
+		intact = intact && Intact(event);
+	}
+	bool sorted = std::is_sorted(last.begin(), last.end(), [](const TraceEvent& a, const TraceEvent& b) { return a.begin < b.begin; });
+	std::printf("%d threads, %.1f ns per record, %lld snapshots with %lld events taken meanwhile\n", threads,
+		seconds * 1e9 / double(events), (long long)snapshots, (long long)checked);
+
+	// enabling again starts an empty trace
+	ring.Enable(capacity);
+	bool cleared = ring.Snapshot().empty() && ring.Recorded() == 0;
+
+	// enabling with another capacity while the writers record reallocates the ring under them
+	std::atomic_bool resizing = true;
+	writers.clear();
+	for (int t = 0; t < threads; t++)
+	{
+		writers.emplace_back([&, t]()
+			{
+				for (int64_t n = 0; resizing; n++)
+				{
+					ring.Record(Synthetic(uint32_t(t + 1), n));
+				}
+			});
+	}
+	bool resized = true;
+	for (int i = 0; i < 200; i++)
+	{
+		size_t size = size_t(256) << (i % 6);
+		ring.Enable(size);
+		std::this_thread::yield();
+		std::vector<TraceEvent> snapshot = ring.Snapshot();
+		resized = resized && snapshot.size() <= size;
+		for (const TraceEvent& event : snapshot)
+		{
+			intact = intact && Intact(event);
+		}
+	}
+	resizing = false;
+	for (std::thread& writer : writers)
+	{
+		writer.join();
+	}
+
+	// a few frames of a pipeline on two named threads, as the plugin dumps them
+	global.Enable(1 << 16);
+	std::thread detection([&]()
+		{
+			global.NameThread("detection \"worker\"");
+			for (int frame = 0; frame < 8; frame++)
+			{
+				TraceFrame trace(frame, 1000000LL * frame);
+				TraceScope process("process");
+				TraceScope detect("detect");
+			}
+		});
+	detection.join();
+	{
+		global.NameThread("acquisition");
+		TraceScope acquire("acquire");
+	}
+	global.Disable();
+	std::string json = global.ToChromeJson();
+
+	int depth = 0;
+	bool inString = false;
+	bool balanced = true;
+	for (size_t i = 0; i < json.size(); i++)
+	{
+		char c = json[i];
+		if (inString)
+		{
+			if (c == '\\')
+			{
+				i++;
+			}
+			else if (c == '"')
+			{
+				inString = false;
+			}
+			continue;
+		}
+		inString = c == '"';
+		depth += (c == '{' || c == '[') ? 1 : (c == '}' || c == ']') ? -1 : 0;
+		balanced = balanced && depth >= 0;
+	}
+	balanced = balanced && depth == 0 && !inString;
+	auto count = [&](const char* text)
+	{
+		size_t n = 0;
+		for (size_t at = json.find(text); at != std::string::npos; at = json.find(text, at + 1))
+		{
+			n++;
+		}
+		return n;
+	};
+	bool complete = count("\"ph\":\"X\"") == 17 && count("\"ph\":\"M\"") == 2 && count("\"frame\":") == 16;
+	std::printf("chrome trace: %zu bytes, %zu events, %zu thread names\n", json.size(), count("\"ph\":\"X\""), count("\"ph\":\"M\""));
+
+	if (tracePath != nullptr)
+	{
+		FILE* file = std::fopen(tracePath, "wb");
+		bool written = file != nullptr && std::fwrite(json.data(), 1, json.size(), file) == json.size();
+		if (file != nullptr)
+		{
+			std::fclose(file);
+		}
+		std::printf("%s %s\n", written ? "written to" : "cannot write", tracePath);
+	}
+
+	std::printf("intact %s, bounded %s, full %s, newest %s, sorted %s, cleared %s, resized %s, json %s\n",
+		intact ? "ok" : "FAILED", bounded ? "ok" : "FAILED", full ? "ok" : "FAILED", newest ? "ok" : "FAILED",
+		sorted ? "ok" : "FAILED", cleared ? "ok" : "FAILED", resized ? "ok" : "FAILED", balanced && complete ? "ok" : "FAILED");
+
+	ok = intact && bounded && full && newest && sorted && cleared && resized && balanced && complete;
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+// Runs a recorded camera sequence through a detector session with the
+// tracking mode off (full image every frame) and on (regions around the
+// previous markers, full image every reacquireInterval frames or on loss).
+// Reports the per-frame latency of both runs and how many detections the
+// tracking run missed compared to the full image run.
+// The recorded frames carry no camera poses, so regions are searched around
+// the previous corners without motion prediction.
+//
+// Build on Linux (one command):
+//   g++ -O2 -std=c++17 -I../../projects/common -o TrackingBench TrackingBench.cpp
+//       ../../projects/common/ArUcoDetectorSession.cpp ../../projects/common/UndistortionTable.cpp ../../projects/common/FileFrameSource.cpp
+//       $(pkg-config --cflags --libs opencv4)
+//
+// Usage:
+//   ./TrackingBench <image dir> <fx> <fy> <cx> <cy> [dictId] [markerLength] [reacquireInterval]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "ArUcoDetectorSession.h"
+#include "FileFrameSource.h"
+
+using namespace HoloLens2CV;
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char** argv)
+{
+	if (argc < 6)
+	{
+		std::fprintf(stderr, "usage: %s <image dir> <fx> <fy> <cx> <cy> [dictId] [markerLength] [reacquireInterval]\n", argv[0]);
+		return 1;
+	}
+
+	CameraIntrinsics intrinsics;
+	intrinsics.fx = std::strtof(argv[2], nullptr);
+	intrinsics.fy = std::strtof(argv[3], nullptr);
+	intrinsics.cx = std::strtof(argv[4], nullptr);
+	intrinsics.cy = std::strtof(argv[5], nullptr);
+	int dictId = argc > 6 ? std::atoi(argv[6]) : 0;
+	float markerLength = argc > 7 ? std::strtof(argv[7], nullptr) : 0.05f;
+
+	TrackingSettings tracking;
+	tracking.enabled = true;
+	tracking.reacquireInterval = argc > 8 ? std::atoi(argv[8]) : tracking.reacquireInterval;
+
+	FileFrameSource source(argv[1]);
+	std::vector<cv::Mat> frames;
+	cv::Mat gray;
+	int64_t ts;
+	while (source.Next(gray, ts))
+	{
+		frames.push_back(gray.clone());
+	}
+	if (frames.empty())
+	{
+		std::fprintf(stderr, "no frames found in %s\n", argv[1]);
+		return 1;
+	}
+
+	ArUcoDetectorSession fullSession, trackingSession;
+	for (ArUcoDetectorSession* session : { &fullSession, &trackingSession })
+	{
+		session->Configure(dictId, markerLength);
+		session->SetCameraIntrinsics(intrinsics);
+	}
+	trackingSession.ConfigureTracking(tracking);
+
+	std::vector<MarkerPose> fullMarkers, trackedMarkers;
+	std::vector<double> fullUs, trackedUs;
+	size_t fullDetections = 0, missed = 0;
+	for (const cv::Mat& frame : frames)
+	{
+		auto t1 = Clock::now();
+		fullSession.Process(frame, fullMarkers);
+		auto t2 = Clock::now();
+		trackingSession.Process(frame, trackedMarkers);
+		auto t3 = Clock::now();
+
+		fullUs.push_back(std::chrono::duration<double, std::micro>(t2 - t1).count());
+		trackedUs.push_back(std::chrono::duration<double, std::micro>(t3 - t2).count());
+
+		fullDetections += fullMarkers.size();
+		for (const MarkerPose& marker : fullMarkers)
+		{
+			bool found = std::any_of(trackedMarkers.begin(), trackedMarkers.end(),
+				[&marker](const MarkerPose& tracked) { return tracked.id == marker.id; });
+			missed += found ? 0 : 1;
+		}
+	}
+
+	auto report = [](const char* name, std::vector<double>& us) {
+		std::sort(us.begin(), us.end());
+		double mean = 0;
+		for (double v : us)
+		{
+			mean += v;
+		}
+		mean /= us.size();
+		std::printf("%-9s mean %8.1f us, p50 %8.1f us, p95 %8.1f us\n", name, mean, us[us.size() / 2], us[us.size() * 95 / 100]);
+	};
+
+	TrackingStats stats = trackingSession.GetTrackingStats();
+	std::printf("frames: %zu, detections (full image): %zu, missed by tracking: %zu\n", frames.size(), fullDetections, missed);
+	std::printf("full scans: %lld, region scans: %lld, lost: %lld\n",
+		(long long)stats.fullScans, (long long)stats.regionScans, (long long)stats.lost);
+	report("full:", fullUs);
+	report("tracking:", trackedUs);
+	return 0;
+}
@@ -0,0 +1,100 @@
+// Contention stress run for the lock-free frame publication used by
+// GetLFCameraBuffer / GetRFCameraBuffer. A writer publishes 640x480 frames
+// as fast as it can while a reader keeps polling and copying the latest one,
+// like Unity does every frame. Every frame is filled with its sequence number,
+// so a torn (partially written) frame is detected by the reader.
+//
+// Build on Linux (one command):
+//   g++ -O2 -std=c++17 -pthread -I../../projects/common -o TripleBufferStress TripleBufferStress.cpp
+//
+// Usage:
+//   ./TripleBufferStress [seconds]
+// Exits with 1 if a torn or out of order frame was observed.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "FrontCamerasFrame.h"
+#include "TripleBuffer.h"
+
+using namespace HoloLens2CV;
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char** argv)
+{
+	const int seconds = argc > 1 ? std::atoi(argv[1]) : 5;
+	const int width = 640, height = 480;
+
+	TripleBuffer<CameraFrame> publisher;
+	std::atomic_bool running = true;
+
+	uint64_t published = 0;
+	double maxPublishUs = 0;
+
+	std::thread writer([&] {
+		std::vector<uint8_t> source(size_t(width) * height);
+		while (running)
+		{
+			published++;
+			std::memset(source.data(), int(published & 0xff), source.size());
+
+			auto t1 = Clock::now();
+			CameraFrame& frame = publisher.WriteBuffer();
+			frame.hostTicks = published;
+			frame.timestamp = int64_t(published);
+			frame.width = width;
+			frame.height = height;
+			frame.image.assign(source.begin(), source.end());
+			publisher.Publish();
+			auto t2 = Clock::now();
+
+			maxPublishUs = std::max(maxPublishUs, std::chrono::duration<double, std::micro>(t2 - t1).count());
+		}
+	});
+
+	uint64_t reads = 0, fresh = 0, torn = 0, outOfOrder = 0, lastSeen = 0;
+	std::vector<uint8_t> copy;
+	auto end = Clock::now() + std::chrono::seconds(seconds);
+	while (Clock::now() < end)
+	{
+		bool updated = publisher.Update();
+		const CameraFrame& frame = publisher.ReadBuffer();
+		reads++;
+		if (frame.image.empty())
+		{
+			continue;
+		}
+
+		// same copy the WinRT getter does into the com_array
+		copy.assign(frame.image.begin(), frame.image.end());
+
+		uint8_t expected = uint8_t(frame.hostTicks & 0xff);
+		if (std::any_of(copy.begin(), copy.end(), [expected](uint8_t v) { return v != expected; }))
+		{
+			torn++;
+		}
+		if (updated)
+		{
+			fresh++;
+			if (frame.hostTicks <= lastSeen)
+			{
+				outOfOrder++;
+			}
+			lastSeen = frame.hostTicks;
+		}
+	}
+	running = false;
+	writer.join();
+
+	std::printf("published: %llu, reads: %llu, new frames read: %llu\n",
+		(unsigned long long)published, (unsigned long long)reads, (unsigned long long)fresh);
+	std::printf("writer max publish time: %.1f us\n", maxPublishUs);
+	std::printf("torn frames: %llu, out of order: %llu\n", (unsigned long long)torn, (unsigned long long)outOfOrder);
+	return torn == 0 && outOfOrder == 0 ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+// Accuracy and cost of the precomputed undistortion table against
+// cv::undistortPoints for random sub-pixel points of a 640x480 VLC like
+// camera, plus the one-off build time and the full image undistorted view.
+//
+// Build on Linux (one command):
+//   g++ -O2 -std=c++17 -I../../projects/common -o UndistortionBench UndistortionBench.cpp
+//       ../../projects/common/UndistortionTable.cpp $(pkg-config --cflags --libs opencv4)
+//
+// Usage:
+//   ./UndistortionBench [fx fy cx cy k1 k2 p1 p2 k3]
+// Exits with 1 if a table lookup is further than 1e-4 (normalized units, ~0.05 px) from undistortPoints.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "UndistortionTable.h"
+
+using namespace HoloLens2CV;
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char** argv)
+{
+	// defaults are in the range of the HoloLens 2 front VLC cameras
+	double p[9] = { 450, 450, 320, 240, -0.12, 0.03, 0.0005, -0.0003, 0 };
+	for (int i = 1; i < argc && i <= 9; i++)
+	{
+		p[i - 1] = std::strtod(argv[i], nullptr);
+	}
+	cv::Mat cameraMatrix(cv::Matx33d(p[0], 0, p[2], 0, p[1], p[3], 0, 0, 1));
+	cv::Mat distortionCoefficients(cv::Matx<double, 1, 5>(p[4], p[5], p[6], p[7], p[8]));
+	const cv::Size imageSize(640, 480);
+
+	UndistortionTable table;
+	auto t1 = Clock::now();
+	table.Build(cameraMatrix, distortionCoefficients, imageSize);
+	auto t2 = Clock::now();
+
+	// 4 corners per marker, as solvePnP sees them
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> ux(0.f, float(imageSize.width - 1)), uy(0.f, float(imageSize.height - 1));
+	std::vector<cv::Point2f> points(4000), reference, lookedUp(points.size());
+	for (cv::Point2f& point : points)
+	{
+		point = cv::Point2f(ux(rng), uy(rng));
+	}
+
+	auto t3 = Clock::now();
+	for (size_t i = 0; i < points.size(); i += 4)
+	{
+		std::vector<cv::Point2f> corners(points.begin() + i, points.begin() + i + 4), normalized;
+		cv::undistortPoints(corners, normalized, cameraMatrix, distortionCoefficients);
+		reference.insert(reference.end(), normalized.begin(), normalized.end());
+	}
+	auto t4 = Clock::now();
+	for (size_t i = 0; i < points.size(); i++)
+	{
+		lookedUp[i] = table.Normalize(points[i]);
+	}
+	auto t5 = Clock::now();
+
+	double maxError = 0, meanError = 0;
+	for (size_t i = 0; i < points.size(); i++)
+	{
+		cv::Point2f d = lookedUp[i] - reference[i];
+		double e = std::sqrt(d.dot(d));
+		maxError = std::max(maxError, e);
+		meanError += e / points.size();
+	}
+
+	cv::Mat image(imageSize, CV_8U, cv::Scalar(128)), undistorted;
+	table.Undistort(image, undistorted);    // builds the remap tables
+	auto t6 = Clock::now();
+	table.Undistort(image, undistorted);
+	auto t7 = Clock::now();
+
+	auto us = [](Clock::time_point a, Clock::time_point b) { return std::chrono::duration<double, std::micro>(b - a).count(); };
+	std::printf("table build: %.1f ms (%dx%d)\n", us(t1, t2) / 1000.0, imageSize.width, imageSize.height);
+	std::printf("undistortPoints: %.3f us/point, table: %.3f us/point\n", us(t3, t4) / points.size(), us(t4, t5) / points.size());
+	std::printf("table error: mean %.2e, max %.2e (normalized), max %.3f px\n", meanError, maxError, maxError * p[0]);
+	std::printf("full image undistort: %.1f us\n", us(t6, t7));
+	return maxError < 1e-4 ? 0 : 1;
+}